@@ -87,6 +87,31 @@ public:
   /// multiple times with the same fleet_name and add a robot using whichever
   /// handle has the traits and navigation graph that match the robot.
   ///
+  /// The planner of the fleet can be adjusted with these node parameters:
+  /// - planner_statistics: Collect search statistics and log them each time a
+  ///   robot of the fleet finds a plan.
+  /// - planner_incremental_replanning: Reuse the previous plan of a robot when
+  ///   it replans.
+  /// - planner_precompute_heuristics: Compute the heuristics for every waypoint
+  ///   of the graph in the background as soon as the fleet is added.
+  /// - planner_precompute_goal_orientations: The goal orientations, in radians,
+  ///   whose heuristics should also be precomputed.
+  /// - planner_precomputation_threads: How many threads to precompute with.
+  ///   Zero means the hardware concurrency.
+  /// - planner_heuristic_landmarks: How many landmark waypoints the heuristics
+  ///   should use.
+  /// - planner_heuristic_cache_budget: A limit, in bytes, on the memory of the
+  ///   heuristic caches. Zero means there is no limit.
+  /// - planner_heuristic_cache_directory: A directory to keep the heuristic
+  ///   cache of each fleet in. The cache is loaded from
+  ///   <directory>/<fleet_name>.heuristics when the fleet is added, and saved
+  ///   there when the Adapter is destroyed. When the same fleet_name is added
+  ///   more than once, the n-th repeat uses
+  ///   <directory>/<fleet_name>.<n>.heuristics instead.
+  ///
+  /// See rmf_traffic::agv::Planner::Configuration and
+  /// rmf_traffic::agv::Planner::Options for details.
+  ///
   /// \param[in] fleet_name
   ///   The name of the fleet that is being added.
   ///
@@ -351,7 +351,12 @@ private:
         continue;
       }
 
-      const auto result = _planner->plan(starts, goal->index());
+      // The starts are independent of each other, so each one can be searched
+      // on its own thread.
+      auto options = _planner->get_default_options();
+      options.parallel_starts(0);
+
+      const auto result = _planner->plan(starts, goal->index(), options);
       if (!result)
       {
         RCLCPP_ERROR(
@@ -25,6 +25,7 @@
 #include <rmf_traffic_ros2/schedule/Negotiation.hpp>
 #include <rmf_traffic_ros2/schedule/Writer.hpp>
 #include <rmf_traffic_ros2/blockade/Writer.hpp>
+#include <rmf_traffic_ros2/Trajectory.hpp>
 
 #include "internal_TrafficLight.hpp"
 #include "internal_EasyTrafficLight.hpp"
@@ -54,6 +55,112 @@ private:
   rxcpp::schedulers::worker _worker;
 };
 
+//==============================================================================
+/// The node parameters that adjust the planners of the fleets
+struct PlannerParameters
+{
+  bool statistics = false;
+  bool incremental_replanning = false;
+  bool precompute_heuristics = false;
+  std::vector<double> precompute_goal_orientations = {};
+  std::size_t precomputation_threads = 0;
+  std::size_t heuristic_landmarks = 0;
+  rmf_utils::optional<std::size_t> heuristic_cache_budget = rmf_utils::nullopt;
+  rmf_utils::optional<std::string> heuristic_cache_directory =
+      rmf_utils::nullopt;
+
+  static PlannerParameters load(rclcpp::Node& node)
+  {
+    PlannerParameters parameters;
+    parameters.statistics =
+        get_parameter_or_default(node, "planner_statistics", false);
+
+    parameters.incremental_replanning = get_parameter_or_default(
+          node, "planner_incremental_replanning", false);
+
+    parameters.precompute_heuristics = get_parameter_or_default(
+          node, "planner_precompute_heuristics", false);
+
+    parameters.precompute_goal_orientations = node.declare_parameter(
+          "planner_precompute_goal_orientations", std::vector<double>());
+    if (!parameters.precompute_goal_orientations.empty())
+    {
+      std::string yaws;
+      for (const double yaw : parameters.precompute_goal_orientations)
+        yaws += " " + std::to_string(yaw);
+
+      RCLCPP_INFO(
+        node.get_logger(),
+        "Parameter [planner_precompute_goal_orientations] set to:" + yaws);
+    }
+
+    parameters.precomputation_threads = non_negative(
+          node, "planner_precomputation_threads", 0);
+
+    parameters.heuristic_landmarks = non_negative(
+          node, "planner_heuristic_landmarks", 0);
+
+    // A budget of zero means that the heuristic caches are not limited
+    if (const auto budget =
+        non_negative(node, "planner_heuristic_cache_budget", 0))
+    {
+      parameters.heuristic_cache_budget = budget;
+    }
+
+    const std::string directory = node.declare_parameter(
+          "planner_heuristic_cache_directory", std::string());
+    if (!directory.empty())
+    {
+      RCLCPP_INFO(
+        node.get_logger(),
+        "Parameter [planner_heuristic_cache_directory] set to: " + directory);
+      parameters.heuristic_cache_directory = directory;
+    }
+
+    return parameters;
+  }
+
+  /// Get the file that the heuristic cache of a fleet's planner is kept in.
+  /// Each planner gets its own file, because a cache is only valid for the
+  /// graph and vehicle traits that it was made with. The same fleet_name may
+  /// be added several times with different graphs or traits, so index is the
+  /// number of times that fleet_name had already been added.
+  rmf_utils::optional<std::string> heuristic_cache_file(
+      const std::string& fleet_name,
+      const std::size_t index) const
+  {
+    if (!heuristic_cache_directory)
+      return rmf_utils::nullopt;
+
+    const std::string name = index == 0 ?
+          fleet_name : fleet_name + "." + std::to_string(index);
+
+    return *heuristic_cache_directory + "/" + name + ".heuristics";
+  }
+
+private:
+
+  static std::size_t non_negative(
+      rclcpp::Node& node,
+      const std::string& param_name,
+      const int64_t default_value)
+  {
+    const int64_t value =
+        get_parameter_or_default(node, param_name, default_value);
+
+    if (value < 0)
+    {
+      RCLCPP_WARN(
+        node.get_logger(),
+        "Parameter [" + param_name + "] must not be negative. We will use "
+        + std::to_string(default_value) + " instead.");
+      return static_cast<std::size_t>(default_value);
+    }
+
+    return static_cast<std::size_t>(value);
+  }
+};
+
 //==============================================================================
 class Adapter::Implementation
 {
@@ -66,6 +173,16 @@ public:
   std::shared_ptr<rmf_traffic_ros2::blockade::Writer> blockade_writer;
   rmf_traffic_ros2::schedule::MirrorManager mirror_manager;
 
+  PlannerParameters planner_parameters;
+
+  // The planners whose heuristic caches will be saved when the adapter is
+  // destroyed, along with the file that each one is saved to.
+  std::vector<std::pair<std::shared_ptr<rmf_traffic::agv::Planner>,
+    std::string>> cached_planners;
+
+  // How many times each fleet name has been added
+  std::unordered_map<std::string, std::size_t> fleet_name_count;
+
   std::vector<std::shared_ptr<FleetUpdateHandle>> fleets = {};
 
   // TODO(MXG): This mutex probably isn't needed
@@ -104,6 +221,19 @@ public:
     // Do nothing
   }
 
+  ~Implementation()
+  {
+    for (const auto& [planner, filename] : cached_planners)
+    {
+      if (!planner->save_heuristic_cache(filename))
+      {
+        RCLCPP_WARN(
+          node->get_logger(),
+          "Failed to save the planner heuristic cache to [" + filename + "]");
+      }
+    }
+  }
+
   static rmf_utils::unique_impl_ptr<Implementation> make(
       const std::string& node_name,
       const rclcpp::NodeOptions& node_options,
@@ -127,6 +257,10 @@ public:
           get_parameter_or_default_time(*node, "discovery_timeout", 60.0);
     }
 
+    auto planner_parameters = PlannerParameters::load(*node);
+
+    rmf_traffic_ros2::declare_trajectory_encoding(*node);
+
     auto mirror_future = rmf_traffic_ros2::schedule::make_mirror(
           *node, rmf_traffic::schedule::query_all());
 
@@ -160,12 +294,18 @@ public:
               *node, mirror_manager.snapshot_handle(),
               std::make_shared<WorkerWrapper>(worker));
 
-        return rmf_utils::make_unique_impl<Implementation>(
+        // Only receive the negotiation traffic of our own participants
+        negotiation->scoped_delivery(true);
+
+        auto pimpl = rmf_utils::make_unique_impl<Implementation>(
                 worker,
                 std::move(node),
                 std::move(negotiation),
                 std::make_shared<ParticipantFactoryRos2>(std::move(writer)),
                 std::move(mirror_manager));
+
+        pimpl->planner_parameters = std::move(planner_parameters);
+        return pimpl;
       }
     }
 
@@ -209,11 +349,33 @@ std::shared_ptr<FleetUpdateHandle> Adapter::add_fleet(
     rmf_traffic::agv::VehicleTraits traits,
     rmf_traffic::agv::Graph navigation_graph)
 {
+  const auto& parameters = _pimpl->planner_parameters;
+
+  rmf_traffic::agv::Planner::Configuration config(
+        std::move(navigation_graph), std::move(traits));
+  config
+      .precompute_goal_orientations(parameters.precompute_goal_orientations)
+      .precomputation_threads(parameters.precomputation_threads)
+      .heuristic_landmarks(parameters.heuristic_landmarks)
+      .heuristic_cache_budget(parameters.heuristic_cache_budget);
+
+  if (parameters.precompute_heuristics)
+    config.precompute_heuristics(std::vector<std::size_t>());
+
+  const auto cache_file = parameters.heuristic_cache_file(
+        fleet_name, _pimpl->fleet_name_count[fleet_name]++);
+  config.heuristic_cache_file(cache_file);
+
+  rmf_traffic::agv::Planner::Options options(nullptr);
+  options
+      .collect_statistics(parameters.statistics)
+      .incremental_replanning(parameters.incremental_replanning);
+
   auto planner = std::make_shared<rmf_traffic::agv::Planner>(
-        rmf_traffic::agv::Planner::Configuration(
-          std::move(navigation_graph),
-          std::move(traits)),
-        rmf_traffic::agv::Planner::Options(nullptr));
+        std::move(config), std::move(options));
+
+  if (cache_file)
+    _pimpl->cached_planners.emplace_back(planner, *cache_file);
 
   auto fleet = FleetUpdateHandle::Implementation::make(
         fleet_name, std::move(planner), _pimpl->node, _pimpl->worker,
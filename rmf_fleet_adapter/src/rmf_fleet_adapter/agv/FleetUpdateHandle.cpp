@@ -743,11 +743,24 @@ std::size_t FleetUpdateHandle::Implementation::get_nearest_charger(
 {
   assert(!charging_waypoints.empty());
   const auto& graph = planner->get_configuration().graph();
-  Eigen::Vector2d p = graph.get_waypoint(start.waypoint()).get_location();
+  const auto& start_wp = graph.get_waypoint(start.waypoint());
+  Eigen::Vector2d p = start_wp.get_location();
 
   if (start.location().has_value())
     p = *start.location();
 
+  // Prefer the nearest charger on the same map as the robot, which the spatial
+  // index of the graph can find without checking every charger.
+  const auto nearest_on_map = graph.find_nearest_waypoint(
+        start_wp.get_map_name(), p,
+        [&charging_waypoints](const rmf_traffic::agv::Graph::Waypoint& wp)
+  {
+    return charging_waypoints.count(wp.index()) > 0;
+  });
+
+  if (nearest_on_map.has_value())
+    return *nearest_on_map;
+
   double min_dist = std::numeric_limits<double>::max();
   std::size_t nearest_charger = 0;
   for (const auto& wp : charging_waypoints)
@@ -24,9 +24,42 @@
 
 #include <rmf_traffic/schedule/StubbornNegotiator.hpp>
 
+#include <string>
+
 namespace rmf_fleet_adapter {
 namespace phases {
 
+namespace {
+//==============================================================================
+std::string describe(
+  const rmf_traffic::agv::Planner::SearchStatistics& stats)
+{
+  const auto ms = [](const rmf_traffic::Duration d)
+  {
+    return std::to_string(rmf_traffic::time::to_seconds(d) * 1000.0) + "ms";
+  };
+
+  std::string output =
+      "expanded nodes: " + std::to_string(stats.expanded_nodes)
+      + " | queued nodes: " + std::to_string(stats.queued_nodes)
+      + " | validator calls: " + std::to_string(stats.validator_calls)
+      + " (" + ms(stats.validator_time) + ")"
+      + " | traversal generations: "
+      + std::to_string(stats.traversal_generations)
+      + " | setup: " + ms(stats.setup_time)
+      + " | search: " + ms(stats.search_time)
+      + " | reconstruction: " + ms(stats.reconstruction_time);
+
+  for (const auto& layer : stats.heuristic_lookups)
+  {
+    output += " | " + layer.name + " hits/misses: "
+        + std::to_string(layer.hits) + "/" + std::to_string(layer.misses);
+  }
+
+  return output;
+}
+} // anonymous namespace
+
 //==============================================================================
 auto GoToPlace::Active::observe() const -> const rxcpp::observable<StatusMsg>&
 {
@@ -243,6 +276,15 @@ void GoToPlace::Active::find_plan()
       return;
     }
 
+    if (const auto* stats = result.statistics())
+    {
+      RCLCPP_INFO(
+        phase->_context->node()->get_logger(),
+        "Planner statistics for [%s]: %s",
+        phase->_context->requester_id().c_str(),
+        describe(*stats).c_str());
+    }
+
     phase->execute_plan(*std::move(result));
     phase->_find_path_service = nullptr;
   });
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <src/rmf_traffic/Spline.hpp>
+#include <src/rmf_traffic/geometry/ShapeInternal.hpp>
+
+#include <rmf_traffic/DetectConflict.hpp>
+#include <rmf_traffic/geometry/Circle.hpp>
+
+#ifdef RMF_TRAFFIC__USING_FCL_0_6
+#include <fcl/narrowphase/continuous_collision.h>
+using FclContinuousCollisionRequest = fcl::ContinuousCollisionRequestd;
+using FclContinuousCollisionResult = fcl::ContinuousCollisionResultd;
+using FclContinuousCollisionObject = fcl::ContinuousCollisionObjectd;
+#else
+#include <fcl/continuous_collision.h>
+using FclContinuousCollisionRequest = fcl::ContinuousCollisionRequest;
+using FclContinuousCollisionResult = fcl::ContinuousCollisionResult;
+using FclContinuousCollisionObject = fcl::ContinuousCollisionObject;
+#endif
+
+#include <chrono>
+#include <iostream>
+#include <random>
+
+using namespace std::chrono_literals;
+
+//==============================================================================
+template<typename F>
+double time_per_call_us(const std::size_t count, const F& f)
+{
+  const auto begin = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < count; ++i)
+    f(i);
+  const auto finish = std::chrono::steady_clock::now();
+
+  return std::chrono::duration_cast<
+    std::chrono::duration<double, std::micro>>(finish - begin).count()
+    / static_cast<double>(count);
+}
+
+//==============================================================================
+/// Compare the analytic circle-vs-circle check against FCL's continuous
+/// collision detection on randomly generated pairs of spline segments.
+int main(int argc, char* argv[])
+{
+  const std::size_t num_pairs = argc > 1 ? std::stoul(argv[1]) : 10000;
+  const double radius = 0.5;
+
+  const auto circle = rmf_traffic::geometry::make_final_convex<
+    rmf_traffic::geometry::Circle>(radius);
+  const rmf_traffic::Profile profile{circle};
+
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<double> position(-5.0, 5.0);
+  std::uniform_real_distribution<double> velocity(-1.0, 1.0);
+  const auto random_waypoint = [&]()
+    {
+      return std::make_pair(
+        Eigen::Vector3d{position(rng), position(rng), 0.0},
+        Eigen::Vector3d{velocity(rng), velocity(rng), 0.0});
+    };
+
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<rmf_traffic::Trajectory> trajectories;
+  for (std::size_t i = 0; i < 2*num_pairs; ++i)
+  {
+    rmf_traffic::Trajectory trajectory;
+    const auto wp0 = random_waypoint();
+    const auto wp1 = random_waypoint();
+    trajectory.insert(start, wp0.first, wp0.second);
+    trajectory.insert(start + 10s, wp1.first, wp1.second);
+    trajectories.emplace_back(std::move(trajectory));
+  }
+
+  std::vector<rmf_traffic::Spline> splines;
+  for (const auto& trajectory : trajectories)
+    splines.emplace_back(++trajectory.begin());
+
+  const auto finish = start + 10s;
+  std::vector<char> analytic_results(num_pairs);
+  const double analytic_us = time_per_call_us(
+    num_pairs, [&](const std::size_t i)
+    {
+      const rmf_traffic::DistanceDifferential differential(
+        splines[2*i], splines[2*i+1]);
+      analytic_results[i] =
+        differential.first_time_within(2.0*radius).has_value();
+    });
+
+  const auto collision =
+    rmf_traffic::geometry::FinalConvexShape::Implementation::get_collision(
+    *circle);
+
+  FclContinuousCollisionRequest request;
+  request.ccd_solver_type = fcl::CCDC_CONSERVATIVE_ADVANCEMENT;
+  request.gjk_solver_type = fcl::GST_LIBCCD;
+
+  std::vector<char> fcl_results(num_pairs);
+  const double fcl_us = time_per_call_us(
+    num_pairs, [&](const std::size_t i)
+    {
+      const auto motion_a = std::make_shared<rmf_traffic::FclSplineMotion>(
+        splines[2*i].to_fcl(start, finish));
+      const auto motion_b = std::make_shared<rmf_traffic::FclSplineMotion>(
+        splines[2*i+1].to_fcl(start, finish));
+
+      const FclContinuousCollisionObject obj_a(collision, motion_a);
+      const FclContinuousCollisionObject obj_b(collision, motion_b);
+
+      FclContinuousCollisionResult result;
+      fcl::collide(&obj_a, &obj_b, request, result);
+      fcl_results[i] = result.is_collide;
+    });
+
+  const double between_us = time_per_call_us(
+    num_pairs, [&](const std::size_t i)
+    {
+      rmf_traffic::DetectConflict::between(
+        profile, trajectories[2*i], profile, trajectories[2*i+1]);
+    });
+
+  std::size_t conflicts = 0;
+  std::size_t disagreements = 0;
+  for (std::size_t i = 0; i < num_pairs; ++i)
+  {
+    if (analytic_results[i])
+      ++conflicts;
+
+    if (analytic_results[i] != fcl_results[i])
+      ++disagreements;
+  }
+
+  std::cout << "Spline pairs: " << num_pairs
+            << " | Collisions: " << conflicts
+            << " | Disagreements with FCL: " << disagreements << "\n"
+            << "Analytic circle check: " << analytic_us << " us per pair\n"
+            << "FCL continuous collision: " << fcl_us << " us per pair\n"
+            << "DetectConflict::between: " << between_us << " us per pair"
+            << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic/agv/Planner.hpp>
+#include <rmf_traffic/agv/debug/debug_Planner.hpp>
+#include <rmf_traffic/geometry/Circle.hpp>
+#include <rmf_traffic/schedule/Database.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <new>
+
+using namespace std::chrono_literals;
+
+//==============================================================================
+// Count every heap allocation made by the process
+std::atomic_size_t allocation_count(0);
+
+void* operator new(std::size_t size)
+{
+  ++allocation_count;
+  if (void* ptr = std::malloc(size == 0 ? 1 : size))
+    return ptr;
+
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+//==============================================================================
+/// The "DP1 Graph" from test_Planner.cpp
+rmf_traffic::agv::Graph make_dp1_graph()
+{
+  const std::string map = "test_map";
+  rmf_traffic::agv::Graph graph;
+  const std::vector<Eigen::Vector2d> locations = {
+    {12, -12}, {18, -12}, {-10, -8}, {-2, -8}, {3, -8}, {12, -8}, {18, -8},
+    {-15, -4}, {-10, -4}, {-2, -4}, {3, -4}, {6, -4}, {9, -4}, {-15, 0},
+    {-10, 0}, {0, 0}, {3, 0.1}, {6, 0}, {9, 0}, {15, 0}, {18, 0}, {-2, 4},
+    {3, 4}, {6, 4}, {9, 4}, {15, 4}, {18, 4}, {-15, 8}, {-10, 8}, {3, 8},
+    {6, 8}, {15, 8}, {18, 8}
+  };
+
+  for (const auto& location : locations)
+    graph.add_waypoint(map, location);
+
+  const std::vector<std::pair<std::size_t, std::size_t>> lanes = {
+    {0, 1}, {2, 3}, {4, 5}, {5, 6}, {7, 8}, {8, 9}, {10, 11}, {11, 12},
+    {13, 14}, {14, 15}, {15, 16}, {16, 17}, {17, 18}, {21, 22}, {23, 24},
+    {24, 25}, {25, 26}, {0, 5}, {2, 8}, {4, 10}, {8, 14}, {10, 16}, {11, 17},
+    {12, 18}, {13, 27}, {14, 28}, {16, 22}, {17, 23}, {19, 25}, {20, 26},
+    {22, 29}, {23, 30}, {25, 31}, {26, 32}
+  };
+
+  for (const auto& lane : lanes)
+  {
+    graph.add_lane(lane.first, lane.second);
+    graph.add_lane(lane.second, lane.first);
+  }
+
+  return graph;
+}
+
+//==============================================================================
+/// Put obstacles on the schedule that sit on the lanes of the shortest paths so
+/// that the planner has to search around them or wait for them.
+void add_obstacles(
+  rmf_traffic::schedule::Database& database,
+  const rmf_traffic::Profile& profile,
+  const rmf_traffic::Time time)
+{
+  const auto obstacle = database.register_participant(
+    rmf_traffic::schedule::ParticipantDescription{
+      "obstacle",
+      "benchmark",
+      rmf_traffic::schedule::ParticipantDescription::Rx::Unresponsive,
+      profile
+    });
+
+  const std::vector<std::pair<Eigen::Vector3d, Eigen::Vector3d>> blocks = {
+    {{-10, 8, -M_PI_2}, {-10, -8, -M_PI_2}},
+    {{3, 0, M_PI_2}, {3, 8, M_PI_2}},
+    {{9, 4, 0}, {18, 4, 0}},
+    {{6, -4, M_PI_2}, {6, 8, M_PI_2}}
+  };
+
+  rmf_traffic::schedule::Writer::Input input;
+  for (std::size_t i = 0; i < blocks.size(); ++i)
+  {
+    rmf_traffic::Trajectory trajectory;
+    trajectory.insert(time, blocks[i].first, Eigen::Vector3d::Zero());
+    trajectory.insert(time + 60s, blocks[i].second, Eigen::Vector3d::Zero());
+    input.push_back(
+      {
+        static_cast<rmf_traffic::RouteId>(i),
+        std::make_shared<rmf_traffic::Route>("test_map", std::move(trajectory))
+      });
+  }
+
+  database.set(obstacle.id(), input, 0);
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+  const std::size_t repetitions = argc > 1 ? std::stoul(argv[1]) : 10;
+
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(1.0)
+  };
+
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4}, {1.0, 0.5}, profile};
+
+  const auto time = std::chrono::steady_clock::now();
+  const auto database = std::make_shared<rmf_traffic::schedule::Database>();
+  add_obstacles(*database, profile, time);
+
+  const rmf_traffic::agv::Planner planner{
+    rmf_traffic::agv::Planner::Configuration{make_dp1_graph(), traits},
+    rmf_traffic::agv::Planner::Options{
+      rmf_traffic::agv::ScheduleRouteValidator::make(
+        database, std::numeric_limits<std::size_t>::max(), profile)
+    }
+  };
+
+  const std::vector<std::pair<std::size_t, std::size_t>> problems = {
+    {1, 30}, {7, 20}, {2, 32}, {27, 6}, {13, 31}
+  };
+
+  for (const auto& problem : problems)
+  {
+    const rmf_traffic::agv::Planner::Start start{time, problem.first, 0.0};
+    const rmf_traffic::agv::Planner::Goal goal{problem.second};
+
+    // Run once to fill the heuristic caches so they do not pollute the counts
+    planner.plan(start, goal);
+
+    std::size_t nodes = 0;
+    const std::size_t initial_allocations = allocation_count;
+    const auto begin = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < repetitions; ++i)
+    {
+      const auto result = planner.plan(start, goal);
+      nodes = rmf_traffic::agv::Planner::Debug::node_count(result);
+    }
+    const auto finish = std::chrono::steady_clock::now();
+
+    const double allocations =
+      static_cast<double>(allocation_count - initial_allocations)
+      / static_cast<double>(repetitions);
+
+    const double ms = std::chrono::duration_cast<
+      std::chrono::duration<double, std::milli>>(finish - begin).count()
+      / static_cast<double>(repetitions);
+
+    std::cout << problem.first << " -> " << problem.second
+              << " | Nodes: " << nodes
+              << " | Allocations per plan: " << allocations
+              << " | Time per plan: " << ms << " ms" << std::endl;
+  }
+
+  return 0;
+}
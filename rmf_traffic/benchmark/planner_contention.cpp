@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic/agv/Planner.hpp>
+#include <rmf_traffic/geometry/Circle.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+//==============================================================================
+/// A square grid of waypoints with bidirectional lanes between neighbors
+rmf_traffic::agv::Graph make_grid(const std::size_t N)
+{
+  rmf_traffic::agv::Graph graph;
+  for (std::size_t i = 0; i < N; ++i)
+  {
+    for (std::size_t j = 0; j < N; ++j)
+      graph.add_waypoint("test_map", {5.0*i, 5.0*j});
+  }
+
+  for (std::size_t i = 0; i < N; ++i)
+  {
+    for (std::size_t j = 0; j < N; ++j)
+    {
+      const std::size_t wp = i*N + j;
+      if (i+1 < N)
+      {
+        graph.add_lane(wp, wp + N);
+        graph.add_lane(wp + N, wp);
+      }
+
+      if (j+1 < N)
+      {
+        graph.add_lane(wp, wp + 1);
+        graph.add_lane(wp + 1, wp);
+      }
+    }
+  }
+
+  return graph;
+}
+
+//==============================================================================
+/// Have a number of threads plan at the same time with one shared Planner so
+/// that they all read from and write into the same heuristic caches. The first
+/// pass has every thread filling the caches at once. The second pass has every
+/// thread reading from caches that are already warm.
+int main(int argc, char* argv[])
+{
+  const std::size_t num_threads = argc > 1 ? std::stoul(argv[1]) : 8;
+  const std::size_t plans_per_thread = argc > 2 ? std::stoul(argv[2]) : 20;
+  const std::size_t grid_size = argc > 3 ? std::stoul(argv[3]) : 12;
+
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(1.0)
+  };
+
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4}, {1.0, 0.5}, profile};
+
+  const rmf_traffic::agv::Planner planner{
+    rmf_traffic::agv::Planner::Configuration{make_grid(grid_size), traits},
+    rmf_traffic::agv::Planner::Options{nullptr}
+  };
+
+  const std::size_t num_waypoints = grid_size*grid_size;
+  std::vector<std::vector<std::pair<std::size_t, std::size_t>>> problems;
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<std::size_t> pick(0, num_waypoints - 1);
+  for (std::size_t t = 0; t < num_threads; ++t)
+  {
+    problems.emplace_back();
+    for (std::size_t i = 0; i < plans_per_thread; ++i)
+      problems.back().push_back({pick(rng), pick(rng)});
+  }
+
+  const auto time = std::chrono::steady_clock::now();
+  for (const std::string pass : {"Cold", "Warm"})
+  {
+    std::vector<double> worst_ms(num_threads, 0.0);
+    std::vector<std::thread> threads;
+    const auto begin = std::chrono::steady_clock::now();
+    for (std::size_t t = 0; t < num_threads; ++t)
+    {
+      threads.emplace_back(
+        [&, t]()
+        {
+          for (const auto& problem : problems[t])
+          {
+            const auto plan_begin = std::chrono::steady_clock::now();
+            planner.plan({time, problem.first, 0.0}, problem.second);
+            const double ms = std::chrono::duration_cast<
+              std::chrono::duration<double, std::milli>>(
+              std::chrono::steady_clock::now() - plan_begin).count();
+
+            worst_ms[t] = std::max(worst_ms[t], ms);
+          }
+        });
+    }
+
+    for (auto& thread : threads)
+      thread.join();
+
+    const double total_ms = std::chrono::duration_cast<
+      std::chrono::duration<double, std::milli>>(
+      std::chrono::steady_clock::now() - begin).count();
+
+    const double plans = static_cast<double>(num_threads * plans_per_thread);
+    std::cout << pass << " | Threads: " << num_threads
+              << " | Plans: " << plans
+              << " | Wall time: " << total_ms << " ms"
+              << " | Plans per second: " << 1000.0 * plans / total_ms
+              << " | Worst plan: "
+              << *std::max_element(worst_ms.begin(), worst_ms.end())
+              << " ms" << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "utils_SyntheticMaps.hpp"
+
+#include <rmf_traffic/agv/Planner.hpp>
+#include <rmf_traffic/geometry/Circle.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+//==============================================================================
+/// Plan between random waypoints on different floors of a synthetic building,
+/// once with the default heuristics and once for each number of landmarks.
+/// Every configuration gets a fresh Planner so that each plan is a first-time
+/// plan towards its goal, which is when the heuristics matter the most.
+int main(int argc, char* argv[])
+{
+  const std::size_t floors = argc > 1 ? std::stoul(argv[1]) : 5;
+  const std::size_t grid_size = argc > 2 ? std::stoul(argv[2]) : 15;
+  const std::size_t num_plans = argc > 3 ? std::stoul(argv[3]) : 20;
+
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(1.0)
+  };
+
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4}, {1.0, 0.5}, profile};
+
+  const auto graph = make_building(floors*grid_size*grid_size, floors);
+  const std::size_t per_floor = grid_size*grid_size;
+
+  std::vector<std::pair<std::size_t, std::size_t>> problems;
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<std::size_t> pick_floor(0, floors - 1);
+  std::uniform_int_distribution<std::size_t> pick_wp(0, per_floor - 1);
+  while (problems.size() < num_plans)
+  {
+    const std::size_t f0 = pick_floor(rng);
+    const std::size_t f1 = pick_floor(rng);
+    if (f0 == f1)
+      continue;
+
+    const std::size_t start = f0*per_floor + pick_wp(rng);
+    const std::size_t goal = f1*per_floor + pick_wp(rng);
+    problems.push_back({start, goal});
+  }
+
+  std::cout << "Floors: " << floors << " | Waypoints: "
+            << graph.num_waypoints() << " | Lanes: " << graph.num_lanes()
+            << " | Plans: " << num_plans << std::endl;
+
+  const auto time = std::chrono::steady_clock::now();
+  for (const std::size_t landmarks : {0, 2, 4, 8, 16})
+  {
+    const auto setup_begin = std::chrono::steady_clock::now();
+    const rmf_traffic::agv::Planner planner{
+      rmf_traffic::agv::Planner::Configuration{graph, traits}
+      .heuristic_landmarks(landmarks),
+      rmf_traffic::agv::Planner::Options{nullptr}
+    };
+    const double setup_ms = std::chrono::duration_cast<
+      std::chrono::duration<double, std::milli>>(
+      std::chrono::steady_clock::now() - setup_begin).count();
+
+    double total_ms = 0.0;
+    double worst_ms = 0.0;
+    double total_cost = 0.0;
+    for (const auto& problem : problems)
+    {
+      const auto plan_begin = std::chrono::steady_clock::now();
+      const auto plan = planner.plan(
+        {time, problem.first, 0.0}, problem.second);
+      const double ms = std::chrono::duration_cast<
+        std::chrono::duration<double, std::milli>>(
+        std::chrono::steady_clock::now() - plan_begin).count();
+
+      total_ms += ms;
+      worst_ms = std::max(worst_ms, ms);
+      if (plan)
+        total_cost += plan->get_cost();
+    }
+
+    std::cout << (landmarks == 0 ? "Euclidean" : "Landmarks")
+              << " | Landmarks: " << landmarks
+              << " | Setup: " << setup_ms << " ms"
+              << " | Mean plan: " << total_ms / num_plans << " ms"
+              << " | Worst plan: " << worst_ms << " ms"
+              << " | Total cost: " << total_cost << std::endl;
+  }
+
+  return 0;
+}
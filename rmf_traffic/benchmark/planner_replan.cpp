@@ -0,0 +1,302 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic/agv/Planner.hpp>
+#include <rmf_traffic/agv/debug/debug_Planner.hpp>
+#include <rmf_traffic/geometry/Circle.hpp>
+#include <rmf_traffic/schedule/Database.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <optional>
+
+using namespace std::chrono_literals;
+
+//==============================================================================
+/// The "DP1 Graph" from test_Planner.cpp
+rmf_traffic::agv::Graph make_dp1_graph()
+{
+  const std::string map = "test_map";
+  rmf_traffic::agv::Graph graph;
+  const std::vector<Eigen::Vector2d> locations = {
+    {12, -12}, {18, -12}, {-10, -8}, {-2, -8}, {3, -8}, {12, -8}, {18, -8},
+    {-15, -4}, {-10, -4}, {-2, -4}, {3, -4}, {6, -4}, {9, -4}, {-15, 0},
+    {-10, 0}, {0, 0}, {3, 0.1}, {6, 0}, {9, 0}, {15, 0}, {18, 0}, {-2, 4},
+    {3, 4}, {6, 4}, {9, 4}, {15, 4}, {18, 4}, {-15, 8}, {-10, 8}, {3, 8},
+    {6, 8}, {15, 8}, {18, 8}
+  };
+
+  for (const auto& location : locations)
+    graph.add_waypoint(map, location);
+
+  const std::vector<std::pair<std::size_t, std::size_t>> lanes = {
+    {0, 1}, {2, 3}, {4, 5}, {5, 6}, {7, 8}, {8, 9}, {10, 11}, {11, 12},
+    {13, 14}, {14, 15}, {15, 16}, {16, 17}, {17, 18}, {21, 22}, {23, 24},
+    {24, 25}, {25, 26}, {0, 5}, {2, 8}, {4, 10}, {8, 14}, {10, 16}, {11, 17},
+    {12, 18}, {13, 27}, {14, 28}, {16, 22}, {17, 23}, {19, 25}, {20, 26},
+    {22, 29}, {23, 30}, {25, 31}, {26, 32}
+  };
+
+  for (const auto& lane : lanes)
+  {
+    graph.add_lane(lane.first, lane.second);
+    graph.add_lane(lane.second, lane.first);
+  }
+
+  return graph;
+}
+
+//==============================================================================
+/// Put obstacles on the schedule that sit on the lanes of the shortest paths so
+/// that the planner has to search around them or wait for them.
+void add_obstacles(
+  rmf_traffic::schedule::Database& database,
+  const rmf_traffic::Profile& profile,
+  const rmf_traffic::Time time)
+{
+  const auto obstacle = database.register_participant(
+    rmf_traffic::schedule::ParticipantDescription{
+      "obstacle",
+      "benchmark",
+      rmf_traffic::schedule::ParticipantDescription::Rx::Unresponsive,
+      profile
+    });
+
+  const std::vector<std::pair<Eigen::Vector3d, Eigen::Vector3d>> blocks = {
+    {{-10, 8, -M_PI_2}, {-10, -8, -M_PI_2}},
+    {{3, 0, M_PI_2}, {3, 8, M_PI_2}},
+    {{9, 4, 0}, {18, 4, 0}},
+    {{6, -4, M_PI_2}, {6, 8, M_PI_2}}
+  };
+
+  rmf_traffic::schedule::Writer::Input input;
+  for (std::size_t i = 0; i < blocks.size(); ++i)
+  {
+    rmf_traffic::Trajectory trajectory;
+    trajectory.insert(time, blocks[i].first, Eigen::Vector3d::Zero());
+    trajectory.insert(time + 60s, blocks[i].second, Eigen::Vector3d::Zero());
+    input.push_back(
+      {
+        static_cast<rmf_traffic::RouteId>(i),
+        std::make_shared<rmf_traffic::Route>("test_map", std::move(trajectory))
+      });
+  }
+
+  database.set(obstacle.id(), input, 0);
+}
+
+//==============================================================================
+struct Totals
+{
+  double ms = 0.0;
+  std::size_t expansions = 0;
+  std::size_t reused = 0;
+};
+
+//==============================================================================
+double time_replan(
+  const rmf_traffic::agv::Planner::Result& previous,
+  const rmf_traffic::agv::Planner::Start& start,
+  const rmf_traffic::agv::Planner::Options& options,
+  const std::size_t repetitions,
+  Totals& totals,
+  std::optional<double>& cost)
+{
+  const auto begin = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < repetitions; ++i)
+  {
+    const auto result = previous.replan(start, options);
+    if (i+1 < repetitions)
+      continue;
+
+    totals.expansions +=
+      rmf_traffic::agv::Planner::Debug::expansion_count(result);
+    totals.reused += result.reused_node_count();
+    if (result)
+      cost = result->get_cost();
+  }
+
+  const double ms = std::chrono::duration_cast<
+    std::chrono::duration<double, std::milli>>(
+    std::chrono::steady_clock::now() - begin).count()
+    / static_cast<double>(repetitions);
+
+  totals.ms += ms;
+  return ms;
+}
+
+//==============================================================================
+void print(const std::string& label, const Totals& totals, std::size_t count)
+{
+  const double n = static_cast<double>(count);
+  std::cout << "   " << label
+            << " | Time per replan: " << totals.ms / n << " ms"
+            << " | Expansions per replan: "
+            << static_cast<double>(totals.expansions) / n
+            << " | Reused nodes per replan: "
+            << static_cast<double>(totals.reused) / n << std::endl;
+}
+
+//==============================================================================
+/// Replan along the plans of the "DP1 Graph" from test_Planner.cpp, once from
+/// scratch and once incrementally. The first case has the robot replanning
+/// from each waypoint that it reaches along its previous plan. The second case
+/// has the robot replanning from the same start after a new schedule entry has
+/// appeared.
+int main(int argc, char* argv[])
+{
+  const std::size_t repetitions = argc > 1 ? std::stoul(argv[1]) : 10;
+
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(1.0)
+  };
+
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4}, {1.0, 0.5}, profile};
+
+  const auto time = std::chrono::steady_clock::now();
+  const auto database = std::make_shared<rmf_traffic::schedule::Database>();
+  add_obstacles(*database, profile, time);
+
+  const rmf_traffic::agv::Planner planner{
+    rmf_traffic::agv::Planner::Configuration{make_dp1_graph(), traits},
+    rmf_traffic::agv::Planner::Options{
+      rmf_traffic::agv::ScheduleRouteValidator::make(
+        database, std::numeric_limits<std::size_t>::max(), profile)
+    }
+  };
+
+  const auto scratch_options = planner.get_default_options();
+  auto incremental_options = scratch_options;
+  incremental_options.incremental_replanning(true);
+
+  const std::vector<std::pair<std::size_t, std::size_t>> problems = {
+    {1, 30}, {7, 20}, {2, 32}, {27, 6}, {13, 31}
+  };
+
+  const auto intruder = database->register_participant(
+    rmf_traffic::schedule::ParticipantDescription{
+      "intruder",
+      "benchmark",
+      rmf_traffic::schedule::ParticipantDescription::Rx::Unresponsive,
+      profile
+    });
+  rmf_traffic::schedule::ItineraryVersion intruder_version = 0;
+  rmf_traffic::RouteId intruder_route = 0;
+
+  std::size_t mismatches = 0;
+  for (const auto& problem : problems)
+  {
+    const rmf_traffic::agv::Planner::Start start{time, problem.first, 0.0};
+    const auto first = planner.plan(start, problem.second, incremental_options);
+    if (!first)
+    {
+      std::cout << problem.first << " -> " << problem.second
+                << " | No plan found" << std::endl;
+      continue;
+    }
+
+    std::cout << problem.first << " -> " << problem.second << std::endl;
+
+    // Replan from every waypoint that the plan arrives at
+    Totals scratch_totals;
+    Totals incremental_totals;
+    std::size_t count = 0;
+    std::optional<std::size_t> last_index;
+    for (const auto& wp : first->get_waypoints())
+    {
+      if (!wp.graph_index() || wp.graph_index() == last_index)
+        continue;
+
+      last_index = wp.graph_index();
+      if (*last_index == problem.second)
+        continue;
+
+      const rmf_traffic::agv::Planner::Start moved{
+        wp.time(), *last_index, wp.position()[2]};
+
+      std::optional<double> scratch_cost;
+      std::optional<double> incremental_cost;
+      time_replan(
+        first, moved, scratch_options, repetitions,
+        scratch_totals, scratch_cost);
+      time_replan(
+        first, moved, incremental_options, repetitions,
+        incremental_totals, incremental_cost);
+
+      if (scratch_cost.has_value() != incremental_cost.has_value()
+        || (scratch_cost && 1e-6 < std::abs(*scratch_cost - *incremental_cost)))
+        ++mismatches;
+
+      ++count;
+    }
+
+    if (count > 0)
+    {
+      std::cout << " Moving along the plan (" << count << " starts)"
+                << std::endl;
+      print("Scratch    ", scratch_totals, count);
+      print("Incremental", incremental_totals, count);
+    }
+
+    // Put a brief new entry on the schedule where the plan reaches the last
+    // waypoint before its goal, then replan from the original start.
+    const auto& waypoints = first->get_waypoints();
+    auto blocked = waypoints.end() - 1;
+    while (blocked != waypoints.begin()
+      && (!blocked->graph_index() || blocked->graph_index() == problem.second))
+      --blocked;
+
+    rmf_traffic::Trajectory trajectory;
+    trajectory.insert(
+      blocked->time() - 2s, blocked->position(), Eigen::Vector3d::Zero());
+    trajectory.insert(
+      blocked->time() + 2s, blocked->position(), Eigen::Vector3d::Zero());
+    database->set(
+      intruder.id(),
+      {{intruder_route++, std::make_shared<rmf_traffic::Route>(
+            "test_map", std::move(trajectory))}},
+      intruder_version++);
+
+    Totals scratch_changed;
+    Totals incremental_changed;
+    std::optional<double> scratch_cost;
+    std::optional<double> incremental_cost;
+    time_replan(
+      first, start, scratch_options, repetitions,
+      scratch_changed, scratch_cost);
+    time_replan(
+      first, start, incremental_options, repetitions,
+      incremental_changed, incremental_cost);
+
+    if (scratch_cost.has_value() != incremental_cost.has_value()
+      || (scratch_cost && 1e-6 < std::abs(*scratch_cost - *incremental_cost)))
+      ++mismatches;
+
+    std::cout << " New schedule entry along the plan" << std::endl;
+    print("Scratch    ", scratch_changed, 1);
+    print("Incremental", incremental_changed, 1);
+
+    database->erase(intruder.id(), intruder_version++);
+  }
+
+  std::cout << "Replans with a different cost: " << mismatches << std::endl;
+  return 0;
+}
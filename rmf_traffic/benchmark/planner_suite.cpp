@@ -0,0 +1,287 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "utils_SyntheticMaps.hpp"
+
+#include <rmf_traffic/agv/Planner.hpp>
+#include <rmf_traffic/geometry/Circle.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <string>
+#include <vector>
+
+//==============================================================================
+// Track the number of heap bytes in use by the process, and the peak since the
+// last reset. Each allocation is prefixed with its size so that it can be
+// subtracted again when it is freed.
+std::atomic_size_t heap_bytes(0);
+std::atomic_size_t peak_heap_bytes(0);
+
+constexpr std::size_t header_size = alignof(std::max_align_t);
+
+void* operator new(std::size_t size)
+{
+  void* const raw = std::malloc(size + header_size);
+  if (!raw)
+    throw std::bad_alloc();
+
+  *static_cast<std::size_t*>(raw) = size;
+  const std::size_t current = heap_bytes += size;
+  std::size_t peak = peak_heap_bytes.load();
+  while (peak < current
+    && !peak_heap_bytes.compare_exchange_weak(peak, current))
+  {
+    // Keep trying until the peak is at least as high as the current usage
+  }
+
+  return static_cast<char*>(raw) + header_size;
+}
+
+void operator delete(void* ptr) noexcept
+{
+  if (!ptr)
+    return;
+
+  void* const raw = static_cast<char*>(ptr) - header_size;
+  heap_bytes -= *static_cast<std::size_t*>(raw);
+  std::free(raw);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  operator delete(ptr);
+}
+
+//==============================================================================
+struct Samples
+{
+  std::vector<double> values;
+
+  void add(double value)
+  {
+    values.push_back(value);
+  }
+
+  double percentile(double p) const
+  {
+    if (values.empty())
+      return 0.0;
+
+    auto sorted = values;
+    std::sort(sorted.begin(), sorted.end());
+    const std::size_t i = static_cast<std::size_t>(
+      std::round(p*static_cast<double>(sorted.size() - 1)));
+    return sorted[i];
+  }
+
+  double mean() const
+  {
+    if (values.empty())
+      return 0.0;
+
+    double total = 0.0;
+    for (const double v : values)
+      total += v;
+
+    return total / static_cast<double>(values.size());
+  }
+
+  double max() const
+  {
+    return values.empty() ? 0.0 :
+      *std::max_element(values.begin(), values.end());
+  }
+
+  void print(std::ostream& out, const std::string& name) const
+  {
+    out << "\"" << name << "\":{\"mean\":" << mean()
+        << ",\"p50\":" << percentile(0.5)
+        << ",\"p95\":" << percentile(0.95)
+        << ",\"max\":" << max() << "}";
+  }
+};
+
+//==============================================================================
+double ms_since(const std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(
+    std::chrono::steady_clock::now() - start).count();
+}
+
+//==============================================================================
+struct Scenario
+{
+  std::string map;
+  std::function<rmf_traffic::agv::Graph(std::size_t)> make_graph;
+};
+
+//==============================================================================
+/// Plan between random waypoints of synthetic warehouse, hospital and
+/// multi-floor building maps of increasing size, with and without obstacle
+/// participants on the schedule. Each scenario gets a fresh Planner, so its
+/// first plans pay for filling the heuristic caches, the same as a fleet that
+/// has just started up.
+///
+/// The search statistics of the planner are turned on to count expansions and
+/// route validations, and the peak heap usage of each plan is recorded.
+///
+/// Each scenario prints one line of JSON to stdout.
+///
+/// Arguments: plans per scenario, number of obstacles, largest map size,
+/// saturation limit, random seed
+int main(int argc, char* argv[])
+{
+  const std::size_t num_plans = argc > 1 ? std::stoul(argv[1]) : 10;
+  const std::size_t num_obstacles = argc > 2 ? std::stoul(argv[2]) : 10;
+  const std::size_t max_size = argc > 3 ? std::stoul(argv[3]) : 10000;
+  const std::size_t saturation_limit =
+    argc > 4 ? std::stoul(argv[4]) : 100000;
+  const auto seed = static_cast<std::mt19937::result_type>(
+    argc > 5 ? std::stoul(argv[5]) : 42);
+
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(0.5)
+  };
+
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4}, {1.0, 0.5}, profile};
+
+  const std::vector<Scenario> scenarios = {
+    {"warehouse", make_warehouse},
+    {"hospital", make_hospital},
+    {"building", [](std::size_t n) { return make_building(n, 4); }}
+  };
+
+  std::vector<std::size_t> obstacle_counts = {0};
+  if (num_obstacles > 0)
+    obstacle_counts.push_back(num_obstacles);
+
+  for (const auto& scenario : scenarios)
+  {
+    for (const std::size_t size : {100, 1000, 10000})
+    {
+      if (size > max_size)
+        continue;
+
+      for (const std::size_t obstacles : obstacle_counts)
+      {
+        // The problems get their own generator so that they are the same
+        // with and without obstacles
+        std::mt19937 problem_rng(seed);
+        std::mt19937 obstacle_rng(seed + 1);
+
+        const auto graph = scenario.make_graph(size);
+        const auto problems = make_problems(graph, num_plans, problem_rng);
+
+        const auto time = std::chrono::steady_clock::now();
+        const auto database =
+          std::make_shared<rmf_traffic::schedule::Database>();
+        add_wandering_obstacles(
+          *database, graph, profile, obstacles, time, obstacle_rng);
+
+        const auto validator = rmf_traffic::agv::ScheduleRouteValidator::make(
+          database, std::numeric_limits<std::size_t>::max(), profile);
+
+        rmf_traffic::agv::Planner::Options options{validator};
+        options.saturation_limit(saturation_limit);
+        options.collect_statistics(true);
+
+        const auto setup_begin = std::chrono::steady_clock::now();
+        const rmf_traffic::agv::Planner planner{
+          rmf_traffic::agv::Planner::Configuration{graph, traits}, options};
+        const double setup_ms = ms_since(setup_begin);
+
+        std::size_t solved = 0;
+        std::size_t saturated = 0;
+        Samples latency;
+        Samples expansions;
+        Samples validator_calls;
+        Samples validator_ms;
+        Samples heuristic_misses;
+        Samples peak_bytes;
+        for (const auto& problem : problems)
+        {
+          const rmf_traffic::agv::Planner::Start start{
+            time, problem.first, 0.0};
+          const rmf_traffic::agv::Planner::Goal goal{problem.second};
+
+          const std::size_t baseline_bytes = heap_bytes;
+          peak_heap_bytes = baseline_bytes;
+          const auto plan_begin = std::chrono::steady_clock::now();
+          const auto result = planner.plan(start, goal);
+          latency.add(ms_since(plan_begin));
+          peak_bytes.add(
+            static_cast<double>(peak_heap_bytes - baseline_bytes));
+
+          const auto& stats = *result.statistics();
+          expansions.add(static_cast<double>(stats.expanded_nodes));
+          validator_calls.add(static_cast<double>(stats.validator_calls));
+          validator_ms.add(
+            rmf_traffic::time::to_seconds(stats.validator_time) * 1000.0);
+
+          std::size_t misses = 0;
+          for (const auto& layer : stats.heuristic_lookups)
+            misses += layer.misses;
+
+          heuristic_misses.add(static_cast<double>(misses));
+
+          if (result)
+            ++solved;
+
+          if (result.saturated())
+            ++saturated;
+        }
+
+        const auto cache = planner.heuristic_cache_statistics();
+
+        std::cout << "{\"map\":\"" << scenario.map << "\""
+                  << ",\"waypoints\":" << graph.num_waypoints()
+                  << ",\"lanes\":" << graph.num_lanes()
+                  << ",\"obstacles\":" << obstacles
+                  << ",\"seed\":" << seed
+                  << ",\"plans\":" << problems.size()
+                  << ",\"solved\":" << solved
+                  << ",\"saturated\":" << saturated
+                  << ",\"setup_ms\":" << setup_ms << ",";
+        latency.print(std::cout, "latency_ms");
+        std::cout << ",";
+        expansions.print(std::cout, "expansions");
+        std::cout << ",";
+        validator_calls.print(std::cout, "validator_calls");
+        std::cout << ",";
+        validator_ms.print(std::cout, "validator_ms");
+        std::cout << ",";
+        heuristic_misses.print(std::cout, "heuristic_misses");
+        std::cout << ",";
+        peak_bytes.print(std::cout, "peak_heap_bytes");
+        std::cout << ",\"heuristic_cache_bytes\":" << cache.estimated_bytes
+                  << "}" << std::endl;
+      }
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,292 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TRAFFIC__BENCHMARK__UTILS_SYNTHETICMAPS_HPP
+#define RMF_TRAFFIC__BENCHMARK__UTILS_SYNTHETICMAPS_HPP
+
+#include <rmf_traffic/agv/Graph.hpp>
+#include <rmf_traffic/schedule/Database.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+//==============================================================================
+// Generators for synthetic navigation graphs and schedule traffic. Everything
+// here is driven by a std::mt19937, whose output sequence is fixed by the
+// standard, so the same seed produces the same maps and traffic on every
+// platform. std::uniform_int_distribution is implementation-defined, so it is
+// deliberately avoided.
+
+//==============================================================================
+/// Pick a number in [0, n) from the generator
+inline std::size_t pick(std::mt19937& rng, const std::size_t n)
+{
+  return static_cast<std::size_t>(rng()) % n;
+}
+
+//==============================================================================
+inline void add_bidir_lane(
+  rmf_traffic::agv::Graph& graph,
+  const std::size_t i,
+  const std::size_t j)
+{
+  graph.add_lane(i, j);
+  graph.add_lane(j, i);
+}
+
+//==============================================================================
+/// A warehouse floor with roughly the requested number of waypoints, laid out
+/// as a rectangular grid with 2.5m spacing. Every column is an aisle, but the
+/// aisles are only connected to each other by cross aisles at every tenth row
+/// and at both ends, like the gaps between rows of shelves.
+///
+/// Waypoint (row r, column c) has the index r*columns + c.
+inline rmf_traffic::agv::Graph make_warehouse(const std::size_t num_waypoints)
+{
+  const std::size_t columns = std::max<std::size_t>(
+    2, static_cast<std::size_t>(std::ceil(std::sqrt(num_waypoints))));
+  const std::size_t rows = std::max<std::size_t>(
+    2, (num_waypoints + columns - 1)/columns);
+
+  rmf_traffic::agv::Graph graph;
+  for (std::size_t r = 0; r < rows; ++r)
+  {
+    for (std::size_t c = 0; c < columns; ++c)
+      graph.add_waypoint("warehouse", {2.5*c, 2.5*r});
+  }
+
+  for (std::size_t r = 0; r < rows; ++r)
+  {
+    const bool cross_aisle = r % 10 == 0 || r+1 == rows;
+    for (std::size_t c = 0; c < columns; ++c)
+    {
+      const std::size_t wp = r*columns + c;
+      if (r+1 < rows)
+        add_bidir_lane(graph, wp, wp + columns);
+
+      if (cross_aisle && c+1 < columns)
+        add_bidir_lane(graph, wp, wp + 1);
+    }
+  }
+
+  return graph;
+}
+
+//==============================================================================
+/// A hospital floor with roughly the requested number of waypoints. A main
+/// corridor runs along the x axis with a waypoint every 3m. Every fourth
+/// corridor waypoint has a ward branching off on each side: a dead-end
+/// corridor of six waypoints, each with a room on its left and right.
+inline rmf_traffic::agv::Graph make_hospital(const std::size_t num_waypoints)
+{
+  const std::size_t ward_length = 6;
+  const std::string map = "hospital";
+
+  rmf_traffic::agv::Graph graph;
+  std::size_t previous_spine = 0;
+  for (std::size_t s = 0; graph.num_waypoints() < num_waypoints; ++s)
+  {
+    const double x = 3.0*s;
+    const std::size_t spine = graph.add_waypoint(map, {x, 0.0}).index();
+    if (s > 0)
+      add_bidir_lane(graph, previous_spine, spine);
+
+    previous_spine = spine;
+    if (s % 4 != 0)
+      continue;
+
+    for (const double side : {1.0, -1.0})
+    {
+      std::size_t previous = spine;
+      for (std::size_t k = 1; k <= ward_length; ++k)
+      {
+        const double y = side*3.0*k;
+        const std::size_t corridor = graph.add_waypoint(map, {x, y}).index();
+        add_bidir_lane(graph, previous, corridor);
+        previous = corridor;
+
+        for (const double dx : {-1.5, 1.5})
+        {
+          const std::size_t room =
+            graph.add_waypoint(map, {x + dx, y}).index();
+          add_bidir_lane(graph, corridor, room);
+        }
+      }
+    }
+  }
+
+  return graph;
+}
+
+//==============================================================================
+/// A building with roughly the requested number of waypoints spread evenly
+/// over its floors. Each floor is a square grid with 5m spacing, and two lifts,
+/// one in each of two opposite corners, connect every pair of neighboring
+/// floors.
+///
+/// With a grid of N*N waypoints per floor, waypoint (i, j) of floor f has the
+/// index f*N*N + i*N + j.
+inline rmf_traffic::agv::Graph make_building(
+  const std::size_t num_waypoints,
+  const std::size_t floors)
+{
+  using namespace std::chrono_literals;
+
+  const std::size_t N = std::max<std::size_t>(
+    2, static_cast<std::size_t>(
+      std::round(std::sqrt(double(num_waypoints)/double(floors)))));
+
+  rmf_traffic::agv::Graph graph;
+  for (std::size_t f = 0; f < floors; ++f)
+  {
+    const std::string map = "L" + std::to_string(f);
+    for (std::size_t i = 0; i < N; ++i)
+    {
+      for (std::size_t j = 0; j < N; ++j)
+        graph.add_waypoint(map, {5.0*i, 5.0*j});
+    }
+
+    const std::size_t offset = f*N*N;
+    for (std::size_t i = 0; i < N; ++i)
+    {
+      for (std::size_t j = 0; j < N; ++j)
+      {
+        const std::size_t wp = offset + i*N + j;
+        if (i+1 < N)
+          add_bidir_lane(graph, wp, wp + N);
+
+        if (j+1 < N)
+          add_bidir_lane(graph, wp, wp + 1);
+      }
+    }
+  }
+
+  const auto lift_move = rmf_traffic::agv::Graph::Lane::Event::make(
+    rmf_traffic::agv::Graph::Lane::LiftMove("lift", "floor", 15s));
+
+  for (std::size_t f = 0; f+1 < floors; ++f)
+  {
+    for (const std::size_t corner : {std::size_t(0), N*N - 1})
+    {
+      const std::size_t lower = f*N*N + corner;
+      const std::size_t upper = (f+1)*N*N + corner;
+      graph.add_lane({lower, lift_move}, upper);
+      graph.add_lane({upper, lift_move}, lower);
+    }
+  }
+
+  return graph;
+}
+
+//==============================================================================
+/// Register the requested number of obstacle participants in the database.
+/// Each one wanders along the lanes of the graph at 1m/s, starting from a
+/// random waypoint at the given time, for up to the given number of lanes.
+/// Lanes that change maps or have events are never followed.
+inline void add_wandering_obstacles(
+  rmf_traffic::schedule::Database& database,
+  const rmf_traffic::agv::Graph& graph,
+  const rmf_traffic::Profile& profile,
+  const std::size_t count,
+  const rmf_traffic::Time time,
+  std::mt19937& rng,
+  const std::size_t num_lanes = 20)
+{
+  for (std::size_t n = 0; n < count; ++n)
+  {
+    const auto obstacle = database.register_participant(
+      rmf_traffic::schedule::ParticipantDescription{
+        "obstacle_" + std::to_string(n),
+        "benchmark",
+        rmf_traffic::schedule::ParticipantDescription::Rx::Unresponsive,
+        profile
+      });
+
+    std::size_t wp = pick(rng, graph.num_waypoints());
+    const std::string map = graph.get_waypoint(wp).get_map_name();
+    Eigen::Vector2d p = graph.get_waypoint(wp).get_location();
+    double yaw = 0.0;
+    auto t = time;
+
+    rmf_traffic::Trajectory trajectory;
+    trajectory.insert(t, {p.x(), p.y(), yaw}, Eigen::Vector3d::Zero());
+    for (std::size_t l = 0; l < num_lanes; ++l)
+    {
+      std::vector<std::size_t> options;
+      for (const auto lane_index : graph.lanes_from(wp))
+      {
+        const auto& lane = graph.get_lane(lane_index);
+        const auto next = lane.exit().waypoint_index();
+        if (lane.entry().event() || lane.exit().event())
+          continue;
+
+        if (graph.get_waypoint(next).get_map_name() != map)
+          continue;
+
+        options.push_back(next);
+      }
+
+      if (options.empty())
+        break;
+
+      wp = options[pick(rng, options.size())];
+      const Eigen::Vector2d next_p = graph.get_waypoint(wp).get_location();
+      const Eigen::Vector2d dp = next_p - p;
+      const double length = dp.norm();
+
+      // Turn in place, then drive to the next waypoint
+      yaw = std::atan2(dp.y(), dp.x());
+      t += rmf_traffic::time::from_seconds(1.0);
+      trajectory.insert(t, {p.x(), p.y(), yaw}, Eigen::Vector3d::Zero());
+
+      t += rmf_traffic::time::from_seconds(length);
+      p = next_p;
+      trajectory.insert(t, {p.x(), p.y(), yaw}, Eigen::Vector3d::Zero());
+    }
+
+    database.set(
+      obstacle.id(),
+      {{0, std::make_shared<rmf_traffic::Route>(map, std::move(trajectory))}},
+      0);
+  }
+}
+
+//==============================================================================
+/// Choose random pairs of distinct waypoints to plan between
+inline std::vector<std::pair<std::size_t, std::size_t>> make_problems(
+  const rmf_traffic::agv::Graph& graph,
+  const std::size_t count,
+  std::mt19937& rng)
+{
+  std::vector<std::pair<std::size_t, std::size_t>> problems;
+  const std::size_t N = graph.num_waypoints();
+  while (problems.size() < count)
+  {
+    const std::size_t start = pick(rng, N);
+    const std::size_t goal = pick(rng, N);
+    if (start != goal)
+      problems.push_back({start, goal});
+  }
+
+  return problems;
+}
+
+#endif // RMF_TRAFFIC__BENCHMARK__UTILS_SYNTHETICMAPS_HPP
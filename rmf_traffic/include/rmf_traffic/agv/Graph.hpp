@@ -24,7 +24,9 @@
 
 #include <rmf_utils/impl_ptr.hpp>
 #include <rmf_utils/clone_ptr.hpp>
+#include <rmf_utils/optional.hpp>
 
+#include <functional>
 #include <vector>
 #include <unordered_map>
 
@@ -514,6 +516,27 @@ public:
   /// const-qualified lane_from()
   const Lane* lane_from(std::size_t from_wp, std::size_t to_wp) const;
 
+  /// Find the waypoint on a map that is nearest to a location. This uses a
+  /// spatial index of the graph, which is built the first time it is needed
+  /// and rebuilt after the graph or any of its waypoints have been changed.
+  ///
+  /// \param[in] map_name
+  ///   The map to search. Waypoints on other maps are never returned.
+  ///
+  /// \param[in] location
+  ///   The location to search around.
+  ///
+  /// \param[in] filter
+  ///   If this is not null, only waypoints that it returns true for will be
+  ///   considered.
+  ///
+  /// \return the index of the nearest waypoint, or a nullopt if there is no
+  /// waypoint on the map that passes the filter.
+  rmf_utils::optional<std::size_t> find_nearest_waypoint(
+    const std::string& map_name,
+    const Eigen::Vector2d& location,
+    const std::function<bool(const Waypoint&)>& filter = nullptr) const;
+
   class Implementation;
 private:
   rmf_utils::impl_ptr<Implementation> _pimpl;
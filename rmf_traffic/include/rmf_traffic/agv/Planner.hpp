@@ -88,6 +88,88 @@ public:
     /// Get a const reference to the interpolation options
     const Interpolate::Options& interpolation() const;
 
+    /// Set a file that the Planner will load its heuristic cache from when it
+    /// is constructed. The file should have been created by
+    /// Planner::save_heuristic_cache() using a Planner with the same graph,
+    /// vehicle traits, and interpolation options. If the file does not exist or
+    /// was made for a different configuration, it will be ignored.
+    Configuration& heuristic_cache_file(
+      rmf_utils::optional<std::string> filename);
+
+    /// Get the file that the heuristic cache will be loaded from, if any.
+    const rmf_utils::optional<std::string>& heuristic_cache_file() const;
+
+    /// Have the Planner compute the heuristics for a set of goal waypoints on
+    /// background threads as soon as it is constructed, so that the first plan
+    /// towards each of those goals does not need to pay for computing them.
+    /// Plans that are requested before the precomputation is finished will
+    /// still work, and will compute any heuristics that they need which are not
+    /// ready yet.
+    ///
+    /// \param[in] goals
+    ///   The goal waypoints whose heuristics should be precomputed. An empty
+    ///   list means every waypoint in the graph. A nullopt (the default) means
+    ///   no heuristics will be precomputed.
+    ///
+    /// The heuristics are only precomputed for goals that do not require an
+    /// orientation, unless the orientations are listed with
+    /// precompute_goal_orientations().
+    Configuration& precompute_heuristics(
+      rmf_utils::optional<std::vector<std::size_t>> goals);
+
+    /// Get the goal waypoints whose heuristics will be precomputed, if any.
+    const rmf_utils::optional<std::vector<std::size_t>>&
+    precompute_heuristics() const;
+
+    /// Also precompute the heuristics for reaching each goal of
+    /// precompute_heuristics() at these orientations. A goal that requires an
+    /// orientation has its own heuristics, so they will not be warmed up unless
+    /// the orientation is listed here. The heuristics for goals that do not
+    /// require an orientation are always precomputed. By default this is empty.
+    ///
+    /// \param[in] yaws
+    ///   The goal orientations that the fleet uses, in radians.
+    Configuration& precompute_goal_orientations(std::vector<double> yaws);
+
+    /// Get the goal orientations whose heuristics will be precomputed.
+    const std::vector<double>& precompute_goal_orientations() const;
+
+    /// Set the number of background threads that will be used to precompute
+    /// heuristics. If this is zero (the default), the hardware concurrency will
+    /// be used.
+    Configuration& precomputation_threads(std::size_t num_threads);
+
+    /// Get the number of background threads that will be used to precompute
+    /// heuristics.
+    std::size_t precomputation_threads() const;
+
+    /// Have the Planner pick a number of landmark waypoints and compute the
+    /// travel costs to and from each of them when it is constructed. The
+    /// heuristics will use those costs to bound the cost of reaching a goal,
+    /// which helps the most when the goal is on a different floor than the
+    /// start. Each landmark costs two sweeps over the graph at construction
+    /// and two numbers per waypoint of memory. The default is zero, which does
+    /// not use any landmarks.
+    Configuration& heuristic_landmarks(std::size_t num_landmarks);
+
+    /// Get the number of landmarks that the heuristics will use.
+    std::size_t heuristic_landmarks() const;
+
+    /// Set a limit on how much memory the heuristic caches of the Planner may
+    /// use. The limit is split evenly between the layers of heuristics. When a
+    /// layer goes over its share, the tables of the goals that were used least
+    /// recently are discarded, and they will be computed again if they are
+    /// needed later. The memory use is a rough estimate, so the limit should
+    /// be tuned with Planner::heuristic_cache_statistics().
+    ///
+    /// \param[in] bytes
+    ///   The limit in bytes. A nullopt (the default) means there is no limit.
+    Configuration& heuristic_cache_budget(
+      rmf_utils::optional<std::size_t> bytes);
+
+    /// Get the limit on how much memory the heuristic caches may use.
+    const rmf_utils::optional<std::size_t>& heuristic_cache_budget() const;
+
     // TODO(MXG): Add a field to specify whether multi-start planning problems
     // should choose the plan that takes the least amount of time (according to
     // plan duration) or the plan that finishes the earliest (according to the
@@ -224,6 +306,52 @@ public:
     /// Get the saturation limit.
     rmf_utils::optional<std::size_t> saturation_limit() const;
 
+    /// Turn incremental replanning on or off. When this is on, Result::replan()
+    /// will try to reuse the solution of the previous search instead of
+    /// searching from scratch. Whenever the new search reaches a waypoint that
+    /// the previous solution passed through, the rest of the previous solution
+    /// is shifted to the new time, checked against the validator, and placed
+    /// into the queue for as far as it remains valid. This is most effective
+    /// when the robot has moved forward along its previous plan or when only a
+    /// few schedule entries have changed since the previous plan was found.
+    ///
+    /// This is off by default.
+    Options& incremental_replanning(bool on);
+
+    /// Check whether incremental replanning is turned on.
+    bool incremental_replanning() const;
+
+    /// Turn the collection of search statistics on or off. When this is on,
+    /// Result::statistics() will describe the work that went into a plan, such
+    /// as the number of nodes that were expanded, the use of the heuristic
+    /// caches, and the time spent validating routes.
+    ///
+    /// This is off by default, in which case no statistics are collected.
+    Options& collect_statistics(bool on);
+
+    /// Check whether search statistics will be collected.
+    bool collect_statistics() const;
+
+    /// Search from each Start of a StartSet separately, on a pool of threads,
+    /// with Planner::plan_in_parallel(). The searches share a bound on the best
+    /// cost that has been found so far, so a search that can no longer win gets
+    /// cancelled early. This only affects Planner::plan() when it is given more
+    /// than one Start.
+    ///
+    /// The Result of the winning Start gets returned, so its get_starts() will
+    /// only contain that Start. If no Start can reach the goal, the Result of
+    /// the Start with the lowest ideal cost is returned instead.
+    ///
+    /// \param[in] num_threads
+    ///   The number of threads to use, or zero to use the hardware concurrency.
+    ///   Pass in a nullopt to search from every Start together in a single
+    ///   search, which is the default.
+    Options& parallel_starts(std::optional<std::size_t> num_threads);
+
+    /// Get the number of threads that will be used to search from each Start
+    /// separately, or a nullopt if all Starts are searched together.
+    std::optional<std::size_t> parallel_starts() const;
+
     class Implementation;
   private:
     rmf_utils::impl_ptr<Implementation> _pimpl;
@@ -386,6 +514,123 @@ public:
   /// Get a const reference to the default planning options.
   const Options& get_default_options() const;
 
+  /// Save the heuristics that this Planner has computed so far to a file, so
+  /// that a future Planner with the same Configuration can start with a warm
+  /// cache. The file is tagged with a hash of the graph, vehicle traits, and
+  /// interpolation options.
+  ///
+  /// \return true if the file was written successfully.
+  bool save_heuristic_cache(const std::string& filename) const;
+
+  /// Load heuristics from a file that was created by save_heuristic_cache().
+  /// Heuristics that are in the file will not need to be computed again.
+  ///
+  /// \return true if the heuristics were loaded. False will be returned if the
+  /// file does not exist, is malformed, or was made for a Planner with a
+  /// different graph, vehicle traits, or interpolation options.
+  bool load_heuristic_cache(const std::string& filename) const;
+
+  /// Check whether the background precomputation of heuristics that was
+  /// requested by Configuration::precompute_heuristics() has finished. This
+  /// will always return true if no precomputation was requested.
+  bool heuristics_precomputed() const;
+
+  /// Statistics about the heuristic caches of a Planner
+  struct HeuristicCacheStatistics
+  {
+    /// Statistics about one layer of heuristics
+    struct Layer
+    {
+      /// The name of the heuristic
+      std::string name;
+
+      /// The number of goal tables that are currently held
+      std::size_t tables = 0;
+
+      /// The number of entries in the tables that are currently held
+      std::size_t entries = 0;
+
+      /// A rough estimate of the memory used by those entries
+      std::size_t estimated_bytes = 0;
+
+      /// The number of lookups that found an entry which was already cached.
+      /// These are counted when each search finishes with the cache.
+      std::size_t hits = 0;
+
+      /// The number of lookups that needed a new entry to be computed
+      std::size_t misses = 0;
+
+      /// The number of tables that were discarded to stay within the budget
+      std::size_t evicted_tables = 0;
+
+      /// The number of entries that were in the discarded tables
+      std::size_t evicted_entries = 0;
+    };
+
+    /// The statistics of each layer, from the highest to the lowest
+    std::vector<Layer> layers;
+
+    /// The total estimated memory of every layer
+    std::size_t estimated_bytes = 0;
+  };
+
+  /// Get statistics about the heuristic caches of this Planner, such as their
+  /// sizes, hit rates, and evictions. This can be used to tune
+  /// Configuration::heuristic_cache_budget().
+  HeuristicCacheStatistics heuristic_cache_statistics() const;
+
+  /// Statistics about the work that went into a planning Result. These are
+  /// only collected when Options::collect_statistics() is turned on, and they
+  /// accumulate each time the Result is resumed.
+  struct SearchStatistics
+  {
+    /// The lookups that the search made into one layer of heuristics
+    struct Lookups
+    {
+      /// The name of the heuristic, the same as in HeuristicCacheStatistics
+      std::string name;
+
+      /// The number of lookups that found an entry which was already cached
+      std::size_t hits = 0;
+
+      /// The number of lookups that needed a new entry to be computed
+      std::size_t misses = 0;
+    };
+
+    /// The number of search nodes that have been expanded
+    std::size_t expanded_nodes = 0;
+
+    /// The number of search nodes that are still waiting in the queue
+    std::size_t queued_nodes = 0;
+
+    /// The lookups into each layer of heuristics, from the highest to the
+    /// lowest. When a lookup into one layer misses, the lookups that the layer
+    /// makes into the lower layers to fill in the entry are counted too.
+    std::vector<Lookups> heuristic_lookups;
+
+    /// The number of times that the traversals out of a waypoint needed to be
+    /// generated because they had not been cached yet
+    std::size_t traversal_generations = 0;
+
+    /// The number of routes that were checked with
+    /// RouteValidator::find_conflict(). Checks of the same route are answered
+    /// from memory after the first time, but they are still counted here.
+    std::size_t validator_calls = 0;
+
+    /// The total time spent checking routes
+    Duration validator_time = Duration(0);
+
+    /// The time spent setting up the search, which is mostly spent computing
+    /// the heuristic for each start
+    Duration setup_time = Duration(0);
+
+    /// The time spent searching
+    Duration search_time = Duration(0);
+
+    /// The time spent turning the solution of the search into a Plan
+    Duration reconstruction_time = Duration(0);
+  };
+
   using StartSet = std::vector<Start>;
 
   /// Produce a plan for the given starting conditions and goal. The default
@@ -449,7 +694,8 @@ public:
   ///
   /// \param[in] options
   ///   The options to use for this plan. This overrides the default Options of
-  ///   the Planner instance.
+  ///   the Planner instance. See Options::parallel_starts() for searching from
+  ///   each start in parallel.
   Result plan(
     const StartSet& starts,
     Goal goal,
@@ -481,6 +727,50 @@ public:
     Goal goal,
     Options options) const;
 
+  /// One of the planning problems that can be given to plan_in_parallel()
+  struct Problem
+  {
+    StartSet starts;
+    Goal goal;
+    Options options;
+  };
+
+  /// The outcome of plan_in_parallel()
+  struct ParallelResults
+  {
+    /// One Result for each Problem, in the same order as the problems
+    std::vector<Result> results;
+
+    /// The index of the successful Result with the lowest cost. Ties are won
+    /// by the earliest Problem. This is a nullopt if no Problem was solved.
+    std::optional<std::size_t> best;
+  };
+
+  /// Solve several independent planning problems at once on a pool of threads
+  /// and find the one with the lowest cost. This is meant for situations that
+  /// would otherwise plan for one alternative after another, like trying each
+  /// goal or each validator of a negotiation.
+  ///
+  /// The searches share a bound on the best cost that has been found so far.
+  /// The problems with the lowest ideal costs are searched first, and a search
+  /// gets cancelled as soon as the lowest cost it could still achieve is
+  /// higher than that bound. A cancelled Result will report interrupted() and
+  /// it can be resume()d.
+  ///
+  /// The best Result and its plan do not depend on how the threads happen to
+  /// be scheduled, because a search is only cancelled once it can no longer
+  /// win. Which of the other Results get cancelled can vary from run to run.
+  ///
+  /// \param[in] problems
+  ///   The problems to solve
+  ///
+  /// \param[in] num_threads
+  ///   The number of threads to use. If this is zero, the hardware concurrency
+  ///   will be used.
+  ParallelResults plan_in_parallel(
+    const std::vector<Problem>& problems,
+    std::size_t num_threads = 0) const;
+
   class Implementation;
   class Debug;
 private:
@@ -642,6 +932,16 @@ public:
   /// do prevent the optimal solution from being available.
   std::vector<schedule::ParticipantId> blockers() const;
 
+  /// The number of search nodes in the plan that were reused from the previous
+  /// Result when this Result was produced by replan() with
+  /// Options::incremental_replanning() turned on. Otherwise this will be zero.
+  std::size_t reused_node_count() const;
+
+  /// Statistics about the work that went into this Result, if
+  /// Options::collect_statistics() was turned on. Otherwise this will return
+  /// a nullptr.
+  const SearchStatistics* statistics() const;
+
   class Implementation;
 private:
   Result();
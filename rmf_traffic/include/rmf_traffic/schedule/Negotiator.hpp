@@ -97,6 +97,41 @@ public:
     const TableViewerPtr& table_viewer,
     const ResponderPtr& responder) = 0;
 
+  /// A table that a Negotiator should respond to, along with the Responder
+  /// that the response should be given to.
+  struct Request
+  {
+    Negotiator* negotiator;
+    TableViewerPtr table_viewer;
+    ResponderPtr responder;
+  };
+
+  /// Have the negotiators of several tables respond to them concurrently.
+  ///
+  /// The requests are started in the order that they are given.
+  ///
+  /// Requests that share a Negotiator are never evaluated at the same time, so
+  /// each Negotiator instance only needs to be safe to use alongside other
+  /// Negotiator instances. This is the case for sibling tables, which always
+  /// belong to different participants.
+  ///
+  /// The responses are held back until every negotiator has returned, and then
+  /// they are passed along to the Responders of the requests on the calling
+  /// thread, in the order of the requests. That means the Responders and the
+  /// Negotiation do not need to be thread-safe. Any response that a Negotiator
+  /// gives after its respond() function has returned will be passed along
+  /// immediately on whichever thread it is given.
+  ///
+  /// \param[in] requests
+  ///   The tables to respond to.
+  ///
+  /// \param[in] num_threads
+  ///   The maximum number of threads to use, including the calling thread. Use
+  ///   0 to pick the number of hardware threads.
+  static void respond_in_parallel(
+    const std::vector<Request>& requests,
+    std::size_t num_threads = 0);
+
   virtual ~Negotiator() = default;
 };
 
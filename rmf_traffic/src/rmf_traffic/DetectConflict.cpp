@@ -21,6 +21,8 @@
 #include "Spline.hpp"
 #include "StaticMotion.hpp"
 
+#include <rmf_traffic/geometry/Circle.hpp>
+
 #include "DetectConflictInternal.hpp"
 
 #ifdef RMF_TRAFFIC__USING_FCL_0_6
@@ -168,11 +170,11 @@ get_initial_iterators(
 }
 
 //==============================================================================
-struct BoundingBox
-{
-  Eigen::Vector2d min;
-  Eigen::Vector2d max;
-};
+using internal::BoundingBox;
+using internal::adjust_bounding_box;
+using internal::get_bounding_box;
+using internal::overlap;
+using internal::void_box;
 
 //==============================================================================
 struct BoundingProfile
@@ -202,14 +204,19 @@ std::array<double, 2> get_local_extrema(
   extrema_candidates.emplace_back(evaluate_spline(coeffs, 0));
   extrema_candidates.emplace_back(evaluate_spline(coeffs, 1));
 
+  // Critical points that fall outside of the [0,1] range of the spline are not
+  // part of the motion, so they must not be counted as extrema.
+  const auto add_candidate = [&](const double t)
+    {
+      if (0.0 < t && t < 1.0)
+        extrema_candidates.emplace_back(evaluate_spline(coeffs, t));
+    };
+
   // When derivate of spline motion is not quadratic
   if (std::abs(coeffs[3]) < 1e-12)
   {
     if (std::abs(coeffs[2]) > 1e-12)
-    {
-      double t = -coeffs[1] / (2 * coeffs[2]);
-      extrema_candidates.emplace_back(evaluate_spline(coeffs, t));
-    }
+      add_candidate(-coeffs[1] / (2 * coeffs[2]));
   }
   else
   {
@@ -218,9 +225,7 @@ std::array<double, 2> get_local_extrema(
 
     if (std::abs(D) < 1e-4)
     {
-      const double t = (-2 * coeffs[2]) / (6 * coeffs[3]);
-      const double extrema = evaluate_spline(coeffs, t);
-      extrema_candidates.emplace_back(extrema);
+      add_candidate((-2 * coeffs[2]) / (6 * coeffs[3]));
     }
     else if (D < 0)
     {
@@ -230,11 +235,8 @@ std::array<double, 2> get_local_extrema(
     }
     else
     {
-      const double t1 = ((-2 * coeffs[2]) + std::sqrt(D)) / (6 * coeffs[3]);
-      const double t2 = ((-2 * coeffs[2]) - std::sqrt(D)) / (6 * coeffs[3]);
-
-      extrema_candidates.emplace_back(evaluate_spline(coeffs, t1));
-      extrema_candidates.emplace_back(evaluate_spline(coeffs, t2));
+      add_candidate(((-2 * coeffs[2]) + std::sqrt(D)) / (6 * coeffs[3]));
+      add_candidate(((-2 * coeffs[2]) - std::sqrt(D)) / (6 * coeffs[3]));
     }
   }
 
@@ -250,42 +252,6 @@ std::array<double, 2> get_local_extrema(
   return extrema;
 }
 
-//==============================================================================
-BoundingBox get_bounding_box(const rmf_traffic::Spline& spline)
-{
-  auto params = spline.get_params();
-  std::array<double, 2> extrema_x = get_local_extrema(params.coeffs[0]);
-  std::array<double, 2> extrema_y = get_local_extrema(params.coeffs[1]);
-
-  return BoundingBox{
-    Eigen::Vector2d{extrema_x[0], extrema_y[0]},
-    Eigen::Vector2d{extrema_x[1], extrema_y[1]}
-  };
-}
-
-//==============================================================================
-/// Create a bounding box which will never overlap with any other BoundingBox
-BoundingBox void_box()
-{
-  constexpr double inf = std::numeric_limits<double>::infinity();
-  return BoundingBox{
-    Eigen::Vector2d{inf, inf},
-    Eigen::Vector2d{-inf, -inf}
-  };
-}
-
-//==============================================================================
-BoundingBox adjust_bounding_box(
-  const BoundingBox& input,
-  const double value)
-{
-  BoundingBox box = input;
-  box.min -= Eigen::Vector2d{value, value};
-  box.max += Eigen::Vector2d{value, value};
-
-  return box;
-}
-
 //==============================================================================
 BoundingProfile get_bounding_profile(
   const rmf_traffic::Spline& spline,
@@ -306,23 +272,6 @@ BoundingProfile get_bounding_profile(
   return BoundingProfile{f_box, v_box};
 }
 
-//==============================================================================
-bool overlap(
-  const BoundingBox& box_a,
-  const BoundingBox& box_b)
-{
-  for (int i = 0; i < 2; ++i)
-  {
-    if (box_a.max[i] < box_b.min[i])
-      return false;
-
-    if (box_b.max[i] < box_a.min[i])
-      return false;
-  }
-
-  return true;
-}
-
 //==============================================================================
 #ifdef RMF_TRAFFIC__USING_FCL_0_6
 using FclContinuousCollisionRequest = fcl::ContinuousCollisionRequestd;
@@ -394,6 +343,26 @@ rmf_utils::optional<double> check_collision(
   return rmf_utils::nullopt;
 }
 
+//==============================================================================
+/// If both shapes are circles, get the distance between their centers at which
+/// they would make contact. Otherwise return a nullopt.
+rmf_utils::optional<double> circle_contact_distance(
+  const geometry::FinalConvexShape& shape_a,
+  const geometry::FinalConvexShape& shape_b)
+{
+  const auto* circle_a =
+    dynamic_cast<const geometry::Circle*>(&shape_a.source());
+  if (!circle_a)
+    return rmf_utils::nullopt;
+
+  const auto* circle_b =
+    dynamic_cast<const geometry::Circle*>(&shape_b.source());
+  if (!circle_b)
+    return rmf_utils::nullopt;
+
+  return circle_a->get_radius() + circle_b->get_radius();
+}
+
 //==============================================================================
 Profile::Implementation convert_profile(const Profile& profile)
 {
@@ -441,7 +410,8 @@ bool check_overlap(
   const Spline& spline_a,
   const Profile::Implementation& profile_b,
   const Spline& spline_b,
-  const Time time)
+  const Time time,
+  const bool analytic_circles)
 {
   using ConvexPair = std::array<geometry::ConstFinalConvexShapePtr, 2>;
   // TODO(MXG): If footprint and vicinity are equal, we can probably reduce this
@@ -451,6 +421,30 @@ bool check_overlap(
     ConvexPair{profile_a.vicinity, profile_b.footprint}
   };
 
+  // Circles can be checked directly from the distance between their centers
+  const double distance = (spline_a.compute_position(time)
+    - spline_b.compute_position(time)).block<2, 1>(0, 0).norm();
+
+  bool all_circles = analytic_circles;
+  for (const auto& pair : pairs)
+  {
+    if (!analytic_circles)
+      break;
+
+    const auto contact_distance = circle_contact_distance(*pair[0], *pair[1]);
+    if (!contact_distance)
+    {
+      all_circles = false;
+      break;
+    }
+
+    if (distance <= *contact_distance)
+      return true;
+  }
+
+  if (all_circles)
+    return false;
+
 #ifdef RMF_TRAFFIC__USING_FCL_0_6
   fcl::CollisionRequestd request;
   fcl::CollisionResultd result;
@@ -509,7 +503,8 @@ bool close_start(
   const Profile::Implementation& profile_a,
   const Trajectory::const_iterator& a_it,
   const Profile::Implementation& profile_b,
-  const Trajectory::const_iterator& b_it)
+  const Trajectory::const_iterator& b_it,
+  const bool analytic_circles)
 {
   // If two trajectories start very close to each other, then we do not consider
   // it a conflict for them to be in each other's vicinities. This gives robots
@@ -520,7 +515,8 @@ bool close_start(
   const auto start_time =
     std::max(spline_a.start_time(), spline_b.start_time());
 
-  return check_overlap(profile_a, spline_a, profile_b, spline_b, start_time);
+  return check_overlap(
+    profile_a, spline_a, profile_b, spline_b, start_time, analytic_circles);
 }
 
 //==============================================================================
@@ -531,7 +527,8 @@ rmf_utils::optional<rmf_traffic::Time> detect_invasion(
     const Profile::Implementation& profile_b,
     Trajectory::const_iterator b_it,
     const Trajectory::const_iterator& b_end,
-    std::vector<DetectConflict::Implementation::Conflict>* output_conflicts)
+    std::vector<DetectConflict::Implementation::Conflict>* output_conflicts,
+    const bool analytic_circles)
 {
   rmf_utils::optional<Spline> spline_a;
   rmf_utils::optional<Spline> spline_b;
@@ -549,6 +546,18 @@ rmf_utils::optional<rmf_traffic::Time> detect_invasion(
     (profile_a.vicinity != profile_a.footprint)
     || (profile_b.vicinity != profile_b.footprint);
 
+  // When both shapes of a pair are circles, we can find the time of contact
+  // directly from the distance between the splines instead of using FCL.
+  rmf_utils::optional<double> fv_contact_distance;
+  rmf_utils::optional<double> vf_contact_distance;
+  if (analytic_circles)
+  {
+    fv_contact_distance =
+      circle_contact_distance(*profile_a.footprint, *profile_b.vicinity);
+    vf_contact_distance =
+      circle_contact_distance(*profile_a.vicinity, *profile_b.footprint);
+  }
+
   if (output_conflicts)
     output_conflicts->clear();
 
@@ -566,17 +575,39 @@ rmf_utils::optional<rmf_traffic::Time> detect_invasion(
     const Time finish_time =
       std::min(spline_a->finish_time(), spline_b->finish_time());
 
-    *motion_a = spline_a->to_fcl(start_time, finish_time);
-    *motion_b = spline_b->to_fcl(start_time, finish_time);
+    bool fcl_motion_ready = false;
+    rmf_utils::optional<DistanceDifferential> differential;
+    const auto collide = [&](
+      const rmf_utils::optional<double>& contact_distance,
+      const geometry::FinalConvexShape& shape_a,
+      const geometry::FinalConvexShape& shape_b)
+      -> rmf_utils::optional<double>
+      {
+        if (contact_distance)
+        {
+          if (!differential)
+            differential = DistanceDifferential(*spline_a, *spline_b);
+
+          return differential->first_time_within(*contact_distance);
+        }
+
+        if (!fcl_motion_ready)
+        {
+          *motion_a = spline_a->to_fcl(start_time, finish_time);
+          *motion_b = spline_b->to_fcl(start_time, finish_time);
+          fcl_motion_ready = true;
+        }
+
+        return check_collision(shape_a, motion_a, shape_b, motion_b, request);
+      };
 
     const auto bound_a = get_bounding_profile(*spline_a, profile_a);
     const auto bound_b = get_bounding_profile(*spline_b, profile_b);
 
     if (overlap(bound_a.footprint, bound_b.vicinity))
     {
-      if (const auto collision = check_collision(
-          *profile_a.footprint, motion_a,
-          *profile_b.vicinity, motion_b, request))
+      if (const auto collision = collide(
+          fv_contact_distance, *profile_a.footprint, *profile_b.vicinity))
       {
         const auto time = compute_time(*collision, start_time, finish_time);
         if (!output_conflicts)
@@ -589,9 +620,8 @@ rmf_utils::optional<rmf_traffic::Time> detect_invasion(
 
     if (test_complement && overlap(bound_a.vicinity, bound_b.footprint))
     {
-      if (const auto collision = check_collision(
-          *profile_a.vicinity, motion_a,
-          *profile_b.footprint, motion_b, request))
+      if (const auto collision = collide(
+          vf_contact_distance, *profile_a.vicinity, *profile_b.footprint))
       {
         const auto time = compute_time(*collision, start_time, finish_time);
         if (!output_conflicts)
@@ -658,7 +688,8 @@ rmf_utils::optional<rmf_traffic::Time> detect_approach(
     const Profile::Implementation& profile_b,
     Trajectory::const_iterator b_it,
     const Trajectory::const_iterator& b_end,
-    std::vector<DetectConflict::Implementation::Conflict>* output_conflicts)
+    std::vector<DetectConflict::Implementation::Conflict>* output_conflicts,
+    const bool analytic_circles)
 {
   rmf_utils::optional<Spline> spline_a;
   rmf_utils::optional<Spline> spline_b;
@@ -686,7 +717,8 @@ rmf_utils::optional<rmf_traffic::Time> detect_approach(
     const auto approach_times = D.approach_times();
     for (const auto t : approach_times)
     {
-      if (!check_overlap(profile_a, *spline_a, profile_b, *spline_b, t))
+      if (!check_overlap(
+          profile_a, *spline_a, profile_b, *spline_b, t, analytic_circles))
       {
         // If neither vehicle is in the vicinity of the other, then we should
         // revert to the normal invasion detection approach to identifying
@@ -703,7 +735,7 @@ rmf_utils::optional<rmf_traffic::Time> detect_approach(
         return detect_invasion(
           profile_a, ++sliced_trajectory_a.begin(), sliced_trajectory_a.end(),
           profile_b, ++sliced_trajectory_b.begin(), sliced_trajectory_b.end(),
-          output_conflicts);
+          output_conflicts, analytic_circles);
       }
 
       // If one of the vehicles is still inside the vicinity of another during
@@ -716,7 +748,8 @@ rmf_utils::optional<rmf_traffic::Time> detect_approach(
     }
 
     const bool still_close = check_overlap(
-          profile_a, *spline_a, profile_b, *spline_b, D.finish_time());
+          profile_a, *spline_a, profile_b, *spline_b, D.finish_time(),
+          analytic_circles);
 
     if (spline_a->finish_time() < spline_b->finish_time())
     {
@@ -742,7 +775,7 @@ rmf_utils::optional<rmf_traffic::Time> detect_approach(
       return detect_invasion(
         profile_a, a_it, a_end,
         profile_b, b_it, b_end,
-        output_conflicts);
+        output_conflicts, analytic_circles);
     }
   }
 
@@ -764,7 +797,8 @@ rmf_utils::optional<rmf_traffic::Time> DetectConflict::Implementation::between(
   const Profile& input_profile_b,
   const Trajectory& trajectory_b,
   Interpolate /*interpolation*/,
-  std::vector<Conflict>* output_conflicts)
+  std::vector<Conflict>* output_conflicts,
+  const bool analytic_circles)
 {
   if (trajectory_a.size() < 2)
   {
@@ -804,7 +838,7 @@ rmf_utils::optional<rmf_traffic::Time> DetectConflict::Implementation::between(
   Trajectory::const_iterator b_it;
   std::tie(a_it, b_it) = get_initial_iterators(trajectory_a, trajectory_b);
 
-  if (close_start(profile_a, a_it, profile_b, b_it))
+  if (close_start(profile_a, a_it, profile_b, b_it, analytic_circles))
   {
     // If the vehicles are already starting in close proximity, then we consider
     // it a conflict if they get any closer while within that proximity.
@@ -815,7 +849,8 @@ rmf_utils::optional<rmf_traffic::Time> DetectConflict::Implementation::between(
           profile_b,
           std::move(b_it),
           trajectory_b.end(),
-          output_conflicts);
+          output_conflicts,
+          analytic_circles);
   }
 
   // If the vehicles are starting an acceptable distance from each other, then
@@ -827,10 +862,73 @@ rmf_utils::optional<rmf_traffic::Time> DetectConflict::Implementation::between(
         profile_b,
         std::move(b_it),
         trajectory_b.end(),
-        output_conflicts);
+        output_conflicts,
+        analytic_circles);
 }
 
 namespace internal {
+//==============================================================================
+BoundingBox get_bounding_box(const rmf_traffic::Spline& spline)
+{
+  auto params = spline.get_params();
+  std::array<double, 2> extrema_x = get_local_extrema(params.coeffs[0]);
+  std::array<double, 2> extrema_y = get_local_extrema(params.coeffs[1]);
+
+  return BoundingBox{
+    Eigen::Vector2d{extrema_x[0], extrema_y[0]},
+    Eigen::Vector2d{extrema_x[1], extrema_y[1]}
+  };
+}
+
+//==============================================================================
+BoundingBox get_bounding_box(
+  const geometry::FinalShape& shape,
+  const Eigen::Isometry2d& pose)
+{
+  const Eigen::Vector2d p = pose.translation();
+  return adjust_bounding_box(
+    BoundingBox{p, p}, shape.get_characteristic_length());
+}
+
+//==============================================================================
+BoundingBox void_box()
+{
+  constexpr double inf = std::numeric_limits<double>::infinity();
+  return BoundingBox{
+    Eigen::Vector2d{inf, inf},
+    Eigen::Vector2d{-inf, -inf}
+  };
+}
+
+//==============================================================================
+BoundingBox adjust_bounding_box(
+  const BoundingBox& input,
+  const double value)
+{
+  BoundingBox box = input;
+  box.min -= Eigen::Vector2d{value, value};
+  box.max += Eigen::Vector2d{value, value};
+
+  return box;
+}
+
+//==============================================================================
+bool overlap(
+  const BoundingBox& box_a,
+  const BoundingBox& box_b)
+{
+  for (int i = 0; i < 2; ++i)
+  {
+    if (box_a.max[i] < box_b.min[i])
+      return false;
+
+    if (box_b.max[i] < box_a.min[i])
+      return false;
+  }
+
+  return true;
+}
+
 //==============================================================================
 bool detect_conflicts(
   const Profile& profile,
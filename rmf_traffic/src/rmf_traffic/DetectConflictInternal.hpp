@@ -29,6 +29,8 @@
 
 namespace rmf_traffic {
 
+class Spline;
+
 class DetectConflict::Implementation
 {
 public:
@@ -42,13 +44,16 @@ public:
 
   using Conflicts = std::vector<Conflict>;
 
+  /// When analytic_circles is false, pairs of circles are checked with FCL like
+  /// every other shape. This lets the tests compare both checks.
   static rmf_utils::optional<Time> between(
     const Profile& profile_a,
     const Trajectory& trajectory_a,
     const Profile& profile_b,
     const Trajectory& trajectory_b,
     Interpolate interpolation,
-    std::vector<Conflict>* output_conflicts = nullptr);
+    std::vector<Conflict>* output_conflicts = nullptr,
+    bool analytic_circles = true);
 
 };
 
@@ -64,6 +69,38 @@ struct Spacetime
   geometry::ConstFinalShapePtr shape;
 };
 
+//==============================================================================
+struct BoundingBox
+{
+  Eigen::Vector2d min;
+  Eigen::Vector2d max;
+};
+
+//==============================================================================
+/// Get the bounding box of the path that a spline traces out.
+BoundingBox get_bounding_box(const Spline& spline);
+
+//==============================================================================
+/// Get the bounding box of a shape that has been placed at the given pose.
+BoundingBox get_bounding_box(
+  const geometry::FinalShape& shape,
+  const Eigen::Isometry2d& pose);
+
+//==============================================================================
+/// Create a bounding box which will never overlap with any other BoundingBox
+BoundingBox void_box();
+
+//==============================================================================
+/// Inflate a bounding box by the given value in each direction.
+BoundingBox adjust_bounding_box(
+  const BoundingBox& input,
+  const double value);
+
+//==============================================================================
+bool overlap(
+  const BoundingBox& box_a,
+  const BoundingBox& box_b);
+
 //==============================================================================
 bool detect_conflicts(
   const Profile& profile,
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "MapId.hpp"
+
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace rmf_traffic {
+
+namespace {
+//==============================================================================
+class MapNameRegistry
+{
+public:
+
+  static MapNameRegistry& get()
+  {
+    static MapNameRegistry registry;
+    return registry;
+  }
+
+  rmf_utils::optional<uint32_t> find(const std::string& name) const
+  {
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    const auto it = _ids.find(name);
+    if (it == _ids.end())
+      return rmf_utils::nullopt;
+
+    return it->second;
+  }
+
+  uint32_t intern(const std::string& name)
+  {
+    if (const auto id = find(name))
+      return *id;
+
+    std::unique_lock<std::shared_mutex> lock(_mutex);
+    const auto insertion =
+      _ids.insert({name, static_cast<uint32_t>(_names.size())});
+    if (insertion.second)
+      _names.push_back(name);
+
+    return insertion.first->second;
+  }
+
+  const std::string& name(const uint32_t id) const
+  {
+    // A deque never moves its elements when it grows, so the reference stays
+    // valid after the lock is released.
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    return _names.at(id);
+  }
+
+private:
+
+  MapNameRegistry()
+  {
+    _ids.insert({std::string(), 0});
+    _names.push_back(std::string());
+  }
+
+  mutable std::shared_mutex _mutex;
+  std::unordered_map<std::string, uint32_t> _ids;
+  std::deque<std::string> _names;
+};
+} // anonymous namespace
+
+//==============================================================================
+MapId MapId::intern(const std::string& name)
+{
+  return MapId(MapNameRegistry::get().intern(name));
+}
+
+//==============================================================================
+rmf_utils::optional<MapId> MapId::find(const std::string& name)
+{
+  if (const auto id = MapNameRegistry::get().find(name))
+    return MapId(*id);
+
+  return rmf_utils::nullopt;
+}
+
+//==============================================================================
+const std::string& MapId::name() const
+{
+  return MapNameRegistry::get().name(_value);
+}
+
+} // namespace rmf_traffic
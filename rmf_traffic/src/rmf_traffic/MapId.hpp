@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__MAPID_HPP
+#define SRC__RMF_TRAFFIC__MAPID_HPP
+
+#include <rmf_utils/optional.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace rmf_traffic {
+
+//==============================================================================
+/// An interned map name. Every distinct map name that passes through the
+/// public API gets a small integer ID the first time it is seen, so that the
+/// internals can compare and hash map names without touching their strings.
+///
+/// IDs are shared by the whole process and are never released, which is fine
+/// because a deployment only ever has a handful of maps. A default-constructed
+/// MapId refers to the empty map name.
+class MapId
+{
+public:
+
+  /// The ID of the empty map name
+  MapId() = default;
+
+  /// Get the ID of a map name, giving it a new ID if it has never been seen
+  /// before.
+  static MapId intern(const std::string& name);
+
+  /// Get the ID of a map name if it has ever been interned. If it has not, then
+  /// nothing can refer to that map yet.
+  static rmf_utils::optional<MapId> find(const std::string& name);
+
+  /// Get the name that this ID refers to
+  const std::string& name() const;
+
+  /// Get the raw value of this ID
+  uint32_t value() const
+  {
+    return _value;
+  }
+
+  bool operator==(const MapId& other) const
+  {
+    return _value == other._value;
+  }
+
+  bool operator!=(const MapId& other) const
+  {
+    return _value != other._value;
+  }
+
+  bool operator<(const MapId& other) const
+  {
+    return _value < other._value;
+  }
+
+  struct Hash
+  {
+    std::size_t operator()(const MapId& id) const
+    {
+      return std::hash<uint32_t>()(id._value);
+    }
+  };
+
+private:
+
+  explicit MapId(uint32_t value)
+  : _value(value)
+  {
+    // Do nothing
+  }
+
+  uint32_t _value = 0;
+};
+
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__MAPID_HPP
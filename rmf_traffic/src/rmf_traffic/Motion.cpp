@@ -33,20 +33,22 @@ std::unique_ptr<Motion> Motion::compute_cubic_splines(
     // *INDENT-ON*
   }
 
-  using const_iterator = internal::WaypointList::const_iterator;
-  const const_iterator begin = internal::get_raw_iterator(input_begin);
-  const const_iterator end = internal::get_raw_iterator(input_end);
+  const internal::RawIterator begin = internal::get_raw_iterator(input_begin);
+  const internal::RawIterator end = internal::get_raw_iterator(input_end);
+  const internal::TrajectoryStorage& storage = *begin.storage;
 
-  if (++const_iterator(begin) == end)
+  if (begin.index + 1 == end.index)
   {
-    const auto& point = *begin;
     return std::make_unique<SinglePointMotion>(
-      point.data.time, point.data.position, point.data.velocity);
+      storage.times[begin.index],
+      storage.positions[begin.index],
+      storage.velocities[begin.index]);
   }
 
   std::vector<Spline> splines;
-  for (auto it = ++const_iterator(begin); it != end; ++it)
-    splines.emplace_back(Spline(it));
+  splines.reserve(end.index - begin.index - 1);
+  for (std::size_t i = begin.index + 1; i < end.index; ++i)
+    splines.emplace_back(internal::RawIterator{&storage, i});
 
   if (splines.size() == 1)
     return std::make_unique<SplineMotion>(std::move(splines[0]));
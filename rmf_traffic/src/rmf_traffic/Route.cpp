@@ -35,6 +35,7 @@ Route::Route(
 //==============================================================================
 Route& Route::map(std::string value)
 {
+  _pimpl->map_id = MapId::intern(value);
   _pimpl->map = std::move(value);
   return *this;
 }
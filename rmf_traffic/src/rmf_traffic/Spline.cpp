@@ -17,6 +17,7 @@
 
 #include "Spline.hpp"
 
+#include <algorithm>
 #include <unordered_set>
 
 namespace rmf_traffic {
@@ -68,50 +69,21 @@ std::array<Eigen::Vector4d, 3> compute_coefficients(
 
 //==============================================================================
 Spline::Parameters compute_parameters(
-  const Trajectory::const_iterator& finish_it)
+  const internal::TrajectoryStorage& storage,
+  const std::size_t finish_index)
 {
-  const Trajectory::const_iterator start_it =
-    --Trajectory::const_iterator(finish_it);
+  assert(0 < finish_index && finish_index < storage.size());
+  const std::size_t start_index = finish_index - 1;
 
-  const Trajectory::Waypoint& start = *start_it;
-  const Trajectory::Waypoint& finish = *finish_it;
-
-  const Time start_time = start.time();
-  const Time finish_time = finish.time();
+  const Time start_time = storage.times[start_index];
+  const Time finish_time = storage.times[finish_index];
 
   const double delta_t = compute_delta_t(finish_time, start_time);
 
-  const Eigen::Vector3d x0 = start.position();
-  const Eigen::Vector3d x1 = finish.position();
-  const Eigen::Vector3d v0 = delta_t * start.velocity();
-  const Eigen::Vector3d v1 = delta_t * finish.velocity();
-
-  return {
-    compute_coefficients(x0, x1, v0, v1),
-    delta_t,
-    {start_time, finish_time}
-  };
-}
-
-//==============================================================================
-Spline::Parameters compute_parameters(
-  const internal::WaypointList::const_iterator& finish_it)
-{
-  const internal::WaypointList::const_iterator start_it =
-    --internal::WaypointList::const_iterator(finish_it);
-
-  const internal::WaypointElement::Data& start = start_it->data;
-  const internal::WaypointElement::Data& finish = finish_it->data;
-
-  const Time start_time = start.time;
-  const Time finish_time = finish.time;
-
-  const double delta_t = compute_delta_t(finish_time, start_time);
-
-  const Eigen::Vector3d x0 = start.position;
-  const Eigen::Vector3d x1 = finish.position;
-  const Eigen::Vector3d v0 = delta_t * start.velocity;
-  const Eigen::Vector3d v1 = delta_t * finish.velocity;
+  const Eigen::Vector3d& x0 = storage.positions[start_index];
+  const Eigen::Vector3d& x1 = storage.positions[finish_index];
+  const Eigen::Vector3d v0 = delta_t * storage.velocities[start_index];
+  const Eigen::Vector3d v1 = delta_t * storage.velocities[finish_index];
 
   return {
     compute_coefficients(x0, x1, v0, v1),
@@ -206,14 +178,14 @@ const Eigen::Matrix4d M_inv = make_M_inv();
 
 //==============================================================================
 Spline::Spline(const Trajectory::const_iterator& it)
-: params(compute_parameters(it))
+: Spline(internal::get_raw_iterator(it))
 {
   // Do nothing
 }
 
 //==============================================================================
-Spline::Spline(const internal::WaypointList::const_iterator& it)
-: params(compute_parameters(it))
+Spline::Spline(const internal::RawIterator& it)
+: params(compute_parameters(*it.storage, it.index))
 {
   // Do nothing
 }
@@ -636,6 +608,106 @@ std::vector<Time> DistanceDifferential::approach_times() const
   return output;
 }
 
+namespace {
+//==============================================================================
+// The squared distance between two cubic splines is a polynomial of degree 6
+using SextCoefficients = std::array<double, 7>;
+
+//==============================================================================
+/// Convert the coefficients of a polynomial from the power basis to the
+/// Bernstein basis over the domain [0, 1]
+SextCoefficients to_bernstein(const SextCoefficients& power)
+{
+  const std::size_t n = power.size() - 1;
+
+  // The binomial coefficients for n = 6
+  const std::array<double, 7> binomial = {1, 6, 15, 20, 15, 6, 1};
+
+  SextCoefficients bernstein;
+  for (std::size_t i = 0; i <= n; ++i)
+  {
+    // We use the product form of (i choose j) / (n choose j) here
+    double value = 0.0;
+    double i_choose_j = 1.0;
+    for (std::size_t j = 0; j <= i; ++j)
+    {
+      value += i_choose_j / binomial[j] * power[j];
+      i_choose_j = i_choose_j * static_cast<double>(i - j)
+        / static_cast<double>(j + 1);
+    }
+
+    bernstein[i] = value;
+  }
+
+  return bernstein;
+}
+
+//==============================================================================
+/// Find the earliest point in the domain [s0, s1] where the polynomial with
+/// the given Bernstein coefficients is not positive. The Bernstein coefficients
+/// bound the values of the polynomial, so whole segments of the domain can be
+/// ruled out at once, and the rest get split in half with de Casteljau's
+/// algorithm until the earliest contact is pinned down.
+rmf_utils::optional<double> earliest_nonpositive(
+  const SextCoefficients& b,
+  const double s0,
+  const double s1,
+  const std::size_t depth)
+{
+  if (b.front() <= 0.0)
+    return s0;
+
+  if (*std::min_element(b.begin(), b.end()) > 0.0)
+    return rmf_utils::nullopt;
+
+  // This is deep enough to give the time of contact to within a millionth of
+  // the spline duration. At that point we conservatively report a contact.
+  const std::size_t max_depth = 20;
+  if (depth >= max_depth)
+    return s0;
+
+  SextCoefficients left;
+  SextCoefficients right;
+  SextCoefficients work = b;
+  const std::size_t n = b.size() - 1;
+  for (std::size_t k = 0; k <= n; ++k)
+  {
+    left[k] = work[0];
+    right[n-k] = work[n-k];
+    for (std::size_t i = 0; i < n-k; ++i)
+      work[i] = 0.5*(work[i] + work[i+1]);
+  }
+
+  const double s_mid = 0.5*(s0 + s1);
+  if (const auto s = earliest_nonpositive(left, s0, s_mid, depth+1))
+    return s;
+
+  return earliest_nonpositive(right, s_mid, s1, depth+1);
+}
+
+} // anonymous namespace
+
+//==============================================================================
+rmf_utils::optional<double> DistanceDifferential::first_time_within(
+  const double distance) const
+{
+  // Expand (dx^2 + dy^2 - distance^2) into the power basis
+  SextCoefficients power;
+  power.fill(0.0);
+  for (std::size_t d = 0; d < 2; ++d)
+  {
+    const Eigen::Vector4d& c = _params.coeffs[d];
+    for (int i = 0; i < 4; ++i)
+    {
+      for (int j = 0; j < 4; ++j)
+        power[static_cast<std::size_t>(i+j)] += c[i]*c[j];
+    }
+  }
+  power[0] -= distance*distance;
+
+  return earliest_nonpositive(to_bernstein(power), 0.0, 1.0, 0);
+}
+
 //==============================================================================
 Time DistanceDifferential::start_time() const
 {
@@ -22,6 +22,8 @@
 
 #include <rmf_traffic/Trajectory.hpp>
 
+#include <rmf_utils/optional.hpp>
+
 #ifdef RMF_TRAFFIC__USING_FCL_0_6
 #include <fcl/math/motion/spline_motion.h>
 #else
@@ -53,7 +55,7 @@ public:
 
   /// Create a spline that goes from the end of the preceding to the Waypoint of
   /// `it`.
-  Spline(const internal::WaypointList::const_iterator& it);
+  Spline(const internal::RawIterator& it);
 
   /// Compute the knots for the motion of this spline from start_time to
   /// finish_time, scaled to a "time" range of [0, 1].
@@ -108,6 +110,12 @@ public:
   /// they should.
   std::vector<Time> approach_times() const;
 
+  /// Find the earliest moment when the distance between the splines is no
+  /// greater than the given distance. The result is given as a scaled time,
+  /// where 0.0 is start_time() and 1.0 is finish_time(). A nullopt means the
+  /// splines never come within the distance.
+  rmf_utils::optional<double> first_time_within(const double distance) const;
+
   Time start_time() const;
   Time finish_time() const;
 
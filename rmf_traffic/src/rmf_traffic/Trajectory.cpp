@@ -21,26 +21,50 @@
 #include "MotionInternal.hpp"
 #include "TrajectoryInternal.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 
 namespace rmf_traffic {
 
+//==============================================================================
+class Trajectory::Waypoint::Implementation
+{
+public:
+
+  // Note: these fields will be filled in by the
+  // Trajectory::Implementation::make_waypoint() function.
+  std::size_t slot;
+  Trajectory::Implementation* parent;
+
+  // A copy of the time of this waypoint. The times in the parent storage move
+  // around as waypoints get inserted and erased, but this stays put for as
+  // long as the waypoint exists, which lets start_time() and finish_time()
+  // return stable pointers.
+  Time time;
+
+};
+
 namespace internal {
 //==============================================================================
 class TrajectoryIteratorImplementation
 {
 public:
 
-  WaypointList::iterator raw_iterator;
+  std::size_t slot;
   const Trajectory::Implementation* parent;
 
+  std::size_t index() const;
+
+  void increment();
+
+  void decrement();
+
   template<typename SegT>
-  Trajectory::base_iterator<SegT> make_iterator(
-    internal::WaypointList::iterator it) const
+  Trajectory::base_iterator<SegT> make_iterator(const std::size_t s) const
   {
     Trajectory::base_iterator<SegT> result;
-    result._pimpl->raw_iterator = it;
+    result._pimpl->slot = s;
     result._pimpl->parent = parent;
 
     return result;
@@ -49,95 +73,63 @@ public:
   template<typename SegT>
   Trajectory::base_iterator<SegT> post_increment()
   {
-    const Trajectory::base_iterator<SegT> old_it =
-      make_iterator<SegT>(raw_iterator);
-
-    ++raw_iterator;
-
+    const Trajectory::base_iterator<SegT> old_it = make_iterator<SegT>(slot);
+    increment();
     return old_it;
   }
 
   template<typename SegT>
   Trajectory::base_iterator<SegT> post_decrement()
   {
-    const Trajectory::base_iterator<SegT> old_it =
-      make_iterator<SegT>(raw_iterator);
-
-    --raw_iterator;
-
+    const Trajectory::base_iterator<SegT> old_it = make_iterator<SegT>(slot);
+    decrement();
     return old_it;
   }
 
-  static WaypointList::const_iterator raw(
-    const Trajectory::const_iterator& iterator)
-  {
-    return iterator._pimpl->raw_iterator;
-  }
+  static RawIterator raw(const Trajectory::const_iterator& iterator);
 };
 
-//==============================================================================
-WaypointList::const_iterator get_raw_iterator(
-  const Trajectory::const_iterator& iterator)
-{
-  return TrajectoryIteratorImplementation::raw(iterator);
-}
-
 } // namespace internal
 
 //==============================================================================
-class Trajectory::Waypoint::Implementation
+class Trajectory::Implementation
 {
 public:
 
-  // Note: these fields will be filled in by the
-  // Trajectory::Implementation::insert() function.
-  internal::WaypointList::iterator myself;
-  Trajectory::Implementation* parent;
+  internal::TrajectoryStorage data;
 
-  internal::WaypointElement::Data& data()
-  {
-    return myself->data;
-  }
+  // The Waypoint object of each slot. We keep these alive so that we can always
+  // safely return a reference to a Trajectory::Waypoint object. The objects of
+  // free slots are kept so they can be reused by the next insertion.
+  std::vector<std::unique_ptr<Waypoint>> waypoints;
 
-  const internal::WaypointElement::Data& data() const
+  std::size_t index_of(const std::size_t slot) const
   {
-    return myself->data;
+    return slot == internal::EndSlot ? data.size() : data.indices[slot];
   }
 
-  Time time() const
+  std::size_t slot_at(const std::size_t index) const
   {
-    return data().time;
+    return index < data.size() ? data.slots[index] : internal::EndSlot;
   }
 
-};
-
-//==============================================================================
-class Trajectory::Implementation
-{
-public:
-
-  internal::OrderMap ordering;
-  internal::WaypointList segments;
-
   template<typename SegT>
-  base_iterator<SegT> make_iterator(
-    internal::WaypointList::iterator iterator) const
+  base_iterator<SegT> make_iterator(const std::size_t slot) const
   {
     base_iterator<SegT> it;
-    it._pimpl->raw_iterator = std::move(iterator);
+    it._pimpl->slot = slot;
     it._pimpl->parent = this;
 
     return it;
   }
 
-  std::unique_ptr<Waypoint> make_segment(
-    internal::WaypointList::iterator iterator)
+  std::unique_ptr<Waypoint> make_waypoint(const std::size_t slot)
   {
-    std::unique_ptr<Waypoint> seg(new Waypoint);
-    seg->_pimpl->myself = std::move(iterator);
-    seg->_pimpl->parent = this;
+    std::unique_ptr<Waypoint> wp(new Waypoint);
+    wp->_pimpl->slot = slot;
+    wp->_pimpl->parent = this;
 
-    return seg;
+    return wp;
   }
 
   Implementation()
@@ -152,204 +144,283 @@ public:
 
   Implementation& operator=(const Implementation& other)
   {
-    // Start by making a normal copy
-    ordering = other.ordering;
-    segments = other.segments;
-
-    // Now correct all the iterators to point to the freshly copied container
-    internal::WaypointList::iterator sit = segments.begin();
-    internal::OrderMap::iterator oit = ordering.begin();
-    for ( ; sit != segments.end(); ++sit, ++oit)
+    data.times = other.data.times;
+    data.positions = other.data.positions;
+    data.velocities = other.data.velocities;
+
+    // The copy does not need to inherit the free slots of the original, so we
+    // renumber the slots to match the indices.
+    const std::size_t N = data.size();
+    data.slots.resize(N);
+    data.indices.resize(N);
+    data.free_slots.clear();
+    waypoints.resize(N);
+    for (std::size_t i = 0; i < N; ++i)
     {
-      sit->myself = make_segment(sit);
-      oit->value = sit;
+      data.slots[i] = i;
+      data.indices[i] = i;
+      if (!waypoints[i])
+        waypoints[i] = make_waypoint(i);
+
+      waypoints[i]->_pimpl->time = data.times[i];
     }
 
     return *this;
   }
 
-  InsertionResult insert(internal::WaypointElement::Data data)
+  // Update the slot-to-index map for every waypoint in [begin, end)
+  void reindex(const std::size_t begin, const std::size_t end)
+  {
+    for (std::size_t i = begin; i < end; ++i)
+      data.indices[data.slots[i]] = i;
+  }
+
+  std::size_t lower_bound_index(const Time time) const
+  {
+    return static_cast<std::size_t>(
+      std::lower_bound(data.times.begin(), data.times.end(), time)
+      - data.times.begin());
+  }
+
+  InsertionResult insert(
+    const Time time,
+    const Eigen::Vector3d& position,
+    const Eigen::Vector3d& velocity)
   {
-    const internal::OrderMap::iterator hint = ordering.lower_bound(data.time);
-    if (hint != ordering.end() && hint->key == data.time)
+    const std::size_t index = lower_bound_index(time);
+    if (index < data.size() && data.times[index] == time)
     {
       // We already have a Waypoint in the Trajectory that ends at this same
       // exact moment in time, so we will return the existing iterator along
       // with inserted==false.
-      assert(segments.size() > 0);
-      return InsertionResult{make_iterator<Waypoint>(hint->value), false};
+      return InsertionResult{make_iterator<Waypoint>(data.slots[index]), false};
     }
 
-    const internal::WaypointList::const_iterator list_destination =
-      (hint == ordering.end()) ? segments.end() : hint->value;
-
-    const internal::WaypointList::iterator result =
-      segments.emplace(list_destination, std::move(data));
-    result->myself = make_segment(result);
-    assert(segments.size() > 0);
+    std::size_t slot;
+    if (data.free_slots.empty())
+    {
+      slot = data.indices.size();
+      data.indices.push_back(index);
+      waypoints.push_back(make_waypoint(slot));
+    }
+    else
+    {
+      slot = data.free_slots.back();
+      data.free_slots.pop_back();
+    }
 
-    ordering.emplace_hint(hint, data.time, result);
-    assert(ordering.size() > 0);
+    data.times.insert(data.times.begin() + index, time);
+    data.positions.insert(data.positions.begin() + index, position);
+    data.velocities.insert(data.velocities.begin() + index, velocity);
+    data.slots.insert(data.slots.begin() + index, slot);
+    waypoints[slot]->_pimpl->time = time;
+    reindex(index, data.size());
 
-    return InsertionResult{make_iterator<Waypoint>(result), true};
+    return InsertionResult{make_iterator<Waypoint>(slot), true};
   }
 
   iterator find(Time time)
   {
-    const auto it = ordering.lower_bound(time);
-    if (it == ordering.end())
-      return make_iterator<Waypoint>(segments.end());
+    const std::size_t index = lower_bound_index(time);
+    if (index >= data.size())
+      return end();
 
     // If the time comes before the start of the Trajectory, then we return
     // the end() iterator
-    if (time < segments.begin()->data.time)
-      return make_iterator<Waypoint>(segments.end());
+    if (time < data.times.front())
+      return end();
 
-    return make_iterator<Waypoint>(it->value);
+    return make_iterator<Waypoint>(data.slots[index]);
   }
 
   iterator lower_bound(Time time)
   {
-    const auto it = ordering.lower_bound(time);
-    if (it == ordering.end())
-      return make_iterator<Waypoint>(segments.end());
+    return make_iterator<Waypoint>(slot_at(lower_bound_index(time)));
+  }
+
+  iterator erase(const std::size_t first, const std::size_t last)
+  {
+    if (first >= last)
+      return make_iterator<Waypoint>(slot_at(first));
+
+    for (std::size_t i = first; i < last; ++i)
+      data.free_slots.push_back(data.slots[i]);
 
-    return make_iterator<Waypoint>(it->value);
+    const auto erase_range = [first, last](auto& v)
+      {
+        v.erase(v.begin() + first, v.begin() + last);
+      };
+
+    erase_range(data.times);
+    erase_range(data.positions);
+    erase_range(data.velocities);
+    erase_range(data.slots);
+    reindex(first, data.size());
+
+    return make_iterator<Waypoint>(slot_at(first));
   }
 
   iterator erase(iterator waypoint)
   {
-    ordering.erase(waypoint->_pimpl->myself->data.time);
-    return make_iterator<Waypoint>(segments.erase(waypoint->_pimpl->myself));
+    const std::size_t index = waypoint._pimpl->index();
+    return erase(index, index+1);
   }
 
   iterator erase(iterator first, iterator last)
   {
-    const auto seg_begin = first->_pimpl->myself;
-    const auto seg_end = last._pimpl->raw_iterator == segments.end() ?
-      segments.end() : last->_pimpl->myself;
+    return erase(first._pimpl->index(), last._pimpl->index());
+  }
 
-    const auto order_start = ordering.find(seg_begin->data.time);
-    const auto order_end = seg_end == segments.end() ?
-      ordering.end() : ordering.find(seg_end->data.time);
+  // Move the waypoint at index `from` so that it has the index `to`, shifting
+  // the waypoints in between.
+  void move_waypoint(const std::size_t from, const std::size_t to)
+  {
+    if (from == to)
+      return;
 
-    ordering.erase(order_start, order_end);
-    return make_iterator<Waypoint>(segments.erase(seg_begin, seg_end));
+    const auto move = [from, to](auto& v)
+      {
+        if (from < to)
+        {
+          std::rotate(
+            v.begin() + from, v.begin() + from + 1, v.begin() + to + 1);
+        }
+        else
+        {
+          std::rotate(
+            v.begin() + to, v.begin() + from, v.begin() + from + 1);
+        }
+      };
+
+    move(data.times);
+    move(data.positions);
+    move(data.velocities);
+    move(data.slots);
+    reindex(std::min(from, to), std::max(from, to) + 1);
   }
 
   iterator begin()
   {
-    return make_iterator<Waypoint>(segments.begin());
+    return make_iterator<Waypoint>(slot_at(0));
   }
 
   iterator end()
   {
-    return make_iterator<Waypoint>(segments.end());
+    return make_iterator<Waypoint>(internal::EndSlot);
   }
 
 };
 
+namespace internal {
+//==============================================================================
+std::size_t TrajectoryIteratorImplementation::index() const
+{
+  return parent->index_of(slot);
+}
+
+//==============================================================================
+void TrajectoryIteratorImplementation::increment()
+{
+  slot = parent->slot_at(index() + 1);
+}
+
+//==============================================================================
+void TrajectoryIteratorImplementation::decrement()
+{
+  slot = parent->slot_at(index() - 1);
+}
+
+//==============================================================================
+RawIterator TrajectoryIteratorImplementation::raw(
+  const Trajectory::const_iterator& iterator)
+{
+  const auto& it = *iterator._pimpl;
+  return RawIterator{&it.parent->data, it.index()};
+}
+
+//==============================================================================
+RawIterator get_raw_iterator(const Trajectory::const_iterator& iterator)
+{
+  return TrajectoryIteratorImplementation::raw(iterator);
+}
+
+} // namespace internal
+
 //==============================================================================
 Eigen::Vector3d Trajectory::Waypoint::position() const
 {
-  return _pimpl->data().position;
+  const auto& parent = *_pimpl->parent;
+  return parent.data.positions[parent.index_of(_pimpl->slot)];
 }
 
 //==============================================================================
 Trajectory::Waypoint& Trajectory::Waypoint::position(
   Eigen::Vector3d new_position)
 {
-  _pimpl->data().position = std::move(new_position);
+  auto& parent = *_pimpl->parent;
+  parent.data.positions[parent.index_of(_pimpl->slot)] =
+    std::move(new_position);
   return *this;
 }
 
 //==============================================================================
 Eigen::Vector3d Trajectory::Waypoint::velocity() const
 {
-  return _pimpl->data().velocity;
+  const auto& parent = *_pimpl->parent;
+  return parent.data.velocities[parent.index_of(_pimpl->slot)];
 }
 
 //==============================================================================
 Trajectory::Waypoint& Trajectory::Waypoint::velocity(
   Eigen::Vector3d new_velocity)
 {
-  _pimpl->data().velocity = std::move(new_velocity);
+  auto& parent = *_pimpl->parent;
+  parent.data.velocities[parent.index_of(_pimpl->slot)] =
+    std::move(new_velocity);
   return *this;
 }
 
 //==============================================================================
 Time Trajectory::Waypoint::time() const
 {
-  return _pimpl->time();
+  const auto& parent = *_pimpl->parent;
+  return parent.data.times[parent.index_of(_pimpl->slot)];
 }
 
 //==============================================================================
 Trajectory::Waypoint& Trajectory::Waypoint::change_time(const Time new_time)
 {
-  internal::WaypointList::iterator data_it = _pimpl->myself;
-  internal::WaypointElement::Data& current_data = data_it->data;
-  const Time current_time = current_data.time;
+  Trajectory::Implementation& parent = *_pimpl->parent;
+  std::vector<Time>& times = parent.data.times;
+  const std::size_t current_index = parent.index_of(_pimpl->slot);
 
-  if (current_time == new_time)
+  if (times[current_index] == new_time)
   {
-    // Short-circuit, since nothing is changing. The erase and re-insertion
-    // would be a waste of time in this case.
+    // Short-circuit, since nothing is changing.
     return *this;
   }
 
-  internal::OrderMap& ordering = _pimpl->parent->ordering;
-  internal::WaypointList& segments = _pimpl->parent->segments;
-  const internal::OrderMap::iterator current_order_it =
-    ordering.find(current_time);
-  assert(current_order_it != ordering.end());
-
-  const internal::OrderMap::iterator hint = ordering.lower_bound(new_time);
-
-  current_order_it->key = new_time;
-  if (current_order_it == hint)
+  const std::size_t hint = parent.lower_bound_index(new_time);
+  if (hint < times.size() && times[hint] == new_time)
   {
-    // The Waypoint is already in the correct location within the list, so it
-    // does not need to be moved. We can just update its entry in the OrderMap.
+    // The new time conflicts with an existing time, so we will throw an
+    // exception.
+    // *INDENT-OFF*
+    throw std::invalid_argument(
+      "[Trajectory::Waypoint::change_time] Attempted to set time to "
+      + std::to_string(new_time.time_since_epoch().count())
+      + "ns, but a waypoint already exists at that timestamp.");
+    // *INDENT-ON*
   }
-  else if (hint == ordering.end())
-  {
-    // This Waypoint must be moved to the end of the list.
-    segments.splice(segments.end(), segments, data_it);
-    ordering.rotate(current_order_it, hint);
-  }
-  else
-  {
-    const internal::WaypointList::const_iterator destination = hint->value;
-    assert(destination != segments.end());
 
-    if (destination->data.time == new_time)
-    {
-      // The new time conflicts with an existing time, so we will throw an
-      // exception.
-      // *INDENT-OFF*
-      throw std::invalid_argument(
-        "[Trajectory::Waypoint::change_time] Attempted to set time to "
-        + std::to_string(new_time.time_since_epoch().count())
-        + "ns, but a waypoint already exists at that timestamp.");
-      // *INDENT-ON*
-    }
-
-    if (current_order_it + 1 == hint)
-    {
-      // The waypoint is already in the correct location within the list, so it
-      // does not need to be moved. We separate this from the
-      // current_order_it == hint branch because we still need to make sure that
-      // destination->data.time != new_time, and throw an exception if it is.
-    }
-    else
-    {
-      segments.splice(destination, segments, data_it);
-      ordering.rotate(current_order_it, hint);
-    }
-  }
+  // If the hint comes after the current index, then the waypoint will land
+  // just before the hint once it has been removed from its current location.
+  const std::size_t new_index =
+    current_index < hint ? hint - 1 : hint;
 
-  // Update the time value in the data field.
-  current_data.time = new_time;
+  parent.move_waypoint(current_index, new_index);
+  times[new_index] = new_time;
+  _pimpl->time = new_time;
 
   return *this;
 }
@@ -357,22 +428,20 @@ Trajectory::Waypoint& Trajectory::Waypoint::change_time(const Time new_time)
 //==============================================================================
 void Trajectory::Waypoint::adjust_times(Duration delta_t)
 {
-  internal::WaypointList& segments = _pimpl->parent->segments;
-  const internal::WaypointList::iterator begin_it = _pimpl->myself;
-  const Time original_begin_time = begin_it->data.time;
+  Trajectory::Implementation& parent = *_pimpl->parent;
+  std::vector<Time>& times = parent.data.times;
+  const std::size_t begin_index = parent.index_of(_pimpl->slot);
 
-  if (delta_t.count() < 0 && begin_it != segments.begin())
+  if (delta_t.count() < 0 && begin_index > 0)
   {
     // If delta_t is negative and this is not the first Waypoint in the
     // Trajectory, make sure the change in time does not make it dip beneath its
     // predecessor Waypoint.
-    const internal::WaypointList::const_iterator predecessor_it =
-      --internal::WaypointList::iterator(begin_it);
-    const auto new_time = begin_it->data.time + delta_t;
-    if (new_time <= predecessor_it->data.time)
+    const Time predecessor_time = times[begin_index - 1];
+    const auto new_time = times[begin_index] + delta_t;
+    if (new_time <= predecessor_time)
     {
-      const auto tp = predecessor_it->data.time
-        .time_since_epoch().count();
+      const auto tp = predecessor_time.time_since_epoch().count();
       const auto tc = (new_time).time_since_epoch().count();
 
       const std::string error =
@@ -387,19 +456,13 @@ void Trajectory::Waypoint::adjust_times(Duration delta_t)
     }
   }
 
-  // Adjust the times for the segments
-  for (auto it = begin_it; it != segments.end(); ++it)
-    it->data.time += delta_t;
-
-  // Adjust the keys in the ordering map. The ordering is preserved by this
-  // operation, so we don't need to worry about rotating any entries.
-  internal::OrderMap& ordering = _pimpl->parent->ordering;
-  const internal::OrderMap::iterator order_begin_it =
-    ordering.find(original_begin_time);
-  assert(order_begin_it != ordering.end());
-
-  for (auto it = order_begin_it; it != ordering.end(); ++it)
-    it->key += delta_t;
+  // The ordering is preserved by this operation, so we don't need to move any
+  // of the waypoints.
+  for (std::size_t i = begin_index; i < times.size(); ++i)
+  {
+    times[i] += delta_t;
+    parent.waypoints[parent.data.slots[i]]->_pimpl->time = times[i];
+  }
 }
 
 //==============================================================================
@@ -436,17 +499,18 @@ Trajectory::InsertionResult Trajectory::insert(
   Eigen::Vector3d position,
   Eigen::Vector3d velocity)
 {
-  return _pimpl->insert(
-    internal::WaypointElement::Data{
-      std::move(time),
-      std::move(position),
-      std::move(velocity)});
+  return _pimpl->insert(time, position, velocity);
 }
 
 //==============================================================================
 Trajectory::InsertionResult Trajectory::insert(const Waypoint& other)
 {
-  return _pimpl->insert(internal::WaypointElement::Data{other._pimpl->data()});
+  // Copy the values first in case the other Waypoint belongs to this
+  // Trajectory.
+  const Time time = other.time();
+  const Eigen::Vector3d position = other.position();
+  const Eigen::Vector3d velocity = other.velocity();
+  return _pimpl->insert(time, position, velocity);
 }
 
 //==============================================================================
@@ -458,26 +522,26 @@ Trajectory::iterator Trajectory::find(Time time)
 //==============================================================================
 Trajectory::Waypoint& Trajectory::operator[](const std::size_t index)
 {
-  return *_pimpl->ordering[index].value->myself;
+  return *_pimpl->waypoints[_pimpl->data.slots[index]];
 }
 
 //==============================================================================
 const Trajectory::Waypoint& Trajectory::operator[](
     const std::size_t index) const
 {
-  return *_pimpl->ordering[index].value->myself;
+  return *_pimpl->waypoints[_pimpl->data.slots[index]];
 }
 
 //==============================================================================
 Trajectory::Waypoint& Trajectory::at(const std::size_t index)
 {
-  return *_pimpl->ordering.at(index).value->myself;
+  return *_pimpl->waypoints[_pimpl->data.slots.at(index)];
 }
 
 //==============================================================================
 const Trajectory::Waypoint& Trajectory::at(const std::size_t index) const
 {
-  return *_pimpl->ordering.at(index).value->myself;
+  return *_pimpl->waypoints[_pimpl->data.slots.at(index)];
 }
 
 //==============================================================================
@@ -549,81 +613,83 @@ Trajectory::const_iterator Trajectory::cend() const
 //==============================================================================
 auto Trajectory::front() -> Waypoint&
 {
-  return *_pimpl->segments.front().myself;
+  return *_pimpl->waypoints[_pimpl->data.slots.front()];
 }
 
 //==============================================================================
 auto Trajectory::front() const -> const Waypoint&
 {
-  return *_pimpl->segments.front().myself;
+  return *_pimpl->waypoints[_pimpl->data.slots.front()];
 }
 
 //==============================================================================
 auto Trajectory::back() -> Waypoint&
 {
-  return *_pimpl->segments.back().myself;
+  return *_pimpl->waypoints[_pimpl->data.slots.back()];
 }
 
 //==============================================================================
 auto Trajectory::back() const -> const Waypoint&
 {
-  return *_pimpl->segments.back().myself;
+  return *_pimpl->waypoints[_pimpl->data.slots.back()];
 }
 
 //==============================================================================
 const Time* Trajectory::start_time() const
 {
-  const auto& segments = _pimpl->segments;
-  return segments.size() == 0 ? nullptr : &segments.front().data.time;
+  const auto& slots = _pimpl->data.slots;
+  return slots.empty() ?
+    nullptr : &_pimpl->waypoints[slots.front()]->_pimpl->time;
 }
 
 //==============================================================================
 const Time* Trajectory::finish_time() const
 {
-  const auto& segments = _pimpl->segments;
-  return segments.size() == 0 ? nullptr : &segments.back().data.time;
+  const auto& slots = _pimpl->data.slots;
+  return slots.empty() ?
+    nullptr : &_pimpl->waypoints[slots.back()]->_pimpl->time;
 }
 
 //==============================================================================
 Duration Trajectory::duration() const
 {
-  const auto& segments = _pimpl->segments;
-  return segments.size() < 2 ?
+  const auto& times = _pimpl->data.times;
+  return times.size() < 2 ?
     Duration(0) :
-    segments.back().data.time - segments.front().data.time;
+    times.back() - times.front();
 }
 
 //==============================================================================
 std::size_t Trajectory::size() const
 {
-  return _pimpl->segments.size();
+  return _pimpl->data.size();
 }
 
 //==============================================================================
 bool Trajectory::empty() const
 {
-  return _pimpl->segments.empty();
+  return _pimpl->data.times.empty();
 }
 
 //==============================================================================
 template<typename SegT>
 SegT& Trajectory::base_iterator<SegT>::operator*() const
 {
-  return *_pimpl->raw_iterator->myself;
+  return *_pimpl->parent->waypoints[_pimpl->slot];
 }
 
 //==============================================================================
 template<typename SegT>
 SegT* Trajectory::base_iterator<SegT>::operator->() const
 {
-  return _pimpl->raw_iterator->myself.get();
+  return _pimpl->parent->waypoints[_pimpl->slot].get();
 }
 
 //==============================================================================
 template<typename SegT>
 auto Trajectory::base_iterator<SegT>::operator++() -> base_iterator&
 {
-  ++_pimpl->raw_iterator;
+  _pimpl->increment();
   return *this;
 }
 
@@ -631,7 +697,7 @@ auto Trajectory::base_iterator<SegT>::operator++() -> base_iterator&
 template<typename SegT>
 auto Trajectory::base_iterator<SegT>::operator--() -> base_iterator&
 {
-  --_pimpl->raw_iterator;
+  _pimpl->decrement();
   return *this;
 }
 
@@ -655,7 +721,7 @@ auto Trajectory::base_iterator<SegT>::operator--(int) -> base_iterator
   bool Trajectory::base_iterator<SegT>::operator op( \
     const base_iterator& other) const \
   { \
-    return _pimpl->raw_iterator op other._pimpl->raw_iterator; \
+    return _pimpl->slot op other._pimpl->slot; \
   }
 
 DEFINE_BASIC_ITERATOR_OP(==)
@@ -665,10 +731,8 @@ template<typename SegT>
 bool Trajectory::base_iterator<SegT>::operator<(
   const base_iterator& other) const
 {
-  const bool this_is_end =
-    this->_pimpl->raw_iterator == _pimpl->parent->segments.end();
-  const bool other_is_end =
-    other._pimpl->raw_iterator == _pimpl->parent->segments.end();
+  const bool this_is_end = this->_pimpl->slot == internal::EndSlot;
+  const bool other_is_end = other._pimpl->slot == internal::EndSlot;
 
   if (this_is_end || other_is_end)
   {
@@ -680,9 +744,8 @@ bool Trajectory::base_iterator<SegT>::operator<(
     return other_is_end && !this_is_end;
   }
 
-  // If they are both valid iterators, then we can compare their times.
-  return this->_pimpl->raw_iterator->data.time
-    < other._pimpl->raw_iterator->data.time;
+  // If they are both valid iterators, then we can compare their indices.
+  return this->_pimpl->index() < other._pimpl->index();
 }
 
 //==============================================================================
@@ -690,10 +753,8 @@ template<typename SegT>
 bool Trajectory::base_iterator<SegT>::operator>(
   const base_iterator& other) const
 {
-  const bool this_is_end =
-    this->_pimpl->raw_iterator == _pimpl->parent->segments.end();
-  const bool other_is_end =
-    other._pimpl->raw_iterator == _pimpl->parent->segments.end();
+  const bool this_is_end = this->_pimpl->slot == internal::EndSlot;
+  const bool other_is_end = other._pimpl->slot == internal::EndSlot;
 
   if (this_is_end || other_is_end)
   {
@@ -702,9 +763,8 @@ bool Trajectory::base_iterator<SegT>::operator>(
     return this_is_end && !other_is_end;
   }
 
-  // If they are both valid iterators, then we can compare their times.
-  return this->_pimpl->raw_iterator->data.time
-    > other._pimpl->raw_iterator->data.time;
+  // If they are both valid iterators, then we can compare their indices.
+  return this->_pimpl->index() > other._pimpl->index();
 }
 
 //==============================================================================
@@ -727,7 +787,7 @@ bool Trajectory::base_iterator<SegT>::operator>=(
 template<typename SegT>
 Trajectory::base_iterator<SegT>::operator const_iterator() const
 {
-  return _pimpl->make_iterator<const SegT>(_pimpl->raw_iterator);
+  return _pimpl->make_iterator<const SegT>(_pimpl->slot);
 }
 
 //==============================================================================
@@ -748,56 +808,40 @@ bool Trajectory::Debug::check_iterator_time_consistency(
 {
   assert(trajectory._pimpl);
 
-  const internal::WaypointList& segments = trajectory._pimpl->segments;
-  const internal::OrderMap& ordering = trajectory._pimpl->ordering;
+  const internal::TrajectoryStorage& data = trajectory._pimpl->data;
 
   bool consistent = true;
+  consistent &= data.positions.size() == data.size();
+  consistent &= data.velocities.size() == data.size();
+  consistent &= data.slots.size() == data.size();
 
-  internal::WaypointList::const_iterator s_it = segments.begin();
-  internal::OrderMap::const_iterator o_it = ordering.begin();
-  for ( ; s_it != segments.end() && o_it != ordering.end(); ++s_it, ++o_it)
+  for (std::size_t i = 0; consistent && i < data.size(); ++i)
   {
-    consistent &= s_it->data.time == o_it->key;
+    consistent &= data.indices[data.slots[i]] == i;
+    if (i > 0)
+      consistent &= data.times[i-1] < data.times[i];
   }
 
-  consistent &= s_it == segments.end();
-  consistent &= o_it == ordering.end();
-
   if (print_inconsistency && !consistent)
   {
-    std::size_t index = 0;
-    s_it = segments.begin();
-    o_it = ordering.begin();
     std::cout << "Trajectory time inconsistency detected: "
-              << "( ordering | segments | difference )\n";
-    for ( ; s_it != segments.end() && o_it != ordering.end();
-      ++s_it, ++o_it, ++index)
+              << "( time | slot | index of slot )\n";
+    for (std::size_t i = 0; i < data.size(); ++i)
     {
-      const auto difference = o_it->key - s_it->data.time;
-      std::cout << " -- [" << index << "] "
-                << o_it->key.time_since_epoch().count()/1e9 << " | "
-                << s_it->data.time.time_since_epoch().count()/1e9
-                << " | Difference: " << difference.count()/1e9 << "\n";
-    }
+      std::cout << " -- [" << i << "] "
+                << data.times[i].time_since_epoch().count()/1e9;
 
-    if (s_it != segments.end())
-    {
-      std::cout << " -- more elements in segments\n";
-      for ( ; s_it != segments.end(); ++s_it, ++index)
+      if (i < data.slots.size())
       {
-        std::cout << "      -- [" << index << "] "
-                  << s_it->data.time.time_since_epoch().count()/1e9
-                  << "\n";
-      }
-    }
-    if (o_it != ordering.end())
-    {
-      std::cout << " -- more elements in ordering:\n";
-      for ( ; o_it != ordering.end(); ++o_it, ++index)
-      {
-        std::cout << "     -- [" << index << "] "
-                  << o_it->key.time_since_epoch().count()/1e9 << "\n";
+        const std::size_t slot = data.slots[i];
+        std::cout << " | " << slot << " | ";
+        if (slot < data.indices.size())
+          std::cout << data.indices[slot];
+        else
+          std::cout << "invalid slot";
       }
+
+      std::cout << "\n";
     }
     std::cout << std::endl;
   }
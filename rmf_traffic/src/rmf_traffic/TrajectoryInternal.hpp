@@ -20,286 +20,59 @@
 
 #include <rmf_traffic/Trajectory.hpp>
 
-#include <list>
-#include <map>
+#include <limits>
+#include <vector>
 
 namespace rmf_traffic {
 namespace internal {
 
 //==============================================================================
-struct WaypointElement;
-using WaypointList = std::list<WaypointElement>;
-
-//==============================================================================
-template <typename Key, typename Value>
-class TemplateOrderMap
+/// The waypoint data of a Trajectory, packed into contiguous arrays that are
+/// sorted by time.
+///
+/// Each waypoint is also assigned a slot which does not change for as long as
+/// the waypoint remains in the trajectory. Iterators and Waypoint references
+/// refer to slots, so they remain valid when other waypoints are inserted or
+/// erased, even though the indices of the waypoints may shift.
+struct TrajectoryStorage
 {
-public:
-
-  struct Element
-  {
-    Key key;
-    Value value;
-
-    template <typename... Args>
-    static Element make(const Key& key, Args&&... args)
-    {
-      return Element{key, Value{std::forward<Args>(args)...}};
-    }
-  };
-
-  struct Comparison
-  {
-    bool operator()(const Element& element, const Key& key)
-    {
-      return element.key < key;
-    }
-  };
-
-  using Storage = std::vector<Element>;
-  using iterator = typename Storage::iterator;
-  using const_iterator = typename Storage::const_iterator;
-
-  iterator begin()
-  {
-    return _storage.begin();
-  }
-
-  const_iterator begin() const
-  {
-    return _storage.begin();
-  }
-
-  iterator end()
-  {
-    return _storage.end();
-  }
-
-  const_iterator end() const
-  {
-    return _storage.end();
-  }
-
-  iterator lower_bound(const Key& k)
-  {
-    return std::lower_bound(_storage.begin(), _storage.end(), k, Comparison());
-  }
-
-  const_iterator lower_bound(const Key& k) const
-  {
-    return std::lower_bound(_storage.begin(), _storage.end(), k, Comparison());
-  }
-
-  template <typename... Args>
-  iterator emplace_hint(iterator hint, const Key& key, Args&&... args)
-  {
-    if (_storage.empty())
-    {
-      _storage.push_back(Element::make(key, std::forward<Args>(args)...));
-      return _storage.begin();
-    }
-
-    if (hint == _storage.end())
-    {
-      if ( (--const_iterator(hint))->key < key)
-      {
-        return _storage.emplace(
-              _storage.end(), Element::make(key, std::forward<Args>(args)...));
-      }
-
-      // If the above test failed, then we were given a bad hint. Let's just use
-      // std::lower_bound to find the right place for this insertion.
-      const auto new_hint = lower_bound(key);
-
-      if (new_hint->key == key)
-        return new_hint;
-
-      return _storage.emplace(
-            new_hint, Element::make(key, std::forward<Args>(args)...));
-    }
-
-    if (hint->key == key)
-      return hint;
-
-    if (key < hint->key)
-    {
-      if (hint == _storage.begin())
-      {
-        return _storage.emplace(
-              hint, Element::make(key, std::forward<Args>(args)...));
-      }
-      else if ( (--const_iterator(hint))->key < key)
-      {
-        return _storage.emplace(
-              hint, Element::make(key, std::forward<Args>(args)...));
-      }
-
-      // If the above tests failed, then we don't have a perfect hint, but at
-      // least we know that it's on the correct side of hint, so we'll use that
-      // for the upper bound on the search.
-      const auto new_hint =
-          std::lower_bound(_storage.begin(), hint, key, Comparison());
-
-      if (new_hint->key == key)
-        return new_hint;
-
-      return _storage.emplace(
-            new_hint, Element::make(key, std::forward<Args>(args)...));
-    }
-
-    // If the above tests failed, then we have been given a bad hint, but at
-    // least we know hint is on the lower end of the bound.
-    const auto new_hint =
-        std::lower_bound(hint, _storage.end(), key, Comparison());
-
-    if (new_hint->key == key)
-      return new_hint;
-
-    return _storage.emplace(
-          new_hint, Element::make(key, std::forward<Args>(args)...));
-  }
-
-  /// Rotate the elements of the vector so that the mover is located right in
-  /// front of the target.
-  void rotate(iterator mover, iterator target)
-  {
-    // These conditions should be checked by change_time before the rotate()
-    // function gets used.
-    assert(mover != target);
-    assert(mover + 1 != target);
-
-    if (mover < target)
-    {
-      std::rotate(mover, mover+1, target);
-    }
-    else
-    {
-      assert(target < mover);
-      std::rotate(target, mover, mover+1);
-    }
-  }
-
-  iterator erase(const Key& key)
-  {
-    const auto it = lower_bound(key);
-    if (it->key == key)
-      return _storage.erase(it);
-
-    return _storage.end();
-  }
-
-  iterator erase(iterator begin, iterator end)
-  {
-    return _storage.erase(begin, end);
-  }
-
-  iterator erase(iterator it)
-  {
-    return _storage.erase(it);
-  }
-
-  iterator erase(const_iterator it)
-  {
-    return _storage.erase(it);
-  }
-
-  iterator find(const Key& key)
-  {
-    const auto it = lower_bound(key);
-    if (it->key == key)
-      return it;
-
-    return _storage.end();
-  }
-
-  const_iterator find(const Key& key) const
-  {
-    const auto it = lower_bound(key);
-    if (it->key == key)
-      return it;
-
-    return _storage.end();
-  }
-
-  Element& operator[](const std::size_t index)
-  {
-    return _storage[index];
-  }
+  std::vector<Time> times;
+  std::vector<Eigen::Vector3d> positions;
+  std::vector<Eigen::Vector3d> velocities;
 
-  const Element& operator[](const std::size_t index) const
-  {
-    return _storage[index];
-  }
+  /// The slot of the waypoint at each index
+  std::vector<std::size_t> slots;
 
-  Element& at(const std::size_t index)
-  {
-    return _storage.at(index);
-  }
+  /// The index of the waypoint in each slot. Entries for free slots are
+  /// meaningless.
+  std::vector<std::size_t> indices;
 
-  const Element& at(const std::size_t index) const
-  {
-    return _storage.at(index);
-  }
+  /// Slots that are not being used by any waypoint
+  std::vector<std::size_t> free_slots;
 
   std::size_t size() const
   {
-    return _storage.size();
+    return times.size();
   }
-
-  bool empty() const
-  {
-    return _storage.empty();
-  }
-
-private:
-  Storage _storage;
 };
 
-using OrderMap = TemplateOrderMap<Time, WaypointList::iterator>;
+//==============================================================================
+/// The slot value used by the end() iterator of a Trajectory
+const std::size_t EndSlot = std::numeric_limits<std::size_t>::max();
 
 //==============================================================================
-struct WaypointElement
+/// A lightweight reference to a position inside of a TrajectoryStorage
+struct RawIterator
 {
-  struct Data
-  {
-    Time time;
-    Eigen::Vector3d position;
-    Eigen::Vector3d velocity;
-  };
-
-  Data data;
-
-  // We store a Trajectory::Waypoint in this struct so that we can always safely
-  // return a reference to a Trajectory::Waypoint object. As long as this
-  // WaypointData is alive, any Trajectory::Waypoint reference that refers to it
-  // will remain valid.
-  std::unique_ptr<Trajectory::Waypoint> myself;
-
-  WaypointElement(Data input_data)
-  : data(std::move(input_data))
-  {
-    // Do nothing
-  }
-
-  WaypointElement(const WaypointElement& other)
-  : data(other.data)
-  {
-    // Do nothing
-  }
-
-  WaypointElement& operator=(const WaypointElement& other)
-  {
-    data = other.data;
-    return *this;
-  }
+  const TrajectoryStorage* storage;
 
-  WaypointElement(WaypointElement&&) = default;
-  WaypointElement& operator=(WaypointElement&&) = default;
+  /// The index of the waypoint. For the end() iterator this will be equal to
+  /// the size of the storage.
+  std::size_t index;
 };
 
 //==============================================================================
-WaypointList::const_iterator get_raw_iterator(
-  const Trajectory::const_iterator& iterator);
+RawIterator get_raw_iterator(const Trajectory::const_iterator& iterator);
 
 } // namespace internal
 } // namespace rmf_traffic
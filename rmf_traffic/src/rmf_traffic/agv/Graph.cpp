@@ -20,48 +20,10 @@
 #include <rmf_traffic/agv/Graph.hpp>
 
 #include <rmf_utils/math.hpp>
-#include <rmf_utils/optional.hpp>
 
 namespace rmf_traffic {
 namespace agv {
 
-//==============================================================================
-class Graph::Waypoint::Implementation
-{
-public:
-
-  std::size_t index;
-
-  std::string map_name;
-
-  Eigen::Vector2d location;
-
-  rmf_utils::optional<std::string> name = rmf_utils::nullopt;
-
-  bool holding_point = false;
-
-  bool passthrough_point = false;
-
-  bool parking_spot = false;
-
-  bool charger = false;
-
-  template<typename... Args>
-  static Waypoint make(Args&& ... args)
-  {
-    Waypoint result;
-    result._pimpl = rmf_utils::make_impl<Implementation>(
-      Implementation{std::forward<Args>(args)...});
-
-    return result;
-  }
-
-  static Waypoint::Implementation& get(Waypoint& wp)
-  {
-    return *wp._pimpl;
-  }
-};
-
 //==============================================================================
 const std::string& Graph::Waypoint::get_map_name() const
 {
@@ -71,7 +33,11 @@ const std::string& Graph::Waypoint::get_map_name() const
 //==============================================================================
 auto Graph::Waypoint::set_map_name(std::string map) -> Waypoint&
 {
+  _pimpl->map_id = MapId::intern(map);
   _pimpl->map_name = std::move(map);
+  if (const auto spatial_index = _pimpl->spatial_index.lock())
+    spatial_index->invalidate();
+
   return *this;
 }
 
@@ -85,6 +51,9 @@ const Eigen::Vector2d& Graph::Waypoint::get_location() const
 auto Graph::Waypoint::set_location(Eigen::Vector2d location) -> Waypoint&
 {
   _pimpl->location = std::move(location);
+  if (const auto spatial_index = _pimpl->spatial_index.lock())
+    spatial_index->invalidate();
+
   return *this;
 }
 
@@ -723,6 +692,10 @@ auto Graph::add_waypoint(
       _pimpl->waypoints.size(),
       std::move(map_name), std::move(location)));
 
+  Waypoint::Implementation::get(_pimpl->waypoints.back()).spatial_index =
+    _pimpl->spatial_index;
+  _pimpl->spatial_index->invalidate();
+
   _pimpl->lanes_from.push_back({});
   _pimpl->lanes_into.push_back({});
   _pimpl->lane_between.push_back({});
@@ -838,6 +811,7 @@ auto Graph::add_lane(
       std::move(exit),
       false, std::size_t()));
 
+  _pimpl->spatial_index->invalidate();
   return _pimpl->lanes.back();
 }
 
@@ -883,5 +857,32 @@ auto Graph::lane_from(std::size_t from_wp, std::size_t to_wp) const
   return const_cast<Graph&>(*this).lane_from(from_wp, to_wp);
 }
 
+//==============================================================================
+rmf_utils::optional<std::size_t> Graph::find_nearest_waypoint(
+  const std::string& map_name,
+  const Eigen::Vector2d& location,
+  const std::function<bool(const Waypoint&)>& filter) const
+{
+  const auto map = MapId::find(map_name);
+  if (!map)
+    return rmf_utils::nullopt;
+
+  std::function<bool(std::size_t)> index_filter;
+  if (filter)
+  {
+    index_filter = [this, &filter](const std::size_t wp)
+      {
+        return filter(_pimpl->waypoints[wp]);
+      };
+  }
+
+  const auto nearest = _pimpl->get_spatial_index()->nearest_waypoint(
+    *map, location, index_filter);
+  if (!nearest)
+    return rmf_utils::nullopt;
+
+  return *nearest;
+}
+
 } // namespace avg
 } // namespace rmf_traffic
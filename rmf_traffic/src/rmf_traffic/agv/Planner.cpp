@@ -18,8 +18,15 @@
 #include <rmf_traffic/agv/Planner.hpp>
 #include <rmf_traffic/agv/debug/debug_Planner.hpp>
 
+#include "internal_Graph.hpp"
 #include "internal_Planner.hpp"
 #include "internal_planning.hpp"
+#include "../internal_run_in_parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <mutex>
 
 namespace rmf_traffic {
 namespace agv {
@@ -37,6 +44,12 @@ public:
   Graph graph;
   VehicleTraits traits;
   Interpolate::Options interpolation;
+  rmf_utils::optional<std::string> heuristic_cache_file;
+  rmf_utils::optional<std::vector<std::size_t>> precompute_heuristics;
+  std::vector<double> precompute_goal_orientations;
+  std::size_t precomputation_threads;
+  std::size_t heuristic_landmarks;
+  rmf_utils::optional<std::size_t> heuristic_cache_budget;
 
 };
 
@@ -49,7 +62,13 @@ Planner::Configuration::Configuration(
       Implementation{
         std::move(graph),
         std::move(traits),
-        std::move(interpolation)
+        std::move(interpolation),
+        rmf_utils::nullopt,
+        rmf_utils::nullopt,
+        {},
+        0,
+        0,
+        rmf_utils::nullopt
       }))
 {
   // Do nothing
@@ -114,21 +133,165 @@ const Interpolate::Options& Planner::Configuration::interpolation() const
   return _pimpl->interpolation;
 }
 
+//==============================================================================
+auto Planner::Configuration::heuristic_cache_file(
+  rmf_utils::optional<std::string> filename) -> Configuration&
+{
+  _pimpl->heuristic_cache_file = std::move(filename);
+  return *this;
+}
+
+//==============================================================================
+const rmf_utils::optional<std::string>&
+Planner::Configuration::heuristic_cache_file() const
+{
+  return _pimpl->heuristic_cache_file;
+}
+
+//==============================================================================
+auto Planner::Configuration::precompute_heuristics(
+  rmf_utils::optional<std::vector<std::size_t>> goals) -> Configuration&
+{
+  _pimpl->precompute_heuristics = std::move(goals);
+  return *this;
+}
+
+//==============================================================================
+const rmf_utils::optional<std::vector<std::size_t>>&
+Planner::Configuration::precompute_heuristics() const
+{
+  return _pimpl->precompute_heuristics;
+}
+
+//==============================================================================
+auto Planner::Configuration::precompute_goal_orientations(
+  std::vector<double> yaws) -> Configuration&
+{
+  _pimpl->precompute_goal_orientations = std::move(yaws);
+  return *this;
+}
+
+//==============================================================================
+const std::vector<double>&
+Planner::Configuration::precompute_goal_orientations() const
+{
+  return _pimpl->precompute_goal_orientations;
+}
+
+//==============================================================================
+auto Planner::Configuration::precomputation_threads(
+  const std::size_t num_threads) -> Configuration&
+{
+  _pimpl->precomputation_threads = num_threads;
+  return *this;
+}
+
+//==============================================================================
+std::size_t Planner::Configuration::precomputation_threads() const
+{
+  return _pimpl->precomputation_threads;
+}
+
+//==============================================================================
+auto Planner::Configuration::heuristic_landmarks(
+  const std::size_t num_landmarks) -> Configuration&
+{
+  _pimpl->heuristic_landmarks = num_landmarks;
+  return *this;
+}
+
+//==============================================================================
+std::size_t Planner::Configuration::heuristic_landmarks() const
+{
+  return _pimpl->heuristic_landmarks;
+}
+
+//==============================================================================
+auto Planner::Configuration::heuristic_cache_budget(
+  rmf_utils::optional<std::size_t> bytes) -> Configuration&
+{
+  _pimpl->heuristic_cache_budget = bytes;
+  return *this;
+}
+
+//==============================================================================
+const rmf_utils::optional<std::size_t>&
+Planner::Configuration::heuristic_cache_budget() const
+{
+  return _pimpl->heuristic_cache_budget;
+}
+
+namespace {
+//==============================================================================
+/// Keeps a validator together with a token that identifies it. Every validator
+/// that gets assigned, including the clone that is made by a copy, receives a
+/// new token, so a token is never shared by two different validators even if
+/// one of them ends up at the address of the other.
+struct IdentifiedValidator
+{
+  static std::size_t next_token()
+  {
+    static std::atomic_size_t counter{0};
+    return ++counter;
+  }
+
+  IdentifiedValidator(rmf_utils::clone_ptr<RouteValidator> validator_)
+  : validator(std::move(validator_)),
+    token(next_token())
+  {
+    // Do nothing
+  }
+
+  IdentifiedValidator(const IdentifiedValidator& other)
+  : validator(other.validator),
+    token(next_token())
+  {
+    // Do nothing
+  }
+
+  IdentifiedValidator& operator=(const IdentifiedValidator& other)
+  {
+    validator = rmf_utils::clone_ptr<RouteValidator>(other.validator);
+    token = next_token();
+    return *this;
+  }
+
+  IdentifiedValidator(IdentifiedValidator&&) = default;
+  IdentifiedValidator& operator=(IdentifiedValidator&&) = default;
+
+  rmf_utils::clone_ptr<RouteValidator> validator;
+  std::size_t token;
+};
+} // anonymous namespace
+
 //==============================================================================
 class Planner::Options::Implementation
 {
 public:
 
-  rmf_utils::clone_ptr<RouteValidator> validator;
+  IdentifiedValidator validator;
   Duration min_hold_time;
   rmf_utils::optional<double> maximum_cost_estimate;
   rmf_utils::optional<std::size_t> saturation_limit;
 
   std::function<bool()> interrupter = nullptr;
   std::shared_ptr<const bool> interrupt_flag = nullptr;
+  bool incremental_replanning = false;
+  bool collect_statistics = false;
+  std::optional<std::size_t> parallel_starts = std::nullopt;
 
+  static std::size_t validator_token(const Options& options)
+  {
+    return options._pimpl->validator.token;
+  }
 };
 
+//==============================================================================
+std::size_t validator_token(const Planner::Options& options)
+{
+  return Planner::Options::Implementation::validator_token(options);
+}
+
 //==============================================================================
 Planner::Options::Options(
   rmf_utils::clone_ptr<RouteValidator> validator,
@@ -170,14 +333,14 @@ Planner::Options::Options(
 auto Planner::Options::validator(rmf_utils::clone_ptr<RouteValidator> v)
 -> Options&
 {
-  _pimpl->validator = std::move(v);
+  _pimpl->validator = IdentifiedValidator(std::move(v));
   return *this;
 }
 
 //==============================================================================
 const rmf_utils::clone_ptr<RouteValidator>& Planner::Options::validator() const
 {
-  return _pimpl->validator;
+  return _pimpl->validator.validator;
 }
 
 //==============================================================================
@@ -260,6 +423,46 @@ rmf_utils::optional<std::size_t> Planner::Options::saturation_limit() const
   return _pimpl->saturation_limit;
 }
 
+//==============================================================================
+auto Planner::Options::incremental_replanning(const bool on) -> Options&
+{
+  _pimpl->incremental_replanning = on;
+  return *this;
+}
+
+//==============================================================================
+bool Planner::Options::incremental_replanning() const
+{
+  return _pimpl->incremental_replanning;
+}
+
+//==============================================================================
+auto Planner::Options::collect_statistics(const bool on) -> Options&
+{
+  _pimpl->collect_statistics = on;
+  return *this;
+}
+
+//==============================================================================
+bool Planner::Options::collect_statistics() const
+{
+  return _pimpl->collect_statistics;
+}
+
+//==============================================================================
+auto Planner::Options::parallel_starts(
+  const std::optional<std::size_t> num_threads) -> Options&
+{
+  _pimpl->parallel_starts = num_threads;
+  return *this;
+}
+
+//==============================================================================
+std::optional<std::size_t> Planner::Options::parallel_starts() const
+{
+  return _pimpl->parallel_starts;
+}
+
 //==============================================================================
 class Planner::Start::Implementation
 {
@@ -483,13 +686,17 @@ Planner::Result Planner::Result::Implementation::generate(
   planning::InterfacePtr interface,
   const std::vector<Planner::Start>& starts,
   Planner::Goal goal,
-  Planner::Options options)
+  Planner::Options options,
+  const planning::State* previous)
 {
   // TODO(MXG): Throw an exception if any of the starts or the goal has an
   // invalid waypoint index.
   auto state = interface->initiate(
         starts, std::move(goal), std::move(options));
 
+  if (previous && state.conditions.options.incremental_replanning())
+    interface->reuse_search(state, *previous);
+
   auto plan = Plan::Implementation::make(interface->plan(state));
 
   Planner::Result result;
@@ -531,12 +738,42 @@ auto Planner::Result::Implementation::get(const Result& r)
   return *r._pimpl;
 }
 
+//==============================================================================
+auto Planner::Result::Implementation::get(Result& r) -> Implementation&
+{
+  return *r._pimpl;
+}
+
 //==============================================================================
 auto Planner::get_configuration() const -> const Configuration&
 {
   return _pimpl->configuration;
 }
 
+//==============================================================================
+bool Planner::save_heuristic_cache(const std::string& filename) const
+{
+  return _pimpl->interface->save_heuristic_cache(filename);
+}
+
+//==============================================================================
+bool Planner::load_heuristic_cache(const std::string& filename) const
+{
+  return _pimpl->interface->load_heuristic_cache(filename);
+}
+
+//==============================================================================
+bool Planner::heuristics_precomputed() const
+{
+  return _pimpl->interface->heuristics_precomputed();
+}
+
+//==============================================================================
+auto Planner::heuristic_cache_statistics() const -> HeuristicCacheStatistics
+{
+  return _pimpl->interface->heuristic_cache_statistics();
+}
+
 //==============================================================================
 Planner& Planner::set_default_options(Options default_options)
 {
@@ -582,11 +819,7 @@ Planner::Result Planner::plan(
 //==============================================================================
 Planner::Result Planner::plan(const StartSet& starts, Goal goal) const
 {
-  return Result::Implementation::generate(
-    _pimpl->interface,
-    starts,
-    std::move(goal),
-    _pimpl->default_options);
+  return plan(starts, std::move(goal), _pimpl->default_options);
 }
 
 //==============================================================================
@@ -595,6 +828,31 @@ Planner::Result Planner::plan(
   Goal goal,
   Options options) const
 {
+  if (starts.size() > 1 && options.parallel_starts())
+  {
+    std::vector<Problem> problems;
+    problems.reserve(starts.size());
+    for (const auto& start : starts)
+      problems.push_back(Problem{{start}, goal, options});
+
+    auto output = plan_in_parallel(problems, *options.parallel_starts());
+    if (output.best)
+      return std::move(output.results[*output.best]);
+
+    // None of the starts can reach the goal, so give back the Result of the one
+    // that looked the most promising.
+    const double inf = std::numeric_limits<double>::infinity();
+    std::size_t chosen = 0;
+    for (std::size_t i = 1; i < output.results.size(); ++i)
+    {
+      if (output.results[i].ideal_cost().value_or(inf)
+        < output.results[chosen].ideal_cost().value_or(inf))
+        chosen = i;
+    }
+
+    return std::move(output.results[chosen]);
+  }
+
   return Result::Implementation::generate(
     _pimpl->interface,
     starts,
@@ -648,6 +906,99 @@ Planner::Result Planner::setup(
     std::move(options));
 }
 
+//==============================================================================
+auto Planner::plan_in_parallel(
+  const std::vector<Problem>& problems,
+  const std::size_t num_threads) const -> ParallelResults
+{
+  const std::size_t N = problems.size();
+
+  // Set up every problem first so that we know their ideal costs
+  std::vector<std::optional<Result>> setups(N);
+  run_in_parallel(N, num_threads, [&](const std::size_t i)
+    {
+      const auto& problem = problems[i];
+      setups[i] = Result::Implementation::setup(
+        _pimpl->interface, problem.starts, problem.goal, problem.options);
+    });
+
+  ParallelResults output;
+  output.results.reserve(N);
+  for (auto& setup : setups)
+    output.results.emplace_back(std::move(*setup));
+
+  // The problems that might be cheapest get searched first, so that the bound
+  // gets tight quickly.
+  const double inf = std::numeric_limits<double>::infinity();
+  std::vector<std::size_t> order(N);
+  for (std::size_t i = 0; i < N; ++i)
+    order[i] = i;
+
+  std::stable_sort(order.begin(), order.end(),
+    [&](const std::size_t a, const std::size_t b)
+    {
+      const auto& state_a = Result::Implementation::get(output.results[a]).state;
+      const auto& state_b = Result::Implementation::get(output.results[b]).state;
+      return state_a.ideal_cost.value_or(inf) < state_b.ideal_cost.value_or(inf);
+    });
+
+  std::atomic<double> bound(inf);
+  std::mutex best_mutex;
+  double best_cost = inf;
+  run_in_parallel(N, num_threads, [&](const std::size_t k)
+    {
+      const std::size_t i = order[k];
+      auto& result = Result::Implementation::get(output.results[i]);
+      auto& state = result.state;
+
+      // A search is only ever cancelled when its cost cannot possibly be as
+      // low as a plan that was already found, so it could never have been the
+      // best. That is what keeps the best result deterministic.
+      if (bound.load() < state.ideal_cost.value_or(inf))
+      {
+        state.issues.interrupted = true;
+        return;
+      }
+
+      auto& options = state.conditions.options;
+      const auto interrupt_flag = options.interrupt_flag();
+      const auto interrupter = options.interrupter();
+      const planning::State::Internal* const internal = state.internal.get();
+      options.interrupter(
+        [&bound, internal, interrupter]() -> bool
+        {
+          if (interrupter && interrupter())
+            return true;
+
+          const auto lower_bound = internal->cost_estimate();
+          return lower_bound && bound.load() < *lower_bound;
+        });
+
+      result.plan = Plan::Implementation::make(result.interface->plan(state));
+
+      // Put back the original interruption settings in case the Result gets
+      // resumed later.
+      if (interrupt_flag)
+        options.interrupt_flag(interrupt_flag);
+      else
+        options.interrupter(interrupter);
+
+      if (!result.plan)
+        return;
+
+      const double cost = result.plan->get_cost();
+      std::lock_guard<std::mutex> lock(best_mutex);
+      if (cost < best_cost || (cost == best_cost && i < *output.best))
+      {
+        best_cost = cost;
+        output.best = i;
+        bound = cost;
+      }
+    });
+
+  return output;
+}
+
 //==============================================================================
 bool Planner::Result::success() const
 {
@@ -697,7 +1048,8 @@ Planner::Result Planner::Result::replan(const Start& new_start) const
     _pimpl->interface,
     {new_start},
     _pimpl->state.conditions.goal,
-    _pimpl->state.conditions.options);
+    _pimpl->state.conditions.options,
+    &_pimpl->state);
 }
 
 //==============================================================================
@@ -709,7 +1061,8 @@ Planner::Result Planner::Result::replan(
     _pimpl->interface,
     {new_start},
     _pimpl->state.conditions.goal,
-    std::move(new_options));
+    std::move(new_options),
+    &_pimpl->state);
 }
 
 //==============================================================================
@@ -719,7 +1072,8 @@ Planner::Result Planner::Result::replan(const StartSet& new_starts) const
     _pimpl->interface,
     new_starts,
     _pimpl->state.conditions.goal,
-    _pimpl->state.conditions.options);
+    _pimpl->state.conditions.options,
+    &_pimpl->state);
 }
 
 //==============================================================================
@@ -731,7 +1085,8 @@ Planner::Result Planner::Result::replan(
     _pimpl->interface,
     new_starts,
     _pimpl->state.conditions.goal,
-    std::move(new_options));
+    std::move(new_options),
+    &_pimpl->state);
 }
 
 //==============================================================================
@@ -800,6 +1155,9 @@ bool Planner::Result::resume(std::shared_ptr<const bool> interrupt_flag)
 //==============================================================================
 Planner::Options& Planner::Result::options()
 {
+  // The caller might change the validator, so we can't trust anything that
+  // was learned from the old one.
+  _pimpl->state.internal->clear_validation_cache();
   return _pimpl->state.conditions.options;
 }
 
@@ -812,6 +1170,7 @@ const Planner::Options& Planner::Result::options() const
 //==============================================================================
 Planner::Result& Planner::Result::options(Options new_options)
 {
+  _pimpl->state.internal->clear_validation_cache();
   _pimpl->state.conditions.options = std::move(new_options);
   return *this;
 }
@@ -885,6 +1244,21 @@ std::vector<schedule::ParticipantId> Planner::Result::blockers() const
   return blockers;
 }
 
+//==============================================================================
+std::size_t Planner::Result::reused_node_count() const
+{
+  return _pimpl->state.internal->reused_node_count();
+}
+
+//==============================================================================
+auto Planner::Result::statistics() const -> const SearchStatistics*
+{
+  if (_pimpl->state.statistics.has_value())
+    return &*_pimpl->state.statistics;
+
+  return nullptr;
+}
+
 //==============================================================================
 Planner::Result::Result()
 {
@@ -976,37 +1350,32 @@ std::vector<Plan::Start> compute_plan_starts(
   const Eigen::Vector2d p_location = {pose[0], pose[1]};
   const double start_yaw = pose[2];
 
-  // If there are waypoints which are very close, take that as the only Start
-  for (std::size_t i = 0; i < graph.num_waypoints(); ++i)
-  {
-    const auto& wp = graph.get_waypoint(i);
-    if (wp.get_map_name() != map_name)
-      continue;
+  // If the map name has never been interned then no waypoint can be on it
+  const auto map = MapId::find(map_name);
+  if (!map)
+    return {};
 
-    const Eigen::Vector2d wp_location = wp.get_location();
+  const auto index = Graph::Implementation::get(graph).get_spatial_index();
 
-    if ( (p_location - wp_location).norm() < max_merge_waypoint_distance)
-    {
-      return {Plan::Start(start_time, wp.index(), start_yaw)};
-    }
-  }
+  // If there are waypoints which are very close, take the one with the lowest
+  // index as the only Start
+  const auto close_waypoints =
+    index->waypoints_within(*map, p_location, max_merge_waypoint_distance);
+  if (!close_waypoints.empty())
+    return {Plan::Start(start_time, close_waypoints.front(), start_yaw)};
 
   // Iterate through the lanes and return the set of possible waypoints, i.e.
-  // entries and exits of nearby lanes.
+  // entries and exits of nearby lanes. The spatial index only gives us the
+  // lanes that could be close enough, and they are both on the requested map.
   std::vector<Plan::Start> starts;
   std::unordered_set<std::size_t> raw_starts;
 
-  for (std::size_t i = 0; i < graph.num_lanes(); ++i)
+  for (const std::size_t i
+    : index->lanes_near(*map, p_location, max_merge_lane_distance))
   {
     const auto& lane = graph.get_lane(i);
     const auto& wp0 = graph.get_waypoint(lane.entry().waypoint_index());
-    if (wp0.get_map_name() != map_name)
-      continue;
-
     const auto& wp1 = graph.get_waypoint(lane.exit().waypoint_index());
-    if (wp1.get_map_name() != map_name)
-      continue;
-
     const Eigen::Vector2d p0 = wp0.get_location();
     const Eigen::Vector2d p1 = wp1.get_location();
 
@@ -15,23 +15,20 @@
  *
 */
 
-#include <rmf_traffic/agv/RouteValidator.hpp>
+#include "internal_RouteValidator.hpp"
+#include "../internal_Route.hpp"
+
 #include <rmf_traffic/DetectConflict.hpp>
 
 namespace rmf_traffic {
 namespace agv {
 
 //==============================================================================
-class ScheduleRouteValidator::Implementation
+auto ScheduleRouteValidator::Implementation::get(
+  const ScheduleRouteValidator& validator) -> const Implementation&
 {
-public:
-
-  std::shared_ptr<const schedule::Viewer> shared_viewer;
-  const schedule::Viewer* viewer;
-  schedule::ParticipantId participant;
-  Profile profile;
-
-};
+  return *validator._pimpl;
+}
 
 //==============================================================================
 ScheduleRouteValidator::ScheduleRouteValidator(
@@ -417,7 +414,7 @@ NegotiatingRouteValidator::find_conflict(const Route& route) const
         .at(r.participant)
         ->at(r.version).back();
 
-    if (route.map() != last_route->map())
+    if (RouteData::get(route).map_id != RouteData::get(*last_route).map_id)
       continue;
 
     const auto& last_wp = last_route->trajectory().back();
@@ -0,0 +1,326 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "SpatialIndex.hpp"
+#include "internal_Graph.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace rmf_traffic {
+namespace agv {
+
+namespace {
+
+// A lane whose bounding box covers more than this many cells of the lane grid
+// is kept in the list of long lanes instead.
+const std::size_t MaxCellsPerLane = 64;
+
+// Cell coordinates get clamped to this magnitude so that enormous (or infinite)
+// query radii do not overflow the integer cell indices.
+const int64_t MaxCellIndex = int64_t(1) << 40;
+
+//==============================================================================
+int64_t to_cell_index(const double value, const double cell_size)
+{
+  const double index = std::floor(value / cell_size);
+  if (std::isnan(index))
+    return 0;
+
+  if (index < -static_cast<double>(MaxCellIndex))
+    return -MaxCellIndex;
+
+  if (static_cast<double>(MaxCellIndex) < index)
+    return MaxCellIndex;
+
+  return static_cast<int64_t>(index);
+}
+
+//==============================================================================
+double cell_count(
+  const int64_t min_x, const int64_t max_x,
+  const int64_t min_y, const int64_t max_y)
+{
+  return (static_cast<double>(max_x - min_x) + 1.0)
+    * (static_cast<double>(max_y - min_y) + 1.0);
+}
+
+} // anonymous namespace
+
+//==============================================================================
+auto SpatialIndex::MapIndex::cell_of(const Eigen::Vector2d& p) const -> Cell
+{
+  return Cell{to_cell_index(p.x(), cell_size), to_cell_index(p.y(), cell_size)};
+}
+
+//==============================================================================
+void SpatialIndex::build_tree(
+  const std::vector<Point>::iterator begin,
+  const std::vector<Point>::iterator end,
+  const std::size_t depth)
+{
+  if (end - begin < 2)
+    return;
+
+  const std::size_t axis = depth % 2;
+  const auto mid = begin + (end - begin)/2;
+  std::nth_element(
+    begin, mid, end,
+    [axis](const Point& a, const Point& b) { return a.p[axis] < b.p[axis]; });
+
+  build_tree(begin, mid, depth+1);
+  build_tree(mid+1, end, depth+1);
+}
+
+//==============================================================================
+std::shared_ptr<const SpatialIndex> SpatialIndex::make(
+  const Graph::Implementation& graph)
+{
+  auto index = std::make_shared<SpatialIndex>();
+
+  for (const auto& wp : graph.waypoints)
+  {
+    const auto& data = Graph::Waypoint::Implementation::get(wp);
+    index->_maps[data.map_id].tree.push_back(Point{data.location, data.index});
+  }
+
+  for (auto& [map, map_index] : index->_maps)
+  {
+    (void)(map);
+    build_tree(map_index.tree.begin(), map_index.tree.end(), 0);
+  }
+
+  // Size the cells of each lane grid to the average length of the lanes on
+  // that map, so that a typical lane only lands in a few cells.
+  std::unordered_map<MapId, std::vector<std::size_t>, MapId::Hash> map_lanes;
+  std::unordered_map<MapId, double, MapId::Hash> total_length;
+  for (std::size_t i = 0; i < graph.lanes.size(); ++i)
+  {
+    const auto& lane = graph.lanes[i];
+    const auto& wp0 = Graph::Waypoint::Implementation::get(
+      graph.waypoints[lane.entry().waypoint_index()]);
+    const auto& wp1 = Graph::Waypoint::Implementation::get(
+      graph.waypoints[lane.exit().waypoint_index()]);
+
+    if (wp0.map_id != wp1.map_id)
+      continue;
+
+    map_lanes[wp0.map_id].push_back(i);
+    total_length[wp0.map_id] += (wp1.location - wp0.location).norm();
+  }
+
+  for (const auto& [map, lanes] : map_lanes)
+  {
+    auto& map_index = index->_maps[map];
+    const double mean_length =
+      total_length[map] / static_cast<double>(lanes.size());
+    if (std::isfinite(mean_length) && mean_length > 0.0)
+      map_index.cell_size = mean_length;
+
+    for (const std::size_t i : lanes)
+    {
+      const auto& lane = graph.lanes[i];
+      const auto& p0 = graph.waypoints[lane.entry().waypoint_index()]
+        .get_location();
+      const auto& p1 = graph.waypoints[lane.exit().waypoint_index()]
+        .get_location();
+
+      const Cell min = map_index.cell_of(p0.cwiseMin(p1));
+      const Cell max = map_index.cell_of(p0.cwiseMax(p1));
+      if (static_cast<double>(MaxCellsPerLane)
+        < cell_count(min.x, max.x, min.y, max.y))
+      {
+        map_index.long_lanes.push_back(i);
+        continue;
+      }
+
+      for (int64_t x = min.x; x <= max.x; ++x)
+      {
+        for (int64_t y = min.y; y <= max.y; ++y)
+          map_index.grid[Cell{x, y}].push_back(i);
+      }
+    }
+  }
+
+  return index;
+}
+
+//==============================================================================
+std::vector<std::size_t> SpatialIndex::waypoints_within(
+  const MapId map,
+  const Eigen::Vector2d& location,
+  const double radius) const
+{
+  std::vector<std::size_t> output;
+  const auto map_it = _maps.find(map);
+  if (map_it == _maps.end() || !(radius > 0.0))
+    return output;
+
+  const double radius_squared = radius*radius;
+  const auto search = [&](
+    const auto& self,
+    const std::vector<Point>::const_iterator begin,
+    const std::vector<Point>::const_iterator end,
+    const std::size_t depth) -> void
+    {
+      if (begin == end)
+        return;
+
+      const std::size_t axis = depth % 2;
+      const auto mid = begin + (end - begin)/2;
+      if ((mid->p - location).squaredNorm() < radius_squared)
+        output.push_back(mid->waypoint);
+
+      const double diff = location[axis] - mid->p[axis];
+      if (diff < radius)
+        self(self, begin, mid, depth+1);
+
+      if (-radius < diff)
+        self(self, mid+1, end, depth+1);
+    };
+
+  const auto& tree = map_it->second.tree;
+  search(search, tree.begin(), tree.end(), 0);
+  std::sort(output.begin(), output.end());
+  return output;
+}
+
+//==============================================================================
+std::optional<std::size_t> SpatialIndex::nearest_waypoint(
+  const MapId map,
+  const Eigen::Vector2d& location,
+  const std::function<bool(std::size_t)>& filter) const
+{
+  const auto map_it = _maps.find(map);
+  if (map_it == _maps.end())
+    return std::nullopt;
+
+  std::optional<std::size_t> nearest;
+  double best = std::numeric_limits<double>::infinity();
+  const auto search = [&](
+    const auto& self,
+    const std::vector<Point>::const_iterator begin,
+    const std::vector<Point>::const_iterator end,
+    const std::size_t depth) -> void
+    {
+      if (begin == end)
+        return;
+
+      const std::size_t axis = depth % 2;
+      const auto mid = begin + (end - begin)/2;
+      const double dist = (mid->p - location).squaredNorm();
+      if (dist < best || (dist == best && nearest && mid->waypoint < *nearest))
+      {
+        if (!filter || filter(mid->waypoint))
+        {
+          best = dist;
+          nearest = mid->waypoint;
+        }
+      }
+
+      // Search the side of the split that contains the location first, since
+      // that is where the nearest waypoint is most likely to be.
+      const double diff = location[axis] - mid->p[axis];
+      const auto near_begin = diff < 0.0 ? begin : mid+1;
+      const auto near_end = diff < 0.0 ? mid : end;
+      const auto far_begin = diff < 0.0 ? mid+1 : begin;
+      const auto far_end = diff < 0.0 ? end : mid;
+
+      self(self, near_begin, near_end, depth+1);
+      if (diff*diff <= best)
+        self(self, far_begin, far_end, depth+1);
+    };
+
+  const auto& tree = map_it->second.tree;
+  search(search, tree.begin(), tree.end(), 0);
+  return nearest;
+}
+
+//==============================================================================
+std::vector<std::size_t> SpatialIndex::lanes_near(
+  const MapId map,
+  const Eigen::Vector2d& location,
+  const double radius) const
+{
+  std::vector<std::size_t> output;
+  const auto map_it = _maps.find(map);
+  if (map_it == _maps.end() || !(radius > 0.0))
+    return output;
+
+  const MapIndex& map_index = map_it->second;
+  output = map_index.long_lanes;
+
+  const Eigen::Vector2d r = Eigen::Vector2d::Constant(radius);
+  const Cell min = map_index.cell_of(location - r);
+  const Cell max = map_index.cell_of(location + r);
+
+  if (cell_count(min.x, max.x, min.y, max.y)
+    < static_cast<double>(map_index.grid.size()))
+  {
+    // The radius covers fewer cells than the grid has, so it is cheaper to
+    // look up each of the cells that it covers.
+    for (int64_t x = min.x; x <= max.x; ++x)
+    {
+      for (int64_t y = min.y; y <= max.y; ++y)
+      {
+        const auto cell_it = map_index.grid.find(Cell{x, y});
+        if (cell_it == map_index.grid.end())
+          continue;
+
+        output.insert(
+          output.end(), cell_it->second.begin(), cell_it->second.end());
+      }
+    }
+  }
+  else
+  {
+    for (const auto& [cell, lanes] : map_index.grid)
+    {
+      if (cell.x < min.x || max.x < cell.x || cell.y < min.y || max.y < cell.y)
+        continue;
+
+      output.insert(output.end(), lanes.begin(), lanes.end());
+    }
+  }
+
+  // A lane appears in every cell that it touches, so remove the duplicates
+  std::sort(output.begin(), output.end());
+  output.erase(std::unique(output.begin(), output.end()), output.end());
+  return output;
+}
+
+//==============================================================================
+std::shared_ptr<const SpatialIndex> SpatialIndex::Cache::get(
+  const Graph::Implementation& graph) const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (!_index)
+    _index = SpatialIndex::make(graph);
+
+  return _index;
+}
+
+//==============================================================================
+void SpatialIndex::Cache::invalidate()
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _index = nullptr;
+}
+
+} // namespace agv
+} // namespace rmf_traffic
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__AGV__SPATIALINDEX_HPP
+#define SRC__RMF_TRAFFIC__AGV__SPATIALINDEX_HPP
+
+#include "../MapId.hpp"
+
+#include <rmf_traffic/agv/Graph.hpp>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace rmf_traffic {
+namespace agv {
+
+//==============================================================================
+/// A spatial index of the waypoints and lanes of a Graph, split up by map.
+/// The waypoints of each map are kept in a 2D k-d tree and the lanes of each
+/// map are kept in a uniform grid. Lanes that connect two different maps are
+/// not indexed.
+///
+/// The index is immutable once it has been made. Use SpatialIndex::Cache to
+/// keep an index up to date with a graph that might change.
+class SpatialIndex
+{
+public:
+
+  static std::shared_ptr<const SpatialIndex> make(
+    const Graph::Implementation& graph);
+
+  /// Get the indices of the waypoints on the map that are strictly closer than
+  /// radius to location, in ascending order.
+  std::vector<std::size_t> waypoints_within(
+    MapId map,
+    const Eigen::Vector2d& location,
+    double radius) const;
+
+  /// Get the index of the waypoint on the map that is nearest to location and
+  /// is accepted by the filter. A null filter accepts every waypoint.
+  std::optional<std::size_t> nearest_waypoint(
+    MapId map,
+    const Eigen::Vector2d& location,
+    const std::function<bool(std::size_t)>& filter = nullptr) const;
+
+  /// Get the indices of the lanes on the map that might pass closer than
+  /// radius to location, in ascending order. This is a superset of the lanes
+  /// that actually do, so the caller still needs to measure the distance.
+  std::vector<std::size_t> lanes_near(
+    MapId map,
+    const Eigen::Vector2d& location,
+    double radius) const;
+
+  /// Holds the index of one graph, builds it the first time it is needed, and
+  /// drops it whenever the graph changes. A Cache can be used by multiple
+  /// threads at once.
+  class Cache
+  {
+  public:
+
+    std::shared_ptr<const SpatialIndex> get(
+      const Graph::Implementation& graph) const;
+
+    void invalidate();
+
+  private:
+    mutable std::mutex _mutex;
+    mutable std::shared_ptr<const SpatialIndex> _index;
+  };
+
+private:
+
+  struct Point
+  {
+    Eigen::Vector2d p;
+    std::size_t waypoint;
+  };
+
+  struct Cell
+  {
+    int64_t x;
+    int64_t y;
+
+    bool operator==(const Cell& other) const
+    {
+      return x == other.x && y == other.y;
+    }
+
+    struct Hash
+    {
+      std::size_t operator()(const Cell& cell) const
+      {
+        const std::size_t hx = std::hash<int64_t>()(cell.x);
+        const std::size_t hy = std::hash<int64_t>()(cell.y);
+        return hx ^ (hy + 0x9e3779b9 + (hx << 6) + (hx >> 2));
+      }
+    };
+  };
+
+  struct MapIndex
+  {
+    // A balanced k-d tree stored in place: the median of each range is the
+    // node, and the halves before and after it are its children. The split
+    // axis alternates between x and y with depth.
+    std::vector<Point> tree;
+
+    double cell_size = 1.0;
+    std::unordered_map<Cell, std::vector<std::size_t>, Cell::Hash> grid;
+
+    // Lanes that would cover too many cells of the grid are kept aside and
+    // always treated as candidates.
+    std::vector<std::size_t> long_lanes;
+
+    Cell cell_of(const Eigen::Vector2d& p) const;
+  };
+
+  static void build_tree(
+    std::vector<Point>::iterator begin,
+    std::vector<Point>::iterator end,
+    std::size_t depth);
+
+  std::unordered_map<MapId, MapIndex, MapId::Hash> _maps;
+};
+
+} // namespace agv
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__AGV__SPATIALINDEX_HPP
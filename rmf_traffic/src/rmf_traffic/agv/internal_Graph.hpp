@@ -18,11 +18,66 @@
 #ifndef SRC__RMF_TRAFFIC__AGV__INTERNAL_GRAPH_HPP
 #define SRC__RMF_TRAFFIC__AGV__INTERNAL_GRAPH_HPP
 
+#include "../MapId.hpp"
+#include "SpatialIndex.hpp"
+
 #include <rmf_traffic/agv/Graph.hpp>
 
+#include <rmf_utils/optional.hpp>
+
 namespace rmf_traffic {
 namespace agv {
 
+//==============================================================================
+class Graph::Waypoint::Implementation
+{
+public:
+
+  std::size_t index;
+
+  std::string map_name;
+
+  Eigen::Vector2d location;
+
+  rmf_utils::optional<std::string> name = rmf_utils::nullopt;
+
+  bool holding_point = false;
+
+  bool passthrough_point = false;
+
+  bool parking_spot = false;
+
+  bool charger = false;
+
+  // The interned form of map_name, which is kept in sync with it so that the
+  // planner can compare the maps of waypoints without comparing strings
+  MapId map_id = MapId::intern(map_name);
+
+  // The spatial index of the graph that this waypoint belongs to. Changing the
+  // location or map of the waypoint drops the index.
+  std::weak_ptr<SpatialIndex::Cache> spatial_index = {};
+
+  template<typename... Args>
+  static Waypoint make(Args&& ... args)
+  {
+    Waypoint result;
+    result._pimpl = rmf_utils::make_impl<Implementation>(
+      Implementation{std::forward<Args>(args)...});
+
+    return result;
+  }
+
+  static Waypoint::Implementation& get(Waypoint& wp)
+  {
+    return *wp._pimpl;
+  }
+
+  static const Waypoint::Implementation& get(const Waypoint& wp)
+  {
+    return *wp._pimpl;
+  }
+};
+
 //==============================================================================
 class Graph::Implementation
 {
@@ -41,6 +96,40 @@ public:
 
   std::vector<std::unordered_map<std::size_t, std::size_t>> lane_between;
 
+  // This is shared with the waypoints of the graph so that they can drop the
+  // index when they get moved. A copy of the graph gets its own cache.
+  std::shared_ptr<SpatialIndex::Cache> spatial_index =
+    std::make_shared<SpatialIndex::Cache>();
+
+  Implementation() = default;
+
+  Implementation(const Implementation& other)
+  : waypoints(other.waypoints),
+    lanes(other.lanes),
+    keys(other.keys),
+    lanes_from(other.lanes_from),
+    lanes_into(other.lanes_into),
+    lane_between(other.lane_between)
+  {
+    for (auto& wp : waypoints)
+      Waypoint::Implementation::get(wp).spatial_index = spatial_index;
+  }
+
+  Implementation& operator=(const Implementation& other)
+  {
+    *this = Implementation(other);
+    return *this;
+  }
+
+  Implementation(Implementation&&) = default;
+  Implementation& operator=(Implementation&&) = default;
+
+  /// Get the spatial index of this graph, building it if necessary
+  std::shared_ptr<const SpatialIndex> get_spatial_index() const
+  {
+    return spatial_index->get(*this);
+  }
+
   static Graph::Implementation& get(Graph& graph)
   {
     return *graph._pimpl;
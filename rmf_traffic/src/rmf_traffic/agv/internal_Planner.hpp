@@ -53,6 +53,11 @@ public:
   }
 };
 
+//==============================================================================
+/// Get a token that identifies the validator of these options. Each validator
+/// given to the options, and each copy of the options, gets a new token.
+std::size_t validator_token(const Planner::Options& options);
+
 //==============================================================================
 class Planner::Result::Implementation
 {
@@ -62,11 +67,14 @@ public:
   planning::State state;
   std::optional<Plan> plan;
 
+  /// If previous is given and the options ask for incremental replanning,
+  /// the new search will try to reuse the solution of the previous state.
   static Result generate(
     planning::InterfacePtr interface,
     const std::vector<Planner::Start>& starts,
     Planner::Goal goal,
-    Planner::Options options);
+    Planner::Options options,
+    const planning::State* previous = nullptr);
 
   static Result setup(
     planning::InterfacePtr interface,
@@ -76,6 +84,8 @@ public:
 
   static const Implementation& get(const Result& r);
 
+  static Implementation& get(Result& r);
+
 };
 
 } // namespace agv
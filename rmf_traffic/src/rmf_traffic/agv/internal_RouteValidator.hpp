@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__AGV__INTERNAL_ROUTEVALIDATOR_HPP
+#define SRC__RMF_TRAFFIC__AGV__INTERNAL_ROUTEVALIDATOR_HPP
+
+#include <rmf_traffic/agv/RouteValidator.hpp>
+
+namespace rmf_traffic {
+namespace agv {
+
+//==============================================================================
+class ScheduleRouteValidator::Implementation
+{
+public:
+
+  std::shared_ptr<const schedule::Viewer> shared_viewer;
+  const schedule::Viewer* viewer;
+  schedule::ParticipantId participant;
+  Profile profile;
+
+  static const Implementation& get(const ScheduleRouteValidator& validator);
+};
+
+} // namespace agv
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__AGV__INTERNAL_ROUTEVALIDATOR_HPP
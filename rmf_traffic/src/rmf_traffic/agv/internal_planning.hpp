@@ -64,11 +64,18 @@ struct State
 
     virtual std::size_t expansion_count() const = 0;
 
+    virtual std::size_t reused_node_count() const = 0;
+
+    virtual void clear_validation_cache() = 0;
+
     virtual ~Internal() = default;
   };
 
   rmf_utils::impl_ptr<Internal> internal;
   std::size_t popped_count = 0;
+
+  // Only present when the options ask for statistics
+  std::optional<Planner::SearchStatistics> statistics = std::nullopt;
 };
 
 //==============================================================================
@@ -92,6 +99,10 @@ public:
 
   virtual std::optional<PlanData> plan(State& state) const = 0;
 
+  /// Give a freshly initiated state access to the solution of a previous state
+  /// so that the search can reuse whatever parts of it are still valid.
+  virtual void reuse_search(State& state, const State& previous) const = 0;
+
   virtual std::vector<schedule::Itinerary> rollout(
     const Duration span,
     const Issues::BlockedNodes& nodes,
@@ -101,6 +112,15 @@ public:
 
   virtual const Planner::Configuration& get_configuration() const = 0;
 
+  virtual bool save_heuristic_cache(const std::string& filename) const = 0;
+
+  virtual bool load_heuristic_cache(const std::string& filename) const = 0;
+
+  virtual bool heuristics_precomputed() const = 0;
+
+  virtual Planner::HeuristicCacheStatistics
+  heuristic_cache_statistics() const = 0;
+
   class Debugger
   {
   public:
@@ -18,16 +18,140 @@
 #ifndef SRC__RMF_TRAFFIC__AGV__PLANNING__CACHEMANAGER_HPP
 #define SRC__RMF_TRAFFIC__AGV__PLANNING__CACHEMANAGER_HPP
 
+#include "ConcurrentStorage.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <optional>
 #include <memory>
 #include <mutex>
 #include <functional>
+#include <typeindex>
 #include <unordered_map>
+#include <vector>
 
 namespace rmf_traffic {
 namespace agv {
 namespace planning {
 
+//==============================================================================
+/// Statistics about the use of a cache, which can help with tuning its memory
+/// budget.
+struct CacheStatistics
+{
+  /// The number of tables that are currently held
+  std::size_t tables = 0;
+
+  /// The number of entries in the tables that are currently held
+  std::size_t entries = 0;
+
+  /// A rough estimate of the memory used by those entries
+  std::size_t estimated_bytes = 0;
+
+  /// The number of lookups that found an entry that was already cached
+  std::size_t hits = 0;
+
+  /// The number of lookups that needed to generate an entry
+  std::size_t misses = 0;
+
+  /// The number of tables that were discarded to stay within the budget
+  std::size_t evicted_tables = 0;
+
+  /// The number of entries that were in the discarded tables
+  std::size_t evicted_entries = 0;
+
+  CacheStatistics& operator+=(const CacheStatistics& other)
+  {
+    tables += other.tables;
+    entries += other.entries;
+    estimated_bytes += other.estimated_bytes;
+    hits += other.hits;
+    misses += other.misses;
+    evicted_tables += other.evicted_tables;
+    evicted_entries += other.evicted_entries;
+    return *this;
+  }
+};
+
+//==============================================================================
+/// The lookup counters of a CacheManager. They are shared by every table that
+/// the manager creates, so they are not lost when a table gets discarded.
+struct CacheCounters
+{
+  std::atomic_size_t hits{0};
+  std::atomic_size_t misses{0};
+};
+
+//==============================================================================
+/// While a CacheLookupRecorder exists, it collects the hits and misses of every
+/// Cache that gets flushed on the thread that created it, sorted by the type of
+/// Generator. This lets one planning search find out how it used the caches
+/// even when other searches are using the same caches at the same time.
+///
+/// A Cache only reports its lookups when it is destroyed or reassigned, so the
+/// recorder must outlive the Caches that it should hear about. Recorders may be
+/// nested, in which case only the innermost one gets the lookups.
+class CacheLookupRecorder
+{
+public:
+
+  struct Lookups
+  {
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+  };
+
+  CacheLookupRecorder()
+  : _previous(_current())
+  {
+    _current() = this;
+  }
+
+  CacheLookupRecorder(const CacheLookupRecorder&) = delete;
+  CacheLookupRecorder& operator=(const CacheLookupRecorder&) = delete;
+
+  ~CacheLookupRecorder()
+  {
+    _current() = _previous;
+  }
+
+  /// The recorder that is active on this thread, if there is one
+  static CacheLookupRecorder* current()
+  {
+    return _current();
+  }
+
+  void record(std::type_index generator, std::size_t hits, std::size_t misses)
+  {
+    auto& lookups = _lookups[generator];
+    lookups.hits += hits;
+    lookups.misses += misses;
+  }
+
+  /// Get the lookups that were recorded for one type of Generator
+  template<typename G>
+  Lookups get() const
+  {
+    const auto it = _lookups.find(typeid(G));
+    if (it == _lookups.end())
+      return {};
+
+    return it->second;
+  }
+
+private:
+
+  static CacheLookupRecorder*& _current()
+  {
+    static thread_local CacheLookupRecorder* current = nullptr;
+    return current;
+  }
+
+  CacheLookupRecorder* _previous;
+  std::unordered_map<std::type_index, Lookups> _lookups;
+};
+
 //==============================================================================
 template <typename StorageArg>
 class Generator
@@ -35,12 +159,18 @@ class Generator
 public:
 
   using Storage = StorageArg;
+  using SharedStorage = ConcurrentStorage<Storage>;
   using Key = typename Storage::key_type;
   using Value = typename Storage::mapped_type;
 
+  /// An estimate of the memory that each value owns beyond its own size, such
+  /// as the nodes that a pointer refers to. Generators whose values own memory
+  /// should hide this with an estimate of their own.
+  static constexpr std::size_t value_overhead_bytes = 0;
+
   virtual Value generate(
       const Key& key,
-      const Storage& old_items,
+      const SharedStorage& old_items,
       Storage& new_items) const = 0;
 
   virtual ~Generator() = default;
@@ -70,24 +200,36 @@ public:
 
   using Generator = GeneratorArg;
   using Storage = typename Generator::Storage;
+  using SharedStorage = typename Generator::SharedStorage;
 
   Upstream(
-    std::function<Storage()> storage_initializer,
-    std::shared_ptr<const Generator> generator_)
-  : storage(std::make_shared<Storage>(storage_initializer())),
-    generator(std::move(generator_))
+    std::function<Storage()> storage_initializer_,
+    std::shared_ptr<const Generator> generator_,
+    std::shared_ptr<CacheCounters> counters_)
+  : storage(std::make_shared<SharedStorage>(storage_initializer_())),
+    generator(std::move(generator_)),
+    storage_initializer(std::move(storage_initializer_)),
+    counters(std::move(counters_))
   {
     // Do nothing
   }
 
-  std::shared_ptr<Storage> storage;
+  const std::shared_ptr<SharedStorage> storage;
   const std::shared_ptr<const Generator> generator;
+  const std::function<Storage()> storage_initializer;
+  const std::shared_ptr<CacheCounters> counters;
 };
 
 //==============================================================================
-template <typename> class CacheManager;
-
-//==============================================================================
+/// A handle for looking up items in the storage of a CacheManager. Items that
+/// are missing will be generated and inserted into the shared storage right
+/// away, so they are immediately visible to every other Cache of the same
+/// manager. Creating a Cache is cheap because it does not copy any items.
+///
+/// Each Cache counts its own hits and misses and adds them to the counters of
+/// its manager when it is destroyed, so that lookups from different threads do
+/// not contend over shared counters. It also reports them to the
+/// CacheLookupRecorder of the thread, if there is one.
 template <typename GeneratorArg>
 class Cache
 {
@@ -95,33 +237,32 @@ public:
 
   using Generator = GeneratorArg;
   using Storage = typename Generator::Storage;
-  using Self = Cache<Generator>;
   using Upstream_type = Upstream<Generator>;
 
-  Cache(
-    std::shared_ptr<const Upstream_type> upstream,
-    std::shared_ptr<const CacheManager<Self>> manager,
-    std::function<Storage()> storage_initializer);
+  Cache(std::shared_ptr<const Upstream_type> upstream);
 
+  Cache(const Cache& other);
+  Cache(Cache&& other);
+  Cache& operator=(const Cache& other);
+  Cache& operator=(Cache&& other);
+  ~Cache();
 
   using Key = typename Storage::key_type;
   using Value = typename Storage::mapped_type;
 
   Value get(const Key& key) const;
 
-  ~Cache();
-
 private:
+  void _flush_counters() const;
+
   std::shared_ptr<const Upstream_type> _upstream;
-  std::shared_ptr<const CacheManager<Self>> _manager;
-  std::function<Storage()> _storage_initializer;
-  mutable Storage _all_items;
-  mutable Storage _new_items;
+  mutable std::size_t _hits = 0;
+  mutable std::size_t _misses = 0;
 };
 
 //==============================================================================
 template <typename CacheArg>
-class CacheManager : public std::enable_shared_from_this<CacheManager<CacheArg>>
+class CacheManager
 {
 public:
 
@@ -130,28 +271,66 @@ public:
   using Upstream_type = Upstream<Generator>;
   using Self = CacheManager<CacheArg>;
 
+  /// A rough estimate of the memory used by each entry, including its share of
+  /// the slots of the storage and the memory that its value owns.
+  static constexpr std::size_t bytes_per_entry =
+    sizeof(typename Storage::key_type) + sizeof(typename Storage::mapped_type)
+    + 4*sizeof(void*) + Generator::value_overhead_bytes;
+
   template <typename... Args>
   static std::shared_ptr<const Self> make(Args&&... args)
   {
     return std::shared_ptr<Self>(new Self(std::forward<Args>(args)...));
   }
 
+  /// Get a handle for looking up items. If the manager is over its memory
+  /// budget, every item will be discarded first.
   CacheArg get() const;
 
+  /// Get a copy of every item that has been cached so far.
+  Storage items() const;
+
+  /// Add items into the cache, e.g. items that were loaded from a file. Items
+  /// with the same keys as existing items will be ignored.
+  void insert(Storage new_items) const;
+
+  /// Get the generator that this manager uses to fill its cache.
+  std::shared_ptr<const Generator> generator() const;
+
+  /// Get the number of items that are currently cached.
+  std::size_t size() const;
+
+  /// Set a limit on the estimated memory of the cached items. When a Cache is
+  /// requested while the manager is over its limit, all of the items will be
+  /// discarded. Caches that are already in use will keep seeing the old items
+  /// until they are destroyed. A nullopt (the default) means there is no limit.
+  void set_memory_budget(std::optional<std::size_t> bytes) const;
+
+  /// The last time that a Cache was requested from this manager
+  std::chrono::steady_clock::rep last_used() const;
+
+  /// Get statistics about the use of this manager
+  CacheStatistics statistics() const;
+
 private:
 
   CacheManager(
     std::shared_ptr<const Generator> generator,
     std::function<Storage()> storage_initializer = [](){ return Storage(); });
 
-  void _update(Storage new_items) const;
+  std::shared_ptr<const Upstream_type> _get_upstream() const;
 
-  std::unique_lock<std::mutex> _lock() const;
-
-  template <typename G> friend class Cache;
-  std::shared_ptr<Upstream_type> _upstream;
-  const std::function<Storage()> _storage_initializer;
-  mutable std::mutex _update_mutex;
+  std::shared_ptr<const Generator> _generator;
+  std::function<Storage()> _storage_initializer;
+  std::shared_ptr<CacheCounters> _counters;
+
+  // NOTE(MXG): See the note in CacheManagerMap about mutability.
+  mutable std::mutex _mutex;
+  mutable std::shared_ptr<const Upstream_type> _upstream;
+  mutable std::optional<std::size_t> _budget;
+  mutable std::size_t _evicted_tables = 0;
+  mutable std::size_t _evicted_entries = 0;
+  mutable std::atomic<std::chrono::steady_clock::rep> _last_used;
 };
 
 //==============================================================================
@@ -177,57 +356,140 @@ public:
 
   CacheManagerPtr get(std::size_t goal_index) const;
 
+  /// Get a copy of the cached items of each goal that has a manager.
+  std::unordered_map<std::size_t, Storage> items() const;
+
+  /// Get the factory that creates the generator for each goal.
+  const GeneratorFactory& factory() const;
+
+  /// Set a limit on the total estimated memory of the goal tables in this map.
+  /// When a goal is requested while the map is over its limit, the goal tables
+  /// that were least recently used get evicted until the map is back within
+  /// its limit. Tables that are still held by something else, like the
+  /// generator of a higher level heuristic, are never evicted because that
+  /// would not free any memory. A nullopt (the default) means there is no
+  /// limit.
+  void set_memory_budget(std::optional<std::size_t> bytes) const;
+
+  /// Get statistics about the use of this map, including the tables that it
+  /// has evicted.
+  CacheStatistics statistics() const;
+
 private:
+  using ManagerStorage = std::unordered_map<std::size_t, CacheManagerPtr>;
+
+  void _enforce_budget(std::size_t keep_goal) const;
+
   // NOTE(MXG): We take some significant liberties with mutability here because
   // this cache manager is always logically const, even as its physical state is
   // changing significantly. Besides memoizing the results of previous
   // computations, the cache manager does not actually have any internal state.
-  mutable std::unordered_map<std::size_t, CacheManagerPtr> _managers;
+  mutable ManagerStorage _managers;
   mutable std::mutex _map_mutex;
+  mutable std::optional<std::size_t> _budget;
+  mutable CacheStatistics _evicted;
   const std::shared_ptr<const GeneratorFactory> _generator_factory;
   const std::function<Storage()> _storage_initializer;
 };
 
 //==============================================================================
 template <typename GeneratorArg>
-Cache<GeneratorArg>::Cache(std::shared_ptr<const Upstream_type> upstream,
-  std::shared_ptr<const CacheManager<Self>> manager,
-  std::function<Storage()> storage_initializer)
-: _upstream(std::move(upstream)),
-  _manager(std::move(manager)),
-  _storage_initializer(std::move(storage_initializer)),
-  _all_items(*_upstream->storage),
-  _new_items(_storage_initializer())
+Cache<GeneratorArg>::Cache(std::shared_ptr<const Upstream_type> upstream)
+: _upstream(std::move(upstream))
 {
   // Do nothing
 }
 
 //==============================================================================
 template <typename GeneratorArg>
-auto Cache<GeneratorArg>::get(const Key& key) const -> Value
+Cache<GeneratorArg>::Cache(const Cache& other)
+: _upstream(other._upstream)
 {
-  const auto it = _all_items.find(key);
-  if (it != _all_items.end())
-    return it->second;
+  // The counts stay with the other Cache so they are only added once
+}
 
-  Storage new_items = _storage_initializer();
-  auto result = _upstream->generator->generate(key, _all_items, new_items);
+//==============================================================================
+template <typename GeneratorArg>
+Cache<GeneratorArg>::Cache(Cache&& other)
+: _upstream(std::move(other._upstream)),
+  _hits(other._hits),
+  _misses(other._misses)
+{
+  other._hits = 0;
+  other._misses = 0;
+}
 
-  for (const auto& item : new_items)
+//==============================================================================
+template <typename GeneratorArg>
+auto Cache<GeneratorArg>::operator=(const Cache& other) -> Cache&
+{
+  if (this != &other)
   {
-    _all_items.insert(item);
-    _new_items.insert(item);
+    _flush_counters();
+    _upstream = other._upstream;
   }
 
-  return result;
+  return *this;
+}
+
+//==============================================================================
+template <typename GeneratorArg>
+auto Cache<GeneratorArg>::operator=(Cache&& other) -> Cache&
+{
+  if (this != &other)
+  {
+    _flush_counters();
+    _upstream = std::move(other._upstream);
+    _hits = other._hits;
+    _misses = other._misses;
+    other._hits = 0;
+    other._misses = 0;
+  }
+
+  return *this;
 }
 
 //==============================================================================
 template <typename GeneratorArg>
 Cache<GeneratorArg>::~Cache()
 {
-  if (!_new_items.empty())
-    _manager->_update(std::move(_new_items));
+  _flush_counters();
+}
+
+//==============================================================================
+template <typename GeneratorArg>
+auto Cache<GeneratorArg>::get(const Key& key) const -> Value
+{
+  const auto& storage = *_upstream->storage;
+  if (const Value* const value = storage.find(key))
+  {
+    ++_hits;
+    return *value;
+  }
+
+  ++_misses;
+  Storage new_items = _upstream->storage_initializer();
+  auto result = _upstream->generator->generate(key, storage, new_items);
+  _upstream->storage->insert(std::move(new_items));
+
+  return result;
+}
+
+//==============================================================================
+template <typename GeneratorArg>
+void Cache<GeneratorArg>::_flush_counters() const
+{
+  if (_upstream && (_hits > 0 || _misses > 0))
+  {
+    _upstream->counters->hits.fetch_add(_hits, std::memory_order_relaxed);
+    _upstream->counters->misses.fetch_add(_misses, std::memory_order_relaxed);
+
+    if (const auto recorder = CacheLookupRecorder::current())
+      recorder->record(typeid(Generator), _hits, _misses);
+  }
+
+  _hits = 0;
+  _misses = 0;
 }
 
 //==============================================================================
@@ -235,9 +497,13 @@ template <typename CacheArg>
 CacheManager<CacheArg>::CacheManager(
   std::shared_ptr<const Generator> generator,
   std::function<Storage()> storage_initializer)
-: _upstream(
-    std::make_shared<Upstream_type>(storage_initializer, std::move(generator))),
-  _storage_initializer(std::move(storage_initializer))
+: _generator(std::move(generator)),
+  _storage_initializer(std::move(storage_initializer)),
+  _counters(std::make_shared<CacheCounters>()),
+  _upstream(
+    std::make_shared<Upstream_type>(
+      _storage_initializer, _generator, _counters)),
+  _last_used(std::chrono::steady_clock::now().time_since_epoch().count())
 {
   // Do nothing
 }
@@ -246,34 +512,93 @@ CacheManager<CacheArg>::CacheManager(
 template <typename CacheArg>
 CacheArg CacheManager<CacheArg>::get() const
 {
-  auto lock = _lock();
-  return CacheArg{_upstream, this->shared_from_this(), _storage_initializer};
+  _last_used.store(
+    std::chrono::steady_clock::now().time_since_epoch().count(),
+    std::memory_order_relaxed);
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  const std::size_t entries = _upstream->storage->size();
+  if (_budget.has_value() && *_budget < entries * bytes_per_entry)
+  {
+    // The old storage will be freed once the last Cache that uses it is gone
+    ++_evicted_tables;
+    _evicted_entries += entries;
+    _upstream = std::make_shared<Upstream_type>(
+      _storage_initializer, _generator, _counters);
+  }
+
+  return CacheArg{_upstream};
 }
 
 //==============================================================================
 template <typename CacheArg>
-void CacheManager<CacheArg>::_update(Storage new_items) const
+auto CacheManager<CacheArg>::items() const -> Storage
 {
-  auto lock = _lock();
-  auto new_storage = std::make_shared<Storage>(*_upstream->storage);
-  for (auto&& item : new_items)
-    (*new_storage)[item.first] = std::move(item.second);
+  return _get_upstream()->storage->items();
+}
 
-  _upstream->storage = std::move(new_storage);
+//==============================================================================
+template <typename CacheArg>
+void CacheManager<CacheArg>::insert(Storage new_items) const
+{
+  _get_upstream()->storage->insert(std::move(new_items));
 }
 
 //==============================================================================
 template <typename CacheArg>
-std::unique_lock<std::mutex> CacheManager<CacheArg>::_lock() const
+auto CacheManager<CacheArg>::generator() const
+-> std::shared_ptr<const Generator>
 {
-  std::unique_lock<std::mutex> lock(_update_mutex, std::defer_lock);
-  while (!lock.try_lock())
-  {
-    // Intentionally busy-wait to get the lock as soon as possible. Other lock
-    // holders should only be holding the lock very briefly.
-  }
+  return _generator;
+}
 
-  return lock;
+//==============================================================================
+template <typename CacheArg>
+std::size_t CacheManager<CacheArg>::size() const
+{
+  return _get_upstream()->storage->size();
+}
+
+//==============================================================================
+template <typename CacheArg>
+void CacheManager<CacheArg>::set_memory_budget(
+  std::optional<std::size_t> bytes) const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _budget = bytes;
+}
+
+//==============================================================================
+template <typename CacheArg>
+std::chrono::steady_clock::rep CacheManager<CacheArg>::last_used() const
+{
+  return _last_used.load(std::memory_order_relaxed);
+}
+
+//==============================================================================
+template <typename CacheArg>
+CacheStatistics CacheManager<CacheArg>::statistics() const
+{
+  CacheStatistics output;
+  output.tables = 1;
+  output.hits = _counters->hits.load(std::memory_order_relaxed);
+  output.misses = _counters->misses.load(std::memory_order_relaxed);
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  output.entries = _upstream->storage->size();
+  output.estimated_bytes = output.entries * bytes_per_entry;
+  output.evicted_tables = _evicted_tables;
+  output.evicted_entries = _evicted_entries;
+  return output;
+}
+
+//==============================================================================
+template <typename CacheArg>
+auto CacheManager<CacheArg>::_get_upstream() const
+-> std::shared_ptr<const Upstream_type>
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _upstream;
 }
 
 //==============================================================================
@@ -292,23 +617,107 @@ template <typename CacheArg>
 auto CacheManagerMap<CacheArg>::get(std::size_t goal_index) const
 -> CacheManagerPtr
 {
-  std::unique_lock<std::mutex> lock(_map_mutex, std::defer_lock);
-  while (!lock.try_lock())
+  // This is only called once for each heuristic search rather than for each
+  // lookup, so a plain mutex is cheap enough here, and it lets us evict goals.
+  // The generator factories are cheap to run.
+  std::lock_guard<std::mutex> lock(_map_mutex);
+  auto it = _managers.find(goal_index);
+  if (it == _managers.end())
   {
-    // Intentionally busy-wait to get the lock as soon as possible. Other lock
-    // holders should only be holding the lock very briefly.
+    auto manager = CacheManager_type::make(
+      _generator_factory->make(goal_index),
+      _storage_initializer);
+
+    it = _managers.insert({goal_index, std::move(manager)}).first;
   }
 
-  const auto it = _managers.insert({goal_index, nullptr});
-  auto& manager = it.first->second;
-  if (manager == nullptr)
+  CacheManagerPtr manager = it->second;
+  _enforce_budget(goal_index);
+  return manager;
+}
+
+//==============================================================================
+template <typename CacheArg>
+auto CacheManagerMap<CacheArg>::items() const
+-> std::unordered_map<std::size_t, Storage>
+{
+  std::lock_guard<std::mutex> lock(_map_mutex);
+  std::unordered_map<std::size_t, Storage> output;
+  for (const auto& manager : _managers)
+    output.insert({manager.first, manager.second->items()});
+
+  return output;
+}
+
+//==============================================================================
+template <typename CacheArg>
+auto CacheManagerMap<CacheArg>::factory() const -> const GeneratorFactory&
+{
+  return *_generator_factory;
+}
+
+//==============================================================================
+template <typename CacheArg>
+void CacheManagerMap<CacheArg>::set_memory_budget(
+  std::optional<std::size_t> bytes) const
+{
+  std::lock_guard<std::mutex> lock(_map_mutex);
+  _budget = bytes;
+}
+
+//==============================================================================
+template <typename CacheArg>
+CacheStatistics CacheManagerMap<CacheArg>::statistics() const
+{
+  std::lock_guard<std::mutex> lock(_map_mutex);
+  CacheStatistics output = _evicted;
+  for (const auto& manager : _managers)
+    output += manager.second->statistics();
+
+  return output;
+}
+
+//==============================================================================
+template <typename CacheArg>
+void CacheManagerMap<CacheArg>::_enforce_budget(
+  const std::size_t keep_goal) const
+{
+  if (!_budget.has_value())
+    return;
+
+  std::size_t total = 0;
+  for (const auto& manager : _managers)
+    total += manager.second->size() * CacheManager_type::bytes_per_entry;
+
+  if (total <= *_budget)
+    return;
+
+  std::vector<std::pair<std::chrono::steady_clock::rep, std::size_t>>
+  candidates;
+  for (const auto& [goal, manager] : _managers)
   {
-    manager = CacheManager_type::make(
-          _generator_factory->make(goal_index),
-          _storage_initializer);
+    if (goal != keep_goal && manager.use_count() == 1)
+      candidates.push_back({manager->last_used(), goal});
   }
 
-  return manager;
+  std::sort(candidates.begin(), candidates.end());
+  for (const auto& candidate : candidates)
+  {
+    if (total <= *_budget)
+      break;
+
+    const auto it = _managers.find(candidate.second);
+    const auto stats = it->second->statistics();
+    total -= std::min(total, stats.estimated_bytes);
+
+    // Keep the counts of the evicted table so that the statistics of this map
+    // cover its whole lifetime.
+    _evicted.hits += stats.hits;
+    _evicted.misses += stats.misses;
+    _evicted.evicted_tables += stats.evicted_tables + 1;
+    _evicted.evicted_entries += stats.evicted_entries + stats.entries;
+    _managers.erase(it);
+  }
 }
 
 } // namespace planning
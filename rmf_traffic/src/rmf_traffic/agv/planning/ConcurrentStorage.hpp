@@ -0,0 +1,321 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__AGV__PLANNING__CONCURRENTSTORAGE_HPP
+#define SRC__RMF_TRAFFIC__AGV__PLANNING__CONCURRENTSTORAGE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace rmf_traffic {
+namespace agv {
+namespace planning {
+
+//==============================================================================
+/// A hash map that can be read by any number of threads without locking while
+/// other threads are inserting into it. It takes its key, value, hash, and
+/// equality types from a std::unordered_map type, StorageArg.
+///
+/// The map is split into shards so that writers only contend with other writers
+/// that land on the same shard. Each shard is an open-addressed table of
+/// pointers to immutable items. A writer publishes an item by storing its
+/// pointer into an empty slot, so a reader either sees the whole item or no
+/// item at all.
+///
+/// Readers may be looking at an item or a table at any time, so neither can be
+/// freed until the whole map is destroyed. To keep that bounded, a key is only
+/// ever given one item: inserting a key that is already present discards the
+/// new value. This suits the planner caches, whose values are a function of
+/// their keys, so two threads that generate the same key will also generate
+/// the same value. When a shard grows, the item pointers are moved into a table
+/// with twice the capacity, so the retired tables of a shard never add up to
+/// more than the table that is in use.
+///
+/// The values that are returned by find() remain valid for as long as the map
+/// exists.
+template<typename StorageArg>
+class ConcurrentStorage
+{
+public:
+
+  using Storage = StorageArg;
+  using Key = typename Storage::key_type;
+  using Value = typename Storage::mapped_type;
+  using Hash = typename Storage::hasher;
+  using Equal = typename Storage::key_equal;
+
+  /// Constructor
+  ///
+  /// \param[in] prototype
+  ///   The hash and equality functions of this storage will be used.
+  ConcurrentStorage(const Storage& prototype);
+
+  /// Find the value of a key without locking. If the key has not been inserted
+  /// yet, this returns a nullptr.
+  const Value* find(const Key& key) const;
+
+  /// Insert a value if its key is not present yet. Otherwise the value is
+  /// discarded.
+  void insert(const Key& key, Value value);
+
+  /// Insert every item in the storage whose key is not present yet. The values
+  /// of the other items are discarded.
+  void insert(Storage items);
+
+  /// Get a copy of every item that has been inserted so far.
+  Storage items() const;
+
+  /// Get the number of keys that have been inserted so far. This does not lock,
+  /// so it may miss insertions that are still in progress.
+  std::size_t size() const;
+
+  ConcurrentStorage(const ConcurrentStorage&) = delete;
+  ConcurrentStorage& operator=(const ConcurrentStorage&) = delete;
+
+private:
+
+  struct Item
+  {
+    Key key;
+    Value value;
+  };
+
+  using Slot = std::atomic<const Item*>;
+
+  struct Table
+  {
+    Table(std::size_t capacity);
+
+    const std::size_t mask;
+    const std::unique_ptr<Slot[]> slots;
+  };
+
+  struct Shard
+  {
+    std::atomic<const Table*> table;
+
+    // Everything below is only used while holding the mutex
+    mutable std::mutex mutex;
+    std::size_t count = 0;
+    std::vector<std::unique_ptr<Table>> tables;
+    std::deque<Item> items;
+  };
+
+  static constexpr std::size_t ShardBits = 4;
+  static constexpr std::size_t InitialCapacity = 16;
+
+  std::uint64_t _mix(const Key& key) const;
+
+  void _insert(Shard& shard, std::uint64_t h, const Key& key, Value value);
+
+  Hash _hash;
+  Equal _equal;
+  std::array<Shard, 1 << ShardBits> _shards;
+  std::atomic_size_t _size{0};
+};
+
+//==============================================================================
+template<typename StorageArg>
+ConcurrentStorage<StorageArg>::Table::Table(const std::size_t capacity)
+: mask(capacity - 1),
+  slots(new Slot[capacity])
+{
+  for (std::size_t i = 0; i < capacity; ++i)
+    slots[i].store(nullptr, std::memory_order_relaxed);
+}
+
+//==============================================================================
+template<typename StorageArg>
+ConcurrentStorage<StorageArg>::ConcurrentStorage(const Storage& prototype)
+: _hash(prototype.hash_function()),
+  _equal(prototype.key_eq())
+{
+  for (auto& shard : _shards)
+  {
+    shard.tables.push_back(std::make_unique<Table>(InitialCapacity));
+    shard.table.store(shard.tables.back().get(), std::memory_order_release);
+  }
+}
+
+//==============================================================================
+template<typename StorageArg>
+auto ConcurrentStorage<StorageArg>::find(const Key& key) const -> const Value*
+{
+  const std::uint64_t h = _mix(key);
+  const Shard& shard = _shards[h >> (64 - ShardBits)];
+  const Table* const table = shard.table.load(std::memory_order_acquire);
+
+  // The tables are never more than half full, so this will always reach an
+  // empty slot if the key is not present.
+  for (std::size_t i = h & table->mask; ; i = (i+1) & table->mask)
+  {
+    const Item* const item = table->slots[i].load(std::memory_order_acquire);
+    if (!item)
+      return nullptr;
+
+    if (_equal(item->key, key))
+      return &item->value;
+  }
+}
+
+//==============================================================================
+template<typename StorageArg>
+void ConcurrentStorage<StorageArg>::insert(const Key& key, Value value)
+{
+  const std::uint64_t h = _mix(key);
+  Shard& shard = _shards[h >> (64 - ShardBits)];
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  _insert(shard, h, key, std::move(value));
+}
+
+//==============================================================================
+template<typename StorageArg>
+void ConcurrentStorage<StorageArg>::insert(Storage items)
+{
+  // Sort the items by shard first so that each shard only gets locked once.
+  using Entry = typename Storage::value_type;
+  std::array<std::vector<std::pair<std::uint64_t, Entry*>>, 1 << ShardBits>
+  sorted;
+
+  for (auto& item : items)
+  {
+    const std::uint64_t h = _mix(item.first);
+    sorted[h >> (64 - ShardBits)].push_back({h, &item});
+  }
+
+  for (std::size_t s = 0; s < sorted.size(); ++s)
+  {
+    if (sorted[s].empty())
+      continue;
+
+    Shard& shard = _shards[s];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    for (const auto& [h, item] : sorted[s])
+      _insert(shard, h, item->first, std::move(item->second));
+  }
+}
+
+//==============================================================================
+template<typename StorageArg>
+auto ConcurrentStorage<StorageArg>::items() const -> Storage
+{
+  Storage output(0, _hash, _equal);
+  output.reserve(size());
+  for (const auto& shard : _shards)
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const Table* const table = shard.table.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i <= table->mask; ++i)
+    {
+      const Item* const item = table->slots[i].load(std::memory_order_relaxed);
+      if (item)
+        output.insert({item->key, item->value});
+    }
+  }
+
+  return output;
+}
+
+//==============================================================================
+template<typename StorageArg>
+std::size_t ConcurrentStorage<StorageArg>::size() const
+{
+  return _size.load(std::memory_order_relaxed);
+}
+
+//==============================================================================
+template<typename StorageArg>
+std::uint64_t ConcurrentStorage<StorageArg>::_mix(const Key& key) const
+{
+  // The hash functions of the planner often pack fields into bits instead of
+  // mixing them, so we apply the splitmix64 finalizer to spread them out over
+  // the shard and slot bits.
+  std::uint64_t h = static_cast<std::uint64_t>(_hash(key));
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ull;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebull;
+  h ^= h >> 31;
+  return h;
+}
+
+//==============================================================================
+template<typename StorageArg>
+void ConcurrentStorage<StorageArg>::_insert(
+  Shard& shard,
+  const std::uint64_t h,
+  const Key& key,
+  Value value)
+{
+  const Table* table = shard.table.load(std::memory_order_relaxed);
+
+  std::size_t i = h & table->mask;
+  for (; ; i = (i+1) & table->mask)
+  {
+    const Item* const item = table->slots[i].load(std::memory_order_relaxed);
+    if (!item)
+      break;
+
+    // The key already has a value, and it cannot be replaced without
+    // leaking the old item, since readers may still be using it.
+    if (_equal(item->key, key))
+      return;
+  }
+
+  if (table->mask + 1 < 2*(shard.count + 1))
+  {
+    const std::size_t capacity = 2*(table->mask + 1);
+    auto bigger = std::make_unique<Table>(capacity);
+    for (std::size_t j = 0; j <= table->mask; ++j)
+    {
+      const Item* const item = table->slots[j].load(std::memory_order_relaxed);
+      if (!item)
+        continue;
+
+      std::size_t k = _mix(item->key) & bigger->mask;
+      while (bigger->slots[k].load(std::memory_order_relaxed))
+        k = (k+1) & bigger->mask;
+
+      bigger->slots[k].store(item, std::memory_order_relaxed);
+    }
+
+    table = bigger.get();
+    shard.tables.push_back(std::move(bigger));
+    shard.table.store(table, std::memory_order_release);
+
+    i = h & table->mask;
+    while (table->slots[i].load(std::memory_order_relaxed))
+      i = (i+1) & table->mask;
+  }
+
+  shard.items.push_back(Item{key, std::move(value)});
+  table->slots[i].store(&shard.items.back(), std::memory_order_release);
+  ++shard.count;
+  _size.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace planning
+} // namespace agv
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__AGV__PLANNING__CONCURRENTSTORAGE_HPP
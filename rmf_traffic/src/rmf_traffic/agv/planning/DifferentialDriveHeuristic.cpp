@@ -312,11 +312,11 @@ public:
       _goal_entry.orientation
     };
 
-    const auto old_it = _old_items.find(key);
-    if (old_it == _old_items.end())
+    const auto* const old_value = _old_items.find(key);
+    if (!old_value)
       return false;
 
-    auto solution = old_it->second->child;
+    auto solution = (*old_value)->child;
     auto node = top;
     while (solution)
     {
@@ -441,7 +441,7 @@ public:
 
   DifferentialDriveExpander(
     Entry goal_entry,
-    const DifferentialDriveHeuristic::Storage& old_items,
+    const DifferentialDriveHeuristic::SharedStorage& old_items,
     Cache<TranslationHeuristic> heuristic,
     std::shared_ptr<const Supergraph> graph)
   : _goal_entry(std::move(goal_entry)),
@@ -469,7 +469,7 @@ private:
   std::size_t _goal_waypoint;
   std::optional<double> _goal_yaw;
   Entry _goal_entry;
-  const DifferentialDriveHeuristic::Storage& _old_items;
+  const DifferentialDriveHeuristic::SharedStorage& _old_items;
   Cache<TranslationHeuristic> _heuristic;
   std::shared_ptr<const Supergraph> _graph;
   KinematicLimits _limits;
@@ -480,9 +480,11 @@ private:
 
 //==============================================================================
 DifferentialDriveHeuristic::DifferentialDriveHeuristic(
-  std::shared_ptr<const Supergraph> graph)
+  std::shared_ptr<const Supergraph> graph,
+  const std::size_t num_landmarks)
 : _graph(std::move(graph)),
-  _heuristic_map(std::make_shared<TranslationHeuristicFactory>(_graph))
+  _heuristic_map(
+    std::make_shared<TranslationHeuristicFactory>(_graph, num_landmarks))
 {
   // Do nothing
 }
@@ -490,7 +492,7 @@ DifferentialDriveHeuristic::DifferentialDriveHeuristic(
 //==============================================================================
 auto DifferentialDriveHeuristic::generate(
   const Key& key,
-  const Storage& old_items,
+  const SharedStorage& old_items,
   Storage& new_items) const -> SolutionNodePtr
 {
   using SearchQueue = DifferentialDriveExpander::SearchQueue;
@@ -673,14 +675,23 @@ auto DifferentialDriveHeuristic::generate(
 //==============================================================================
 CacheManagerPtr<DifferentialDriveHeuristic>
 DifferentialDriveHeuristic::make_manager(
-  std::shared_ptr<const Supergraph> supergraph)
+  std::shared_ptr<const Supergraph> supergraph,
+  const std::size_t num_landmarks)
 {
   const std::size_t N = supergraph->original().lanes.size();
   return CacheManager<Cache<DifferentialDriveHeuristic>>::make(
-    std::make_shared<DifferentialDriveHeuristic>(std::move(supergraph)),
+    std::make_shared<DifferentialDriveHeuristic>(
+      std::move(supergraph), num_landmarks),
     [N](){ return Storage(4093, DifferentialDriveMapTypes::KeyHash{N}); });
 }
 
+//==============================================================================
+const TranslationHeuristicCacheMap&
+DifferentialDriveHeuristic::translation_heuristics() const
+{
+  return _heuristic_map;
+}
+
 //==============================================================================
 DifferentialDriveHeuristicAdapter::DifferentialDriveHeuristicAdapter(
   Cache<DifferentialDriveHeuristic> cache,
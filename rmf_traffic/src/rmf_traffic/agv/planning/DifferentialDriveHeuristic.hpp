@@ -33,20 +33,30 @@ class DifferentialDriveHeuristic : public Generator<DifferentialDriveMap>
 {
 public:
 
-  DifferentialDriveHeuristic(std::shared_ptr<const Supergraph> graph);
+  DifferentialDriveHeuristic(
+    std::shared_ptr<const Supergraph> graph,
+    std::size_t num_landmarks = 0);
 
   using SolutionNode = DifferentialDriveMapTypes::SolutionNode;
   using SolutionNodePtr = DifferentialDriveMapTypes::SolutionNodePtr;
   using Entry = DifferentialDriveMapTypes::Entry;
   using Key = DifferentialDriveMapTypes::Key;
 
+  // Each value points to a chain of solution nodes. Most of the chain is
+  // shared with the values of other entries, so we only count one node.
+  static constexpr std::size_t value_overhead_bytes =
+    sizeof(SolutionNode) + 2*sizeof(void*);
+
   SolutionNodePtr generate(
     const Key& key,
-    const Storage& old_items,
+    const SharedStorage& old_items,
     Storage& new_items) const final;
 
   static CacheManagerPtr<DifferentialDriveHeuristic> make_manager(
-      std::shared_ptr<const Supergraph> graph);
+      std::shared_ptr<const Supergraph> graph,
+      std::size_t num_landmarks = 0);
+
+  const TranslationHeuristicCacheMap& translation_heuristics() const;
 
 private:
   std::shared_ptr<const Supergraph> _graph;
@@ -18,11 +18,19 @@
 #include "DifferentialDrivePlanner.hpp"
 
 #include "../internal_Planner.hpp"
+#include "../../internal_Route.hpp"
 
 #include "a_star.hpp"
+#include "HeuristicCacheFile.hpp"
+#include "MemoizedRouteValidator.hpp"
+#include "NodePool.hpp"
 
 #include <rmf_utils/math.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
 #ifdef RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
 #include <iostream>
 #endif // RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
@@ -273,7 +281,8 @@ std::pair<std::vector<Route>, std::vector<Indexing>> reconstruct_routes(
     for (const Route& next_route : node->route_from_parent)
     {
       Route& last_route = routes.back();
-      if (next_route.map() == last_route.map())
+      if (RouteData::get(next_route).map_id
+        == RouteData::get(last_route).map_id)
       {
         for (const auto& waypoint : next_route.trajectory())
         {
@@ -366,9 +375,11 @@ public:
 
   using Entry = DifferentialDriveMapTypes::Entry;
 
+  // Search nodes are owned by the SearchNodePool of the search that created
+  // them, so they can refer to each other with plain pointers.
   struct SearchNode;
-  using SearchNodePtr = std::shared_ptr<SearchNode>;
-  using ConstSearchNodePtr = std::shared_ptr<const SearchNode>;
+  using SearchNodePtr = SearchNode*;
+  using ConstSearchNodePtr = const SearchNode*;
   using NodePtr = SearchNodePtr;
 
   struct SearchNode
@@ -393,6 +404,9 @@ public:
     std::optional<Planner::Start> start;
     SearchNodePtr parent;
 
+    // True if this node was copied from the solution of a previous search
+    bool reused = false;
+
     double get_total_cost_estimate() const
     {
       return current_cost + remaining_cost_estimate;
@@ -493,10 +507,45 @@ public:
       DifferentialDriveCompare<SearchNodePtr>
     >;
 
+  using SearchNodePool = NodePool<SearchNode>;
+  using SearchNodePoolPtr = std::shared_ptr<SearchNodePool>;
+
   class InternalState : public State::Internal
   {
   public:
 
+    InternalState()
+    : pool(std::make_shared<SearchNodePool>())
+    {
+      // Do nothing
+    }
+
+    // A copy of the state needs its own pool for the nodes that it creates,
+    // but it will keep the original pool alive because its queue still refers
+    // to the nodes inside of it.
+    InternalState(const InternalState& other)
+    : queue(other.queue),
+      popped_count(other.popped_count),
+      pool(std::make_shared<SearchNodePool>(other.pool)),
+      previous(other.previous),
+      spliced(other.spliced),
+      solution(other.solution)
+    {
+      // Do nothing
+    }
+
+    InternalState& operator=(const InternalState& other)
+    {
+      queue = other.queue;
+      popped_count = other.popped_count;
+      pool = std::make_shared<SearchNodePool>(other.pool);
+      previous = other.previous;
+      spliced = other.spliced;
+      solution = other.solution;
+      memoized_validator.reset();
+      return *this;
+    }
+
     std::optional<double> cost_estimate() const final
     {
       if (queue.empty())
@@ -516,8 +565,64 @@ public:
       return popped_count;
     }
 
+    void clear_validation_cache() final
+    {
+      memoized_validator.reset();
+    }
+
+    std::size_t reused_node_count() const final
+    {
+      std::size_t count = 0;
+      for (ConstSearchNodePtr node = solution; node; node = node->parent)
+      {
+        if (node->reused)
+          ++count;
+      }
+
+      return count;
+    }
+
+    struct PreviousSolution
+    {
+      // The nodes of the solution, ordered from the root to the goal
+      std::vector<ConstSearchNodePtr> path;
+
+      // Keeps the nodes of the path alive
+      std::shared_ptr<const SearchNodePool> pool;
+    };
+
     SearchQueue queue;
     std::size_t popped_count = 0;
+    SearchNodePoolPtr pool;
+
+    // The solution of a previous search that may be reused by this one, and a
+    // flag for each of its nodes to indicate whether we have already tried to
+    // continue from it.
+    std::shared_ptr<const PreviousSolution> previous;
+    std::vector<bool> spliced;
+
+    SearchNodePtr solution = nullptr;
+
+    // Remembers the validation results of this search so that they can be
+    // reused, including after the search is resumed. Copies of the state do
+    // not get this, because their options have their own validator.
+    std::optional<MemoizedRouteValidator> memoized_validator;
+
+    const RouteValidator* memoize(
+      const Planner::Options& options,
+      Planner::SearchStatistics* statistics)
+    {
+      const RouteValidator* validator = options.validator().get();
+      if (!validator)
+        return nullptr;
+
+      const std::size_t token = validator_token(options);
+      if (!memoized_validator || !memoized_validator->is_current(token))
+        memoized_validator.emplace(validator, token);
+
+      memoized_validator->record_statistics(statistics);
+      return &*memoized_validator;
+    }
   };
 
   bool quit(const SearchNodePtr& top, SearchQueue& queue) const
@@ -665,7 +770,7 @@ public:
       // TODO(MXG): We can actually specify the orientation for this. We just
       // need to be smarter with make_start_approach_trajectories(). We should
       // really have it return a Traversal.
-      auto node = std::make_shared<SearchNode>(
+      auto node = _internal->pool->make(
         SearchNode{
           target_waypoint_index,
           wp_location,
@@ -682,7 +787,7 @@ public:
 
       if (exit_event)
       {
-        node = std::make_shared<SearchNode>(
+        node = _internal->pool->make(
           SearchNode{
             target_waypoint_index,
             wp_location,
@@ -723,7 +828,7 @@ public:
     }
 
     queue.push(
-      std::make_shared<SearchNode>(
+      _internal->pool->make(
             SearchNode{
               std::nullopt,
               p,
@@ -765,7 +870,7 @@ public:
     if (!is_valid(top, route))
       return;
 
-    queue.push(std::make_shared<SearchNode>(
+    queue.push(_internal->pool->make(
        SearchNode{
          wp_index,
          p,
@@ -809,7 +914,7 @@ public:
     if (_validator && !is_valid(top, route))
       return nullptr;
 
-    return std::make_shared<SearchNode>(
+    return _internal->pool->make(
       SearchNode{
         _goal_waypoint,
         p,
@@ -833,9 +938,14 @@ public:
       auto conflict = _validator->find_conflict(route);
       if (conflict)
       {
+        // The blocked node keeps the pool of this search alive so that it
+        // can be used for rollouts later.
         auto time_it =
             _issues->blocked_nodes[conflict->participant]
-            .insert({parent, conflict->time});
+            .insert({
+              std::shared_ptr<void>(_internal->pool, parent),
+              conflict->time
+            });
 
         if (!time_it.second)
         {
@@ -1048,7 +1158,7 @@ public:
         const double yaw = approach_wp.position()[2];
         const auto time = approach_wp.time();
 
-        node = std::make_shared<SearchNode>(
+        node = _internal->pool->make(
           SearchNode{
             initial_waypoint_index,
             p0,
@@ -1068,7 +1178,8 @@ public:
       if (entry_event_route.trajectory().size() >= 2)
       {
         auto& front = traversal_result.routes.front();
-        if (entry_event_route.map() == front.map())
+        if (RouteData::get(entry_event_route).map_id
+          == RouteData::get(front).map_id)
         {
           for (const auto& wp : entry_event_route.trajectory())
             front.trajectory().insert(wp);
@@ -1081,7 +1192,7 @@ public:
         }
       }
 
-      node = std::make_shared<SearchNode>(
+      node = _internal->pool->make(
         SearchNode{
           next_waypoint_index,
           next_position,
@@ -1098,7 +1209,7 @@ public:
 
       if (traversal.exit_event && exit_event_route.trajectory().size() >= 2)
       {
-        node = std::make_shared<SearchNode>(
+        node = _internal->pool->make(
           SearchNode{
             next_waypoint_index,
             next_position,
@@ -1150,7 +1261,7 @@ public:
         const auto orientation = entry.has_value()?
               std::make_optional(entry->orientation) : std::nullopt;
 
-        search_node = std::make_shared<SearchNode>(
+        search_node = _internal->pool->make(
           SearchNode{
             solution_root->info.waypoint,
             solution_root->info.position,
@@ -1201,7 +1312,7 @@ public:
         const auto orientation = entry.has_value()?
               std::make_optional(entry->orientation) : std::nullopt;
 
-        search_node = std::make_shared<SearchNode>(
+        search_node = _internal->pool->make(
           SearchNode{
             solution_node->info.waypoint,
             solution_node->info.position,
@@ -1227,6 +1338,103 @@ public:
     }
   }
 
+  void expand_previous_solution(
+    const SearchNodePtr& top,
+    SearchQueue& queue) const
+  {
+    assert(_validator);
+    const auto& path = _internal->previous->path;
+
+    // Find the latest node of the previous solution that is in the same place
+    // as the top node. Anything that came earlier was only the previous robot
+    // waiting around or going in circles.
+    std::size_t match = path.size();
+    for (std::size_t i = path.size(); i > 0; --i)
+    {
+      const auto& node = path[i-1];
+      if (node->waypoint != top->waypoint)
+        continue;
+
+      const double angle_diff = rmf_utils::wrap_to_pi(node->yaw - top->yaw);
+      if (std::abs(angle_diff) <= _rotation_threshold)
+      {
+        match = i-1;
+        break;
+      }
+    }
+
+    if (match == path.size() || _internal->spliced[match])
+      return;
+
+    _internal->spliced[match] = true;
+
+    // Copy the rest of the previous solution onto the top node, shifting it in
+    // time and checking it against the validator, until it runs into a
+    // conflict. The costs of the nodes only depend on the motions, so they can
+    // be offset by the difference in cost between the two branches.
+    const auto& anchor = path[match];
+    const Duration delta_t = top->time - anchor->time;
+    const double delta_cost = top->current_cost - anchor->current_cost;
+
+    SearchNodePtr parent = top;
+    std::size_t last = match;
+    for (std::size_t i = match+1; i < path.size(); ++i)
+    {
+      const auto& original = path[i];
+      std::vector<Route> routes = original->route_from_parent;
+      bool valid = true;
+      for (auto& route : routes)
+      {
+        if (route.trajectory().empty())
+          continue;
+
+        route.trajectory().begin()->adjust_times(delta_t);
+        if (route.trajectory().size() >= 2 && _validator->find_conflict(route))
+        {
+          // We deliberately do not use is_valid() here, because the conflict
+          // would be blamed on a node that the search never chose to expand.
+          valid = false;
+          break;
+        }
+      }
+
+      if (!valid)
+        break;
+
+      parent = _internal->pool->make(
+        SearchNode{
+          original->waypoint,
+          original->position,
+          original->yaw,
+          original->time + delta_t,
+          original->orientation,
+          original->remaining_cost_estimate,
+          std::move(routes),
+          original->event,
+          original->current_cost + delta_cost,
+          std::nullopt,
+          parent
+        });
+
+      parent->reused = true;
+      last = i;
+    }
+
+    // A node that still needs to carry out its event should never be put into
+    // the queue, because the event would get skipped when it is expanded.
+    while (parent != top && parent->event && last+1 < path.size())
+    {
+      parent = parent->parent;
+      --last;
+    }
+
+    // Only the deepest node goes into the queue. Every node along the way has
+    // its true cost, so this cannot cause a worse plan to be chosen, and the
+    // intermediate nodes can still be reached by expanding the top node.
+    if (parent != top)
+      queue.push(parent);
+  }
+
   void expand(const SearchNodePtr& top, SearchQueue& queue) const
   {
     if (!top->waypoint.has_value())
@@ -1237,6 +1445,9 @@ public:
       return;
     }
 
+    if (_validator && _internal->previous)
+      expand_previous_solution(top, queue);
+
     if (_validator)
     {
       // There will never be a reason to hold if there is no validator.
@@ -1473,7 +1684,7 @@ public:
 
     assert(!start_point_trajectory.empty());
 
-    return std::make_shared<SearchNode>(
+    return _internal->pool->make(
           SearchNode{
             node_waypoint,
             start_location.value_or(waypoint_location),
@@ -1525,7 +1736,7 @@ public:
     {
       bool skip = false;
       const auto original_node =
-          std::static_pointer_cast<SearchNode>(void_node.first);
+          static_cast<SearchNodePtr>(void_node.first.get());
 
       const auto original_t = void_node.second;
 
@@ -1540,7 +1751,9 @@ public:
       auto ancestor = original_node->parent;
       while (ancestor)
       {
-        if (nodes.count(ancestor) > 0)
+        // We use a non-owning pointer as the key for this lookup
+        const std::shared_ptr<void> key(std::shared_ptr<void>(), ancestor);
+        if (nodes.count(key) > 0)
         {
           // TODO(MXG): Consider if we should account for the time difference
           // between these conflicts so that we get a broader rollout.
@@ -1640,14 +1853,15 @@ public:
     std::shared_ptr<const Supergraph> supergraph,
     DifferentialDriveHeuristicAdapter heuristic,
     const Planner::Goal& goal,
-    const Planner::Options& options)
+    const Planner::Options& options,
+    Planner::SearchStatistics* statistics = nullptr)
   : _internal(static_cast<InternalState*>(internal)),
     _issues(&issues),
     _supergraph(std::move(supergraph)),
     _heuristic(std::move(heuristic)),
     _goal_waypoint(goal.waypoint()),
     _goal_yaw(rmf_utils::pointer_to_opt(goal.orientation())),
-    _validator(options.validator().get()),
+    _validator(_internal->memoize(options, statistics)),
     _holding_time(options.minimum_holding_time()),
     _saturation_limit(options.saturation_limit()),
     _maximum_cost_estimate(options.maximum_cost_estimate()),
@@ -1738,6 +1952,9 @@ public:
     std::vector<agv::Planner::Debug::ConstNodePtr> terminal_nodes_;
     Issues::BlockerMap blocked_nodes_;
 
+    // The nodes of every step are kept in this pool
+    SearchNodePoolPtr pool_;
+
     std::vector<agv::Planner::Start> starts_;
     agv::Planner::Goal goal_;
     agv::Planner::Options options_;
@@ -1758,6 +1975,7 @@ public:
       Cache<DifferentialDriveHeuristic> cache)
     {
       InternalState internal;
+      internal.pool = pool_;
       Issues issues;
 
       ScheduledDifferentialDriveExpander expander{
@@ -1792,6 +2010,7 @@ public:
           std::move(goal),
           std::move(options));
 
+    debugger->pool_ = _internal->pool;
     for (const auto& start : starts)
     {
       if (auto start_node = make_start_node(start))
@@ -1875,7 +2094,58 @@ DifferentialDrivePlanner::DifferentialDrivePlanner(
         _config.vehicle_traits(),
         _config.interpolation());
 
-  _cache = DifferentialDriveHeuristic::make_manager(_supergraph);
+  _cache = DifferentialDriveHeuristic::make_manager(
+    _supergraph, _config.heuristic_landmarks());
+
+  if (const auto& budget = _config.heuristic_cache_budget())
+  {
+    const auto& translation = _cache->generator()->translation_heuristics();
+    const auto& shortest_path =
+      translation.factory().shortest_path_heuristics();
+    const auto& euclidean = shortest_path.factory().euclidean_heuristics();
+    const auto* const landmark = shortest_path.factory().landmark_heuristics();
+
+    // The budget is split evenly between the layers of heuristics
+    const std::size_t share = *budget / (landmark ? 5 : 4);
+    _cache->set_memory_budget(share);
+    translation.set_memory_budget(share);
+    shortest_path.set_memory_budget(share);
+    euclidean.set_memory_budget(share);
+    if (landmark)
+      landmark->set_memory_budget(share);
+  }
+  _configuration_hash = hash_heuristic_configuration(_config);
+
+  if (const auto& filename = _config.heuristic_cache_file())
+    load_heuristic_cache(*filename);
+
+  if (const auto& goals_opt = _config.precompute_heuristics())
+  {
+    const std::size_t N = _supergraph->original().waypoints.size();
+    std::vector<std::size_t> goals = *goals_opt;
+    if (goals.empty())
+    {
+      goals.reserve(N);
+      for (std::size_t i = 0; i < N; ++i)
+        goals.push_back(i);
+    }
+
+    for (const auto goal : goals)
+    {
+      if (N <= goal)
+      {
+        throw std::out_of_range(
+          "[Planner::Planner] Goal [" + std::to_string(goal)
+          + "] requested by Configuration::precompute_heuristics() is out of "
+          "range for a graph with [" + std::to_string(N) + "] waypoints");
+      }
+    }
+
+    _precomputer = std::make_unique<HeuristicPrecomputer>(
+      _cache, _supergraph, std::move(goals),
+      _config.precompute_goal_orientations(),
+      _config.precomputation_threads());
+  }
 }
 
 //==============================================================================
@@ -1886,6 +2156,7 @@ State DifferentialDrivePlanner::initiate(
 {
   using InternalState = ScheduledDifferentialDriveExpander::InternalState;
 
+  const auto setup_begin = std::chrono::steady_clock::now();
   State state{
     Conditions{
       starts,
@@ -1897,27 +2168,40 @@ State DifferentialDrivePlanner::initiate(
     rmf_utils::make_derived_impl<State::Internal, InternalState>()
   };
 
+  Planner::SearchStatistics* statistics = nullptr;
+  std::optional<CacheLookupRecorder> recorder;
+  if (state.conditions.options.collect_statistics())
+  {
+    statistics = &state.statistics.emplace();
+    recorder.emplace();
+  }
+
   auto& internal = static_cast<InternalState&>(*state.internal);
   const auto& goal = state.conditions.goal;
 
-  ScheduledDifferentialDriveExpander expander{
-    state.internal.get(),
-    state.issues,
-    _supergraph,
-    DifferentialDriveHeuristicAdapter{
-      _cache->get(),
+  {
+    // The expander needs to be gone before the recorder is read, because its
+    // cache only reports its lookups when it is destroyed.
+    ScheduledDifferentialDriveExpander expander{
+      state.internal.get(),
+      state.issues,
       _supergraph,
-      goal.waypoint(),
-      rmf_utils::pointer_to_opt(goal.orientation())
-    },
-    goal,
-    state.conditions.options
-  };
+      DifferentialDriveHeuristicAdapter{
+        _cache->get(),
+        _supergraph,
+        goal.waypoint(),
+        rmf_utils::pointer_to_opt(goal.orientation())
+      },
+      goal,
+      state.conditions.options,
+      statistics
+    };
 
-  for (const auto& start : starts)
-  {
-    if (auto node = expander.make_start_node(start))
-      internal.queue.push(node);
+    for (const auto& start : starts)
+    {
+      if (auto node = expander.make_start_node(start))
+        internal.queue.push(node);
+    }
   }
 
   if (internal.queue.empty())
@@ -1930,6 +2214,13 @@ State DifferentialDrivePlanner::initiate(
     state.ideal_cost = top->get_total_cost_estimate();
   }
 
+  if (statistics)
+  {
+    _record_lookups(*statistics, *recorder);
+    statistics->queued_nodes = internal.queue.size();
+    statistics->setup_time = std::chrono::steady_clock::now() - setup_begin;
+  }
+
   return state;
 }
 
@@ -1938,29 +2229,109 @@ std::optional<PlanData> DifferentialDrivePlanner::plan(State& state) const
 {
   const auto& goal = state.conditions.goal;
 
-  ScheduledDifferentialDriveExpander expander{
-    state.internal.get(),
-    state.issues,
-    _supergraph,
-    DifferentialDriveHeuristicAdapter{
-      _cache->get(),
-      _supergraph,
-      goal.waypoint(),
-      rmf_utils::pointer_to_opt(goal.orientation())
-    },
-    state.conditions.goal,
-    state.conditions.options
-  };
+  Planner::SearchStatistics* statistics = nullptr;
+  std::optional<CacheLookupRecorder> recorder;
+  if (state.conditions.options.collect_statistics())
+  {
+    // The statistics might have been turned on after the setup
+    if (!state.statistics.has_value())
+      state.statistics.emplace();
+
+    statistics = &*state.statistics;
+    recorder.emplace();
+  }
 
   using InternalState = ScheduledDifferentialDriveExpander::InternalState;
   auto& internal = static_cast<InternalState&>(*state.internal);
 
-  const auto solution = a_star_search(expander, internal.queue);
+  std::optional<PlanData> output;
+  {
+    // The expander needs to be gone before the recorder is read, because its
+    // cache only reports its lookups when it is destroyed.
+    ScheduledDifferentialDriveExpander expander{
+      state.internal.get(),
+      state.issues,
+      _supergraph,
+      DifferentialDriveHeuristicAdapter{
+        _cache->get(),
+        _supergraph,
+        goal.waypoint(),
+        rmf_utils::pointer_to_opt(goal.orientation())
+      },
+      state.conditions.goal,
+      state.conditions.options,
+      statistics
+    };
+
+    const auto search_begin = std::chrono::steady_clock::now();
+    const auto solution = a_star_search(expander, internal.queue);
+    const auto search_end = std::chrono::steady_clock::now();
+    if (statistics)
+      statistics->search_time += search_end - search_begin;
+
+    if (solution)
+    {
+      // The previous solution is no longer needed, so let its nodes be freed
+      internal.solution = solution;
+      internal.previous = nullptr;
+      output = expander.make_plan(solution);
+
+      if (statistics)
+      {
+        statistics->reconstruction_time +=
+          std::chrono::steady_clock::now() - search_end;
+      }
+    }
+  }
+
+  if (statistics)
+  {
+    _record_lookups(*statistics, *recorder);
+    statistics->expanded_nodes = internal.popped_count;
+    statistics->queued_nodes = internal.queue.size();
+  }
+
+  return output;
+}
+
+//==============================================================================
+void DifferentialDrivePlanner::reuse_search(
+  State& state,
+  const State& previous) const
+{
+  using InternalState = ScheduledDifferentialDriveExpander::InternalState;
+  const auto& previous_internal =
+    static_cast<const InternalState&>(*previous.internal);
+
+  if (!previous_internal.solution)
+    return;
+
+  // The previous solution can only be reused if it was heading to the same
+  // goal, because the remaining cost estimates of its nodes depend on it.
+  const auto& goal = state.conditions.goal;
+  const auto& previous_goal = previous.conditions.goal;
+  if (goal.waypoint() != previous_goal.waypoint())
+    return;
+
+  const double* const goal_yaw = goal.orientation();
+  const double* const previous_goal_yaw = previous_goal.orientation();
+  if (static_cast<bool>(goal_yaw) != static_cast<bool>(previous_goal_yaw))
+    return;
+
+  if (goal_yaw && *goal_yaw != *previous_goal_yaw)
+    return;
+
+  auto solution =
+    std::make_shared<InternalState::PreviousSolution>();
+  for (auto node = previous_internal.solution; node; node = node->parent)
+    solution->path.push_back(node);
 
-  if (!solution)
-    return std::nullopt;
+  std::reverse(solution->path.begin(), solution->path.end());
+  solution->pool = previous_internal.pool;
 
-  return expander.make_plan(solution);
+  auto& internal = static_cast<InternalState&>(*state.internal);
+  internal.spliced.assign(solution->path.size(), false);
+  internal.previous = std::move(solution);
 }
 
 //==============================================================================
@@ -1999,6 +2370,131 @@ DifferentialDrivePlanner::get_configuration() const
   return _config;
 }
 
+//==============================================================================
+bool DifferentialDrivePlanner::save_heuristic_cache(
+  const std::string& filename) const
+{
+  const auto& translation = _cache->generator()->translation_heuristics();
+  const auto& shortest_path =
+    translation.factory().shortest_path_heuristics();
+  const auto& euclidean = shortest_path.factory().euclidean_heuristics();
+
+  return save_heuristic_cache_file(
+    filename,
+    _configuration_hash,
+    HeuristicCacheData{
+      euclidean.items(),
+      shortest_path.items(),
+      translation.items()
+    });
+}
+
+//==============================================================================
+bool DifferentialDrivePlanner::load_heuristic_cache(
+  const std::string& filename) const
+{
+  auto data = load_heuristic_cache_file(filename, _configuration_hash);
+  if (!data)
+    return false;
+
+  const auto& translation = _cache->generator()->translation_heuristics();
+  const auto& shortest_path =
+    translation.factory().shortest_path_heuristics();
+  const auto& euclidean = shortest_path.factory().euclidean_heuristics();
+
+  for (auto& table : data->euclidean)
+    euclidean.get(table.first)->insert(std::move(table.second));
+
+  for (auto& table : data->shortest_path)
+    shortest_path.get(table.first)->insert(std::move(table.second));
+
+  for (auto& table : data->translation)
+    translation.get(table.first)->insert(std::move(table.second));
+
+  return true;
+}
+
+//==============================================================================
+bool DifferentialDrivePlanner::heuristics_precomputed() const
+{
+  return !_precomputer || _precomputer->finished();
+}
+
+//==============================================================================
+Planner::HeuristicCacheStatistics
+DifferentialDrivePlanner::heuristic_cache_statistics() const
+{
+  Planner::HeuristicCacheStatistics output;
+  const auto add_layer = [&output](std::string name, CacheStatistics stats)
+    {
+      output.estimated_bytes += stats.estimated_bytes;
+      output.layers.push_back(
+        Planner::HeuristicCacheStatistics::Layer{
+          std::move(name),
+          stats.tables,
+          stats.entries,
+          stats.estimated_bytes,
+          stats.hits,
+          stats.misses,
+          stats.evicted_tables,
+          stats.evicted_entries
+        });
+    };
+
+  const auto& translation = _cache->generator()->translation_heuristics();
+  const auto& shortest_path =
+    translation.factory().shortest_path_heuristics();
+  const auto& euclidean = shortest_path.factory().euclidean_heuristics();
+
+  add_layer("differential_drive", _cache->statistics());
+  add_layer("translation", translation.statistics());
+  add_layer("shortest_path", shortest_path.statistics());
+  add_layer("euclidean", euclidean.statistics());
+  if (const auto* landmark = shortest_path.factory().landmark_heuristics())
+    add_layer("landmark", landmark->statistics());
+
+  return output;
+}
+
+//==============================================================================
+void DifferentialDrivePlanner::_record_lookups(
+  Planner::SearchStatistics& statistics,
+  const CacheLookupRecorder& recorder) const
+{
+  const auto* const landmark = _cache->generator()->translation_heuristics()
+    .factory().shortest_path_heuristics().factory().landmark_heuristics();
+
+  // The layers are named the same way as in heuristic_cache_statistics()
+  auto& layers = statistics.heuristic_lookups;
+  if (layers.empty())
+  {
+    for (const char* name :
+      {"differential_drive", "translation", "shortest_path", "euclidean"})
+      layers.push_back({name});
+
+    if (landmark)
+      layers.push_back({"landmark"});
+  }
+
+  const auto add = [&layers](
+    const std::size_t layer,
+    const CacheLookupRecorder::Lookups& lookups)
+    {
+      layers[layer].hits += lookups.hits;
+      layers[layer].misses += lookups.misses;
+    };
+
+  add(0, recorder.get<DifferentialDriveHeuristic>());
+  add(1, recorder.get<TranslationHeuristic>());
+  add(2, recorder.get<ShortestPathHeuristic>());
+  add(3, recorder.get<EuclideanHeuristic>());
+  if (landmark)
+    add(4, recorder.get<LandmarkHeuristic>());
+
+  statistics.traversal_generations +=
+    recorder.get<TraversalGenerator>().misses;
+}
+
 //==============================================================================
 auto DifferentialDrivePlanner::debug_begin(
   const std::vector<Planner::Start>& starts,
@@ -21,6 +21,7 @@
 #include "../internal_planning.hpp"
 
 #include "DifferentialDriveHeuristic.hpp"
+#include "HeuristicPrecomputer.hpp"
 
 namespace rmf_traffic {
 namespace agv {
@@ -40,6 +41,8 @@ public:
 
   std::optional<PlanData> plan(State& state) const final;
 
+  void reuse_search(State& state, const State& previous) const final;
+
   std::vector<schedule::Itinerary> rollout(
     const Duration span,
     const Issues::BlockedNodes& nodes,
@@ -49,6 +52,14 @@ public:
 
   const Planner::Configuration& get_configuration() const final;
 
+  bool save_heuristic_cache(const std::string& filename) const final;
+
+  bool load_heuristic_cache(const std::string& filename) const final;
+
+  bool heuristics_precomputed() const final;
+
+  Planner::HeuristicCacheStatistics heuristic_cache_statistics() const final;
+
   std::unique_ptr<Debugger> debug_begin(
       const std::vector<Planner::Start>& starts,
       Planner::Goal goal,
@@ -59,9 +70,18 @@ public:
   std::optional<double> compute_heuristic(const Planner::Start& start) const;
 
 private:
+
+  /// Add the cache lookups that were recorded while a search was running to
+  /// its statistics
+  void _record_lookups(
+    Planner::SearchStatistics& statistics,
+    const CacheLookupRecorder& recorder) const;
+
   Planner::Configuration _config;
   std::shared_ptr<const Supergraph> _supergraph;
   CacheManagerPtr<DifferentialDriveHeuristic> _cache;
+  std::uint64_t _configuration_hash;
+  std::unique_ptr<HeuristicPrecomputer> _precomputer;
 };
 
 } // namespace planning
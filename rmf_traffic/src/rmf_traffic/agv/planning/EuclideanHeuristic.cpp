@@ -73,14 +73,14 @@ public:
     }
 
     const auto current_cost = top->current_cost;
-    const auto old_it = _old_items.find(current_wp_index);
-    if (old_it != _old_items.end())
+    const auto* const old_value = _old_items.find(current_wp_index);
+    if (old_value)
     {
       // If the current waypoint already has an entry in the old items, then we
       // can immediately create a node that brings it the rest of the way to the
       // goal with the best possible cost.
 
-      const auto remaining_cost = old_it->second;
+      const auto remaining_cost = *old_value;
       if (!remaining_cost.has_value())
       {
         // If the old value is a nullopt, then this waypoint has no way to reach
@@ -103,7 +103,8 @@ public:
     // If the current waypoint does not have an entry in the old items, then we
     // need to keep expanding, step by step.
     const auto& current_wp = _graph->original().waypoints.at(current_wp_index);
-    const auto& current_map = current_wp.get_map_name();
+    const MapId current_map =
+      Graph::Waypoint::Implementation::get(current_wp).map_id;
     const Eigen::Vector2d current_p = current_wp.get_location();
 
     if (current_map == _goal_map)
@@ -191,9 +192,9 @@ public:
   EuclideanExpander(
     std::size_t goal,
     Eigen::Vector2d goal_p,
-    const std::string& goal_map,
+    const MapId goal_map,
     double max_speed,
-    const EuclideanHeuristic::Storage& old_items,
+    const EuclideanHeuristic::SharedStorage& old_items,
     std::shared_ptr<const Supergraph> graph)
   : _goal(goal),
     _goal_p(goal_p),
@@ -208,9 +209,9 @@ public:
 private:
   std::size_t _goal;
   Eigen::Vector2d _goal_p;
-  const std::string& _goal_map;
+  MapId _goal_map;
   double _max_speed;
-  const EuclideanHeuristic::Storage& _old_items;
+  const EuclideanHeuristic::SharedStorage& _old_items;
   std::shared_ptr<const Supergraph> _graph;
   std::unordered_set<std::size_t> _visited;
 };
@@ -226,21 +227,21 @@ EuclideanHeuristic::EuclideanHeuristic(
 {
   const auto& goal_wp = _graph->original().waypoints.at(goal);
   _goal_p = goal_wp.get_location();
-  _goal_map = &goal_wp.get_map_name();
+  _goal_map = Graph::Waypoint::Implementation::get(goal_wp).map_id;
 }
 
 //==============================================================================
 std::optional<double> EuclideanHeuristic::generate(
     const std::size_t& key,
-    const Storage& old_items,
+    const SharedStorage& old_items,
     Storage& new_items) const
 {
   const auto& start_wp = _graph->original().waypoints.at(key);
-  const auto& start_map = start_wp.get_map_name();
+  const MapId start_map = Graph::Waypoint::Implementation::get(start_wp).map_id;
   const Eigen::Vector2d start_p = start_wp.get_location();
   const auto minimum_cost = (_goal_p - start_p).norm()/_max_speed;
 
-  if (start_map == *_goal_map)
+  if (start_map == _goal_map)
   {
     const auto it = new_items.insert({key, minimum_cost});
     return it.first->second;
@@ -249,7 +250,7 @@ std::optional<double> EuclideanHeuristic::generate(
   EuclideanExpander expander{
     _goal,
     _goal_p,
-    *_goal_map,
+    _goal_map,
     _max_speed,
     old_items,
     _graph
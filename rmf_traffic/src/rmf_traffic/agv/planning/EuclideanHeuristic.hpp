@@ -44,13 +44,13 @@ public:
 
   std::optional<double> generate(
       const std::size_t& key,
-      const Storage& old_items,
+      const SharedStorage& old_items,
       Storage& new_items) const final;
 
 private:
   std::size_t _goal;
   Eigen::Vector2d _goal_p;
-  const std::string* _goal_map;
+  MapId _goal_map;
   double _max_speed;
   std::shared_ptr<const Supergraph> _graph;
 };
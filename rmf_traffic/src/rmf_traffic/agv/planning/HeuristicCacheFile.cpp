@@ -0,0 +1,340 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "HeuristicCacheFile.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <vector>
+
+namespace rmf_traffic {
+namespace agv {
+namespace planning {
+
+namespace {
+//==============================================================================
+/// A 64-bit FNV-1a hash
+class Hasher
+{
+public:
+
+  void add(const void* data, const std::size_t size)
+  {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      _value ^= bytes[i];
+      _value *= 1099511628211ull;
+    }
+  }
+
+  void add(const double value)
+  {
+    add(&value, sizeof(value));
+  }
+
+  void add(const std::uint64_t value)
+  {
+    add(&value, sizeof(value));
+  }
+
+  void add(const std::string& value)
+  {
+    add(static_cast<std::uint64_t>(value.size()));
+    add(value.data(), value.size());
+  }
+
+  std::uint64_t value() const
+  {
+    return _value;
+  }
+
+private:
+  std::uint64_t _value = 14695981039346656037ull;
+};
+
+//==============================================================================
+void add_event(Hasher& hasher, const Graph::Lane::Event* event)
+{
+  hasher.add(static_cast<std::uint64_t>(event != nullptr));
+  if (event)
+    hasher.add(static_cast<std::uint64_t>(event->duration().count()));
+}
+
+//==============================================================================
+void add_constraint(
+  Hasher& hasher,
+  const Graph::OrientationConstraint* constraint,
+  const Eigen::Vector2d& course_vector)
+{
+  hasher.add(static_cast<std::uint64_t>(constraint != nullptr));
+  if (!constraint)
+    return;
+
+  // Orientation constraints are opaque, so we capture their behavior by
+  // probing how they would be applied to this lane from a few initial yaws.
+  for (const double yaw : {0.0, M_PI/2.0, M_PI, -M_PI/2.0})
+  {
+    Eigen::Vector3d position(0.0, 0.0, yaw);
+    const bool applied = constraint->apply(position, course_vector);
+    hasher.add(static_cast<std::uint64_t>(applied));
+    hasher.add(position[2]);
+  }
+}
+
+//==============================================================================
+const char Magic[8] = {'R', 'M', 'F', 'H', 'E', 'U', 'R', '\0'};
+const std::uint32_t Version = 1;
+
+struct FileHeader
+{
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t table_count;
+  std::uint64_t configuration_hash;
+};
+
+enum class TableKind : std::uint32_t
+{
+  Euclidean = 0,
+  ShortestPath = 1,
+  Translation = 2
+};
+
+struct TableHeader
+{
+  std::uint32_t kind;
+  std::uint32_t reserved;
+  std::uint64_t goal;
+  std::uint64_t entry_count;
+};
+
+// A nullopt heuristic (the goal cannot be reached) is stored as a NaN
+struct EntryRecord
+{
+  std::uint64_t key;
+  double value;
+};
+
+//==============================================================================
+template<typename T>
+void append(std::vector<char>& buffer, const T& value)
+{
+  const auto* bytes = reinterpret_cast<const char*>(&value);
+  buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+//==============================================================================
+template<typename T>
+bool read(const std::vector<char>& buffer, std::size_t& offset, T& value)
+{
+  if (buffer.size() < offset + sizeof(T))
+    return false;
+
+  std::memcpy(&value, buffer.data() + offset, sizeof(T));
+  offset += sizeof(T);
+  return true;
+}
+
+//==============================================================================
+void append_tables(
+  std::vector<char>& buffer,
+  const TableKind kind,
+  const HeuristicCacheData::Tables& tables)
+{
+  for (const auto& table : tables)
+  {
+    append(buffer, TableHeader{
+        static_cast<std::uint32_t>(kind),
+        0,
+        table.first,
+        table.second.size()
+      });
+
+    for (const auto& entry : table.second)
+    {
+      append(buffer, EntryRecord{
+          entry.first,
+          entry.second.value_or(std::numeric_limits<double>::quiet_NaN())
+        });
+    }
+  }
+}
+
+} // anonymous namespace
+
+//==============================================================================
+std::uint64_t hash_heuristic_configuration(
+  const Planner::Configuration& config)
+{
+  Hasher hasher;
+
+  const auto& traits = config.vehicle_traits();
+  hasher.add(traits.linear().get_nominal_velocity());
+  hasher.add(traits.linear().get_nominal_acceleration());
+  hasher.add(traits.rotational().get_nominal_velocity());
+  hasher.add(traits.rotational().get_nominal_acceleration());
+  if (const auto* differential = traits.get_differential())
+  {
+    hasher.add(differential->get_forward().x());
+    hasher.add(differential->get_forward().y());
+    hasher.add(static_cast<std::uint64_t>(differential->is_reversible()));
+  }
+
+  const auto& interpolation = config.interpolation();
+  hasher.add(interpolation.get_translation_threshold());
+  hasher.add(interpolation.get_rotation_threshold());
+  hasher.add(interpolation.get_corner_angle_threshold());
+
+  const auto& graph = config.graph();
+  hasher.add(static_cast<std::uint64_t>(graph.num_waypoints()));
+  for (std::size_t i = 0; i < graph.num_waypoints(); ++i)
+  {
+    const auto& wp = graph.get_waypoint(i);
+    hasher.add(wp.get_map_name());
+    hasher.add(wp.get_location().x());
+    hasher.add(wp.get_location().y());
+  }
+
+  hasher.add(static_cast<std::uint64_t>(graph.num_lanes()));
+  for (std::size_t i = 0; i < graph.num_lanes(); ++i)
+  {
+    const auto& lane = graph.get_lane(i);
+    const std::size_t entry_wp = lane.entry().waypoint_index();
+    const std::size_t exit_wp = lane.exit().waypoint_index();
+    hasher.add(static_cast<std::uint64_t>(entry_wp));
+    hasher.add(static_cast<std::uint64_t>(exit_wp));
+    add_event(hasher, lane.entry().event());
+    add_event(hasher, lane.exit().event());
+
+    const Eigen::Vector2d course =
+      graph.get_waypoint(exit_wp).get_location()
+      - graph.get_waypoint(entry_wp).get_location();
+    add_constraint(hasher, lane.entry().orientation_constraint(), course);
+    add_constraint(hasher, lane.exit().orientation_constraint(), course);
+  }
+
+  return hasher.value();
+}
+
+//==============================================================================
+bool save_heuristic_cache_file(
+  const std::string& filename,
+  const std::uint64_t configuration_hash,
+  const HeuristicCacheData& data)
+{
+  FileHeader header;
+  std::memcpy(header.magic, Magic, sizeof(Magic));
+  header.version = Version;
+  header.table_count = static_cast<std::uint32_t>(
+    data.euclidean.size() + data.shortest_path.size()
+    + data.translation.size());
+  header.configuration_hash = configuration_hash;
+
+  std::vector<char> buffer;
+  append(buffer, header);
+  append_tables(buffer, TableKind::Euclidean, data.euclidean);
+  append_tables(buffer, TableKind::ShortestPath, data.shortest_path);
+  append_tables(buffer, TableKind::Translation, data.translation);
+
+  const std::string temp_filename = filename + ".tmp";
+  {
+    std::ofstream file(temp_filename, std::ios::binary | std::ios::trunc);
+    if (!file)
+      return false;
+
+    file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    if (!file)
+      return false;
+  }
+
+  return std::rename(temp_filename.c_str(), filename.c_str()) == 0;
+}
+
+//==============================================================================
+std::optional<HeuristicCacheData> load_heuristic_cache_file(
+  const std::string& filename,
+  const std::uint64_t configuration_hash)
+{
+  std::ifstream file(filename, std::ios::binary);
+  if (!file)
+    return std::nullopt;
+
+  const std::vector<char> buffer{
+    std::istreambuf_iterator<char>(file),
+    std::istreambuf_iterator<char>()
+  };
+
+  std::size_t offset = 0;
+  FileHeader header;
+  if (!read(buffer, offset, header))
+    return std::nullopt;
+
+  if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0)
+    return std::nullopt;
+
+  if (header.version != Version)
+    return std::nullopt;
+
+  if (header.configuration_hash != configuration_hash)
+    return std::nullopt;
+
+  HeuristicCacheData data;
+  for (std::uint32_t t = 0; t < header.table_count; ++t)
+  {
+    TableHeader table_header;
+    if (!read(buffer, offset, table_header))
+      return std::nullopt;
+
+    const std::size_t remaining = buffer.size() - offset;
+    if (remaining / sizeof(EntryRecord) < table_header.entry_count)
+      return std::nullopt;
+
+    HeuristicCacheData::Tables* tables = nullptr;
+    switch (static_cast<TableKind>(table_header.kind))
+    {
+      case TableKind::Euclidean: tables = &data.euclidean; break;
+      case TableKind::ShortestPath: tables = &data.shortest_path; break;
+      case TableKind::Translation: tables = &data.translation; break;
+      default: return std::nullopt;
+    }
+
+    auto& table = (*tables)[table_header.goal];
+    table.reserve(table_header.entry_count);
+    for (std::uint64_t i = 0; i < table_header.entry_count; ++i)
+    {
+      EntryRecord record;
+      read(buffer, offset, record);
+
+      std::optional<double> value;
+      if (!std::isnan(record.value))
+        value = record.value;
+
+      table.insert({record.key, value});
+    }
+  }
+
+  return data;
+}
+
+} // namespace planning
+} // namespace agv
+} // namespace rmf_traffic
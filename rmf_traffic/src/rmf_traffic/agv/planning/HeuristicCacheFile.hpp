@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__AGV__PLANNING__HEURISTICCACHEFILE_HPP
+#define SRC__RMF_TRAFFIC__AGV__PLANNING__HEURISTICCACHEFILE_HPP
+
+#include <rmf_traffic/agv/Planner.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace rmf_traffic {
+namespace agv {
+namespace planning {
+
+//==============================================================================
+/// The contents of the heuristic caches that can be saved to a file. Each set
+/// of tables maps from a goal waypoint to the cached heuristic values for that
+/// goal.
+///
+/// The DifferentialDriveHeuristic is not included because its solutions hold
+/// route factories which cannot be serialized, but it is built on top of the
+/// TranslationHeuristic, so it benefits from these tables being warm.
+struct HeuristicCacheData
+{
+  using Table = std::unordered_map<std::size_t, std::optional<double>>;
+  using Tables = std::unordered_map<std::size_t, Table>;
+
+  Tables euclidean;
+  Tables shortest_path;
+  Tables translation;
+};
+
+//==============================================================================
+/// Compute a hash of every part of the planner configuration that can affect
+/// the values of the heuristics. A cache file can only be used by a planner
+/// whose configuration has the same hash.
+std::uint64_t hash_heuristic_configuration(
+  const Planner::Configuration& config);
+
+//==============================================================================
+/// Write the heuristic caches to a file.
+///
+/// The file is a header followed by tables of fixed-size records, so it can be
+/// memory-mapped or read in a single pass. The file is first written to a
+/// temporary location and then renamed, so a reader will never see a partially
+/// written file.
+///
+/// \return true if the file was written successfully.
+bool save_heuristic_cache_file(
+  const std::string& filename,
+  std::uint64_t configuration_hash,
+  const HeuristicCacheData& data);
+
+//==============================================================================
+/// Read the heuristic caches from a file.
+///
+/// \return the cache data, or a nullopt if the file could not be read, is
+/// malformed, or was made for a configuration with a different hash.
+std::optional<HeuristicCacheData> load_heuristic_cache_file(
+  const std::string& filename,
+  std::uint64_t configuration_hash);
+
+} // namespace planning
+} // namespace agv
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__AGV__PLANNING__HEURISTICCACHEFILE_HPP
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "HeuristicPrecomputer.hpp"
+
+#include <algorithm>
+
+namespace rmf_traffic {
+namespace agv {
+namespace planning {
+
+//==============================================================================
+HeuristicPrecomputer::HeuristicPrecomputer(
+  CacheManagerPtr<DifferentialDriveHeuristic> cache,
+  std::shared_ptr<const Supergraph> supergraph,
+  std::vector<std::size_t> goals,
+  std::vector<double> goal_yaws,
+  std::size_t num_threads)
+: _cache(std::move(cache)),
+  _supergraph(std::move(supergraph)),
+  _goals(std::move(goals)),
+  _goal_yaws(goal_yaws.begin(), goal_yaws.end()),
+  _next_goal(0),
+  _active_threads(0),
+  _stop(false)
+{
+  _goal_yaws.insert(_goal_yaws.begin(), std::nullopt);
+
+  if (num_threads == 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+  num_threads = std::min(num_threads, _goals.size());
+  _active_threads = num_threads;
+
+  try
+  {
+    _threads.reserve(num_threads);
+    for (std::size_t i = 0; i < num_threads; ++i)
+      _threads.emplace_back([this]() { _run(); });
+  }
+  catch (...)
+  {
+    _stop = true;
+    _active_threads -= num_threads - _threads.size();
+    for (auto& thread : _threads)
+      thread.join();
+
+    throw;
+  }
+}
+
+//==============================================================================
+bool HeuristicPrecomputer::finished() const
+{
+  return _active_threads == 0;
+}
+
+//==============================================================================
+HeuristicPrecomputer::~HeuristicPrecomputer()
+{
+  _stop = true;
+  for (auto& thread : _threads)
+    thread.join();
+}
+
+//==============================================================================
+void HeuristicPrecomputer::_run()
+{
+  while (!_stop)
+  {
+    const std::size_t i = _next_goal++;
+    if (_goals.size() <= i)
+      break;
+
+    _precompute(_goals[i]);
+  }
+
+  --_active_threads;
+}
+
+//==============================================================================
+void HeuristicPrecomputer::_precompute(const std::size_t goal) const
+{
+  const std::size_t N = _supergraph->original().waypoints.size();
+  const auto& translation = _cache->generator()->translation_heuristics();
+  const auto& shortest_path =
+    translation.factory().shortest_path_heuristics();
+
+  // Each item is visible to the planners as soon as it has been generated, so
+  // nothing is lost if we are told to stop part way through.
+  const auto shortest_path_cache = shortest_path.get(goal)->get();
+  const auto translation_cache = translation.get(goal)->get();
+  for (std::size_t start = 0; start < N && !_stop; ++start)
+  {
+    shortest_path_cache.get(start);
+    translation_cache.get(start);
+  }
+
+  for (const auto& goal_yaw : _goal_yaws)
+  {
+    const DifferentialDriveHeuristicAdapter adapter{
+      _cache->get(), _supergraph, goal, goal_yaw};
+
+    for (std::size_t start = 0; start < N && !_stop; ++start)
+      adapter.compute(start, 0.0);
+  }
+}
+
+} // namespace planning
+} // namespace agv
+} // namespace rmf_traffic
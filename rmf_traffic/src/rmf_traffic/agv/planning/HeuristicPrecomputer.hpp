@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__AGV__PLANNING__HEURISTICPRECOMPUTER_HPP
+#define SRC__RMF_TRAFFIC__AGV__PLANNING__HEURISTICPRECOMPUTER_HPP
+
+#include "DifferentialDriveHeuristic.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace rmf_traffic {
+namespace agv {
+namespace planning {
+
+//==============================================================================
+/// Fills the heuristic caches of a planner for a set of goals using a pool of
+/// background threads. Each goal is handed to one thread at a time. Planning
+/// requests that arrive in the meantime can use whatever has been computed so
+/// far and will lazily generate anything that is missing.
+class HeuristicPrecomputer
+{
+public:
+
+  /// Constructor
+  ///
+  /// \param[in] cache
+  ///   The cache manager of the planner whose heuristics should be filled
+  ///
+  /// \param[in] supergraph
+  ///   The supergraph that the planner is using
+  ///
+  /// \param[in] goals
+  ///   The goal waypoints whose heuristics should be computed
+  ///
+  /// \param[in] goal_yaws
+  ///   The goal orientations to compute heuristics for, in addition to having
+  ///   no goal orientation
+  ///
+  /// \param[in] num_threads
+  ///   The number of threads to use. If this is zero, the hardware concurrency
+  ///   will be used.
+  HeuristicPrecomputer(
+    CacheManagerPtr<DifferentialDriveHeuristic> cache,
+    std::shared_ptr<const Supergraph> supergraph,
+    std::vector<std::size_t> goals,
+    std::vector<double> goal_yaws,
+    std::size_t num_threads);
+
+  /// True if every goal has been computed.
+  bool finished() const;
+
+  /// Stop computing and wait for the threads to wind down. Goals that are
+  /// already being computed will be abandoned part way through.
+  ~HeuristicPrecomputer();
+
+private:
+
+  void _run();
+
+  void _precompute(std::size_t goal) const;
+
+  CacheManagerPtr<DifferentialDriveHeuristic> _cache;
+  std::shared_ptr<const Supergraph> _supergraph;
+  std::vector<std::size_t> _goals;
+  std::vector<std::optional<double>> _goal_yaws;
+  std::atomic_size_t _next_goal;
+  std::atomic_size_t _active_threads;
+  std::atomic_bool _stop;
+  std::vector<std::thread> _threads;
+};
+
+} // namespace planning
+} // namespace agv
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__AGV__PLANNING__HEURISTICPRECOMPUTER_HPP
@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "LandmarkHeuristic.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <queue>
+
+namespace rmf_traffic {
+namespace agv {
+namespace planning {
+
+namespace {
+//==============================================================================
+const double inf = std::numeric_limits<double>::infinity();
+
+//==============================================================================
+/// The cost of moving down a lane, measured the same way as the
+/// ShortestPathExpander measures it.
+double lane_cost(
+  const Graph::Implementation& graph,
+  const Graph::Lane& lane,
+  const double max_speed)
+{
+  const auto& entry = lane.entry();
+  const auto& exit = lane.exit();
+  const Eigen::Vector2d p0 =
+    graph.waypoints[entry.waypoint_index()].get_location();
+  const Eigen::Vector2d p1 =
+    graph.waypoints[exit.waypoint_index()].get_location();
+
+  double cost = (p1 - p0).norm()/max_speed;
+  if (const auto entry_event = entry.event())
+    cost += rmf_traffic::time::to_seconds(entry_event->duration());
+
+  if (const auto exit_event = exit.event())
+    cost += rmf_traffic::time::to_seconds(exit_event->duration());
+
+  return cost;
+}
+
+//==============================================================================
+/// Dijkstra's algorithm from a source waypoint. If reverse is true, the lanes
+/// are followed backwards, which gives the cost of reaching the source from
+/// every waypoint instead.
+std::vector<double> compute_costs(
+  const Graph::Implementation& graph,
+  const std::vector<double>& lane_costs,
+  const std::size_t source,
+  const bool reverse)
+{
+  std::vector<double> costs(graph.waypoints.size(), inf);
+
+  using Item = std::pair<double, std::size_t>;
+  std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue;
+  costs[source] = 0.0;
+  queue.push({0.0, source});
+
+  while (!queue.empty())
+  {
+    const auto [cost, wp] = queue.top();
+    queue.pop();
+    if (costs[wp] < cost)
+      continue;
+
+    const auto& lanes = reverse ? graph.lanes_into[wp] : graph.lanes_from[wp];
+    for (const auto l : lanes)
+    {
+      const auto& lane = graph.lanes[l];
+      const std::size_t next = reverse ?
+        lane.entry().waypoint_index() : lane.exit().waypoint_index();
+
+      const double next_cost = cost + lane_costs[l];
+      if (next_cost < costs[next])
+      {
+        costs[next] = next_cost;
+        queue.push({next_cost, next});
+      }
+    }
+  }
+
+  return costs;
+}
+} // anonymous namespace
+
+//==============================================================================
+Landmarks::Landmarks(
+  const Supergraph& supergraph,
+  const double max_speed,
+  const std::size_t count)
+{
+  const auto& graph = supergraph.original();
+  const std::size_t N = graph.waypoints.size();
+
+  std::vector<double> lane_costs;
+  lane_costs.reserve(graph.lanes.size());
+  for (const auto& lane : graph.lanes)
+    lane_costs.push_back(lane_cost(graph, lane, max_speed));
+
+  // We choose each landmark to be as far as possible from the landmarks that
+  // were already chosen (farthest point selection). Waypoints that cannot be
+  // reached from any landmark in either direction are treated as infinitely
+  // far away so that each disconnected part of the graph gets a landmark.
+  // Waypoints without any lanes would make useless landmarks, so they are
+  // never chosen.
+  std::vector<bool> eligible(N, false);
+  for (std::size_t i = 0; i < N; ++i)
+    eligible[i] = !graph.lanes_from[i].empty() || !graph.lanes_into[i].empty();
+
+  const auto seed_it = std::find(eligible.begin(), eligible.end(), true);
+  if (seed_it == eligible.end() || count == 0)
+    return;
+
+  const std::size_t seed = seed_it - eligible.begin();
+
+  // The first landmark is the waypoint farthest from an arbitrary seed, which
+  // tends to put it on the edge of the graph.
+  std::vector<double> separation =
+    compute_costs(graph, lane_costs, seed, false);
+  for (auto& s : separation)
+  {
+    if (s == inf)
+      s = 0.0;
+  }
+
+  while (_waypoints.size() < count)
+  {
+    std::optional<std::size_t> next;
+    for (std::size_t i = 0; i < N; ++i)
+    {
+      if (!eligible[i])
+        continue;
+
+      if (!next.has_value() || separation[*next] < separation[i])
+        next = i;
+    }
+
+    if (!next.has_value())
+      break;
+
+    const std::size_t landmark = *next;
+    eligible[landmark] = false;
+    _waypoints.push_back(landmark);
+    _cost_from.push_back(compute_costs(graph, lane_costs, landmark, false));
+    _cost_to.push_back(compute_costs(graph, lane_costs, landmark, true));
+
+    if (_waypoints.size() == 1)
+      std::fill(separation.begin(), separation.end(), inf);
+
+    const auto& from = _cost_from.back();
+    const auto& to = _cost_to.back();
+    for (std::size_t i = 0; i < N; ++i)
+      separation[i] = std::min(separation[i], std::min(from[i], to[i]));
+  }
+}
+
+//==============================================================================
+std::optional<double> Landmarks::lower_bound(
+  const std::size_t from,
+  const std::size_t to) const
+{
+  double bound = 0.0;
+  for (std::size_t k = 0; k < _waypoints.size(); ++k)
+  {
+    const double landmark_to_start = _cost_from[k][from];
+    const double landmark_to_goal = _cost_from[k][to];
+    const double start_to_landmark = _cost_to[k][from];
+    const double goal_to_landmark = _cost_to[k][to];
+
+    // If the goal can reach the landmark but the start cannot, then the start
+    // cannot reach the goal either. Likewise if the landmark can reach the
+    // start but not the goal.
+    if (start_to_landmark == inf && goal_to_landmark < inf)
+      return std::nullopt;
+
+    if (landmark_to_goal == inf && landmark_to_start < inf)
+      return std::nullopt;
+
+    if (landmark_to_goal < inf && landmark_to_start < inf)
+      bound = std::max(bound, landmark_to_goal - landmark_to_start);
+
+    if (start_to_landmark < inf && goal_to_landmark < inf)
+      bound = std::max(bound, start_to_landmark - goal_to_landmark);
+  }
+
+  return bound;
+}
+
+//==============================================================================
+const std::vector<std::size_t>& Landmarks::waypoints() const
+{
+  return _waypoints;
+}
+
+//==============================================================================
+LandmarkHeuristic::LandmarkHeuristic(
+  const std::size_t goal,
+  std::shared_ptr<const Landmarks> landmarks)
+: _goal(goal),
+  _landmarks(std::move(landmarks))
+{
+  // Do nothing
+}
+
+//==============================================================================
+std::optional<double> LandmarkHeuristic::generate(
+  const std::size_t& key,
+  const SharedStorage&,
+  Storage& new_items) const
+{
+  const auto bound = _landmarks->lower_bound(key, _goal);
+  new_items.insert({key, bound});
+  return bound;
+}
+
+//==============================================================================
+LandmarkHeuristicFactory::LandmarkHeuristicFactory(
+  std::shared_ptr<const Supergraph> graph,
+  const std::size_t num_landmarks)
+: _landmarks(
+    std::make_shared<Landmarks>(
+      *graph,
+      graph->traits().linear().get_nominal_velocity(),
+      num_landmarks))
+{
+  // Do nothing
+}
+
+//==============================================================================
+ConstLandmarkHeuristicPtr LandmarkHeuristicFactory::make(
+  const std::size_t goal) const
+{
+  return std::make_shared<LandmarkHeuristic>(goal, _landmarks);
+}
+
+//==============================================================================
+const Landmarks& LandmarkHeuristicFactory::landmarks() const
+{
+  return *_landmarks;
+}
+
+} // namespace planning
+} // namespace agv
+} // namespace rmf_traffic
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__AGV__PLANNING__LANDMARKHEURISTIC_HPP
+#define SRC__RMF_TRAFFIC__AGV__PLANNING__LANDMARKHEURISTIC_HPP
+
+#include "CacheManager.hpp"
+#include "Supergraph.hpp"
+
+namespace rmf_traffic {
+namespace agv {
+namespace planning {
+
+//==============================================================================
+/// A set of landmark waypoints together with the shortest path costs from
+/// every waypoint to each landmark and from each landmark to every waypoint.
+/// The costs are measured the same way as the ShortestPathHeuristic measures
+/// them, so the triangle inequality gives lower bounds for that heuristic.
+class Landmarks
+{
+public:
+
+  /// Choose the landmarks and compute their costs.
+  ///
+  /// \param[in] graph
+  ///   The graph to choose landmarks from
+  ///
+  /// \param[in] max_speed
+  ///   The speed used to turn lane lengths into costs
+  ///
+  /// \param[in] count
+  ///   The number of landmarks to choose. Fewer will be chosen if the graph
+  ///   does not have enough waypoints with lanes.
+  Landmarks(
+    const Supergraph& graph,
+    double max_speed,
+    std::size_t count);
+
+  /// Get a lower bound on the cost of moving from one waypoint to another. A
+  /// nullopt means that the landmarks prove there is no way to get there.
+  std::optional<double> lower_bound(std::size_t from, std::size_t to) const;
+
+  /// The waypoints that were chosen as landmarks
+  const std::vector<std::size_t>& waypoints() const;
+
+private:
+  std::vector<std::size_t> _waypoints;
+
+  // _cost_from[k][v] is the cost of moving from landmark k to waypoint v
+  std::vector<std::vector<double>> _cost_from;
+
+  // _cost_to[k][v] is the cost of moving from waypoint v to landmark k
+  std::vector<std::vector<double>> _cost_to;
+};
+
+//==============================================================================
+/// The LandmarkHeuristic uses the triangle inequality with a set of Landmarks
+/// (the ALT technique) to bound the cost of reaching the goal. Unlike the
+/// EuclideanHeuristic, it accounts for the lanes that actually exist and the
+/// durations of their events, so it remains informative when the goal is on
+/// another floor.
+class LandmarkHeuristic
+    : public Generator<std::unordered_map<std::size_t, std::optional<double>>>
+{
+public:
+
+  LandmarkHeuristic(
+    std::size_t goal,
+    std::shared_ptr<const Landmarks> landmarks);
+
+  std::optional<double> generate(
+    const std::size_t& key,
+    const SharedStorage& old_items,
+    Storage& new_items) const final;
+
+private:
+  std::size_t _goal;
+  std::shared_ptr<const Landmarks> _landmarks;
+};
+
+//==============================================================================
+using ConstLandmarkHeuristicPtr = std::shared_ptr<const LandmarkHeuristic>;
+
+//==============================================================================
+class LandmarkHeuristicFactory : public Factory<LandmarkHeuristic>
+{
+public:
+
+  using Generator = LandmarkHeuristic;
+
+  LandmarkHeuristicFactory(
+    std::shared_ptr<const Supergraph> graph,
+    std::size_t num_landmarks);
+
+  ConstLandmarkHeuristicPtr make(const std::size_t goal) const final;
+
+  const Landmarks& landmarks() const;
+
+private:
+  std::shared_ptr<const Landmarks> _landmarks;
+};
+
+//==============================================================================
+using LandmarkHeuristicCacheMap = CacheManagerMap<LandmarkHeuristicFactory>;
+
+} // namespace planning
+} // namespace agv
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__AGV__PLANNING__LANDMARKHEURISTIC_HPP
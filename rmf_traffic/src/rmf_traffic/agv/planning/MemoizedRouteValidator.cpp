@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "MemoizedRouteValidator.hpp"
+
+#include "../internal_RouteValidator.hpp"
+#include "../../internal_Route.hpp"
+
+#include <rmf_traffic/DetectConflict.hpp>
+
+#include <algorithm>
+#include <chrono>
+
+namespace rmf_traffic {
+namespace agv {
+namespace planning {
+
+namespace {
+//==============================================================================
+std::size_t hash_route(const Route& route)
+{
+  std::size_t h = MapId::Hash()(RouteData::get(route).map_id);
+  const auto combine = [&h](const std::size_t value)
+    {
+      h ^= value + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+    };
+
+  for (const auto& wp : route.trajectory())
+  {
+    combine(std::hash<Time::rep>()(wp.time().time_since_epoch().count()));
+    const Eigen::Vector3d p = wp.position();
+    const Eigen::Vector3d v = wp.velocity();
+    for (int i = 0; i < 3; ++i)
+    {
+      combine(std::hash<double>()(p[i]));
+      combine(std::hash<double>()(v[i]));
+    }
+  }
+
+  return h;
+}
+
+//==============================================================================
+bool same_trajectory(const Trajectory& a, const Trajectory& b)
+{
+  if (a.size() != b.size())
+    return false;
+
+  for (auto it_a = a.begin(), it_b = b.begin(); it_a != a.end(); ++it_a, ++it_b)
+  {
+    if (it_a->time() != it_b->time()
+      || it_a->position() != it_b->position()
+      || it_a->velocity() != it_b->velocity())
+      return false;
+  }
+
+  return true;
+}
+} // anonymous namespace
+
+//==============================================================================
+MemoizedRouteValidator::MemoizedRouteValidator(
+  const RouteValidator* validator,
+  const std::size_t token)
+: _validator(validator),
+  _token(token),
+  _schedule_validator(dynamic_cast<const ScheduleRouteValidator*>(validator))
+{
+  if (_schedule_validator)
+    _version = _schedule_validator->schedule_viewer().latest_version();
+}
+
+//==============================================================================
+bool MemoizedRouteValidator::is_current(const std::size_t token) const
+{
+  if (token != _token)
+    return false;
+
+  if (_schedule_validator)
+    return _version == _schedule_validator->schedule_viewer().latest_version();
+
+  return true;
+}
+
+//==============================================================================
+void MemoizedRouteValidator::record_statistics(
+  Planner::SearchStatistics* statistics)
+{
+  _statistics = statistics;
+}
+
+//==============================================================================
+std::optional<RouteValidator::Conflict>
+MemoizedRouteValidator::find_conflict(const Route& route) const
+{
+  if (!_statistics)
+    return _find_memoized(route);
+
+  const auto begin = std::chrono::steady_clock::now();
+  auto conflict = _find_memoized(route);
+  ++_statistics->validator_calls;
+  _statistics->validator_time += std::chrono::steady_clock::now() - begin;
+  return conflict;
+}
+
+//==============================================================================
+std::optional<RouteValidator::Conflict>
+MemoizedRouteValidator::_find_memoized(const Route& route) const
+{
+  if (route.trajectory().empty())
+    return _validator->find_conflict(route);
+
+  auto& memos = _memos[hash_route(route)];
+  for (const auto& memo : memos)
+  {
+    if (memo.map == RouteData::get(route).map_id
+      && same_trajectory(memo.trajectory, route.trajectory()))
+      return memo.conflict;
+  }
+
+  auto conflict = _find_conflict(route);
+  memos.push_back(
+    Memo{RouteData::get(route).map_id, route.trajectory(), conflict});
+  return conflict;
+}
+
+//==============================================================================
+std::unique_ptr<RouteValidator> MemoizedRouteValidator::clone() const
+{
+  return std::make_unique<MemoizedRouteValidator>(*this);
+}
+
+//==============================================================================
+std::optional<RouteValidator::Conflict>
+MemoizedRouteValidator::_find_conflict(const Route& route) const
+{
+  if (!_schedule_validator)
+    return _validator->find_conflict(route);
+
+  const auto& validator =
+    ScheduleRouteValidator::Implementation::get(*_schedule_validator);
+
+  const Time start = *route.trajectory().start_time();
+  const Time finish = *route.trajectory().finish_time();
+  const auto& snapshot = _snapshot(RouteData::get(route).map_id, start);
+
+  // Gather every route that overlaps this one in time. Nothing that starts
+  // before (start - longest) can reach this far.
+  const auto compare = [](const Entry& entry, const Time t)
+    {
+      return entry.start < t;
+    };
+
+  _candidates.clear();
+  auto it = std::lower_bound(
+    snapshot.entries.begin(), snapshot.entries.end(),
+    start - snapshot.longest, compare);
+
+  for (; it != snapshot.entries.end() && it->start <= finish; ++it)
+  {
+    if (start <= it->finish)
+      _candidates.push_back(it->order);
+  }
+
+  // Check the candidates in the order that the schedule gave them to us so
+  // that we report the same conflict as ScheduleRouteValidator would.
+  std::sort(_candidates.begin(), _candidates.end());
+  for (const std::size_t order : _candidates)
+  {
+    const auto& v = *snapshot.entries_by_order[order];
+    if (const auto time = rmf_traffic::DetectConflict::between(
+        validator.profile,
+        route.trajectory(),
+        v.description.profile(),
+        v.route.trajectory()))
+    {
+      return Conflict{v.participant, *time};
+    }
+  }
+
+  return std::nullopt;
+}
+
+//==============================================================================
+auto MemoizedRouteValidator::_snapshot(
+  const MapId map,
+  const Time lower_bound) const -> const Snapshot&
+{
+  const auto found = _snapshots.find(map);
+  if (found != _snapshots.end() && found->second.lower_bound <= lower_bound)
+    return found->second;
+
+  const auto& validator =
+    ScheduleRouteValidator::Implementation::get(*_schedule_validator);
+
+  schedule::Query::Spacetime spacetime;
+  spacetime.query_timespan()
+    .all_maps(false)
+    .add_map(map.name())
+    .set_lower_time_bound(lower_bound);
+
+  Snapshot snapshot;
+  snapshot.lower_bound = lower_bound;
+  snapshot.view = std::make_shared<schedule::Viewer::View>(
+    validator.viewer->query(
+      spacetime, schedule::Query::Participants::make_all()));
+
+  for (const auto& v : *snapshot.view)
+  {
+    const std::size_t order = snapshot.entries_by_order.size();
+    snapshot.entries_by_order.push_back(&v);
+
+    const auto& trajectory = v.route.trajectory();
+    if (v.participant == validator.participant || trajectory.empty())
+      continue;
+
+    const Time start = *trajectory.start_time();
+    const Time finish = *trajectory.finish_time();
+    snapshot.entries.push_back(Entry{start, finish, order});
+    snapshot.longest = std::max(snapshot.longest, finish - start);
+  }
+
+  std::sort(
+    snapshot.entries.begin(), snapshot.entries.end(),
+    [](const Entry& a, const Entry& b) { return a.start < b.start; });
+
+  return _snapshots[map] = std::move(snapshot);
+}
+
+} // namespace planning
+} // namespace agv
+} // namespace rmf_traffic
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__AGV__PLANNING__MEMOIZEDROUTEVALIDATOR_HPP
+#define SRC__RMF_TRAFFIC__AGV__PLANNING__MEMOIZEDROUTEVALIDATOR_HPP
+
+#include "../../MapId.hpp"
+
+#include <rmf_traffic/agv/Planner.hpp>
+#include <rmf_traffic/agv/RouteValidator.hpp>
+
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace rmf_traffic {
+namespace agv {
+namespace planning {
+
+//==============================================================================
+/// Wraps the RouteValidator of a planning attempt so that the same route is
+/// never checked twice. The search produces identical routes over and over,
+/// e.g. when different branches arrive at a waypoint at the same time and then
+/// try the same lanes out of it.
+///
+/// If the wrapped validator is a ScheduleRouteValidator, then this will not
+/// query its schedule viewer for every route. Instead it fetches everything on
+/// a map from the earliest time that it is asked about, once, and indexes the
+/// routes by time. This means the validator works from a snapshot of the
+/// schedule, so it should not outlive the schedule version that it was made
+/// for. Use is_current() to check that.
+class MemoizedRouteValidator : public RouteValidator
+{
+public:
+
+  /// Constructor
+  ///
+  /// \param[in] validator
+  ///   The validator to wrap. This must outlive the MemoizedRouteValidator.
+  ///
+  /// \param[in] token
+  ///   A token that identifies the validator. The address of the validator is
+  ///   not enough, because a different validator may be created at the same
+  ///   address after this one is gone.
+  MemoizedRouteValidator(const RouteValidator* validator, std::size_t token);
+
+  /// True if this is wrapping the validator with the given token and the
+  /// schedule has not changed since the snapshot was taken.
+  bool is_current(std::size_t token) const;
+
+  /// Count the calls to find_conflict() and the time spent in them in these
+  /// statistics. Pass in a nullptr to stop counting.
+  void record_statistics(Planner::SearchStatistics* statistics);
+
+  // Documentation inherited
+  std::optional<Conflict> find_conflict(const Route& route) const final;
+
+  // Documentation inherited
+  std::unique_ptr<RouteValidator> clone() const final;
+
+private:
+
+  std::optional<Conflict> _find_memoized(const Route& route) const;
+
+  std::optional<Conflict> _find_conflict(const Route& route) const;
+
+  struct Entry
+  {
+    Time start;
+    Time finish;
+    std::size_t order;
+  };
+
+  struct Snapshot
+  {
+    Time lower_bound;
+    std::shared_ptr<const schedule::Viewer::View> view;
+
+    // The elements of the view in the order that the schedule gave them
+    std::vector<const schedule::Viewer::View::Element*> entries_by_order;
+
+    // Sorted by start time
+    std::vector<Entry> entries;
+    Duration longest = Duration(0);
+  };
+
+  const Snapshot& _snapshot(MapId map, Time lower_bound) const;
+
+  struct Memo
+  {
+    MapId map;
+    Trajectory trajectory;
+    std::optional<Conflict> conflict;
+  };
+
+  const RouteValidator* _validator;
+  std::size_t _token;
+  const ScheduleRouteValidator* _schedule_validator;
+  std::optional<schedule::Version> _version;
+  Planner::SearchStatistics* _statistics = nullptr;
+
+  mutable std::unordered_map<MapId, Snapshot, MapId::Hash> _snapshots;
+  mutable std::unordered_map<std::size_t, std::vector<Memo>> _memos;
+  mutable std::vector<std::size_t> _candidates;
+};
+
+} // namespace planning
+} // namespace agv
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__AGV__PLANNING__MEMOIZEDROUTEVALIDATOR_HPP
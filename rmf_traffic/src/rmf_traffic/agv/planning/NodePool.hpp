@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__AGV__PLANNING__NODEPOOL_HPP
+#define SRC__RMF_TRAFFIC__AGV__PLANNING__NODEPOOL_HPP
+
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace rmf_traffic {
+namespace agv {
+namespace planning {
+
+//==============================================================================
+/// An arena that owns the nodes of a search tree. Nodes are constructed in
+/// large blocks and are never freed individually. Instead the whole tree is
+/// destroyed at once when the pool is destroyed, so nodes can refer to each
+/// other with plain pointers.
+///
+/// A pool may be chained to the pool of an earlier search whose nodes are being
+/// referred to, e.g. when the state of a search is copied. The earlier pool
+/// will be kept alive for as long as this one is.
+template<typename NodeArg>
+class NodePool
+{
+public:
+
+  using Node = NodeArg;
+
+  NodePool(std::shared_ptr<const NodePool> previous = nullptr);
+
+  /// Construct a new node inside of this pool.
+  template<typename... Args>
+  Node* make(Args&&... args);
+
+  /// The number of nodes that have been constructed in this pool
+  std::size_t size() const;
+
+  NodePool(const NodePool&) = delete;
+  NodePool& operator=(const NodePool&) = delete;
+
+  ~NodePool();
+
+private:
+  using Slot = typename std::aligned_storage<sizeof(Node), alignof(Node)>::type;
+
+  static constexpr std::size_t BlockSize = 128;
+
+  std::vector<std::unique_ptr<Slot[]>> _blocks;
+  std::size_t _size = 0;
+  std::shared_ptr<const NodePool> _previous;
+};
+
+//==============================================================================
+template<typename NodeArg>
+NodePool<NodeArg>::NodePool(std::shared_ptr<const NodePool> previous)
+: _previous(std::move(previous))
+{
+  // Do nothing
+}
+
+//==============================================================================
+template<typename NodeArg>
+template<typename... Args>
+auto NodePool<NodeArg>::make(Args&&... args) -> Node*
+{
+  const std::size_t slot = _size % BlockSize;
+  if (slot == 0 && _blocks.size() * BlockSize == _size)
+    _blocks.emplace_back(new Slot[BlockSize]);
+
+  // If the constructor throws then _size is not incremented, so the slot will
+  // be reused by the next node.
+  Node* const node =
+    new (&_blocks.back()[slot]) Node(std::forward<Args>(args)...);
+
+  ++_size;
+  return node;
+}
+
+//==============================================================================
+template<typename NodeArg>
+std::size_t NodePool<NodeArg>::size() const
+{
+  return _size;
+}
+
+//==============================================================================
+template<typename NodeArg>
+NodePool<NodeArg>::~NodePool()
+{
+  for (std::size_t i = 0; i < _size; ++i)
+  {
+    Slot& slot = _blocks[i / BlockSize][i % BlockSize];
+    reinterpret_cast<Node*>(&slot)->~Node();
+  }
+}
+
+} // namespace planning
+} // namespace agv
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__AGV__PLANNING__NODEPOOL_HPP
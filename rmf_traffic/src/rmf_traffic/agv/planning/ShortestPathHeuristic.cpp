@@ -37,7 +37,8 @@ public:
     std::size_t waypoint;
 
     // For the remaining_cost_estimate we'll use the Euclidean Heuristic, which
-    // takes floor changes into account.
+    // takes floor changes into account, together with the Landmark Heuristic
+    // if landmarks are available.
     double remaining_cost_estimate;
     double current_cost;
     NodePtr parent;
@@ -72,13 +73,13 @@ public:
     }
 
     const auto current_cost = top->current_cost;
-    const auto old_it = _old_items.find(current_wp_index);
-    if (old_it != _old_items.end())
+    const auto* const old_value = _old_items.find(current_wp_index);
+    if (old_value)
     {
       // If the current waypoint already has an entry in the old items, then we
       // can immediately create a node that brings it the rest of the way to the
       // goal with the best possible cost.
-      const auto remaining_cost = old_it->second;
+      const auto remaining_cost = *old_value;
       if (!remaining_cost.has_value())
       {
         // If the old value is a nullopt, then this waypoint has no way to reach
@@ -112,7 +113,7 @@ public:
       }
 
       const std::optional<double> remaining_cost_estimate =
-          _heuristic.get(next_waypoint_index);
+          estimate(next_waypoint_index);
 
       if (!remaining_cost_estimate.has_value())
       {
@@ -152,23 +153,41 @@ public:
   ShortestPathExpander(
       std::size_t goal,
       double max_speed,
-      const ShortestPathHeuristic::Storage& old_items,
+      const ShortestPathHeuristic::SharedStorage& old_items,
       Cache<EuclideanHeuristic> heuristic,
+      std::optional<Cache<LandmarkHeuristic>> landmarks,
       std::shared_ptr<const Supergraph> graph)
     : _goal(goal),
       _max_speed(max_speed),
       _old_items(old_items),
       _heuristic(std::move(heuristic)),
+      _landmarks(std::move(landmarks)),
       _graph(std::move(graph))
   {
     // Do nothing
   }
 
+  /// Both heuristics are lower bounds, so the larger of them is the tighter
+  /// bound. If either of them says the goal cannot be reached, it cannot.
+  std::optional<double> estimate(const std::size_t waypoint) const
+  {
+    const auto euclidean = _heuristic.get(waypoint);
+    if (!euclidean.has_value() || !_landmarks.has_value())
+      return euclidean;
+
+    const auto landmark = _landmarks->get(waypoint);
+    if (!landmark.has_value())
+      return std::nullopt;
+
+    return std::max(*euclidean, *landmark);
+  }
+
 private:
   std::size_t _goal;
   double _max_speed;
-  const ShortestPathHeuristic::Storage& _old_items;
+  const ShortestPathHeuristic::SharedStorage& _old_items;
   Cache<EuclideanHeuristic> _heuristic;
+  std::optional<Cache<LandmarkHeuristic>> _landmarks;
   std::shared_ptr<const Supergraph> _graph;
   std::unordered_set<std::size_t> _visited;
 };
@@ -178,11 +197,13 @@ ShortestPathHeuristic::ShortestPathHeuristic(
     std::size_t goal,
     double max_speed,
     std::shared_ptr<const Supergraph> graph,
-    CacheManagerPtr<EuclideanHeuristic> heuristic)
+    CacheManagerPtr<EuclideanHeuristic> heuristic,
+    CacheManagerPtr<LandmarkHeuristic> landmarks)
   : _goal(goal),
     _max_speed(max_speed),
     _graph(std::move(graph)),
-    _heuristic(std::move(heuristic))
+    _heuristic(std::move(heuristic)),
+    _landmarks(std::move(landmarks))
 {
   // Do nothing
 }
@@ -190,11 +211,23 @@ ShortestPathHeuristic::ShortestPathHeuristic(
 //==============================================================================
 std::optional<double> ShortestPathHeuristic::generate(
     const std::size_t& key,
-    const Storage& old_items,
+    const SharedStorage& old_items,
     Storage& new_items) const
 {
-  auto heuristic = _heuristic->get();
-  auto start_heuristic = heuristic.get(key);
+  std::optional<Cache<LandmarkHeuristic>> landmarks;
+  if (_landmarks)
+    landmarks = _landmarks->get();
+
+  ShortestPathExpander expander{
+    _goal,
+    _max_speed,
+    old_items,
+    _heuristic->get(),
+    std::move(landmarks),
+    _graph
+  };
+
+  const auto start_heuristic = expander.estimate(key);
   if (!start_heuristic.has_value())
   {
     // If the heuristic of this starting waypoint is a nullopt, then it is
@@ -213,14 +246,6 @@ std::optional<double> ShortestPathHeuristic::generate(
         nullptr
       }));
 
-  ShortestPathExpander expander{
-    _goal,
-    _max_speed,
-    old_items,
-    std::move(heuristic),
-    _graph
-  };
-
   const ShortestPathExpander::NodePtr solution = a_star_search(expander, queue);
   if (!solution)
   {
@@ -245,12 +270,17 @@ std::optional<double> ShortestPathHeuristic::generate(
 
 //==============================================================================
 ShortestPathHeuristicFactory::ShortestPathHeuristicFactory(
-  std::shared_ptr<const Supergraph> graph)
+  std::shared_ptr<const Supergraph> graph,
+  const std::size_t num_landmarks)
 : _graph(std::move(graph)),
   _max_speed(_graph->traits().linear().get_nominal_velocity()),
   _heuristic_cache(std::make_shared<EuclideanHeuristicFactory>(_graph))
 {
-  // Do nothing
+  if (num_landmarks > 0)
+  {
+    _landmark_cache = std::make_unique<LandmarkHeuristicCacheMap>(
+      std::make_shared<LandmarkHeuristicFactory>(_graph, num_landmarks));
+  }
 }
 
 //==============================================================================
@@ -258,7 +288,22 @@ ConstShortestPathHeuristicPtr ShortestPathHeuristicFactory::make(
     const std::size_t goal) const
 {
   return std::make_shared<ShortestPathHeuristic>(
-        goal, _max_speed, _graph, _heuristic_cache.get(goal));
+        goal, _max_speed, _graph, _heuristic_cache.get(goal),
+        _landmark_cache ? _landmark_cache->get(goal) : nullptr);
+}
+
+//==============================================================================
+const EuclideanHeuristicCacheMap&
+ShortestPathHeuristicFactory::euclidean_heuristics() const
+{
+  return _heuristic_cache;
+}
+
+//==============================================================================
+const LandmarkHeuristicCacheMap*
+ShortestPathHeuristicFactory::landmark_heuristics() const
+{
+  return _landmark_cache.get();
 }
 
 } // namespace planning
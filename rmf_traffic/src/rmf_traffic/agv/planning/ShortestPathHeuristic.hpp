@@ -22,6 +22,7 @@
 #include "Supergraph.hpp"
 
 #include "EuclideanHeuristic.hpp"
+#include "LandmarkHeuristic.hpp"
 
 namespace rmf_traffic {
 namespace agv {
@@ -31,6 +32,9 @@ namespace planning {
 /// The ShortestPathHeuristic finds the shortest (in terms of time required)
 /// path between two waypoints, not accounting for acceleration, deceleration,
 /// turning, or orientation constraints.
+///
+/// Its search is guided by the EuclideanHeuristic, and also by the
+/// LandmarkHeuristic if landmarks are being used.
 class ShortestPathHeuristic
     : public Generator<std::unordered_map<std::size_t, std::optional<double>>>
 {
@@ -40,11 +44,12 @@ public:
     std::size_t goal,
     double max_speed,
     std::shared_ptr<const Supergraph> graph,
-    CacheManagerPtr<EuclideanHeuristic> heuristic);
+    CacheManagerPtr<EuclideanHeuristic> heuristic,
+    CacheManagerPtr<LandmarkHeuristic> landmarks = nullptr);
 
   std::optional<double> generate(
     const std::size_t& key,
-    const Storage& old_items,
+    const SharedStorage& old_items,
     Storage& new_items) const final;
 
 private:
@@ -52,6 +57,7 @@ private:
   double _max_speed;
   std::shared_ptr<const Supergraph> _graph;
   CacheManagerPtr<EuclideanHeuristic> _heuristic;
+  CacheManagerPtr<LandmarkHeuristic> _landmarks;
 };
 
 //==============================================================================
@@ -65,14 +71,28 @@ public:
 
   using Generator = ShortestPathHeuristic;
 
-  ShortestPathHeuristicFactory(std::shared_ptr<const Supergraph> graph);
+  /// \param[in] graph
+  ///   The graph to find shortest paths on
+  ///
+  /// \param[in] num_landmarks
+  ///   The number of landmarks to use for the LandmarkHeuristic. If this is
+  ///   zero, only the EuclideanHeuristic will be used.
+  ShortestPathHeuristicFactory(
+    std::shared_ptr<const Supergraph> graph,
+    std::size_t num_landmarks = 0);
 
   ConstShortestPathHeuristicPtr make(const std::size_t goal) const final;
 
+  const EuclideanHeuristicCacheMap& euclidean_heuristics() const;
+
+  /// Get the landmark heuristics, or a nullptr if landmarks are not being used.
+  const LandmarkHeuristicCacheMap* landmark_heuristics() const;
+
 private:
   std::shared_ptr<const Supergraph> _graph;
   double _max_speed;
   EuclideanHeuristicCacheMap _heuristic_cache;
+  std::unique_ptr<LandmarkHeuristicCacheMap> _landmark_cache;
 };
 
 //==============================================================================
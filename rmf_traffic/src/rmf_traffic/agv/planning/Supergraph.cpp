@@ -38,16 +38,17 @@ Supergraph::FloorChangeMap find_floor_changes(
 
   for (std::size_t i = 0; i < original.waypoints.size(); ++i)
   {
-    const auto& initial_map_name = original.waypoints[i].get_map_name();
-    auto& floor_changes = all_floor_changes[initial_map_name];
+    const MapId initial_map =
+      Graph::Waypoint::Implementation::get(original.waypoints[i]).map_id;
+    auto& floor_changes = all_floor_changes[initial_map];
 
     for (const auto l : original.lanes_from[i])
     {
       const auto& lane = original.lanes[l];
-      const auto& exit = original.waypoints[lane.exit().waypoint_index()];
-      const auto& final_map_name = exit.get_map_name();
-      if (initial_map_name != final_map_name)
-        floor_changes[final_map_name].push_back(Supergraph::FloorChange{l});
+      const MapId final_map = Graph::Waypoint::Implementation::get(
+        original.waypoints[lane.exit().waypoint_index()]).map_id;
+      if (initial_map != final_map)
+        floor_changes[final_map].push_back(Supergraph::FloorChange{l});
     }
   }
 
@@ -74,8 +75,9 @@ struct TraversalNode
   Graph::Lane::EventPtr entry_event;
   Graph::Lane::EventPtr exit_event;
 
-  // TODO(MXG): Can std::string_view be used to make this more memory efficient?
-  std::vector<std::string> map_names;
+  // The maps are interned while traversing so that copying them from node to
+  // node is cheap. They only get turned back into names for the Traversal.
+  std::vector<MapId> maps;
 
   std::array<std::optional<double>, 2> orientations;
   bool standstill = false;
@@ -109,8 +111,9 @@ void node_to_traversals(
   traversal.finish_lane_index = node.finish_lane_index;
   traversal.finish_waypoint_index = node.finish_waypoint_index;
   traversal.best_time = 0.0;
-  traversal.maps = std::vector<std::string>(
-        node.map_names.begin(), node.map_names.end());
+  traversal.maps.reserve(node.maps.size());
+  for (const MapId map : node.maps)
+    traversal.maps.push_back(map.name());
 
 //  std::cout << "Traversal [" << traversal.initial_lane_index << "] -> ("
 //            << traversal.finish_lane_index << "): entry event {"
@@ -202,8 +205,8 @@ void node_to_traversals(
 
 //==============================================================================
 void add_if_missing(
-    std::vector<std::string>& all_maps,
-    const std::string& map)
+    std::vector<MapId>& all_maps,
+    const MapId map)
 {
   if (std::find(all_maps.begin(), all_maps.end(), map) == all_maps.end())
     all_maps.push_back(map);
@@ -252,7 +255,7 @@ void perform_traversal(
 
     node.initial_lane_index = parent->initial_lane_index;
     node.initial_p = parent->initial_p;
-    node.map_names = parent->map_names;
+    node.maps = parent->maps;
 
     if (parent->entry_event)
       node.entry_event = parent->entry_event->clone();
@@ -268,8 +271,8 @@ void perform_traversal(
 
   node.finish_p = p1;
 
-  add_if_missing(node.map_names, wp0.get_map_name());
-  add_if_missing(node.map_names, wp1.get_map_name());
+  add_if_missing(node.maps, Graph::Waypoint::Implementation::get(wp0).map_id);
+  add_if_missing(node.maps, Graph::Waypoint::Implementation::get(wp1).map_id);
 
   const double dist = (p1 - p0).norm();
   if (!kin.constraint.has_value() || dist < kin.interpolate.translation_thresh)
@@ -464,7 +467,7 @@ TraversalGenerator::TraversalGenerator(
 //==============================================================================
 ConstTraversalsPtr TraversalGenerator::generate(
     const std::size_t& key,
-    const Storage&, // old items are irrelevant
+    const SharedStorage&, // old items are irrelevant
     Storage& new_items) const
 {
   const auto supergraph = _graph.lock();
@@ -724,7 +727,7 @@ Supergraph::EntriesGenerator::EntriesGenerator(
 //==============================================================================
 auto Supergraph::EntriesGenerator::generate(
   const std::size_t& key,
-  const Storage&, // old items are irrelevant
+  const SharedStorage&, // old items are irrelevant
   Storage& new_items) const -> ConstEntriesPtr
 {
   const auto supergraph = _graph.lock();
@@ -807,7 +810,7 @@ Supergraph::LaneYawGenerator::LaneYawGenerator(
 //==============================================================================
 std::optional<double> Supergraph::LaneYawGenerator::generate(
   const Entry& key,
-  const Storage& /*old_items*/,
+  const SharedStorage& /*old_items*/,
   Storage& new_items) const
 {
   if (key.orientation == Orientation::Any)
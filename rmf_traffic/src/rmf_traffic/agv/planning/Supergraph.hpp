@@ -91,7 +91,7 @@ public:
 
   ConstTraversalsPtr generate(
       const std::size_t& key,
-      const Storage& old_items,
+      const SharedStorage& old_items,
       Storage& new_items) const final;
 
   struct Kinematics
@@ -139,8 +139,10 @@ public:
     std::size_t lane;
   };
   using FloorChanges = std::vector<FloorChange>;
-  using DestinationFloorMap = std::unordered_map<std::string, FloorChanges>;
-  using FloorChangeMap = std::unordered_map<std::string, DestinationFloorMap>;
+  using DestinationFloorMap =
+    std::unordered_map<MapId, FloorChanges, MapId::Hash>;
+  using FloorChangeMap =
+    std::unordered_map<MapId, DestinationFloorMap, MapId::Hash>;
   /// Get the lanes that allow the floor to change. This is useful for
   /// identifying the bottlenecks for moving between different maps.
   const FloorChangeMap& floor_change() const;
@@ -211,7 +213,7 @@ private:
 
     ConstEntriesPtr generate(
       const std::size_t& key,
-      const Storage& old_items,
+      const SharedStorage& old_items,
       Storage& new_items) const final;
 
   private:
@@ -232,7 +234,7 @@ private:
 
     std::optional<double> generate(
         const Entry& key,
-        const Storage& old_items,
+        const SharedStorage& old_items,
         Storage& new_items) const final;
 
   private:
@@ -75,13 +75,13 @@ public:
     }
 
     const auto current_cost = top->current_cost;
-    const auto old_it = _old_items.find(current_wp_index);
-    if (old_it != _old_items.end())
+    const auto* const old_value = _old_items.find(current_wp_index);
+    if (old_value)
     {
       // If the current waypoint already has an entry in the old items, then we
       // can immediately create a node that brings it the rest of the way to the
       // goal with the best possible cost.
-      const auto remaining_cost = old_it->second;
+      const auto remaining_cost = *old_value;
       if (!remaining_cost.has_value())
       {
         // If the old value is a nullopt, then this waypoint has no way to reach
@@ -135,7 +135,7 @@ public:
 
   TranslationExpander(
       std::size_t goal,
-      const TranslationHeuristic::Storage& old_items,
+      const TranslationHeuristic::SharedStorage& old_items,
       Cache<ShortestPathHeuristic> heuristic,
       std::shared_ptr<const Supergraph> graph)
     : _goal(goal),
@@ -148,7 +148,7 @@ public:
 
 private:
   std::size_t _goal;
-  const TranslationHeuristic::Storage& _old_items;
+  const TranslationHeuristic::SharedStorage& _old_items;
   Cache<ShortestPathHeuristic> _heuristic;
   std::shared_ptr<const Supergraph> _graph;
   std::unordered_set<std::size_t> _visited;
@@ -169,7 +169,7 @@ TranslationHeuristic::TranslationHeuristic(
 //==============================================================================
 std::optional<double> TranslationHeuristic::generate(
   const std::size_t& key,
-  const Storage& old_items,
+  const SharedStorage& old_items,
   Storage& new_items) const
 {
   auto heuristic = _heuristic->get();
@@ -223,9 +223,11 @@ std::optional<double> TranslationHeuristic::generate(
 
 //==============================================================================
 TranslationHeuristicFactory::TranslationHeuristicFactory(
-    std::shared_ptr<const Supergraph> graph)
+    std::shared_ptr<const Supergraph> graph,
+    const std::size_t num_landmarks)
   : _graph(std::move(graph)),
-    _heuristic_cache(std::make_shared<ShortestPathHeuristicFactory>(_graph))
+    _heuristic_cache(
+      std::make_shared<ShortestPathHeuristicFactory>(_graph, num_landmarks))
 {
   // Do nothing
 }
@@ -238,6 +240,13 @@ ConstTranslationHeuristicPtr TranslationHeuristicFactory::make(
         goal, _graph, _heuristic_cache.get(goal));
 }
 
+//==============================================================================
+const ShortestPathHeuristicCacheMap&
+TranslationHeuristicFactory::shortest_path_heuristics() const
+{
+  return _heuristic_cache;
+}
+
 } // namespace planning
 } // namespace agv
 } // namespace rmf_traffic
@@ -43,7 +43,7 @@ public:
 
   std::optional<double> generate(
     const std::size_t& key,
-    const Storage& old_items,
+    const SharedStorage& old_items,
     Storage& new_items) const final;
 
 private:
@@ -63,10 +63,14 @@ public:
 
   using Generator = TranslationHeuristic;
 
-  TranslationHeuristicFactory(std::shared_ptr<const Supergraph> graph);
+  TranslationHeuristicFactory(
+    std::shared_ptr<const Supergraph> graph,
+    std::size_t num_landmarks = 0);
 
   ConstTranslationHeuristicPtr make(const std::size_t goal) const final;
 
+  const ShortestPathHeuristicCacheMap& shortest_path_heuristics() const;
+
 private:
   std::shared_ptr<const Supergraph> _graph;
   ShortestPathHeuristicCacheMap _heuristic_cache;
@@ -18,6 +18,8 @@
 #ifndef SRC__RMF_TRAFFIC__INTERNAL_ROUTE_HPP
 #define SRC__RMF_TRAFFIC__INTERNAL_ROUTE_HPP
 
+#include "MapId.hpp"
+
 #include <rmf_traffic/Route.hpp>
 
 namespace rmf_traffic {
@@ -30,6 +32,10 @@ public:
   std::string map;
   Trajectory trajectory;
 
+  // The interned form of map, which is kept in sync with it so that routes can
+  // be compared and sorted by map without comparing strings
+  MapId map_id = MapId::intern(map);
+
   static Route make(Implementation data)
   {
     return Route(std::move(data.map), std::move(data.trajectory));
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__INTERNAL_RUN_IN_PARALLEL_HPP
+#define SRC__RMF_TRAFFIC__INTERNAL_RUN_IN_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace rmf_traffic {
+
+//==============================================================================
+/// Run task(i) for every i in [0, N) using up to num_threads threads, including
+/// the calling thread. The tasks are started in the order of their indices. If
+/// any tasks throw, the exception of the lowest index will be rethrown once
+/// every thread has finished.
+template<typename Task>
+void run_in_parallel(
+  const std::size_t N,
+  std::size_t num_threads,
+  const Task& task)
+{
+  if (num_threads == 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+  num_threads = std::min(num_threads, N);
+
+  std::atomic_size_t next(0);
+  std::vector<std::exception_ptr> errors(N);
+  const auto work = [&]()
+    {
+      for (std::size_t i = next++; i < N; i = next++)
+      {
+        try
+        {
+          task(i);
+        }
+        catch (...)
+        {
+          errors[i] = std::current_exception();
+        }
+      }
+    };
+
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  try
+  {
+    for (std::size_t t = 1; t < num_threads; ++t)
+      threads.emplace_back(work);
+  }
+  catch (const std::system_error&)
+  {
+    // If we cannot get as many threads as we wanted, the threads that we
+    // did get will pick up the slack.
+  }
+
+  work();
+  for (auto& thread : threads)
+    thread.join();
+
+  for (const auto& error : errors)
+  {
+    if (error)
+      std::rethrow_exception(error);
+  }
+}
+
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__INTERNAL_RUN_IN_PARALLEL_HPP
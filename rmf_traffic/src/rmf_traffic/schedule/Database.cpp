@@ -30,6 +30,7 @@
 
 #include <algorithm>
 #include <list>
+#include <mutex>
 
 namespace rmf_traffic {
 namespace schedule {
@@ -103,6 +104,27 @@ public:
 
   Timeline<RouteEntry> timeline;
 
+  struct JournalRecord
+  {
+    Version version;
+    std::weak_ptr<const RouteEntry> entry;
+  };
+
+  /// A journal of the route entries that have been added to the database, in
+  /// the order of the schedule versions that created them. This lets us find
+  /// the changes that happened after a certain version without searching the
+  /// whole timeline. Registrations and culls are already tracked by version in
+  /// add_participant_version, remove_participant_version, and last_cull.
+  ///
+  /// Only the newest entry of each route has a record. When a route gets a new
+  /// entry, the record of its predecessor is retired, because any version
+  /// that is older than the predecessor is also older than the new entry. The
+  /// retired records are removed once they make up half of the journal, and
+  /// records whose routes are no longer in the database are removed whenever
+  /// the database gets culled.
+  std::vector<JournalRecord> change_journal;
+  std::size_t retired_journal_records = 0;
+
   using ParticipantStorage = std::unordered_map<RouteId, RouteStorage>;
 
   struct ParticipantState
@@ -168,6 +190,15 @@ public:
 
   rmf_utils::optional<CullInfo> last_cull;
 
+  /// The most recent snapshot that was taken of the database. Every change to
+  /// the database increments schedule_version, so this can be reused for as
+  /// long as its version matches.
+  mutable std::shared_ptr<const Snapshot> latest_snapshot;
+
+  /// This protects latest_snapshot so that snapshot() can be called from
+  /// multiple threads at once.
+  mutable std::mutex snapshot_mutex;
+
   /// The current time is used to know when participants can be culled after
   /// getting unregistered
   rmf_traffic::Time current_time = rmf_traffic::Time(rmf_traffic::Duration(0));
@@ -250,9 +281,44 @@ public:
         });
 
       entry_storage.timeline_handle = timeline.insert(entry_storage.entry);
+      journal(entry_storage.entry);
     }
   }
 
+  /// Add a record for a new route entry to the change journal, and retire the
+  /// record of the entry that it replaces.
+  void journal(const RouteEntryPtr& entry)
+  {
+    change_journal.push_back({schedule_version, entry});
+
+    if (!entry->transition)
+      return;
+
+    const RouteEntry* const predecessor =
+      entry->transition->predecessor.entry.get();
+
+    const auto range = std::equal_range(
+      change_journal.begin(), change_journal.end(),
+      JournalRecord{predecessor->schedule_version, {}},
+      [](const JournalRecord& a, const JournalRecord& b)
+      {
+        return rmf_utils::modular(a.version).less_than(b.version);
+      });
+
+    for (auto it = range.first; it != range.second; ++it)
+    {
+      if (it->entry.lock().get() == predecessor)
+      {
+        it->entry.reset();
+        ++retired_journal_records;
+        break;
+      }
+    }
+
+    if (2*retired_journal_records > change_journal.size())
+      compact_change_journal();
+  }
+
   void apply_delay(
     ParticipantId participant,
     ParticipantState& state,
@@ -299,6 +365,7 @@ public:
         entry_storage.entry;
 
       entry_storage.timeline_handle = timeline.insert(entry_storage.entry);
+      journal(entry_storage.entry);
     }
   }
 
@@ -334,6 +401,7 @@ public:
         entry_storage.entry;
 
       entry_storage.timeline_handle = timeline.insert(entry_storage.entry);
+      journal(entry_storage.entry);
     }
 
     // TODO(MXG): Consider erasing the routes from the active_routes field of
@@ -366,6 +434,67 @@ public:
     // *INDENT-ON*
   }
 
+  /// Check whether an entry belongs to a route that is still being stored by
+  /// the database. Routes that have been culled or whose participant has been
+  /// unregistered are not stored anymore, even if the entry itself is still
+  /// being kept alive by a snapshot.
+  bool is_stored(const RouteEntry& entry) const
+  {
+    const auto p_it = states.find(entry.participant);
+    if (p_it == states.end())
+      return false;
+
+    const auto& storage = p_it->second.storage;
+    const auto r_it = storage.find(entry.route_id);
+    if (r_it == storage.end())
+      return false;
+
+    // Follow the entry to the most recent version of its route, in case its
+    // route ID has been reused since the entry was culled.
+    const RouteEntry* newest = &entry;
+    while (const auto successor = newest->successor.lock())
+      newest = successor.get();
+
+    return newest == r_it->second.entry.get();
+  }
+
+  /// Get the entries of every route that has changed after the given version.
+  std::vector<const RouteEntry*> changed_after(const Version after) const
+  {
+    const auto begin = std::upper_bound(
+      change_journal.begin(), change_journal.end(), after,
+      [](const Version v, const JournalRecord& record)
+      {
+        return rmf_utils::modular(v).less_than(record.version);
+      });
+
+    std::vector<const RouteEntry*> entries;
+    entries.reserve(std::distance(begin, change_journal.end()));
+    for (auto it = begin; it != change_journal.end(); ++it)
+    {
+      const auto entry = it->entry.lock();
+      if (entry && is_stored(*entry))
+        entries.push_back(entry.get());
+    }
+
+    return entries;
+  }
+
+  /// Remove the records of any routes that are no longer in the database.
+  void compact_change_journal()
+  {
+    const auto erase_begin = std::remove_if(
+      change_journal.begin(), change_journal.end(),
+      [this](const JournalRecord& record)
+      {
+        const auto entry = record.entry.lock();
+        return !entry || !is_stored(*entry);
+      });
+
+    change_journal.erase(erase_begin, change_journal.end());
+    retired_journal_records = 0;
+  }
+
 private:
   ParticipantId _next_participant_id = 0;
 };
@@ -381,6 +510,13 @@ std::size_t Database::Debug::current_entry_history_count(
   return count;
 }
 
+//==============================================================================
+std::size_t Database::Debug::current_change_journal_size(
+  const Database& database)
+{
+  return database._pimpl->change_journal.size();
+}
+
 //==============================================================================
 std::size_t Database::Debug::current_removed_participant_count(
   const Database& database)
@@ -1056,11 +1192,18 @@ std::shared_ptr<const Snapshot> Database::snapshot() const
   using SnapshotType =
     SnapshotImplementation<Implementation::RouteEntry, ViewRelevanceInspector>;
 
-  return std::make_shared<SnapshotType>(
+  std::lock_guard<std::mutex> lock(_pimpl->snapshot_mutex);
+  const auto& latest = _pimpl->latest_snapshot;
+  if (latest && latest->latest_version() == _pimpl->schedule_version)
+    return latest;
+
+  _pimpl->latest_snapshot = std::make_shared<SnapshotType>(
     _pimpl->timeline.snapshot(),
     _pimpl->participant_ids,
     _pimpl->descriptions,
     _pimpl->schedule_version);
+
+  return _pimpl->latest_snapshot;
 }
 
 //==============================================================================
@@ -1084,9 +1227,12 @@ auto Database::changes(
   std::unordered_map<ParticipantId, ParticipantChanges> changes;
   if (after)
   {
+    // Only the routes that changed after the mirror's last update can have
+    // anything new to tell the mirror, so we only inspect those.
     PatchRelevanceInspector inspector(*after);
-    _pimpl->timeline.inspect(
-      parameters.spacetime(), parameters.participants(), inspector);
+    _pimpl->timeline.inspect_selection(
+      parameters.spacetime(), parameters.participants(),
+      _pimpl->changed_after(*after), inspector);
 
     changes = inspector.changes;
   }
@@ -1171,8 +1317,9 @@ auto Database::changes(
 Viewer::View Database::query(const Query& parameters, const Version after) const
 {
   ViewerAfterRelevanceInspector inspector{after};
-  _pimpl->timeline.inspect(
-    parameters.spacetime(), parameters.participants(), inspector);
+  _pimpl->timeline.inspect_selection(
+    parameters.spacetime(), parameters.participants(),
+    _pimpl->changed_after(after), inspector);
 
   return Viewer::View::Implementation::make_view(std::move(inspector.routes));
 }
@@ -1202,6 +1349,7 @@ Version Database::cull(Time time)
   }
 
   _pimpl->timeline.cull(time);
+  _pimpl->compact_change_journal();
 
   // Erase all trace of participants that were removed before the culling time.
   const auto p_cull_begin = _pimpl->remove_participant_time.begin();
@@ -22,6 +22,8 @@
 #include "ViewerInternal.hpp"
 #include "internal_Snapshot.hpp"
 
+#include <mutex>
+
 namespace rmf_traffic {
 namespace schedule {
 
@@ -68,6 +70,14 @@ public:
 
   Version latest_version = 0;
 
+  /// The most recent snapshot that was taken of the mirror. This gets cleared
+  /// whenever the mirror is updated.
+  mutable std::shared_ptr<const Snapshot> latest_snapshot;
+
+  /// This protects latest_snapshot so that snapshot() can be called from
+  /// multiple threads at once.
+  mutable std::mutex snapshot_mutex;
+
   static void erase_routes(
     const ParticipantId participant,
     ParticipantState& state,
@@ -275,11 +285,17 @@ std::shared_ptr<const Snapshot> Mirror::snapshot() const
       MirrorViewRelevanceInspector
     >;
 
-  return std::make_shared<SnapshotType>(
+  std::lock_guard<std::mutex> lock(_pimpl->snapshot_mutex);
+  if (_pimpl->latest_snapshot)
+    return _pimpl->latest_snapshot;
+
+  _pimpl->latest_snapshot = std::make_shared<SnapshotType>(
     _pimpl->timeline.snapshot(),
     _pimpl->participant_ids,
     _pimpl->descriptions,
     _pimpl->latest_version);
+
+  return _pimpl->latest_snapshot;
 }
 
 //==============================================================================
@@ -292,6 +308,8 @@ Mirror::Mirror()
 //==============================================================================
 Version Mirror::update(const Patch& patch)
 {
+  _pimpl->latest_snapshot = nullptr;
+
   for (const auto& unregistered : patch.unregistered())
   {
     const ParticipantId id = unregistered.id();
@@ -17,9 +17,148 @@
 
 #include <rmf_traffic/schedule/Negotiator.hpp>
 
+#include "../internal_run_in_parallel.hpp"
+
+#include <mutex>
+#include <unordered_map>
+
 namespace rmf_traffic {
 namespace schedule {
 
+namespace {
+//==============================================================================
+/// Holds onto the responses of a Negotiator until release() is called, so that
+/// negotiators running on other threads never touch the Negotiation directly.
+class DeferredResponder : public Negotiator::Responder
+{
+public:
+
+  DeferredResponder(Negotiator::ResponderPtr target)
+  : _target(std::move(target))
+  {
+    // Do nothing
+  }
+
+  void submit(
+    std::vector<Route> itinerary,
+    ApprovalCallback approval_callback) const final
+  {
+    defer(
+      [itinerary = std::move(itinerary),
+      approval_callback = std::move(approval_callback)](
+        const Responder& target)
+      {
+        target.submit(itinerary, approval_callback);
+      });
+  }
+
+  void reject(const Alternatives& alternatives) const final
+  {
+    defer([alternatives](const Responder& target)
+      {
+        target.reject(alternatives);
+      });
+  }
+
+  void forfeit(const std::vector<ParticipantId>& blockers) const final
+  {
+    defer([blockers](const Responder& target)
+      {
+        target.forfeit(blockers);
+      });
+  }
+
+  /// Pass along every response that has been given so far. Any responses that
+  /// are given after this will be passed along right away.
+  void release() const
+  {
+    std::vector<Response> responses;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _released = true;
+      responses.swap(_responses);
+    }
+
+    for (const auto& response : responses)
+      response(*_target);
+  }
+
+private:
+
+  using Response = std::function<void(const Responder&)>;
+
+  void defer(Response response) const
+  {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (!_released)
+      {
+        _responses.emplace_back(std::move(response));
+        return;
+      }
+    }
+
+    response(*_target);
+  }
+
+  Negotiator::ResponderPtr _target;
+  mutable std::mutex _mutex;
+  mutable std::vector<Response> _responses;
+  mutable bool _released = false;
+};
+} // anonymous namespace
+
+//==============================================================================
+void Negotiator::respond_in_parallel(
+  const std::vector<Request>& requests,
+  const std::size_t num_threads)
+{
+  const std::size_t N = requests.size();
+
+  // Requests that share a negotiator are handled by the same task so that one
+  // negotiator never gets used by two threads at once.
+  std::vector<std::vector<std::size_t>> groups;
+  std::unordered_map<Negotiator*, std::size_t> group_of;
+  for (std::size_t i = 0; i < N; ++i)
+  {
+    const auto insertion =
+      group_of.insert({requests[i].negotiator, groups.size()});
+    if (insertion.second)
+      groups.emplace_back();
+
+    groups[insertion.first->second].push_back(i);
+  }
+
+  std::vector<std::shared_ptr<DeferredResponder>> responders;
+  responders.reserve(N);
+  for (const auto& request : requests)
+  {
+    responders.push_back(
+      std::make_shared<DeferredResponder>(request.responder));
+  }
+
+  try
+  {
+    run_in_parallel(groups.size(), num_threads, [&](const std::size_t g)
+      {
+        for (const auto i : groups[g])
+          requests[i].negotiator->respond(
+            requests[i].table_viewer, responders[i]);
+      });
+  }
+  catch (...)
+  {
+    // Whatever responses we did get should still reach the negotiation
+    for (const auto& responder : responders)
+      responder->release();
+
+    throw;
+  }
+
+  for (const auto& responder : responders)
+    responder->release();
+}
+
 //==============================================================================
 class SimpleResponder::Implementation
 {
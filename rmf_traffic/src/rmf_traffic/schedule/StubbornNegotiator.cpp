@@ -16,6 +16,9 @@
 */
 
 #include <rmf_traffic/schedule/StubbornNegotiator.hpp>
+
+#include "../internal_Route.hpp"
+
 #include <rmf_traffic/DetectConflict.hpp>
 
 namespace rmf_traffic {
@@ -73,7 +76,8 @@ void StubbornNegotiator::respond(
     {
       for (const auto& item : itinerary)
       {
-        if (item.route->map() != other_route->map())
+        if (RouteData::get(*item.route).map_id
+          != RouteData::get(*other_route).map_id)
           continue;
 
         if (rmf_traffic::DetectConflict::between(
@@ -19,11 +19,17 @@
 #define SRC__RMF_TRAFFIC__SCHEDULE__TIMELINE_HPP
 
 #include "../DetectConflictInternal.hpp"
+#include "../Spline.hpp"
+#include "../internal_Route.hpp"
 
 #include <rmf_traffic/schedule/Query.hpp>
 
+#include <cmath>
+#include <limits>
 #include <map>
+#include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace rmf_traffic {
 namespace schedule {
@@ -40,8 +46,135 @@ const Duration BucketDuration = std::chrono::minutes(1);
 // potentially not be very useful.
 const Duration PartialBucketDuration = std::chrono::seconds(50);
 
+// The timeline of each map is split into chunks that each span this much time,
+// so that a snapshot only needs to refreeze the chunks that have changed.
+const Duration TimeChunkDuration = std::chrono::minutes(16);
+
+// Each cell of the spatial index spans a square with sides of this length, in
+// meters.
+const double SpatialCellSize = 10.0;
+
+// Cell coordinates get clamped to this magnitude so that enormous (or infinite)
+// bounding boxes do not overflow the integer cell indices.
+const int64_t MaxSpatialCellIndex = int64_t(1) << 40;
+
+// A trajectory segment whose inflated bounding box covers more than this many
+// cells of the spatial index is kept in the overflow timeline of its map
+// instead.
+const std::size_t MaxCellsPerSegment = 256;
+
 } // anonymous namespace
 
+//==============================================================================
+/// A cell in the 2D spatial index of a Timeline
+struct SpatialCell
+{
+  int64_t x;
+  int64_t y;
+
+  bool operator==(const SpatialCell& other) const
+  {
+    return x == other.x && y == other.y;
+  }
+
+  /// The cell that holds the overflow timeline of a map. Its indices are
+  /// outside of the range that SpatialCellRange clamps to, so it will never be
+  /// mistaken for a cell that covers any actual space.
+  static SpatialCell overflow()
+  {
+    return SpatialCell{
+      std::numeric_limits<int64_t>::min(),
+      std::numeric_limits<int64_t>::min()
+    };
+  }
+
+  struct Hash
+  {
+    std::size_t operator()(const SpatialCell& cell) const
+    {
+      const std::size_t hx = std::hash<int64_t>()(cell.x);
+      const std::size_t hy = std::hash<int64_t>()(cell.y);
+      return hx ^ (hy + 0x9e3779b9 + (hx << 6) + (hx >> 2));
+    }
+  };
+};
+
+//==============================================================================
+/// A rectangular range of cells in the 2D spatial index of a Timeline
+struct SpatialCellRange
+{
+  SpatialCell min;
+  SpatialCell max;
+
+  static int64_t to_index(const double value)
+  {
+    const double index = std::floor(value / SpatialCellSize);
+    if (std::isnan(index))
+      return 0;
+
+    if (index < -static_cast<double>(MaxSpatialCellIndex))
+      return -MaxSpatialCellIndex;
+
+    if (static_cast<double>(MaxSpatialCellIndex) < index)
+      return MaxSpatialCellIndex;
+
+    return static_cast<int64_t>(index);
+  }
+
+  static SpatialCellRange from(const internal::BoundingBox& box)
+  {
+    return SpatialCellRange{
+      SpatialCell{to_index(box.min.x()), to_index(box.min.y())},
+      SpatialCell{to_index(box.max.x()), to_index(box.max.y())}
+    };
+  }
+
+  bool contains(const SpatialCell& cell) const
+  {
+    return min.x <= cell.x && cell.x <= max.x
+      && min.y <= cell.y && cell.y <= max.y;
+  }
+
+  /// The number of cells inside of this range, saturated at the maximum value
+  /// of std::size_t.
+  std::size_t size() const
+  {
+    if (max.x < min.x || max.y < min.y)
+      return 0;
+
+    const double count =
+      (static_cast<double>(max.x - min.x) + 1.0)
+      * (static_cast<double>(max.y - min.y) + 1.0);
+
+    if (static_cast<double>(std::numeric_limits<std::size_t>::max()) <= count)
+      return std::numeric_limits<std::size_t>::max();
+
+    return static_cast<std::size_t>(count);
+  }
+};
+
+//==============================================================================
+/// Indexing for the chunks of time that the timeline of each map is split into
+struct TimeChunk
+{
+  /// Get the index of the chunk that contains the given time
+  static int64_t index(const Time time)
+  {
+    const int64_t count = time.time_since_epoch().count();
+    const int64_t width = TimeChunkDuration.count();
+    if (count < 0)
+      return -((-(count + 1)) / width) - 1;
+
+    return count / width;
+  }
+
+  /// Get the time at which the chunk with the given index begins
+  static Time start(const int64_t index)
+  {
+    return Time(TimeChunkDuration * index);
+  }
+};
+
 //==============================================================================
 struct ParticipantFilter
 {
@@ -101,6 +234,24 @@ struct ParticipantFilter
   };
 };
 
+//==============================================================================
+/// A bucket of timeline entries. The live buckets of a Timeline are modified as
+/// entries come and go, while the buckets that belong to a snapshot are never
+/// modified after they are created.
+///
+/// This is defined outside of TimelineView so that a Timeline<Entry> and its
+/// TimelineView<const Entry> snapshots share the same bucket type.
+template<typename ConstEntry>
+struct TimelineBucket
+{
+  std::vector<std::shared_ptr<ConstEntry>> entries;
+
+  // An immutable copy of this bucket that can be shared by any number of
+  // snapshots. This must be cleared whenever the entries of the bucket get
+  // modified so that the next snapshot will make a fresh copy.
+  std::shared_ptr<TimelineBucket> frozen;
+};
+
 //==============================================================================
 template<typename Entry>
 class TimelineInspector;
@@ -117,7 +268,7 @@ public:
 public:
 
   using ConstEntryPtr = std::shared_ptr<const Entry>;
-  using Bucket = std::vector<ConstEntryPtr>;
+  using Bucket = TimelineBucket<const Entry>;
 
   // We use a shared_ptr for BucketPtr so that the Handle class can hold a
   // weak_ptr to the bucket that contains its entry. If the bucket is ever
@@ -129,14 +280,41 @@ public:
 
   // TODO(MXG): Come up with a better name for this data structure than Entries
   using Entries = std::map<Time, BucketPtr>;
-  using MapNameToEntries = std::unordered_map<std::string, Entries>;
 
-  /// Constructor
-  TimelineView()
-  : _all_bucket(std::make_shared<Bucket>())
-  {
-    // Do nothing
-  }
+  // Each Entries instance is held by a shared_ptr so that snapshots can share
+  // the instances that have not changed since the previous snapshot.
+  using EntriesPtr = std::shared_ptr<Entries>;
+
+  // The timeline of each map is split into chunks of time (see TimeChunk), and
+  // each chunk keeps its own time buckets. A change to one chunk does not
+  // require the buckets of any other chunk to be copied into the next
+  // snapshot.
+  using TimeChunks = std::map<int64_t, EntriesPtr>;
+  using TimeChunksPtr = std::shared_ptr<TimeChunks>;
+
+  // The maps are keyed by their interned IDs so that inserting an entry or
+  // searching the timeline never needs to hash a map name. The names of a query
+  // get interned once at the start of each inspection.
+  using MapToEntries = std::unordered_map<MapId, TimeChunksPtr, MapId::Hash>;
+
+  // The spatial index of each map is a sparse grid of cells, and each cell
+  // keeps its own time buckets so that region queries can narrow down the
+  // candidate entries by both space and time before doing any narrow-phase
+  // conflict detection. Segments that would cover too many cells go into the
+  // overflow timeline of the map (see SpatialCell::overflow()) instead, which
+  // every region query on that map needs to look through.
+  using SpatialEntries =
+    std::unordered_map<SpatialCell, EntriesPtr, SpatialCell::Hash>;
+  using SpatialEntriesPtr = std::shared_ptr<SpatialEntries>;
+  using MapToSpatialEntries =
+    std::unordered_map<MapId, SpatialEntriesPtr, MapId::Hash>;
+
+  // Every entry goes into the bucket of its participant, regardless of its
+  // map or time range. These buckets are used for queries that want to see all
+  // of spacetime. Splitting them up by participant means that a change to one
+  // participant does not require the buckets of every other participant to be
+  // copied into the next snapshot.
+  using ParticipantToBucket = std::unordered_map<ParticipantId, BucketPtr>;
 
   /// Inspect the timeline for entries that match the query
   template<typename Inspector>
@@ -144,29 +322,70 @@ public:
     const Query::Spacetime& spacetime,
     const Query::Participants& participants,
     Inspector& inspector) const
+  {
+    visit_participant_filter(
+      participants,
+      [&](const auto& participant_filter)
+      {
+        inspect_spacetime(spacetime, participant_filter, inspector);
+      });
+  }
+
+  /// Inspect only the given selection of entries, applying the same filtering
+  /// that inspect() would. This allows a caller that already knows which
+  /// entries might be relevant (e.g. the entries that have changed since some
+  /// version) to skip searching through the rest of the timeline.
+  ///
+  /// The selection may contain multiple entries for the same route, but each
+  /// route will only be passed to the inspector once.
+  template<typename Inspector, typename Selection>
+  static void inspect_selection(
+    const Query::Spacetime& spacetime,
+    const Query::Participants& participants,
+    const Selection& selection,
+    Inspector& inspector)
+  {
+    const auto relevant = make_relevance(spacetime);
+    visit_participant_filter(
+      participants,
+      [&](const auto& participant_filter)
+      {
+        Checked checked;
+        for (const Entry* entry : selection)
+        {
+          if (participant_filter.ignore(entry->participant))
+            continue;
+
+          if (!checked[entry->participant].insert(entry->route_id).second)
+            continue;
+
+          inspector.inspect(entry, relevant);
+        }
+      });
+  }
+
+  template<typename> friend class Timeline;
+
+protected:
+
+  template<typename Visitor>
+  static void visit_participant_filter(
+    const Query::Participants& participants,
+    const Visitor& visitor)
   {
     const Query::Participants::Mode mode = participants.get_mode();
 
     if (Query::Participants::Mode::All == mode)
     {
-      inspect_spacetime(
-        spacetime,
-        ParticipantFilter::AllowAll(),
-        inspector);
+      visitor(ParticipantFilter::AllowAll());
     }
     else if (Query::Participants::Mode::Include == mode)
     {
-      inspect_spacetime(
-        spacetime,
-        ParticipantFilter::Include(participants.include()->get_ids()),
-        inspector);
+      visitor(ParticipantFilter::Include(participants.include()->get_ids()));
     }
     else if (Query::Participants::Mode::Exclude == mode)
     {
-      inspect_spacetime(
-        spacetime,
-        ParticipantFilter::Exclude(participants.exclude()->get_ids()),
-        inspector);
+      visitor(ParticipantFilter::Exclude(participants.exclude()->get_ids()));
     }
     else
     {
@@ -178,9 +397,95 @@ public:
     }
   }
 
-  template<typename> friend class Timeline;
+  /// Get the IDs of the maps that a timespan query is interested in. Maps that
+  /// have never been interned are left out, because no entry can be on them.
+  static std::vector<MapId> find_map_ids(
+    const Query::Spacetime::Timespan& timespan)
+  {
+    std::vector<MapId> ids;
+    for (const std::string& map : timespan.maps())
+    {
+      if (const auto id = MapId::find(map))
+        ids.push_back(*id);
+    }
 
-protected:
+    return ids;
+  }
+
+  /// Make a relevance function that checks an entry against the whole
+  /// spacetime of a query. Unlike the relevance functions that are used while
+  /// searching the timeline, this does not assume that the entry was found in
+  /// a bucket that matches the map or time range of the query.
+  static std::function<bool(const Entry&)> make_relevance(
+    const Query::Spacetime& spacetime)
+  {
+    const Query::Spacetime::Mode mode = spacetime.get_mode();
+
+    if (Query::Spacetime::Mode::Regions == mode)
+    {
+      const auto& regions = *spacetime.regions();
+      std::vector<rmf_utils::optional<MapId>> region_maps;
+      for (const Region& region : regions)
+        region_maps.push_back(MapId::find(region.get_map()));
+
+      return [&regions, region_maps = std::move(region_maps)](
+        const Entry& entry) -> bool
+        {
+          const MapId entry_map = RouteData::get(*entry.route).map_id;
+          rmf_traffic::internal::Spacetime spacetime_data;
+          std::size_t r = 0;
+          for (const Region& region : regions)
+          {
+            const auto& region_map = region_maps[r++];
+            if (!region_map || *region_map != entry_map)
+              continue;
+
+            spacetime_data.lower_time_bound = region.get_lower_time_bound();
+            spacetime_data.upper_time_bound = region.get_upper_time_bound();
+            for (const auto& space : region)
+            {
+              spacetime_data.pose = space.get_pose();
+              spacetime_data.shape = space.get_shape();
+              if (rmf_traffic::internal::detect_conflicts(
+                  entry.description->profile(),
+                  entry.route->trajectory(),
+                  spacetime_data))
+              {
+                return true;
+              }
+            }
+          }
+
+          return false;
+        };
+    }
+    else if (Query::Spacetime::Mode::Timespan == mode)
+    {
+      const auto& timespan = *spacetime.timespan();
+      return [&timespan, maps = find_map_ids(timespan)](
+        const Entry& entry) -> bool
+        {
+          if (!timespan.all_maps()
+            && std::find(maps.begin(), maps.end(),
+            RouteData::get(*entry.route).map_id) == maps.end())
+            return false;
+
+          const Trajectory& trajectory = entry.route->trajectory();
+          assert(trajectory.start_time());
+          const Time* const lower_time_bound = timespan.get_lower_time_bound();
+          if (lower_time_bound && *trajectory.finish_time() < *lower_time_bound)
+            return false;
+
+          const Time* const upper_time_bound = timespan.get_upper_time_bound();
+          if (upper_time_bound && *upper_time_bound < *trajectory.start_time())
+            return false;
+
+          return true;
+        };
+    }
+
+    return [](const Entry&) -> bool { return true; };
+  }
 
   template<typename Inspector, typename ParticipantFilter>
   void inspect_spacetime(
@@ -214,15 +519,18 @@ protected:
     Checked checked;
 
     const auto relevant = [](const Entry&) -> bool { return true; };
-    for (const auto& entry : *_all_bucket)
+    for (const auto& bucket : _all_buckets)
     {
-      if (participant_filter.ignore(entry->participant))
+      if (participant_filter.ignore(bucket.first))
         continue;
 
-      if (!checked[entry->participant].insert(entry->route_id).second)
-        continue;
+      for (const auto& entry : bucket.second->entries)
+      {
+        if (!checked[entry->participant].insert(entry->route_id).second)
+          continue;
 
-      inspector.inspect(entry.get(), relevant);
+        inspector.inspect(entry.get(), relevant);
+      }
     }
   }
 
@@ -246,43 +554,80 @@ protected:
 
     for (const Region& region : regions)
     {
-      const std::string& map = region.get_map();
-      const auto map_it = _timelines.find(map);
-      if (map_it == _timelines.end())
+      const auto map = MapId::find(region.get_map());
+      if (!map)
         continue;
 
-      const Entries& timeline = map_it->second;
+      const auto map_it = _spatial_timelines.find(*map);
+      if (map_it == _spatial_timelines.end())
+        continue;
+
+      const SpatialEntries& grid = *map_it->second;
+      const auto overflow_it = grid.find(SpatialCell::overflow());
       const Time* const lower_time_bound = region.get_lower_time_bound();
       const Time* const upper_time_bound = region.get_upper_time_bound();
 
       spacetime_data.lower_time_bound = lower_time_bound;
       spacetime_data.upper_time_bound = upper_time_bound;
 
-      const auto timeline_begin =
-        get_timeline_begin(timeline, lower_time_bound);
-
-      const auto timeline_end =
-        get_timeline_end(timeline, upper_time_bound);
-
-      if (timeline_begin == timeline_end)
-      {
-        // No buckets in the timeline overlap with this spacetime region, so we
-        // can move on to the next region without looping through this one.
-        continue;
-      }
+      const auto inspect_cell = [&](const Entries& timeline)
+        {
+          const auto timeline_begin =
+            get_timeline_begin(timeline, lower_time_bound);
+
+          const auto timeline_end =
+            get_timeline_end(timeline, upper_time_bound);
+
+          if (timeline_begin == timeline_end)
+          {
+            // No buckets in this cell overlap with the time range of the
+            // region, so there is nothing to inspect.
+            return;
+          }
+
+          inspect_entries(
+            relevant,
+            participant_filter,
+            inspector,
+            timeline_begin,
+            timeline_end,
+            checked);
+        };
 
       for (auto space_it = region.begin(); space_it != region.end(); ++space_it)
       {
         spacetime_data.pose = space_it->get_pose();
         spacetime_data.shape = space_it->get_shape();
 
-        inspect_entries(
-          relevant,
-          participant_filter,
-          inspector,
-          timeline_begin,
-          timeline_end,
-          checked);
+        const SpatialCellRange range = SpatialCellRange::from(
+          internal::get_bounding_box(
+            *spacetime_data.shape, spacetime_data.pose));
+
+        if (overflow_it != grid.end())
+          inspect_cell(*overflow_it->second);
+
+        if (range.size() < grid.size())
+        {
+          // The space covers fewer cells than the grid has, so it is cheaper to
+          // look up each of the cells that the space covers.
+          for (int64_t x = range.min.x; x <= range.max.x; ++x)
+          {
+            for (int64_t y = range.min.y; y <= range.max.y; ++y)
+            {
+              const auto cell_it = grid.find(SpatialCell{x, y});
+              if (cell_it != grid.end())
+                inspect_cell(*cell_it->second);
+            }
+          }
+        }
+        else
+        {
+          for (const auto& cell : grid)
+          {
+            if (range.contains(cell.first))
+              inspect_cell(*cell.second);
+          }
+        }
       }
     }
   }
@@ -316,37 +661,71 @@ protected:
     {
       for (const auto& timeline_it : _timelines)
       {
-        const Entries& timeline = timeline_it.second;
-        inspect_entries(
+        inspect_time_chunks(
           relevant,
           participant_filter,
           inspector,
-          get_timeline_begin(timeline, lower_time_bound),
-          get_timeline_end(timeline, upper_time_bound),
+          *timeline_it.second,
+          lower_time_bound,
+          upper_time_bound,
           checked);
       }
     }
     else
     {
-      const auto& maps = timespan.maps();
-      for (const std::string& map : maps)
+      for (const MapId map : find_map_ids(timespan))
       {
         const auto map_it = _timelines.find(map);
         if (map_it == _timelines.end())
           continue;
 
-        const Entries& timeline = map_it->second;
-        inspect_entries(
+        inspect_time_chunks(
           relevant,
           participant_filter,
           inspector,
-          get_timeline_begin(timeline, lower_time_bound),
-          get_timeline_end(timeline, upper_time_bound),
+          *map_it->second,
+          lower_time_bound,
+          upper_time_bound,
           checked);
       }
     }
   }
 
+  template<typename Inspector, typename ParticipantFilter>
+  void inspect_time_chunks(
+    const std::function<bool(const Entry&)>& relevant,
+    const ParticipantFilter& participant_filter,
+    Inspector& inspector,
+    const TimeChunks& chunks,
+    const Time* const lower_time_bound,
+    const Time* const upper_time_bound,
+    Checked& checked) const
+  {
+    if (lower_time_bound && upper_time_bound
+      && *upper_time_bound < *lower_time_bound)
+      return;
+
+    // An entry is put into every chunk that its trajectory passes through, so
+    // we only need to look at the chunks that overlap the time range.
+    const auto chunk_begin = (lower_time_bound == nullptr) ?
+      chunks.begin() : chunks.lower_bound(TimeChunk::index(*lower_time_bound));
+
+    const auto chunk_end = (upper_time_bound == nullptr) ?
+      chunks.end() : chunks.upper_bound(TimeChunk::index(*upper_time_bound));
+
+    for (auto chunk_it = chunk_begin; chunk_it != chunk_end; ++chunk_it)
+    {
+      const Entries& timeline = *chunk_it->second;
+      inspect_entries(
+        relevant,
+        participant_filter,
+        inspector,
+        get_timeline_begin(timeline, lower_time_bound),
+        get_timeline_end(timeline, upper_time_bound),
+        checked);
+    }
+  }
+
   template<typename Inspector, typename ParticipantFilter>
   void inspect_entries(
     const std::function<bool(const Entry&)>& relevant,
@@ -361,8 +740,8 @@ protected:
     {
       const Bucket& bucket = *timeline_it->second;
 
-      auto entry_it = bucket.begin();
-      for (; entry_it != bucket.end(); ++entry_it)
+      auto entry_it = bucket.entries.begin();
+      for (; entry_it != bucket.entries.end(); ++entry_it)
       {
         const Entry* entry = entry_it->get();
 
@@ -399,8 +778,9 @@ protected:
     return ++end;
   }
 
-  MapNameToEntries _timelines;
-  BucketPtr _all_bucket;
+  MapToEntries _timelines;
+  MapToSpatialEntries _spatial_timelines;
+  ParticipantToBucket _all_buckets;
 };
 
 //==============================================================================
@@ -413,6 +793,71 @@ public:
   using Bucket = typename TimelineView<Entry>::Bucket;
   using BucketPtr = typename TimelineView<Entry>::BucketPtr;
   using Entries = typename TimelineView<Entry>::Entries;
+  using EntriesPtr = typename TimelineView<Entry>::EntriesPtr;
+  using TimeChunks = typename TimelineView<Entry>::TimeChunks;
+  using TimeChunksPtr = typename TimelineView<Entry>::TimeChunksPtr;
+  using SpatialEntries = typename TimelineView<Entry>::SpatialEntries;
+  using SpatialEntriesPtr = typename TimelineView<Entry>::SpatialEntriesPtr;
+  using SnapshotView = TimelineView<const Entry>;
+
+  /// The key of a chunk of time in the timeline of a map
+  using ChunkKey = std::pair<MapId, int64_t>;
+
+  /// The key of a cell in the spatial index of a map
+  using CellKey = std::pair<MapId, SpatialCell>;
+
+  struct KeyHash
+  {
+    std::size_t operator()(const ChunkKey& key) const
+    {
+      return MapId::Hash()(key.first)
+        ^ (std::hash<int64_t>()(key.second) << 1);
+    }
+
+    std::size_t operator()(const CellKey& key) const
+    {
+      return MapId::Hash()(key.first)
+        ^ (SpatialCell::Hash()(key.second) << 1);
+    }
+  };
+
+  /// Keeps track of which parts of the timeline have changed since the last
+  /// snapshot was taken.
+  struct Changes
+  {
+    // Nothing gets recorded until the first snapshot has been taken, because
+    // that snapshot needs to freeze the whole timeline anyway.
+    bool recording = false;
+
+    std::unordered_set<ParticipantId> participants;
+    std::unordered_set<ChunkKey, KeyHash> chunks;
+    std::unordered_set<CellKey, KeyHash> cells;
+
+    void record(
+      const ParticipantId participant,
+      const std::vector<ChunkKey>& changed_chunks,
+      const std::vector<CellKey>& changed_cells)
+    {
+      if (!recording)
+        return;
+
+      participants.insert(participant);
+      chunks.insert(changed_chunks.begin(), changed_chunks.end());
+      cells.insert(changed_cells.begin(), changed_cells.end());
+    }
+
+    bool empty() const
+    {
+      return participants.empty() && chunks.empty() && cells.empty();
+    }
+
+    void clear()
+    {
+      participants.clear();
+      chunks.clear();
+      cells.clear();
+    }
+  };
 
   /// This Timeline::Handle class allows us to use RAII so that when an Entry is
   /// deleted it will automatically be removed from any of its timeline buckets.
@@ -420,9 +865,15 @@ public:
   {
     Handle(
       ConstEntryPtr entry,
-      std::vector<std::weak_ptr<Bucket>> buckets)
+      std::vector<std::weak_ptr<Bucket>> buckets,
+      std::vector<ChunkKey> chunks,
+      std::vector<CellKey> cells,
+      std::weak_ptr<Changes> changes)
     : _entry(std::move(entry)),
-      _buckets(std::move(buckets))
+      _buckets(std::move(buckets)),
+      _chunks(std::move(chunks)),
+      _cells(std::move(cells)),
+      _changes(std::move(changes))
     {
       // Do nothing
     }
@@ -435,24 +886,43 @@ public:
         if (!bucket)
           continue;
 
-        const auto it = std::find(bucket->begin(), bucket->end(), _entry);
-        if (it != bucket->end())
-          bucket->erase(it);
+        auto& entries = bucket->entries;
+        const auto it = std::find(entries.begin(), entries.end(), _entry);
+        if (it != entries.end())
+        {
+          entries.erase(it);
+          bucket->frozen = nullptr;
+        }
       }
+
+      // Let the timeline know which of its chunks and cells have changed
+      // without it being involved, so its next snapshot refreezes them.
+      if (const auto changes = _changes.lock())
+        changes->record(_entry->participant, _chunks, _cells);
     }
 
   private:
     ConstEntryPtr _entry;
     std::vector<std::weak_ptr<Bucket>> _buckets;
+    std::vector<ChunkKey> _chunks;
+    std::vector<CellKey> _cells;
+    std::weak_ptr<Changes> _changes;
   };
 
+  /// Constructor
+  Timeline()
+  : _changes(std::make_shared<Changes>())
+  {
+    // Do nothing
+  }
+
   /// Insert a new entry into the timeline
   std::shared_ptr<Handle> insert(
     const std::shared_ptr<Entry>& entry)
   {
     std::vector<std::weak_ptr<Bucket>> buckets;
-    this->_all_bucket->push_back(entry);
-    buckets.emplace_back(this->_all_bucket);
+    std::vector<ChunkKey> chunks;
+    std::vector<CellKey> cells;
 
     if (entry->route && entry->route->trajectory().size() < 2)
     {
@@ -462,85 +932,383 @@ public:
         + std::to_string(entry->route->trajectory().size()) + "] is illegal!");
     }
 
+    auto& all_bucket = this->_all_buckets[entry->participant];
+    if (!all_bucket)
+      all_bucket = std::make_shared<Bucket>();
+
+    add_to_bucket(all_bucket, entry);
+    buckets.emplace_back(all_bucket);
+
     if (entry->route && entry->route->trajectory().start_time())
     {
 
       const Time start_time = *entry->route->trajectory().start_time();
       const Time finish_time = *entry->route->trajectory().finish_time();
-      const std::string& map_name = entry->route->map();
-
-      const auto map_it = this->_timelines.insert(
-        std::make_pair(map_name, Entries())).first;
-
-      Entries& timeline = map_it->second;
+      const MapId map = RouteData::get(*entry->route).map_id;
 
-      const auto start_it = get_timeline_iterator(timeline, start_time);
-      const auto end_it = ++get_timeline_iterator(timeline, finish_time);
+      TimeChunksPtr& chunks_ptr = this->_timelines[map];
+      if (!chunks_ptr)
+        chunks_ptr = std::make_shared<TimeChunks>();
 
-      for (auto it = start_it; it != end_it; ++it)
+      const int64_t last_chunk = TimeChunk::index(finish_time);
+      for (int64_t c = TimeChunk::index(start_time); c <= last_chunk; ++c)
       {
-        it->second->push_back(entry);
-        buckets.emplace_back(it->second);
+        EntriesPtr& timeline_ptr = (*chunks_ptr)[c];
+        if (!timeline_ptr)
+          timeline_ptr = std::make_shared<Entries>();
+
+        Entries& timeline = *timeline_ptr;
+        chunks.push_back({map, c});
+
+        // Only the part of the trajectory that passes through this chunk goes
+        // into its buckets.
+        const Time chunk_start = std::max(start_time, TimeChunk::start(c));
+        const Time chunk_finish = std::min(finish_time, TimeChunk::start(c+1));
+
+        const auto start_it = get_timeline_iterator(timeline, chunk_start);
+        const auto end_it = ++get_timeline_iterator(timeline, chunk_finish);
+
+        for (auto it = start_it; it != end_it; ++it)
+        {
+          add_to_bucket(it->second, entry);
+          buckets.emplace_back(it->second);
+        }
       }
+
+      insert_spatial(entry, buckets, cells);
     }
 
-    return std::make_shared<Handle>(entry, std::move(buckets));
+    _changes->record(entry->participant, chunks, cells);
+
+    return std::make_shared<Handle>(
+      entry, std::move(buckets), std::move(chunks), std::move(cells),
+      _changes);
   }
 
   void cull(const Time time)
   {
-    for (auto& pair : this->_timelines)
+    std::vector<ChunkKey> culled_chunks;
+    for (auto map_it = this->_timelines.begin();
+      map_it != this->_timelines.end(); )
+    {
+      auto& chunks = *map_it->second;
+      for (auto chunk_it = chunks.begin(); chunk_it != chunks.end(); )
+      {
+        if (!cull_timeline(*chunk_it->second, time))
+        {
+          ++chunk_it;
+          continue;
+        }
+
+        culled_chunks.push_back({map_it->first, chunk_it->first});
+        if (chunk_it->second->empty())
+          chunk_it = chunks.erase(chunk_it);
+        else
+          ++chunk_it;
+      }
+
+      if (chunks.empty())
+        map_it = this->_timelines.erase(map_it);
+      else
+        ++map_it;
+    }
+
+    std::vector<CellKey> culled_cells;
+    for (auto map_it = this->_spatial_timelines.begin();
+      map_it != this->_spatial_timelines.end(); )
+    {
+      auto& grid = *map_it->second;
+      for (auto cell_it = grid.begin(); cell_it != grid.end(); )
+      {
+        if (!cull_timeline(*cell_it->second, time))
+        {
+          ++cell_it;
+          continue;
+        }
+
+        culled_cells.push_back({map_it->first, cell_it->first});
+        if (cell_it->second->empty())
+          cell_it = grid.erase(cell_it);
+        else
+          ++cell_it;
+      }
+
+      if (grid.empty())
+        map_it = this->_spatial_timelines.erase(map_it);
+      else
+        ++map_it;
+    }
+
+    if (_changes->recording)
     {
-      auto& timeline = pair.second;
+      _changes->chunks.insert(culled_chunks.begin(), culled_chunks.end());
+      _changes->cells.insert(culled_cells.begin(), culled_cells.end());
+    }
 
-      // NOTE(MXG): It is not an error that we are using get_timeline_begin() to
-      // find the ending iterator. We want to stop just before the first bucket
-      // that contains the cull time, because we only want to erase times that
-      // come before it.
-      const auto end_it =
-        TimelineView<Entry>::get_timeline_begin(timeline, &time);
+    for (auto p_it = this->_all_buckets.begin();
+      p_it != this->_all_buckets.end(); )
+    {
+      if (p_it->second->entries.empty())
+      {
+        if (_changes->recording)
+          _changes->participants.insert(p_it->first);
 
-      if (end_it != timeline.begin())
-        timeline.erase(timeline.begin(), end_it);
+        p_it = this->_all_buckets.erase(p_it);
+      }
+      else
+        ++p_it;
     }
   }
 
   /// Create an immutable snapshot of the current timeline. A single instance of
-  /// the snapshot can be safely used by multiple threads simultaneously.
-  std::shared_ptr<const TimelineView<const Entry>> snapshot() const
+  /// the snapshot can be safely used by multiple threads simultaneously, and
+  /// this function may be called by multiple threads simultaneously as long as
+  /// none of them are modifying the timeline.
+  ///
+  /// Snapshots share every chunk, cell and participant bucket that has not
+  /// changed since the last snapshot was taken, so the cost of this function is
+  /// proportional to how much the timeline has changed. If nothing has changed
+  /// at all, the last snapshot will be returned again.
+  std::shared_ptr<const SnapshotView> snapshot() const
   {
-    // TODO(MXG): Consider whether we could use plain std::vector<Bucket>
-    // instances instead of std::vector<std::shared_ptr<Bucket>> in the snapshot
-    // to reduce how many heap allocations are needed, and to lessen the cache
-    // misses. The tricky part is this may cost us more when copying the maps.
+    std::lock_guard<std::mutex> lock(_snapshot_mutex);
+    if (_last_snapshot && _changes->empty())
+      return _last_snapshot;
+
+    std::shared_ptr<SnapshotView> result = std::make_shared<SnapshotView>();
+
+    if (!_last_snapshot)
+    {
+      for (const auto& map_scope : this->_timelines)
+      {
+        auto chunks = std::make_shared<TimeChunks>();
+        for (const auto& chunk_scope : *map_scope.second)
+          (*chunks)[chunk_scope.first] = freeze(*chunk_scope.second);
 
-    // TODO(MXG): Consider whether there's a safe way to cache a snapshot. The
-    // main problem I see is that we don't have a good way of knowing when an
-    // entry gets removed right now, so we wouldn't know to update the snapshot
-    // when an entry gets taken out.
+        result->_timelines[map_scope.first] = std::move(chunks);
+      }
+
+      for (const auto& map_scope : this->_spatial_timelines)
+      {
+        auto grid = std::make_shared<SpatialEntries>();
+        for (const auto& cell_scope : *map_scope.second)
+          (*grid)[cell_scope.first] = freeze(*cell_scope.second);
+
+        result->_spatial_timelines[map_scope.first] = std::move(grid);
+      }
 
-    std::shared_ptr<TimelineView<const Entry>> result =
-      std::make_shared<TimelineView<const Entry>>();
+      for (const auto& bucket : this->_all_buckets)
+        result->_all_buckets[bucket.first] = freeze(bucket.second);
 
-    // Make a deep copy of the buckets so that adding/removing entries from the
-    // source bucket does not impact the snapshot
-    result->_timelines = this->_timelines;
-    for (auto& map_scope : result->_timelines)
+      _changes->recording = true;
+    }
+    else
     {
-      for (auto& time_scope : map_scope.second)
+      // Start from the previous snapshot and only replace the parts that have
+      // changed since then. Anything that has been removed from the timeline
+      // since then will be missing from the live timeline, so it gets removed
+      // from the snapshot too.
+      result->_timelines = _last_snapshot->_timelines;
+      refreeze(this->_timelines, _changes->chunks, result->_timelines);
+
+      result->_spatial_timelines = _last_snapshot->_spatial_timelines;
+      refreeze(this->_spatial_timelines, _changes->cells,
+        result->_spatial_timelines);
+
+      result->_all_buckets = _last_snapshot->_all_buckets;
+      for (const auto participant : _changes->participants)
       {
-        auto& bucket = time_scope.second;
-        bucket = std::make_shared<Bucket>(*bucket);
+        const auto it = this->_all_buckets.find(participant);
+        if (it == this->_all_buckets.end())
+          result->_all_buckets.erase(participant);
+        else
+          result->_all_buckets[participant] = freeze(it->second);
       }
     }
 
-    result->_all_bucket = std::make_shared<Bucket>(*result->_all_bucket);
+    _changes->clear();
+    _last_snapshot = result;
 
     return result;
   }
 
 private:
 
+  //============================================================================
+  static void add_to_bucket(const BucketPtr& bucket, const ConstEntryPtr& entry)
+  {
+    bucket->entries.push_back(entry);
+    bucket->frozen = nullptr;
+  }
+
+  //============================================================================
+  /// Get an immutable copy of the bucket, reusing the last copy if the bucket
+  /// has not changed since then.
+  static BucketPtr freeze(const BucketPtr& bucket)
+  {
+    if (!bucket->frozen)
+      bucket->frozen = std::make_shared<Bucket>(Bucket{bucket->entries, {}});
+
+    return bucket->frozen;
+  }
+
+  //============================================================================
+  static EntriesPtr freeze(const Entries& timeline)
+  {
+    auto frozen = std::make_shared<Entries>();
+    for (const auto& time_scope : timeline)
+    {
+      frozen->insert(
+        frozen->end(), {time_scope.first, freeze(time_scope.second)});
+    }
+
+    return frozen;
+  }
+
+  //============================================================================
+  /// Update the frozen copy of a per-map index (either the time chunks or the
+  /// spatial grid) so that it matches the live index for each of the changed
+  /// keys. Each changed map gets a new index that shares all of the unchanged
+  /// Entries instances of the previous one.
+  template<typename MapToIndex, typename ChangedKeys>
+  static void refreeze(
+    const MapToIndex& live,
+    const ChangedKeys& changed,
+    MapToIndex& frozen)
+  {
+    using IndexPtr = typename MapToIndex::mapped_type;
+    using Index = typename IndexPtr::element_type;
+
+    MapToIndex updated;
+    for (const auto& key : changed)
+    {
+      IndexPtr& index = updated[key.first];
+      if (!index)
+      {
+        const auto frozen_it = frozen.find(key.first);
+        index = frozen_it == frozen.end() ?
+          std::make_shared<Index>() :
+          std::make_shared<Index>(*frozen_it->second);
+      }
+
+      const auto live_it = live.find(key.first);
+      if (live_it != live.end())
+      {
+        const auto entries_it = live_it->second->find(key.second);
+        if (entries_it != live_it->second->end())
+        {
+          (*index)[key.second] = freeze(*entries_it->second);
+          continue;
+        }
+      }
+
+      index->erase(key.second);
+    }
+
+    for (auto& map_scope : updated)
+    {
+      if (map_scope.second->empty())
+        frozen.erase(map_scope.first);
+      else
+        frozen[map_scope.first] = std::move(map_scope.second);
+    }
+  }
+
+  //============================================================================
+  /// Insert the entry into the cells of the spatial index that are touched by
+  /// the vicinity of its participant, for the time buckets that each segment
+  /// of its trajectory spans.
+  void insert_spatial(
+    const std::shared_ptr<Entry>& entry,
+    std::vector<std::weak_ptr<Bucket>>& buckets,
+    std::vector<CellKey>& cells)
+  {
+    // Region queries only ever consider the vicinity of a participant, so if
+    // there is no vicinity then this entry can never be relevant to them.
+    const auto& vicinity = entry->description->profile().vicinity();
+    if (!vicinity)
+      return;
+
+    const double inflation = vicinity->get_characteristic_length();
+    const MapId map = RouteData::get(*entry->route).map_id;
+    SpatialEntriesPtr& grid_ptr = this->_spatial_timelines[map];
+    if (!grid_ptr)
+      grid_ptr = std::make_shared<SpatialEntries>();
+
+    auto& grid = *grid_ptr;
+
+    // A segment may pass through the same bucket or cell as a previous
+    // segment, but each bucket should only contain the entry once.
+    std::unordered_set<const Bucket*> visited;
+    std::unordered_set<SpatialCell, SpatialCell::Hash> visited_cells;
+
+    const Trajectory& trajectory = entry->route->trajectory();
+    for (auto seg_it = ++trajectory.begin(); seg_it != trajectory.end();
+      ++seg_it)
+    {
+      const Spline spline(seg_it);
+      const SpatialCellRange range = SpatialCellRange::from(
+        internal::adjust_bounding_box(
+          internal::get_bounding_box(spline), inflation));
+
+      const auto insert_into_cell = [&](const SpatialCell& cell)
+        {
+          EntriesPtr& timeline_ptr = grid[cell];
+          if (!timeline_ptr)
+            timeline_ptr = std::make_shared<Entries>();
+
+          Entries& timeline = *timeline_ptr;
+          if (visited_cells.insert(cell).second)
+            cells.push_back({map, cell});
+
+          const auto start_it =
+            get_timeline_iterator(timeline, spline.start_time());
+          const auto end_it =
+            ++get_timeline_iterator(timeline, spline.finish_time());
+
+          for (auto it = start_it; it != end_it; ++it)
+          {
+            if (!visited.insert(it->second.get()).second)
+              continue;
+
+            add_to_bucket(it->second, entry);
+            buckets.emplace_back(it->second);
+          }
+        };
+
+      if (MaxCellsPerSegment < range.size())
+      {
+        insert_into_cell(SpatialCell::overflow());
+        continue;
+      }
+
+      for (int64_t x = range.min.x; x <= range.max.x; ++x)
+      {
+        for (int64_t y = range.min.y; y <= range.max.y; ++y)
+          insert_into_cell(SpatialCell{x, y});
+      }
+    }
+  }
+
+  //============================================================================
+  /// Erase the buckets that end before the given time. Returns true if any
+  /// buckets were erased.
+  static bool cull_timeline(Entries& timeline, const Time time)
+  {
+    // NOTE(MXG): It is not an error that we are using get_timeline_begin() to
+    // find the ending iterator. We want to stop just before the first bucket
+    // that contains the cull time, because we only want to erase times that
+    // come before it.
+    const auto end_it =
+      TimelineView<Entry>::get_timeline_begin(timeline, &time);
+
+    if (end_it == timeline.begin())
+      return false;
+
+    timeline.erase(timeline.begin(), end_it);
+    return true;
+  }
+
   //============================================================================
   static typename Entries::iterator get_timeline_iterator(
     Entries& timeline, const Time time)
@@ -584,6 +1352,16 @@ private:
 
     return start_it;
   }
+
+  // This keeps track of what has changed since the last snapshot. Handles hold
+  // a weak_ptr to it so they can report the buckets that they remove entries
+  // from.
+  std::shared_ptr<Changes> _changes;
+
+  // This protects the snapshot cache (including the frozen copies of the
+  // buckets) so that snapshot() can be called from multiple threads at once.
+  mutable std::mutex _snapshot_mutex;
+  mutable std::shared_ptr<const SnapshotView> _last_snapshot;
 };
 
 //==============================================================================
@@ -36,6 +36,11 @@ public:
   /// is given a cull command, and the entry qualifies for the cull.
   static std::size_t current_entry_history_count(const Database& database);
 
+  /// Returns how many records are in the change journal of the database. Each
+  /// entry history should have at most one record, plus the records that have
+  /// been retired but not removed yet.
+  static std::size_t current_change_journal_size(const Database& database);
+
   /// Returns how many participants remain in the record of participants that
   /// have been removed (aka unregistered). These entries should gradually
   /// disappear when the database is culled from a time that comes after the
@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <src/rmf_traffic/agv/planning/CacheManager.hpp>
+
+#include <rmf_utils/catch.hpp>
+
+#include <thread>
+
+namespace {
+//==============================================================================
+using Storage = std::unordered_map<std::size_t, std::size_t>;
+
+//==============================================================================
+class SumGenerator
+  : public rmf_traffic::agv::planning::Generator<Storage>
+{
+public:
+
+  SumGenerator(std::size_t goal)
+  : _goal(goal)
+  {
+    // Do nothing
+  }
+
+  std::size_t generate(
+    const std::size_t& key,
+    const SharedStorage&,
+    Storage& new_items) const final
+  {
+    new_items.insert({key, key + _goal});
+    return key + _goal;
+  }
+
+private:
+  std::size_t _goal;
+};
+
+//==============================================================================
+class SumFactory
+  : public rmf_traffic::agv::planning::Factory<SumGenerator>
+{
+public:
+
+  ConstGeneratorPtr make(const std::size_t goal) const final
+  {
+    return std::make_shared<SumGenerator>(goal);
+  }
+};
+
+//==============================================================================
+using SumCacheMap = rmf_traffic::agv::planning::CacheManagerMap<SumFactory>;
+using SumCacheManager = SumCacheMap::CacheManager_type;
+
+//==============================================================================
+void wait_for_clock()
+{
+  // Make sure the steady clock moves forward between uses of the tables
+  const auto start = std::chrono::steady_clock::now();
+  while (std::chrono::steady_clock::now() == start)
+    std::this_thread::yield();
+}
+} // anonymous namespace
+
+//==============================================================================
+SCENARIO("Cache manager memory budget")
+{
+  SumCacheMap map(std::make_shared<SumFactory>());
+  const std::size_t entry_bytes = SumCacheManager::bytes_per_entry;
+
+  GIVEN("No budget")
+  {
+    for (std::size_t goal = 0; goal < 10; ++goal)
+    {
+      const auto cache = map.get(goal)->get();
+      for (std::size_t key = 0; key < 10; ++key)
+        CHECK(cache.get(key) == key + goal);
+
+      // Every lookup after the first is a hit
+      for (std::size_t key = 0; key < 10; ++key)
+        CHECK(cache.get(key) == key + goal);
+    }
+
+    const auto stats = map.statistics();
+    CHECK(stats.tables == 10);
+    CHECK(stats.entries == 100);
+    CHECK(stats.estimated_bytes == 100*entry_bytes);
+    CHECK(stats.hits == 100);
+    CHECK(stats.misses == 100);
+    CHECK(stats.evicted_tables == 0);
+    CHECK(stats.evicted_entries == 0);
+  }
+
+  GIVEN("A budget for two and a half tables")
+  {
+    map.set_memory_budget(25*entry_bytes);
+
+    const auto fill = [&](const std::size_t goal)
+      {
+        wait_for_clock();
+        const auto cache = map.get(goal)->get();
+        for (std::size_t key = 0; key < 10; ++key)
+          cache.get(key);
+      };
+
+    fill(0);
+    fill(1);
+    fill(2);
+    CHECK(map.statistics().tables == 3);
+
+    // The map is over budget when goal 0 is requested again, so the least
+    // recently used table, which is goal 1, gets evicted.
+    fill(0);
+    fill(3);
+
+    auto stats = map.statistics();
+    CHECK(stats.tables == 3);
+    CHECK(stats.evicted_tables == 1);
+    CHECK(stats.evicted_entries == 10);
+
+    const auto items = map.items();
+    CHECK(items.count(0) == 1);
+    CHECK(items.count(1) == 0);
+    CHECK(items.count(2) == 1);
+    CHECK(items.count(3) == 1);
+
+    // The lookups of the evicted table are still counted
+    CHECK(stats.misses == 40);
+    CHECK(stats.hits == 10);
+
+    WHEN("A table is held by something else")
+    {
+      const auto held = map.get(2);
+      fill(4);
+      fill(5);
+
+      // Goal 2 was the least recently used, but it could not be evicted
+      CHECK(map.items().count(2) == 1);
+      CHECK(held->size() == 10);
+    }
+  }
+
+  GIVEN("A single manager with a budget")
+  {
+    const auto manager = map.get(0);
+    manager->set_memory_budget(5*entry_bytes);
+
+    {
+      const auto cache = manager->get();
+      for (std::size_t key = 0; key < 10; ++key)
+        cache.get(key);
+    }
+
+    CHECK(manager->size() == 10);
+
+    // The manager is over budget, so the next Cache starts from nothing
+    const auto cache = manager->get();
+    CHECK(manager->size() == 0);
+    CHECK(cache.get(3) == 3);
+
+    const auto stats = manager->statistics();
+    CHECK(stats.evicted_tables == 1);
+    CHECK(stats.evicted_entries == 10);
+    CHECK(stats.misses == 10);
+  }
+}
+
+//==============================================================================
+SCENARIO("Cache lookup recorder")
+{
+  using rmf_traffic::agv::planning::CacheLookupRecorder;
+
+  SumCacheMap map(std::make_shared<SumFactory>());
+  CHECK_FALSE(CacheLookupRecorder::current());
+
+  const auto lookup = [&map](const std::size_t goal)
+    {
+      const auto cache = map.get(goal)->get();
+      for (std::size_t key = 0; key < 10; ++key)
+        cache.get(key);
+    };
+
+  // Lookups made before the recorder exists are not recorded
+  lookup(0);
+
+  CacheLookupRecorder recorder;
+  CHECK(CacheLookupRecorder::current() == &recorder);
+
+  lookup(0);
+  lookup(1);
+
+  // Lookups made by other threads are not recorded either
+  std::thread([&lookup]() { lookup(2); }).join();
+
+  const auto lookups = recorder.get<SumGenerator>();
+  CHECK(lookups.hits == 10);
+  CHECK(lookups.misses == 10);
+
+  const auto stats = map.statistics();
+  CHECK(stats.hits == 10);
+  CHECK(stats.misses == 30);
+
+  {
+    CacheLookupRecorder inner;
+    lookup(1);
+    CHECK(inner.get<SumGenerator>().hits == 10);
+  }
+
+  CHECK(CacheLookupRecorder::current() == &recorder);
+  CHECK(recorder.get<SumGenerator>().hits == 10);
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <src/rmf_traffic/agv/planning/ConcurrentStorage.hpp>
+
+#include <rmf_utils/catch.hpp>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+
+//==============================================================================
+SCENARIO("Concurrent storage")
+{
+  using Storage = std::unordered_map<std::size_t, std::size_t>;
+  rmf_traffic::agv::planning::ConcurrentStorage<Storage> storage{Storage()};
+
+  CHECK(storage.find(0) == nullptr);
+  CHECK(storage.size() == 0);
+
+  WHEN("Items are inserted one at a time")
+  {
+    const std::size_t N = 1000;
+    for (std::size_t i = 0; i < N; ++i)
+      storage.insert(i, 2*i);
+
+    CHECK(storage.size() == N);
+    for (std::size_t i = 0; i < N; ++i)
+    {
+      const auto* value = storage.find(i);
+      REQUIRE(value);
+      CHECK(*value == 2*i);
+    }
+
+    CHECK(storage.find(N) == nullptr);
+
+    THEN("Reinserting a key keeps its original value")
+    {
+      const auto* old_value = storage.find(10);
+      storage.insert(10, 7);
+      CHECK(storage.find(10) == old_value);
+      CHECK(*old_value == 20);
+      CHECK(storage.size() == N);
+    }
+
+    THEN("A copy of the items can be taken")
+    {
+      const Storage items = storage.items();
+      CHECK(items.size() == N);
+      CHECK(items.at(500) == 1000);
+    }
+  }
+
+  WHEN("The same keys are inserted over and over")
+  {
+    using SharedStorage = std::unordered_map<std::size_t, std::shared_ptr<int>>;
+    rmf_traffic::agv::planning::ConcurrentStorage<SharedStorage> shared{
+      SharedStorage()};
+
+    const std::size_t N = 10;
+    std::vector<std::weak_ptr<int>> discarded;
+    for (std::size_t r = 0; r < 1000; ++r)
+    {
+      for (std::size_t i = 0; i < N; ++i)
+      {
+        auto value = std::make_shared<int>(static_cast<int>(r));
+        if (r > 0)
+          discarded.push_back(value);
+
+        shared.insert(i, std::move(value));
+      }
+    }
+
+    CHECK(shared.size() == N);
+    for (std::size_t i = 0; i < N; ++i)
+    {
+      const auto* value = shared.find(i);
+      REQUIRE(value);
+      CHECK(**value == 0);
+    }
+
+    // None of the values that were inserted after the first round are being
+    // held onto by the storage
+    for (const auto& value : discarded)
+      CHECK(value.expired());
+  }
+
+  WHEN("Many threads read and write at the same time")
+  {
+    const std::size_t N_threads = 8;
+    const std::size_t N = 2000;
+    std::atomic_bool wrong_value(false);
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < N_threads; ++t)
+    {
+      threads.emplace_back(
+        [&storage, &wrong_value, t, N, N_threads]()
+        {
+          for (std::size_t i = 0; i < N; ++i)
+          {
+            // Every thread writes the same value for a key, so readers can
+            // check whatever they find.
+            const std::size_t key = (i*N_threads + t) % N;
+            if (const auto* value = storage.find(key))
+            {
+              if (*value != key + 1)
+                wrong_value = true;
+            }
+
+            Storage batch;
+            batch.insert({key, key + 1});
+            batch.insert({(key + 1) % N, (key + 1) % N + 1});
+            storage.insert(std::move(batch));
+          }
+        });
+    }
+
+    for (auto& thread : threads)
+      thread.join();
+
+    CHECK_FALSE(wrong_value);
+    CHECK(storage.size() == N);
+    for (std::size_t i = 0; i < N; ++i)
+    {
+      const auto* value = storage.find(i);
+      REQUIRE(value);
+      CHECK(*value == i + 1);
+    }
+  }
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <src/rmf_traffic/agv/planning/HeuristicCacheFile.hpp>
+
+#include "../../utils_Trajectory.hpp"
+
+#include <rmf_utils/catch.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+namespace {
+//==============================================================================
+/// A scratch directory that gets removed along with everything inside of it
+/// when the test section finishes, even if the section fails.
+struct TemporaryDirectory
+{
+  TemporaryDirectory()
+  {
+    std::random_device rd;
+    path = std::filesystem::temp_directory_path()
+      / ("test_heuristic_cache_file_" + std::to_string(rd()));
+    std::filesystem::create_directories(path);
+  }
+
+  ~TemporaryDirectory()
+  {
+    std::error_code ec;
+    std::filesystem::remove_all(path, ec);
+  }
+
+  std::filesystem::path path;
+};
+} // anonymous namespace
+
+//==============================================================================
+SCENARIO("Heuristic cache file")
+{
+  using namespace std::chrono_literals;
+
+  rmf_traffic::agv::Graph graph;
+  const std::string test_map = "test_map";
+  graph.add_waypoint(test_map, {0, 0}); // 0
+  graph.add_waypoint(test_map, {5, 0}); // 1
+  graph.add_waypoint(test_map, {5, 5}); // 2
+  graph.add_waypoint(test_map, {0, 5}); // 3
+
+  graph.add_lane(0, 1);
+  graph.add_lane(1, 0);
+  graph.add_lane(1, 2);
+  graph.add_lane(2, 1);
+  graph.add_lane(2, 3);
+  graph.add_lane(3, 2);
+
+  const rmf_traffic::agv::VehicleTraits traits(
+    {1.0, 0.5}, {1.0, 0.5}, create_test_profile(UnitCircle));
+
+  const rmf_traffic::agv::Planner::Configuration config{graph, traits};
+  const TemporaryDirectory directory;
+  const std::string filename =
+    (directory.path / "heuristic_cache.bin").string();
+
+  const rmf_traffic::agv::Planner::Options options{nullptr};
+  const rmf_traffic::agv::Planner planner{config, options};
+
+  const auto start_time = std::chrono::steady_clock::now();
+  const auto plan = planner.plan(
+    rmf_traffic::agv::Planner::Start(start_time, 0, 0.0),
+    rmf_traffic::agv::Planner::Goal(3));
+  REQUIRE(plan);
+
+  CHECK_FALSE(planner.load_heuristic_cache(filename));
+  REQUIRE(planner.save_heuristic_cache(filename));
+
+  WHEN("The file is loaded by a planner with the same configuration")
+  {
+    auto same_config = config;
+    same_config.heuristic_cache_file(filename);
+    const rmf_traffic::agv::Planner warm_planner{same_config, options};
+    CHECK(warm_planner.load_heuristic_cache(filename));
+
+    const auto warm_plan = warm_planner.plan(
+      rmf_traffic::agv::Planner::Start(start_time, 0, 0.0),
+      rmf_traffic::agv::Planner::Goal(3));
+    REQUIRE(warm_plan);
+    CHECK(warm_plan->get_cost() == Approx(plan->get_cost()));
+    CHECK(warm_plan->get_waypoints().size() == plan->get_waypoints().size());
+  }
+
+  WHEN("The file is loaded by a planner with a different configuration")
+  {
+    auto other_graph = graph;
+    other_graph.add_lane(3, 0);
+    const rmf_traffic::agv::Planner other_planner{
+      rmf_traffic::agv::Planner::Configuration{other_graph, traits},
+      options
+    };
+
+    CHECK_FALSE(other_planner.load_heuristic_cache(filename));
+
+    const rmf_traffic::agv::VehicleTraits other_traits(
+      {2.0, 0.5}, {1.0, 0.5}, create_test_profile(UnitCircle));
+    const rmf_traffic::agv::Planner faster_planner{
+      rmf_traffic::agv::Planner::Configuration{graph, other_traits},
+      options
+    };
+
+    CHECK_FALSE(faster_planner.load_heuristic_cache(filename));
+  }
+
+  WHEN("The file is read directly")
+  {
+    using rmf_traffic::agv::planning::hash_heuristic_configuration;
+    using rmf_traffic::agv::planning::load_heuristic_cache_file;
+
+    const auto hash = hash_heuristic_configuration(config);
+    const auto data = load_heuristic_cache_file(filename, hash);
+    REQUIRE(data);
+    CHECK(data->translation.count(3) > 0);
+    CHECK_FALSE(data->shortest_path.empty());
+    CHECK_FALSE(data->euclidean.empty());
+
+    CHECK_FALSE(load_heuristic_cache_file(filename, hash + 1));
+  }
+
+  WHEN("The file is truncated")
+  {
+    std::ifstream in(filename, std::ios::binary);
+    const std::string contents{
+      std::istreambuf_iterator<char>(in),
+      std::istreambuf_iterator<char>()
+    };
+    in.close();
+
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    out.write(contents.data(), contents.size() - 4);
+    out.close();
+
+    CHECK_FALSE(planner.load_heuristic_cache(filename));
+  }
+}
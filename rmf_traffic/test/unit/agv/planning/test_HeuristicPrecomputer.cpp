@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic/agv/Planner.hpp>
+
+#include "../../utils_Trajectory.hpp"
+
+#include <rmf_utils/catch.hpp>
+
+#include <thread>
+
+//==============================================================================
+SCENARIO("Precompute heuristics in the background")
+{
+  using namespace std::chrono_literals;
+
+  const std::string test_map = "test_map";
+  const std::size_t N = 6;
+  rmf_traffic::agv::Graph graph;
+  for (std::size_t i = 0; i < N; ++i)
+  {
+    for (std::size_t j = 0; j < N; ++j)
+      graph.add_waypoint(test_map, {5.0*i, 5.0*j});
+  }
+
+  for (std::size_t i = 0; i < N; ++i)
+  {
+    for (std::size_t j = 0; j < N; ++j)
+    {
+      const std::size_t wp = i*N + j;
+      if (i+1 < N)
+      {
+        graph.add_lane(wp, wp + N);
+        graph.add_lane(wp + N, wp);
+      }
+
+      if (j+1 < N)
+      {
+        graph.add_lane(wp, wp + 1);
+        graph.add_lane(wp + 1, wp);
+      }
+    }
+  }
+
+  const rmf_traffic::agv::VehicleTraits traits(
+    {1.0, 0.5}, {1.0, 0.5}, create_test_profile(UnitCircle));
+
+  const rmf_traffic::agv::Planner::Options options{nullptr};
+  const auto start_time = std::chrono::steady_clock::now();
+  const rmf_traffic::agv::Planner::Start start{start_time, 0, 0.0};
+  const rmf_traffic::agv::Planner::Goal goal{N*N - 1};
+
+  const rmf_traffic::agv::Planner lazy_planner{
+    rmf_traffic::agv::Planner::Configuration{graph, traits}, options};
+  CHECK(lazy_planner.heuristics_precomputed());
+
+  const auto expected_plan = lazy_planner.plan(start, goal);
+  REQUIRE(expected_plan);
+
+  auto config = rmf_traffic::agv::Planner::Configuration{graph, traits};
+  CHECK_FALSE(config.precompute_heuristics().has_value());
+
+  WHEN("Every goal is precomputed")
+  {
+    config.precompute_heuristics(std::vector<std::size_t>());
+    config.precomputation_threads(2);
+
+    const rmf_traffic::agv::Planner planner{config, options};
+
+    // Planning must work whether or not the precomputation has finished
+    const auto early_plan = planner.plan(start, goal);
+    REQUIRE(early_plan);
+    CHECK(early_plan->get_cost() == Approx(expected_plan->get_cost()));
+
+    const auto give_up = std::chrono::steady_clock::now() + 60s;
+    while (!planner.heuristics_precomputed()
+      && std::chrono::steady_clock::now() < give_up)
+    {
+      std::this_thread::sleep_for(10ms);
+    }
+
+    REQUIRE(planner.heuristics_precomputed());
+
+    for (std::size_t g = 0; g < N*N; g += N+1)
+    {
+      const auto lazy_plan = lazy_planner.plan(start, g);
+      const auto warm_plan = planner.plan(start, g);
+      REQUIRE(lazy_plan);
+      REQUIRE(warm_plan);
+      CHECK(warm_plan->get_cost() == Approx(lazy_plan->get_cost()));
+    }
+  }
+
+  WHEN("Goal orientations are precomputed")
+  {
+    config.precompute_heuristics(std::vector<std::size_t>{N*N - 1});
+    config.precompute_goal_orientations({0.0, M_PI/2.0});
+    CHECK(config.precompute_goal_orientations().size() == 2);
+
+    const rmf_traffic::agv::Planner planner{config, options};
+
+    const auto give_up = std::chrono::steady_clock::now() + 60s;
+    while (!planner.heuristics_precomputed()
+      && std::chrono::steady_clock::now() < give_up)
+    {
+      std::this_thread::sleep_for(10ms);
+    }
+
+    REQUIRE(planner.heuristics_precomputed());
+
+    const rmf_traffic::agv::Planner::Goal oriented_goal{N*N - 1, M_PI/2.0};
+    const auto lazy_plan = lazy_planner.plan(start, oriented_goal);
+    const auto warm_plan = planner.plan(start, oriented_goal);
+    REQUIRE(lazy_plan);
+    REQUIRE(warm_plan);
+    CHECK(warm_plan->get_cost() == Approx(lazy_plan->get_cost()));
+  }
+
+  WHEN("The planner is destroyed before the precomputation finishes")
+  {
+    config.precompute_heuristics(std::vector<std::size_t>());
+    {
+      const rmf_traffic::agv::Planner planner{config, options};
+    }
+
+    // We only need to reach this point without hanging or crashing
+    CHECK(true);
+  }
+
+  WHEN("A goal that is not in the graph is requested")
+  {
+    config.precompute_heuristics(std::vector<std::size_t>{0, N*N});
+    CHECK_THROWS_AS(
+      rmf_traffic::agv::Planner(config, options), std::out_of_range);
+  }
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <src/rmf_traffic/agv/planning/ShortestPathHeuristic.hpp>
+
+#include "../../utils_Trajectory.hpp"
+
+#include <rmf_utils/catch.hpp>
+
+//==============================================================================
+SCENARIO("Landmark Heuristic -- Multifloor")
+{
+  using namespace rmf_traffic::agv::planning;
+
+  rmf_traffic::agv::Graph graph;
+
+  const auto add_bidir_lane = [&](std::size_t i, std::size_t j)
+  {
+    graph.add_lane(i, j);
+    graph.add_lane(j, i);
+  };
+
+  // Three floors, each with a 3x3 grid of waypoints
+  const std::size_t floors = 3;
+  for (std::size_t f = 0; f < floors; ++f)
+  {
+    const std::string map = "L" + std::to_string(f);
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+      for (std::size_t j = 0; j < 3; ++j)
+        graph.add_waypoint(map, {2.0*i, 2.0*j});
+    }
+
+    const std::size_t offset = 9*f;
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+      for (std::size_t j = 0; j < 3; ++j)
+      {
+        const std::size_t wp = offset + 3*i + j;
+        if (i+1 < 3)
+          add_bidir_lane(wp, wp + 3);
+
+        if (j+1 < 3)
+          add_bidir_lane(wp, wp + 1);
+      }
+    }
+  }
+
+  // A lift connects the corner of each floor to the floor above it
+  const auto lift_move_duration = std::chrono::seconds(10);
+  const auto lift_move = rmf_traffic::agv::Graph::Lane::Event::make(
+    rmf_traffic::agv::Graph::Lane::LiftMove(
+      "does not matter", "does not matter", lift_move_duration));
+
+  for (std::size_t f = 0; f+1 < floors; ++f)
+  {
+    graph.add_lane({9*f + 8, lift_move}, 9*(f+1) + 8);
+    graph.add_lane({9*(f+1) + 8, lift_move}, 9*f + 8);
+  }
+
+  // A one-way dead end: waypoint 27 can be entered but never left
+  graph.add_waypoint("L0", {10.0, 10.0});
+  graph.add_lane(0, 27);
+
+  const std::size_t N = graph.num_waypoints();
+
+  const double max_speed = 2.0;
+  const rmf_traffic::agv::VehicleTraits traits(
+    {max_speed, 0.3}, {1.0, 0.45}, create_test_profile(UnitCircle));
+
+  const auto supergraph = Supergraph::make(
+    rmf_traffic::agv::Graph::Implementation::get(graph),
+    traits, rmf_traffic::agv::Interpolate::Options());
+
+  CacheManagerMap<ShortestPathHeuristicFactory> plain_map(
+    std::make_shared<ShortestPathHeuristicFactory>(supergraph));
+
+  const auto landmark_factory =
+    std::make_shared<ShortestPathHeuristicFactory>(supergraph, 4);
+  CacheManagerMap<ShortestPathHeuristicFactory> landmark_map(landmark_factory);
+
+  REQUIRE(landmark_factory->landmark_heuristics());
+  CHECK_FALSE(plain_map.factory().landmark_heuristics());
+
+  const auto& landmarks =
+    landmark_factory->landmark_heuristics()->factory().landmarks();
+  CHECK(landmarks.waypoints().size() == 4);
+
+  WHEN("Comparing against exact shortest paths")
+  {
+    for (std::size_t goal = 0; goal < N; ++goal)
+    {
+      const auto plain = plain_map.get(goal)->get();
+      const auto with_landmarks = landmark_map.get(goal)->get();
+      for (std::size_t start = 0; start < N; ++start)
+      {
+        const auto expected = plain.get(start);
+        const auto actual = with_landmarks.get(start);
+        const auto bound = landmarks.lower_bound(start, goal);
+
+        CHECK(expected.has_value() == actual.has_value());
+        if (!expected.has_value())
+          continue;
+
+        // Using landmarks must not change the shortest path costs
+        CHECK(*actual == Approx(*expected).margin(1e-9));
+
+        // The landmark bound must never overestimate
+        REQUIRE(bound.has_value());
+        CHECK(*bound <= *expected + 1e-9);
+      }
+    }
+  }
+
+  WHEN("The goal is on a different floor")
+  {
+    // The only way from L0 to L2 is through both lift moves, which the
+    // Euclidean heuristic can only partly see. The landmarks should notice
+    // most of the cost.
+    const auto expected = plain_map.get(18)->get().get(0);
+    REQUIRE(expected.has_value());
+
+    const auto bound = landmarks.lower_bound(0, 18);
+    REQUIRE(bound.has_value());
+    CHECK(*bound >= 2*rmf_traffic::time::to_seconds(lift_move_duration));
+  }
+
+  WHEN("The goal cannot be reached")
+  {
+    CHECK_FALSE(plain_map.get(0)->get().get(27).has_value());
+    CHECK_FALSE(landmark_map.get(0)->get().get(27).has_value());
+  }
+}
@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <src/rmf_traffic/agv/planning/MemoizedRouteValidator.hpp>
+#include <src/rmf_traffic/agv/internal_Planner.hpp>
+
+#include <rmf_traffic/schedule/Database.hpp>
+
+#include "../../utils_Trajectory.hpp"
+
+#include <rmf_utils/catch.hpp>
+
+#include <random>
+
+namespace {
+//==============================================================================
+class CountingValidator : public rmf_traffic::agv::RouteValidator
+{
+public:
+
+  std::optional<Conflict> find_conflict(const Route& route) const final
+  {
+    ++count;
+    if (route.map() == "blocked")
+      return Conflict{7, *route.trajectory().start_time()};
+
+    return std::nullopt;
+  }
+
+  std::unique_ptr<RouteValidator> clone() const final
+  {
+    return std::make_unique<CountingValidator>(*this);
+  }
+
+  mutable std::size_t count = 0;
+};
+
+//==============================================================================
+rmf_traffic::Trajectory make_line(
+  const rmf_traffic::Time start,
+  const Eigen::Vector3d& p0,
+  const Eigen::Vector3d& p1)
+{
+  using namespace std::chrono_literals;
+  rmf_traffic::Trajectory trajectory;
+  trajectory.insert(start, p0, Eigen::Vector3d::Zero());
+  trajectory.insert(start + 10s, p1, Eigen::Vector3d::Zero());
+  return trajectory;
+}
+} // anonymous namespace
+
+//==============================================================================
+SCENARIO("Memoized route validator")
+{
+  using namespace std::chrono_literals;
+  using rmf_traffic::agv::planning::MemoizedRouteValidator;
+
+  const auto time = std::chrono::steady_clock::now();
+
+  GIVEN("A validator that is not for a schedule")
+  {
+    CountingValidator counter;
+    const MemoizedRouteValidator validator(&counter, 1);
+    CHECK(validator.is_current(1));
+
+    const rmf_traffic::Route route{
+      "test_map", make_line(time, {0, 0, 0}, {10, 0, 0})};
+    const rmf_traffic::Route blocked{"blocked", route.trajectory()};
+
+    CHECK_FALSE(validator.find_conflict(route));
+    CHECK_FALSE(validator.find_conflict(route));
+    CHECK(counter.count == 1);
+
+    const auto conflict = validator.find_conflict(blocked);
+    REQUIRE(conflict);
+    CHECK(conflict->participant == 7);
+    CHECK(validator.find_conflict(blocked)->participant == 7);
+    CHECK(counter.count == 2);
+
+    // A different start time is a different route
+    const rmf_traffic::Route later{
+      "test_map", make_line(time + 1s, {0, 0, 0}, {10, 0, 0})};
+    CHECK_FALSE(validator.find_conflict(later));
+    CHECK(counter.count == 3);
+
+    CHECK_FALSE(validator.is_current(2));
+  }
+
+  GIVEN("Planner options")
+  {
+    rmf_traffic::agv::Planner::Options options{
+      rmf_utils::make_clone<CountingValidator>()};
+    const auto token = rmf_traffic::agv::validator_token(options);
+    CHECK(rmf_traffic::agv::validator_token(options) == token);
+
+    // A copy has a clone of the validator, so it must not share the token
+    const auto copy = options;
+    CHECK(rmf_traffic::agv::validator_token(copy) != token);
+
+    // Neither may a new validator, wherever it happens to be allocated
+    options.validator(rmf_utils::make_clone<CountingValidator>());
+    CHECK(rmf_traffic::agv::validator_token(options) != token);
+  }
+
+  GIVEN("A schedule validator")
+  {
+    const auto profile = create_test_profile(UnitCircle);
+    const auto database = std::make_shared<rmf_traffic::schedule::Database>();
+
+    std::vector<rmf_traffic::schedule::ParticipantId> participants;
+    for (std::size_t i = 0; i < 4; ++i)
+    {
+      participants.push_back(
+        database->register_participant(
+          rmf_traffic::schedule::ParticipantDescription{
+            "participant " + std::to_string(i),
+            "test_MemoizedRouteValidator",
+            rmf_traffic::schedule::ParticipantDescription::Rx::Unresponsive,
+            profile
+          }).id());
+    }
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> place(0.0, 50.0);
+    std::uniform_int_distribution<int> when(0, 300);
+    const auto random_line = [&](const std::string& map)
+      {
+        return rmf_traffic::Route{
+          map,
+          make_line(
+            time + std::chrono::seconds(when(rng)),
+            {place(rng), place(rng), 0.0},
+            {place(rng), place(rng), 0.0})
+        };
+      };
+
+    for (std::size_t i = 0; i < participants.size(); ++i)
+    {
+      rmf_traffic::schedule::Writer::Input input;
+      for (std::size_t r = 0; r < 10; ++r)
+      {
+        input.push_back(
+          {
+            static_cast<rmf_traffic::RouteId>(r),
+            std::make_shared<rmf_traffic::Route>(
+              random_line(r%2 == 0 ? "test_map" : "other_map"))
+          });
+      }
+
+      database->set(participants[i], input, 0);
+    }
+
+    // The validator is for participant 0, so its own routes are ignored
+    const rmf_traffic::agv::ScheduleRouteValidator original(
+      database, participants[0], profile);
+    const MemoizedRouteValidator validator(&original, 1);
+
+    std::size_t conflicts = 0;
+    for (std::size_t i = 0; i < 500; ++i)
+    {
+      const auto route = random_line(i%2 == 0 ? "test_map" : "other_map");
+      const auto expected = original.find_conflict(route);
+      const auto actual = validator.find_conflict(route);
+      REQUIRE(expected.has_value() == actual.has_value());
+      if (expected)
+      {
+        ++conflicts;
+        CHECK(expected->participant != participants[0]);
+        CHECK(expected->participant == actual->participant);
+        CHECK(expected->time == actual->time);
+      }
+
+      // Asking again gives the same answer
+      CHECK(validator.find_conflict(route).has_value() == actual.has_value());
+    }
+
+    // Make sure the comparison was meaningful
+    CHECK(conflicts > 0);
+    CHECK(conflicts < 500);
+
+    CHECK(validator.is_current(1));
+    database->erase(participants[1], 1);
+    CHECK_FALSE(validator.is_current(1));
+  }
+}
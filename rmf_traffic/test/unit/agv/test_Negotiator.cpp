@@ -484,8 +484,20 @@ SCENARIO("Multi-participant negotiation")
   intentions.insert({2, NegotiationRoom::Intention{
         {time, 3, 0.0}, 1, configuration}});
 
-  auto proposal = NegotiationRoom(database, intentions, 4.0)/*.print()*/.solve();
-  REQUIRE(proposal);
+  WHEN("Tables are responded to one at a time")
+  {
+    auto proposal =
+      NegotiationRoom(database, intentions, 4.0)/*.print()*/.solve();
+    REQUIRE(proposal);
+  }
+
+  WHEN("Sibling tables are responded to in parallel")
+  {
+    auto proposal =
+      NegotiationRoom(database, intentions, 4.0).solve_in_parallel(4);
+    REQUIRE(proposal);
+    CHECK(proposal->size() == 3);
+  }
 }
 
 // Helper Definitions
@@ -16,6 +16,7 @@
 */
 
 #include <rmf_traffic/agv/Planner.hpp>
+#include <rmf_traffic/agv/debug/debug_Planner.hpp>
 #include <rmf_traffic/schedule/Database.hpp>
 
 #include <rmf_traffic/DetectConflict.hpp>
@@ -3153,3 +3154,530 @@ SCENARIO("Close start", "[close_start]")
   CHECK(visited_wps.count(5));
   CHECK(visited_wps.count(4));
 }
+
+//==============================================================================
+SCENARIO("Incremental replanning", "[incremental]")
+{
+  using namespace std::chrono_literals;
+  using Planner = rmf_traffic::agv::Planner;
+
+  auto database = std::make_shared<rmf_traffic::schedule::Database>();
+  const auto profile = create_test_profile(UnitCircle);
+
+  auto obstacle = rmf_traffic::schedule::make_participant(
+    rmf_traffic::schedule::ParticipantDescription{
+      "obstacle",
+      "test_Planner",
+      rmf_traffic::schedule::ParticipantDescription::Rx::Unresponsive,
+      profile
+    },
+    database);
+
+  const std::string test_map_name = "test_map";
+  rmf_traffic::agv::Graph graph;
+  graph.add_waypoint(test_map_name, { 0.0,  0.0}); // 0
+  graph.add_waypoint(test_map_name, {10.0,  0.0}); // 1
+  graph.add_waypoint(test_map_name, {10.0, 10.0}); // 2
+  graph.add_waypoint(test_map_name, {20.0, 10.0}); // 3
+  graph.add_waypoint(test_map_name, {20.0, 20.0}); // 4
+  graph.add_waypoint(test_map_name, {30.0, 20.0}); // 5
+  graph.add_waypoint(test_map_name, {32.0, 10.0}); // 6
+
+  /*
+   *                     4-----5
+   *                     |      \
+   *               2-----3-------6
+   *               |
+   *         0-----1
+   */
+
+  auto add_bidir_lane = [&](const std::size_t w0, const std::size_t w1)
+    {
+      graph.add_lane(w0, w1);
+      graph.add_lane(w1, w0);
+    };
+
+  add_bidir_lane(0, 1);
+  add_bidir_lane(1, 2);
+  add_bidir_lane(2, 3);
+  add_bidir_lane(3, 4);
+  add_bidir_lane(4, 5);
+  add_bidir_lane(3, 6);
+  add_bidir_lane(6, 5);
+
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4},
+    {1.0, 0.5},
+    profile
+  };
+
+  const auto time = std::chrono::steady_clock::now();
+
+  const Planner planner{
+    Planner::Configuration{graph, traits},
+    Planner::Options{
+      rmf_traffic::agv::ScheduleRouteValidator::make(
+        database, obstacle.id(), profile)
+    }
+  };
+
+  auto options = planner.get_default_options();
+  options.incremental_replanning(true);
+  CHECK(options.incremental_replanning());
+  CHECK_FALSE(planner.get_default_options().incremental_replanning());
+
+  const auto first = planner.plan(Planner::Start{time, 0, 0.0}, 5, options);
+  REQUIRE(first);
+  CHECK(first.reused_node_count() == 0);
+
+  // Find where the plan arrives at a waypoint that is partway along the route
+  std::optional<Planner::Start> middle;
+  for (const auto& wp : first->get_waypoints())
+  {
+    if (wp.graph_index() == std::size_t(2))
+    {
+      middle = Planner::Start{wp.time(), 2, wp.position()[2]};
+      break;
+    }
+  }
+  REQUIRE(middle.has_value());
+
+  WHEN("The robot has moved forward along its previous plan")
+  {
+    const auto scratch = first.replan(*middle, planner.get_default_options());
+    const auto incremental = first.replan(*middle);
+    REQUIRE(scratch);
+    REQUIRE(incremental);
+
+    CHECK(scratch.reused_node_count() == 0);
+    CHECK(incremental.reused_node_count() > 0);
+    CHECK(incremental->get_cost() == Approx(scratch->get_cost()));
+    CHECK(
+      rmf_traffic::agv::Planner::Debug::expansion_count(incremental)
+      <= rmf_traffic::agv::Planner::Debug::expansion_count(scratch));
+
+    const auto finish = incremental->get_waypoints().back();
+    CHECK(finish.graph_index() == std::size_t(5));
+  }
+
+  WHEN("The robot is running late on its previous plan")
+  {
+    Planner::Start late = *middle;
+    late.time(middle->time() + 30s);
+
+    const auto scratch = first.replan(late, planner.get_default_options());
+    const auto incremental = first.replan(late);
+    REQUIRE(scratch);
+    REQUIRE(incremental);
+
+    CHECK(incremental.reused_node_count() > 0);
+    CHECK(incremental->get_cost() == Approx(scratch->get_cost()));
+    CHECK(
+      incremental->get_itinerary().back().trajectory().back().time()
+      == scratch->get_itinerary().back().trajectory().back().time());
+  }
+
+  WHEN("An obstacle appears on the rest of the previous plan")
+  {
+    // Park the obstacle on waypoint 4 for the whole time that the robot would
+    // be travelling.
+    rmf_traffic::Trajectory t_obs;
+    t_obs.insert(time, {20.0, 20.0, 0.0}, {0.0, 0.0, 0.0});
+    t_obs.insert(time + 10min, {20.0, 20.0, 0.0}, {0.0, 0.0, 0.0});
+    obstacle.set({{test_map_name, t_obs}});
+
+    const auto scratch = first.replan(*middle, planner.get_default_options());
+    const auto incremental = first.replan(*middle);
+    REQUIRE(scratch);
+    REQUIRE(incremental);
+
+    CHECK(incremental->get_cost() == Approx(scratch->get_cost()));
+
+    for (const auto& wp : incremental->get_waypoints())
+      CHECK(wp.graph_index() != std::size_t(4));
+  }
+}
+
+//==============================================================================
+SCENARIO("Plan in parallel", "[parallel]")
+{
+  using namespace std::chrono_literals;
+  using Planner = rmf_traffic::agv::Planner;
+
+  const std::string test_map_name = "test_map";
+  const std::size_t N = 8;
+  rmf_traffic::agv::Graph graph;
+  for (std::size_t i = 0; i < N; ++i)
+  {
+    for (std::size_t j = 0; j < N; ++j)
+      graph.add_waypoint(test_map_name, {5.0*i, 5.0*j});
+  }
+
+  for (std::size_t i = 0; i < N; ++i)
+  {
+    for (std::size_t j = 0; j < N; ++j)
+    {
+      const std::size_t wp = i*N + j;
+      if (i+1 < N)
+      {
+        graph.add_lane(wp, wp + N);
+        graph.add_lane(wp + N, wp);
+      }
+
+      if (j+1 < N)
+      {
+        graph.add_lane(wp, wp + 1);
+        graph.add_lane(wp + 1, wp);
+      }
+    }
+  }
+
+  const auto profile = create_test_profile(UnitCircle);
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4},
+    {1.0, 0.5},
+    profile
+  };
+
+  auto database = std::make_shared<rmf_traffic::schedule::Database>();
+  auto obstacle = rmf_traffic::schedule::make_participant(
+    rmf_traffic::schedule::ParticipantDescription{
+      "obstacle",
+      "test_Planner",
+      rmf_traffic::schedule::ParticipantDescription::Rx::Unresponsive,
+      profile
+    },
+    database);
+
+  const auto time = std::chrono::steady_clock::now();
+  rmf_traffic::Trajectory t_obs;
+  t_obs.insert(time, {15.0, 15.0, 0.0}, {0.0, 0.0, 0.0});
+  t_obs.insert(time + 10min, {15.0, 15.0, 0.0}, {0.0, 0.0, 0.0});
+  obstacle.set({{test_map_name, t_obs}});
+
+  const Planner planner{
+    Planner::Configuration{graph, traits},
+    Planner::Options{
+      rmf_traffic::agv::ScheduleRouteValidator::make(
+        database, std::numeric_limits<std::size_t>::max(), profile)
+    }
+  };
+
+  const Planner::StartSet starts = {Planner::Start{time, 0, 0.0}};
+  std::vector<Planner::Problem> problems;
+  for (const std::size_t goal : {63, 36, 27, 45, 9, 54, 18})
+    problems.push_back({starts, goal, planner.get_default_options()});
+
+  // Two problems with the same cost, so the earlier one needs to win
+  problems.push_back({starts, 9, planner.get_default_options()});
+
+  std::vector<double> costs;
+  for (const auto& problem : problems)
+  {
+    const auto result =
+      planner.plan(problem.starts, problem.goal, problem.options);
+    REQUIRE(result);
+    costs.push_back(result->get_cost());
+  }
+
+  std::size_t expected_best = 0;
+  for (std::size_t i = 1; i < costs.size(); ++i)
+  {
+    if (costs[i] < costs[expected_best])
+      expected_best = i;
+  }
+  REQUIRE(expected_best == 4);
+
+  for (const std::size_t threads : {1, 2, 8})
+  {
+    for (std::size_t attempt = 0; attempt < 5; ++attempt)
+    {
+      auto output = planner.plan_in_parallel(problems, threads);
+      REQUIRE(output.results.size() == problems.size());
+      REQUIRE(output.best.has_value());
+      CHECK(*output.best == expected_best);
+
+      const auto& best = output.results[*output.best];
+      REQUIRE(best);
+      CHECK(best->get_cost() == Approx(costs[expected_best]));
+
+      for (std::size_t i = 0; i < problems.size(); ++i)
+      {
+        auto& result = output.results[i];
+        if (!result.success())
+        {
+          // Anything that was cancelled can be finished later
+          CHECK(result.interrupted());
+          CHECK(result.resume());
+        }
+
+        CHECK(result->get_cost() == Approx(costs[i]));
+      }
+    }
+  }
+
+  WHEN("There are no problems")
+  {
+    const auto output = planner.plan_in_parallel({});
+    CHECK(output.results.empty());
+    CHECK_FALSE(output.best.has_value());
+  }
+
+  WHEN("The starts of a plan are searched in parallel")
+  {
+    const Planner::StartSet several_starts = {
+      Planner::Start{time, 0, 0.0},
+      Planner::Start{time, 9, 0.0},
+      Planner::Start{time, 18, 0.0}
+    };
+
+    const auto serial = planner.plan(several_starts, 63);
+    REQUIRE(serial);
+
+    for (const std::size_t threads : {1, 2, 8})
+    {
+      auto options = planner.get_default_options();
+      options.parallel_starts(threads);
+
+      const auto parallel = planner.plan(several_starts, 63, options);
+      REQUIRE(parallel);
+      CHECK(parallel->get_cost() == Approx(serial->get_cost()));
+      CHECK(parallel->get_start().waypoint() == serial->get_start().waypoint());
+      CHECK(parallel.get_starts().size() == 1);
+    }
+  }
+}
+
+//==============================================================================
+SCENARIO("Heuristic cache budget", "[heuristic_cache]")
+{
+  using Planner = rmf_traffic::agv::Planner;
+
+  const std::string test_map_name = "test_map";
+  const std::size_t N = 6;
+  rmf_traffic::agv::Graph graph;
+  for (std::size_t i = 0; i < N; ++i)
+  {
+    for (std::size_t j = 0; j < N; ++j)
+      graph.add_waypoint(test_map_name, {5.0*i, 5.0*j});
+  }
+
+  for (std::size_t i = 0; i < N; ++i)
+  {
+    for (std::size_t j = 0; j < N; ++j)
+    {
+      const std::size_t wp = i*N + j;
+      if (i+1 < N)
+      {
+        graph.add_lane(wp, wp + N);
+        graph.add_lane(wp + N, wp);
+      }
+
+      if (j+1 < N)
+      {
+        graph.add_lane(wp, wp + 1);
+        graph.add_lane(wp + 1, wp);
+      }
+    }
+  }
+
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4},
+    {1.0, 0.5},
+    create_test_profile(UnitCircle)
+  };
+
+  const Planner unlimited{
+    Planner::Configuration{graph, traits},
+    Planner::Options{nullptr}
+  };
+
+  const Planner limited{
+    Planner::Configuration{graph, traits}.heuristic_cache_budget(4000),
+    Planner::Options{nullptr}
+  };
+
+  const auto time = std::chrono::steady_clock::now();
+  for (std::size_t goal = 0; goal < N*N; goal += 5)
+  {
+    const auto expected = unlimited.plan({time, 0, 0.0}, goal);
+    const auto actual = limited.plan({time, 0, 0.0}, goal);
+    REQUIRE(expected);
+    REQUIRE(actual);
+    CHECK(actual->get_cost() == Approx(expected->get_cost()));
+  }
+
+  const auto unlimited_stats = unlimited.heuristic_cache_statistics();
+  const auto limited_stats = limited.heuristic_cache_statistics();
+  REQUIRE(unlimited_stats.layers.size() == 4);
+  REQUIRE(limited_stats.layers.size() == 4);
+  CHECK(unlimited_stats.layers.front().name == "differential_drive");
+
+  std::size_t unlimited_evictions = 0;
+  std::size_t limited_evictions = 0;
+  for (std::size_t i = 0; i < 4; ++i)
+  {
+    unlimited_evictions += unlimited_stats.layers[i].evicted_tables;
+    limited_evictions += limited_stats.layers[i].evicted_tables;
+    CHECK(unlimited_stats.layers[i].misses > 0);
+  }
+
+  CHECK(unlimited_evictions == 0);
+  CHECK(limited_evictions > 0);
+  CHECK(limited_stats.estimated_bytes < unlimited_stats.estimated_bytes);
+}
+
+//==============================================================================
+SCENARIO("Search statistics", "[statistics]")
+{
+  using namespace std::chrono_literals;
+  using Planner = rmf_traffic::agv::Planner;
+
+  auto database = std::make_shared<rmf_traffic::schedule::Database>();
+  const auto profile = create_test_profile(UnitCircle);
+
+  auto obstacle = rmf_traffic::schedule::make_participant(
+    rmf_traffic::schedule::ParticipantDescription{
+      "obstacle",
+      "test_Planner",
+      rmf_traffic::schedule::ParticipantDescription::Rx::Unresponsive,
+      profile
+    },
+    database);
+
+  const std::string test_map_name = "test_map";
+  const std::size_t N = 5;
+  rmf_traffic::agv::Graph graph;
+  for (std::size_t i = 0; i < N; ++i)
+  {
+    for (std::size_t j = 0; j < N; ++j)
+      graph.add_waypoint(test_map_name, {5.0*i, 5.0*j});
+  }
+
+  for (std::size_t i = 0; i < N; ++i)
+  {
+    for (std::size_t j = 0; j < N; ++j)
+    {
+      const std::size_t wp = i*N + j;
+      if (i+1 < N)
+      {
+        graph.add_lane(wp, wp + N);
+        graph.add_lane(wp + N, wp);
+      }
+
+      if (j+1 < N)
+      {
+        graph.add_lane(wp, wp + 1);
+        graph.add_lane(wp + 1, wp);
+      }
+    }
+  }
+
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4},
+    {1.0, 0.5},
+    profile
+  };
+
+  const auto time = std::chrono::steady_clock::now();
+
+  // The obstacle sits in the middle of the grid for a while
+  rmf_traffic::Trajectory obstacle_trajectory;
+  obstacle_trajectory.insert(time, {10.0, 10.0, 0.0}, {0.0, 0.0, 0.0});
+  obstacle_trajectory.insert(time + 30s, {10.0, 10.0, 0.0}, {0.0, 0.0, 0.0});
+  obstacle.set({{test_map_name, obstacle_trajectory}});
+
+  const Planner planner{
+    Planner::Configuration{graph, traits},
+    Planner::Options{
+      rmf_traffic::agv::ScheduleRouteValidator::make(
+        database, std::numeric_limits<std::size_t>::max(), profile)
+    }
+  };
+
+  const Planner::Start start{time, 0, 0.0};
+  const std::size_t goal = N*N - 1;
+
+  CHECK_FALSE(planner.get_default_options().collect_statistics());
+  const auto plain = planner.plan(start, goal);
+  REQUIRE(plain);
+  CHECK_FALSE(plain.statistics());
+
+  auto options = planner.get_default_options();
+  options.collect_statistics(true);
+
+  WHEN("A search is set up and then resumed")
+  {
+    const auto result = planner.setup(start, goal, options);
+    const auto* setup_stats = result.statistics();
+    REQUIRE(setup_stats);
+    CHECK(setup_stats->expanded_nodes == 0);
+    CHECK(setup_stats->queued_nodes > 0);
+    CHECK(setup_stats->setup_time > rmf_traffic::Duration(0));
+
+    // The heuristics of the plain plan are already cached
+    REQUIRE(setup_stats->heuristic_lookups.size() == 4);
+    CHECK(setup_stats->heuristic_lookups[0].hits > 0);
+    CHECK(setup_stats->heuristic_lookups[0].misses == 0);
+
+    auto resumed = result;
+    CHECK(resumed.resume());
+    const auto* stats = resumed.statistics();
+    REQUIRE(stats);
+    CHECK(stats->expanded_nodes
+      == Planner::Debug::expansion_count(resumed));
+    CHECK(stats->queued_nodes == Planner::Debug::queue_size(resumed));
+    CHECK(stats->validator_calls > 0);
+    CHECK(stats->search_time > rmf_traffic::Duration(0));
+
+    // The plan has the same cost as the one without statistics
+    CHECK(resumed->get_cost() == Approx(plain->get_cost()));
+
+    const auto cache_stats = planner.heuristic_cache_statistics();
+    REQUIRE(cache_stats.layers.size() == stats->heuristic_lookups.size());
+    for (std::size_t i = 0; i < cache_stats.layers.size(); ++i)
+    {
+      CHECK(stats->heuristic_lookups[i].name == cache_stats.layers[i].name);
+      CHECK(stats->heuristic_lookups[i].hits
+        <= cache_stats.layers[i].hits);
+    }
+  }
+
+  WHEN("A fresh planner is used")
+  {
+    const Planner fresh{
+      Planner::Configuration{graph, traits},
+      options
+    };
+
+    const auto first = fresh.plan(start, goal);
+    REQUIRE(first);
+    const auto* first_stats = first.statistics();
+    REQUIRE(first_stats);
+    for (const auto& layer : first_stats->heuristic_lookups)
+      CHECK(layer.misses > 0);
+
+    CHECK(first_stats->traversal_generations > 0);
+
+    // Nothing new needs to be computed for the same plan a second time
+    const auto second = fresh.plan(start, goal);
+    REQUIRE(second);
+    const auto* second_stats = second.statistics();
+    REQUIRE(second_stats);
+    CHECK(second_stats->heuristic_lookups[0].misses == 0);
+    CHECK(second_stats->heuristic_lookups[0].hits > 0);
+    CHECK(second_stats->traversal_generations == 0);
+    CHECK(second_stats->expanded_nodes == first_stats->expanded_nodes);
+    CHECK(second_stats->validator_calls == first_stats->validator_calls);
+  }
+
+  WHEN("There is no validator")
+  {
+    options.validator(nullptr);
+    const auto result = planner.plan(start, goal, options);
+    REQUIRE(result);
+    REQUIRE(result.statistics());
+    CHECK(result.statistics()->validator_calls == 0);
+    CHECK(result.statistics()->validator_time == rmf_traffic::Duration(0));
+  }
+}
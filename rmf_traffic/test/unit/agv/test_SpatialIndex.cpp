@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <src/rmf_traffic/agv/internal_Graph.hpp>
+
+#include <rmf_utils/catch.hpp>
+
+#include <random>
+
+namespace {
+//==============================================================================
+/// Two maps with the same randomly scattered waypoints and random lanes
+/// between them, plus a few lanes that go between the maps.
+rmf_traffic::agv::Graph make_random_graph(std::mt19937& rng)
+{
+  rmf_traffic::agv::Graph graph;
+  const std::size_t N = 200;
+  for (const std::string map : {"test_SpatialIndex_L1", "test_SpatialIndex_L2"})
+  {
+    for (std::size_t i = 0; i < N; ++i)
+    {
+      const double x = static_cast<double>(rng() % 10000)/100.0;
+      const double y = static_cast<double>(rng() % 10000)/100.0;
+      graph.add_waypoint(map, {x, y});
+    }
+  }
+
+  for (std::size_t i = 0; i < 3*N; ++i)
+  {
+    const std::size_t offset = (i % 2)*N;
+    graph.add_lane(offset + rng() % N, offset + rng() % N);
+  }
+
+  for (std::size_t i = 0; i < 10; ++i)
+    graph.add_lane(rng() % N, N + rng() % N);
+
+  return graph;
+}
+
+//==============================================================================
+double distance_to_lane(
+  const rmf_traffic::agv::Graph& graph,
+  const std::size_t lane_index,
+  const Eigen::Vector2d& p)
+{
+  const auto& lane = graph.get_lane(lane_index);
+  const Eigen::Vector2d p0 =
+    graph.get_waypoint(lane.entry().waypoint_index()).get_location();
+  const Eigen::Vector2d p1 =
+    graph.get_waypoint(lane.exit().waypoint_index()).get_location();
+
+  const double length = (p1 - p0).norm();
+  if (length < 1e-8)
+    return (p - p0).norm();
+
+  const Eigen::Vector2d n = (p1 - p0)/length;
+  const double s = std::max(0.0, std::min(length, (p - p0).dot(n)));
+  return (p - (p0 + s*n)).norm();
+}
+} // anonymous namespace
+
+//==============================================================================
+SCENARIO("Spatial index of a graph")
+{
+  using rmf_traffic::MapId;
+  using Graph = rmf_traffic::agv::Graph;
+
+  std::mt19937 rng(12345);
+  auto graph = make_random_graph(rng);
+  const auto index = Graph::Implementation::get(graph).get_spatial_index();
+  const MapId L1 = MapId::intern("test_SpatialIndex_L1");
+  const MapId L2 = MapId::intern("test_SpatialIndex_L2");
+
+  const auto on_map = [&graph](const std::size_t wp, const MapId map)
+    {
+      return Graph::Waypoint::Implementation::get(
+        graph.get_waypoint(wp)).map_id == map;
+    };
+
+  for (std::size_t trial = 0; trial < 100; ++trial)
+  {
+    const Eigen::Vector2d p{
+      static_cast<double>(rng() % 12000)/100.0 - 10.0,
+      static_cast<double>(rng() % 12000)/100.0 - 10.0};
+    const double radius = static_cast<double>(rng() % 2000)/100.0;
+    const MapId map = trial % 2 == 0 ? L1 : L2;
+
+    std::vector<std::size_t> expected_waypoints;
+    std::optional<std::size_t> expected_nearest;
+    std::optional<std::size_t> expected_nearest_even;
+    for (std::size_t i = 0; i < graph.num_waypoints(); ++i)
+    {
+      if (!on_map(i, map))
+        continue;
+
+      const double dist = (graph.get_waypoint(i).get_location() - p).norm();
+      if (dist < radius)
+        expected_waypoints.push_back(i);
+
+      const auto closer = [&](const std::optional<std::size_t>& current)
+        {
+          return !current || dist < (graph.get_waypoint(*current)
+            .get_location() - p).norm();
+        };
+
+      if (closer(expected_nearest))
+        expected_nearest = i;
+
+      if (i % 2 == 0 && closer(expected_nearest_even))
+        expected_nearest_even = i;
+    }
+
+    CHECK(index->waypoints_within(map, p, radius) == expected_waypoints);
+    CHECK(index->nearest_waypoint(map, p) == expected_nearest);
+    CHECK(index->nearest_waypoint(
+        map, p, [](std::size_t wp) { return wp % 2 == 0; })
+      == expected_nearest_even);
+
+    const auto near_lanes = index->lanes_near(map, p, radius);
+    CHECK(std::is_sorted(near_lanes.begin(), near_lanes.end()));
+    for (std::size_t i = 0; i < graph.num_lanes(); ++i)
+    {
+      const auto& lane = graph.get_lane(i);
+      const bool lane_on_map = on_map(lane.entry().waypoint_index(), map)
+        && on_map(lane.exit().waypoint_index(), map);
+
+      const bool found =
+        std::binary_search(near_lanes.begin(), near_lanes.end(), i);
+
+      // Lanes between maps are never returned
+      if (!lane_on_map)
+        CHECK_FALSE(found);
+      // Every lane that is close enough must be returned
+      else if (distance_to_lane(graph, i, p) < radius)
+        CHECK(found);
+    }
+  }
+
+  WHEN("A waypoint is moved through a reference")
+  {
+    auto& wp = graph.get_waypoint(3);
+    const Eigen::Vector2d far_away{1000.0, 1000.0};
+    CHECK(graph.find_nearest_waypoint(wp.get_map_name(), far_away) != 3);
+
+    wp.set_location(far_away);
+    CHECK(graph.find_nearest_waypoint(wp.get_map_name(), far_away) == 3);
+
+    wp.set_map_name("test_SpatialIndex_L3");
+    CHECK(graph.find_nearest_waypoint("test_SpatialIndex_L3", far_away) == 3);
+    CHECK(graph.find_nearest_waypoint("test_SpatialIndex_L1", far_away) != 3);
+  }
+
+  WHEN("A waypoint is added")
+  {
+    const Eigen::Vector2d far_away{-1000.0, -1000.0};
+    const std::size_t wp =
+      graph.add_waypoint("test_SpatialIndex_L1", far_away).index();
+    CHECK(graph.find_nearest_waypoint("test_SpatialIndex_L1", far_away) == wp);
+  }
+
+  WHEN("A copy of the graph is changed")
+  {
+    const Eigen::Vector2d far_away{1000.0, -1000.0};
+    CHECK(graph.find_nearest_waypoint("test_SpatialIndex_L1", far_away) != 0);
+
+    auto copy = graph;
+    copy.get_waypoint(0).set_location(far_away);
+    CHECK(copy.find_nearest_waypoint("test_SpatialIndex_L1", far_away) == 0);
+    CHECK(graph.find_nearest_waypoint("test_SpatialIndex_L1", far_away) != 0);
+
+    // Changing the original after the copy must not affect the copy either
+    graph.get_waypoint(1).set_location(far_away + Eigen::Vector2d(1.0, 0.0));
+    CHECK(copy.find_nearest_waypoint("test_SpatialIndex_L1", far_away) == 0);
+    CHECK(graph.find_nearest_waypoint("test_SpatialIndex_L1", far_away) == 1);
+  }
+
+  WHEN("The map has never been seen")
+  {
+    CHECK_FALSE(graph.find_nearest_waypoint(
+        "test_SpatialIndex_never_seen", {0.0, 0.0}).has_value());
+  }
+
+  WHEN("A filter is given")
+  {
+    const auto nearest = graph.find_nearest_waypoint(
+      "test_SpatialIndex_L2", {50.0, 50.0},
+      [](const Graph::Waypoint& wp) { return wp.index() % 7 == 0; });
+    REQUIRE(nearest.has_value());
+    CHECK(*nearest % 7 == 0);
+    CHECK(on_map(*nearest, L2));
+  }
+}
@@ -25,6 +25,7 @@
 
 #include <rmf_utils/catch.hpp>
 
+#include <algorithm>
 #include <unordered_map>
 #include <future>
 #include <iostream>
@@ -273,6 +274,75 @@ public:
       rmf_traffic::schedule::QuickestFinishEvaluator())->proposal();
   }
 
+  /// Solve the negotiation by responding to every table that is waiting for a
+  /// response at the same time, using Negotiator::respond_in_parallel.
+  rmf_utils::optional<Negotiation::Proposal> solve_in_parallel(
+    const std::size_t num_threads = 0)
+  {
+    using Request = rmf_traffic::schedule::Negotiator::Request;
+
+    std::vector<Negotiation::TablePtr> queue;
+    for (const auto& p : negotiation->participants())
+      queue.push_back(negotiation->table(p, {}));
+
+    // Like solve(), we only revisit rejected tables once everything else has
+    // been tried.
+    std::vector<Negotiation::TablePtr> rejected;
+
+    while ((!queue.empty() || !rejected.empty()) && !negotiation->ready())
+    {
+      if (queue.empty())
+        queue.swap(rejected);
+
+      std::vector<Negotiation::TablePtr> batch;
+      std::vector<Request> requests;
+      for (const auto& table : queue)
+      {
+        if (skip(table))
+          continue;
+
+        if (std::find(batch.begin(), batch.end(), table) != batch.end())
+          continue;
+
+        batch.push_back(table);
+        requests.push_back(
+          Request{
+            &negotiators.at(table->participant()),
+            table->viewer(),
+            Responder::make(table)
+          });
+      }
+      queue.clear();
+
+      rmf_traffic::schedule::Negotiator::respond_in_parallel(
+        requests, num_threads);
+
+      for (const auto& table : batch)
+      {
+        if (table->submission())
+        {
+          for (const auto& n : negotiators)
+          {
+            if (const auto respond_to = table->respond(n.first))
+              queue.push_back(respond_to);
+          }
+
+          continue;
+        }
+
+        const auto parent = table->parent();
+        if (parent && parent->rejected())
+          rejected.push_back(parent);
+      }
+    }
+
+    if (!negotiation->ready())
+      return rmf_utils::nullopt;
+
+    return negotiation->evaluate(
+      rmf_traffic::schedule::QuickestFinishEvaluator())->proposal();
+  }
+
   static std::unordered_map<ParticipantId, Negotiator> make_negotiators(
     const std::unordered_map<ParticipantId, Intention>& intentions,
     double maximum_cost_leeway,
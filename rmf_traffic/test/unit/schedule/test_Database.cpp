@@ -26,6 +26,9 @@
 
 #include <rmf_utils/catch.hpp>
 
+#include <thread>
+#include <unordered_set>
+
 using namespace std::chrono_literals;
 
 SCENARIO("Test Database Conflicts")
@@ -301,3 +304,532 @@ SCENARIO("Test Database Conflicts")
     }
   }
 }
+
+SCENARIO("Test Database region queries on a spread out schedule")
+{
+  rmf_traffic::schedule::Database db;
+
+  const rmf_traffic::Time time = std::chrono::steady_clock::now();
+  const auto shape = rmf_traffic::geometry::make_final_convex<
+    rmf_traffic::geometry::Circle>(0.5);
+  const rmf_traffic::Profile profile{shape};
+
+  // Lay out one participant per row, with each row 20m apart so that every
+  // route lands in different cells of the schedule's spatial index.
+  const std::size_t num_participants = 10;
+  const double row_spacing = 20.0;
+  std::vector<rmf_traffic::schedule::ParticipantId> participants;
+  for (std::size_t i = 0; i < num_participants; ++i)
+  {
+    const auto p = db.register_participant(
+      rmf_traffic::schedule::ParticipantDescription{
+        "participant_" + std::to_string(i),
+        "test_Database",
+        rmf_traffic::schedule::ParticipantDescription::Rx::Responsive,
+        profile
+      });
+
+    const double y = row_spacing * static_cast<double>(i);
+    rmf_traffic::Trajectory t;
+    t.insert(time, Eigen::Vector3d{-5, y, 0}, Eigen::Vector3d{0, 0, 0});
+    t.insert(time + 10s, Eigen::Vector3d{5, y, 0}, Eigen::Vector3d{0, 0, 0});
+    db.set(p.id(), create_test_input(0, t), 0);
+
+    participants.push_back(p.id());
+  }
+
+  const auto region_shape = rmf_traffic::geometry::make_final_convex<
+    rmf_traffic::geometry::Box>(4.0, 4.0);
+
+  const auto make_region_query = [&](
+    const double y, const std::string& map = "test_map")
+    {
+      Eigen::Isometry2d tf = Eigen::Isometry2d::Identity();
+      tf.translate(Eigen::Vector2d{0.0, y});
+
+      return rmf_traffic::schedule::make_query(
+        {
+          rmf_traffic::Region{
+            map, time, time + 10s,
+            {rmf_traffic::geometry::Space{region_shape, tf}}
+          }
+        });
+    };
+
+  CHECK_TRAJECTORY_COUNT(db, num_participants, num_participants);
+
+  for (std::size_t i = 0; i < num_participants; ++i)
+  {
+    const auto view = db.query(
+      make_region_query(row_spacing * static_cast<double>(i)));
+    REQUIRE(view.size() == 1);
+    CHECK(view.begin()->participant == participants[i]);
+  }
+
+  // A region in between the rows should not find anything
+  CHECK(db.query(make_region_query(0.5 * row_spacing)).size() == 0);
+
+  // A region on a map that nobody is using should not find anything
+  CHECK(db.query(make_region_query(0.0, "other_map")).size() == 0);
+
+  WHEN("A route is delayed out of the time window of the region")
+  {
+    db.delay(participants[3], 1min, 1);
+    CHECK(db.query(make_region_query(3 * row_spacing)).size() == 0);
+
+    const auto view = db.query(make_region_query(4 * row_spacing));
+    REQUIRE(view.size() == 1);
+    CHECK(view.begin()->participant == participants[4]);
+  }
+
+  WHEN("A route is moved into a different row")
+  {
+    rmf_traffic::Trajectory t;
+    t.insert(time, Eigen::Vector3d{-5, 0, 0}, Eigen::Vector3d{0, 0, 0});
+    t.insert(time + 10s, Eigen::Vector3d{5, 0, 0}, Eigen::Vector3d{0, 0, 0});
+    db.set(participants[5], create_test_input(1, t), 1);
+
+    CHECK(db.query(make_region_query(5 * row_spacing)).size() == 0);
+    CHECK(db.query(make_region_query(0.0)).size() == 2);
+  }
+
+  WHEN("A route is erased")
+  {
+    db.erase(participants[7], 1);
+    CHECK(db.query(make_region_query(7 * row_spacing)).size() == 0);
+    CHECK_TRAJECTORY_COUNT(db, num_participants, num_participants - 1);
+  }
+
+  WHEN("The schedule is culled")
+  {
+    db.cull(time + 1min);
+    CHECK_TRAJECTORY_COUNT(db, num_participants, 0);
+    for (std::size_t i = 0; i < num_participants; ++i)
+    {
+      CHECK(db.query(
+          make_region_query(row_spacing * static_cast<double>(i))).size() == 0);
+    }
+  }
+}
+
+SCENARIO("Test Database region queries on segments that cover many cells")
+{
+  rmf_traffic::schedule::Database db;
+
+  const rmf_traffic::Time time = std::chrono::steady_clock::now();
+  const auto shape = rmf_traffic::geometry::make_final_convex<
+    rmf_traffic::geometry::Circle>(0.5);
+  const rmf_traffic::Profile profile{shape};
+
+  const auto register_participant = [&](const std::string& name)
+    {
+      return db.register_participant(
+        rmf_traffic::schedule::ParticipantDescription{
+          name,
+          "test_Database",
+          rmf_traffic::schedule::ParticipantDescription::Rx::Responsive,
+          profile
+        });
+    };
+
+  // This segment spans so much space that it would take far too long to put
+  // it into each of the cells that it covers.
+  const auto huge = register_participant("huge");
+  rmf_traffic::Trajectory huge_t;
+  huge_t.insert(
+    time, Eigen::Vector3d{-1e12, -1e12, 0}, Eigen::Vector3d{0, 0, 0});
+  huge_t.insert(
+    time + 10s, Eigen::Vector3d{1e12, 1e12, 0}, Eigen::Vector3d{0, 0, 0});
+  db.set(huge.id(), create_test_input(0, huge_t), 0);
+
+  // This segment covers more cells than a single segment is allowed to, but
+  // is otherwise unremarkable.
+  const auto long_diagonal = register_participant("long_diagonal");
+  rmf_traffic::Trajectory long_t;
+  long_t.insert(time, Eigen::Vector3d{0, 0, 0}, Eigen::Vector3d{0, 0, 0});
+  long_t.insert(
+    time + 10s, Eigen::Vector3d{500, 500, 0}, Eigen::Vector3d{0, 0, 0});
+  db.set(long_diagonal.id(), create_test_input(0, long_t), 0);
+
+  const auto region_shape = rmf_traffic::geometry::make_final_convex<
+    rmf_traffic::geometry::Box>(4.0, 4.0);
+
+  const auto make_region_query = [&](const Eigen::Vector2d& p)
+    {
+      Eigen::Isometry2d tf = Eigen::Isometry2d::Identity();
+      tf.translate(p);
+
+      return rmf_traffic::schedule::make_query(
+        {
+          rmf_traffic::Region{
+            "test_map", time, time + 10s,
+            {rmf_traffic::geometry::Space{region_shape, tf}}
+          }
+        });
+    };
+
+  using Participants =
+    std::unordered_set<rmf_traffic::schedule::ParticipantId>;
+
+  const auto participants_in = [&](const Eigen::Vector2d& p)
+    {
+      Participants output;
+      for (const auto& element : db.query(make_region_query(p)))
+        output.insert(element.participant);
+
+      return output;
+    };
+
+  CHECK_TRAJECTORY_COUNT(db, 2, 2);
+
+  // Both segments pass through the middle of the map
+  CHECK(participants_in({250, 250})
+    == Participants{huge.id(), long_diagonal.id()});
+
+  // Only the huge segment goes this far out
+  CHECK(participants_in({1e6, 1e6}) == Participants{huge.id()});
+
+  // Neither of the segments pass anywhere near here, even though they are both
+  // in the overflow timeline of the map
+  CHECK(participants_in({250, -250}).empty());
+
+  WHEN("The long segment is replaced by one that fits in the grid")
+  {
+    rmf_traffic::Trajectory t;
+    t.insert(time, Eigen::Vector3d{0, 0, 0}, Eigen::Vector3d{0, 0, 0});
+    t.insert(time + 10s, Eigen::Vector3d{5, 0, 0}, Eigen::Vector3d{0, 0, 0});
+    db.set(long_diagonal.id(), create_test_input(1, t), 1);
+
+    CHECK(participants_in({250, 250}) == Participants{huge.id()});
+    CHECK(participants_in({0, 0})
+      == Participants{huge.id(), long_diagonal.id()});
+  }
+
+  WHEN("The schedule is culled")
+  {
+    db.cull(time + 1min);
+    CHECK_TRAJECTORY_COUNT(db, 2, 0);
+    CHECK(participants_in({250, 250}).empty());
+    CHECK(participants_in({1e6, 1e6}).empty());
+  }
+}
+
+SCENARIO("Test Database snapshots")
+{
+  rmf_traffic::schedule::Database db;
+
+  const rmf_traffic::Time time = std::chrono::steady_clock::now();
+  const auto shape = rmf_traffic::geometry::make_final_convex<
+    rmf_traffic::geometry::Circle>(0.5);
+  const rmf_traffic::Profile profile{shape};
+
+  std::vector<rmf_traffic::schedule::ParticipantId> participants;
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    const auto p = db.register_participant(
+      rmf_traffic::schedule::ParticipantDescription{
+        "participant_" + std::to_string(i),
+        "test_Database",
+        rmf_traffic::schedule::ParticipantDescription::Rx::Responsive,
+        profile
+      });
+
+    const double y = 20.0 * static_cast<double>(i);
+    rmf_traffic::Trajectory t;
+    t.insert(time, Eigen::Vector3d{-5, y, 0}, Eigen::Vector3d{0, 0, 0});
+    t.insert(time + 10s, Eigen::Vector3d{5, y, 0}, Eigen::Vector3d{0, 0, 0});
+    db.set(p.id(), create_test_input(0, t), 0);
+
+    participants.push_back(p.id());
+  }
+
+  const auto query_all = rmf_traffic::schedule::query_all();
+
+  const auto snapshot = db.snapshot();
+  CHECK(snapshot->latest_version() == db.latest_version());
+  CHECK(snapshot->query(query_all).size() == 3);
+
+  // Taking another snapshot without changing the database gives back the
+  // same snapshot
+  CHECK(db.snapshot() == snapshot);
+
+  WHEN("A route is added to the database")
+  {
+    rmf_traffic::Trajectory t;
+    t.insert(time, Eigen::Vector3d{-5, 0, 0}, Eigen::Vector3d{0, 0, 0});
+    t.insert(time + 20s, Eigen::Vector3d{5, 0, 0}, Eigen::Vector3d{0, 0, 0});
+    db.extend(participants[0], create_test_input(1, t), 1);
+
+    const auto new_snapshot = db.snapshot();
+    CHECK(new_snapshot != snapshot);
+    CHECK(new_snapshot->query(query_all).size() == 4);
+    CHECK(snapshot->query(query_all).size() == 3);
+  }
+
+  WHEN("A route is erased from the database")
+  {
+    db.erase(participants[1], 1);
+
+    const auto new_snapshot = db.snapshot();
+    CHECK(new_snapshot != snapshot);
+    CHECK(new_snapshot->query(query_all).size() == 2);
+  }
+
+  WHEN("The database is culled")
+  {
+    db.cull(time + 1min);
+
+    const auto new_snapshot = db.snapshot();
+    CHECK(new_snapshot->query(query_all).size() == 0);
+    CHECK(snapshot->query(query_all).size() == 3);
+  }
+
+  WHEN("Long routes are changed between snapshots")
+  {
+    // These routes span many chunks of the timeline, so each snapshot should
+    // only refreeze the chunks that they touch
+    const auto count_in_window = [&](
+      const rmf_traffic::schedule::Viewer& viewer,
+      const rmf_traffic::Time lower,
+      const rmf_traffic::Time upper)
+      {
+        const auto query = rmf_traffic::schedule::make_query(
+          {"test_map"}, &lower, &upper);
+
+        return viewer.query(query).size();
+      };
+
+    for (std::size_t i = 0; i < participants.size(); ++i)
+    {
+      const auto start = time + std::chrono::hours(i);
+      rmf_traffic::Trajectory t;
+      t.insert(start, Eigen::Vector3d{-5, 0, 0}, Eigen::Vector3d{0, 0, 0});
+      t.insert(start + 3h, Eigen::Vector3d{5, 0, 0}, Eigen::Vector3d{0, 0, 0});
+      db.set(participants[i], create_test_input(1, t), 1);
+    }
+
+    const auto long_snapshot = db.snapshot();
+    CHECK(long_snapshot->query(query_all).size() == 3);
+    CHECK(count_in_window(*long_snapshot, time + 30min, time + 40min) == 1);
+    CHECK(count_in_window(*long_snapshot, time + 150min, time + 170min) == 3);
+    CHECK(count_in_window(*long_snapshot, time + 290min, time + 300min) == 1);
+    CHECK(count_in_window(*long_snapshot, time + 6h, time + 7h) == 0);
+
+    db.erase(participants[1], 2);
+
+    const auto erased_snapshot = db.snapshot();
+    CHECK(erased_snapshot->query(query_all).size() == 2);
+    CHECK(count_in_window(*erased_snapshot, time + 70min, time + 80min) == 1);
+    CHECK(count_in_window(*erased_snapshot, time + 150min, time + 170min) == 2);
+
+    db.cull(time + 90min);
+
+    const auto culled_snapshot = db.snapshot();
+    CHECK(culled_snapshot->query(query_all).size() == 2);
+    CHECK(count_in_window(*culled_snapshot, time + 100min, time + 110min) == 1);
+    CHECK(count_in_window(*culled_snapshot, time + 150min, time + 170min) == 2);
+    CHECK(count_in_window(*culled_snapshot, time + 290min, time + 300min) == 1);
+    CHECK(count_in_window(*erased_snapshot, time + 30min, time + 40min) == 1);
+
+    // The latest snapshot should agree with the database
+    CHECK(count_in_window(db, time + 150min, time + 170min) == 2);
+    CHECK(db.snapshot() == culled_snapshot);
+  }
+
+  WHEN("Snapshots are taken by multiple threads at once")
+  {
+    rmf_traffic::Trajectory t;
+    t.insert(time, Eigen::Vector3d{-5, 0, 0}, Eigen::Vector3d{0, 0, 0});
+    t.insert(time + 20s, Eigen::Vector3d{5, 0, 0}, Eigen::Vector3d{0, 0, 0});
+    db.extend(participants[2], create_test_input(1, t), 1);
+
+    std::vector<std::shared_ptr<const rmf_traffic::schedule::Snapshot>>
+    snapshots(8);
+
+    std::vector<std::thread> threads;
+    for (auto& s : snapshots)
+      threads.emplace_back([&db, &s]() { s = db.snapshot(); });
+
+    for (auto& thread : threads)
+      thread.join();
+
+    for (const auto& s : snapshots)
+    {
+      CHECK(s == snapshots.front());
+      CHECK(s->query(query_all).size() == 4);
+    }
+  }
+}
+
+SCENARIO("Test Database changes for a filtered query")
+{
+  rmf_traffic::schedule::Database db;
+
+  const rmf_traffic::Time time = std::chrono::steady_clock::now();
+  const auto shape = rmf_traffic::geometry::make_final_convex<
+    rmf_traffic::geometry::Circle>(0.5);
+  const rmf_traffic::Profile profile{shape};
+
+  const auto make_trajectory = [&](const rmf_traffic::Time start)
+    {
+      rmf_traffic::Trajectory t;
+      t.insert(start, Eigen::Vector3d{-5, 0, 0}, Eigen::Vector3d{0, 0, 0});
+      t.insert(start + 10s, Eigen::Vector3d{5, 0, 0}, Eigen::Vector3d{0, 0, 0});
+      return t;
+    };
+
+  std::vector<rmf_traffic::schedule::ParticipantId> participants;
+  for (std::size_t i = 0; i < 5; ++i)
+  {
+    const auto p = db.register_participant(
+      rmf_traffic::schedule::ParticipantDescription{
+        "participant_" + std::to_string(i),
+        "test_Database",
+        rmf_traffic::schedule::ParticipantDescription::Rx::Responsive,
+        profile
+      });
+
+    db.set(p.id(), create_test_input(0, make_trajectory(time)), 0);
+    participants.push_back(p.id());
+  }
+
+  const auto query = rmf_traffic::schedule::make_query(
+    {"test_map"}, &time, nullptr);
+  const auto after = db.latest_version();
+
+  // Nothing has changed yet, so the patch should be empty
+  auto changes = db.changes(query, after);
+  CHECK(changes.size() == 0);
+  CHECK(db.query(query, after).size() == 0);
+
+  WHEN("One participant is delayed")
+  {
+    db.delay(participants[2], 5s, 1);
+
+    changes = db.changes(query, after);
+    REQUIRE(changes.size() == 1);
+    CHECK(changes.begin()->participant_id() == participants[2]);
+    CHECK(changes.begin()->delays().size() == 1);
+    CHECK(changes.begin()->additions().items().size() == 0);
+    CHECK(changes.begin()->erasures().ids().size() == 0);
+
+    const auto view = db.query(query, after);
+    REQUIRE(view.size() == 1);
+    CHECK(view.begin()->participant == participants[2]);
+  }
+
+  WHEN("One route is moved out of the time range of the query")
+  {
+    db.set(participants[1], create_test_input(1, make_trajectory(
+        time - 1min)), 1);
+
+    changes = db.changes(query, after);
+    REQUIRE(changes.size() == 1);
+    CHECK(changes.begin()->participant_id() == participants[1]);
+    CHECK(changes.begin()->additions().items().size() == 0);
+    CHECK(changes.begin()->erasures().ids().size() == 1);
+    CHECK(db.query(query, after).size() == 0);
+  }
+
+  WHEN("One route is added on a different map")
+  {
+    rmf_traffic::schedule::Writer::Input input;
+    input.push_back(
+      rmf_traffic::schedule::Writer::Item{
+        1,
+        std::make_shared<rmf_traffic::Route>(
+          "other_map", make_trajectory(time))
+      });
+    db.extend(participants[3], input, 1);
+
+    CHECK(db.changes(query, after).size() == 0);
+    CHECK(db.query(query, after).size() == 0);
+
+    const auto all_changes =
+      db.changes(rmf_traffic::schedule::query_all(), after);
+    REQUIRE(all_changes.size() == 1);
+    CHECK(all_changes.begin()->additions().items().size() == 1);
+  }
+
+  WHEN("The schedule is culled")
+  {
+    db.delay(participants[0], 5s, 1);
+    db.cull(time + 1min);
+
+    changes = db.changes(query, after);
+    CHECK(changes.size() == 0);
+    REQUIRE(changes.cull());
+    CHECK(db.query(query, after).size() == 0);
+  }
+}
+
+//==============================================================================
+SCENARIO("Test Database change journal size")
+{
+  using Debug = rmf_traffic::schedule::Database::Debug;
+  rmf_traffic::schedule::Database db;
+
+  const rmf_traffic::Time time = std::chrono::steady_clock::now();
+  const auto shape = rmf_traffic::geometry::make_final_convex<
+    rmf_traffic::geometry::Circle>(0.5);
+  const rmf_traffic::Profile profile{shape};
+
+  const auto make_trajectory = [&](const rmf_traffic::Time start)
+    {
+      rmf_traffic::Trajectory t;
+      t.insert(start, Eigen::Vector3d{-5, 0, 0}, Eigen::Vector3d{0, 0, 0});
+      t.insert(start + 10s, Eigen::Vector3d{5, 0, 0}, Eigen::Vector3d{0, 0, 0});
+      return t;
+    };
+
+  const auto p = db.register_participant(
+    rmf_traffic::schedule::ParticipantDescription{
+      "participant",
+      "test_Database",
+      rmf_traffic::schedule::ParticipantDescription::Rx::Responsive,
+      profile
+    }).id();
+
+  db.set(p, create_test_input(0, make_trajectory(time)), 0);
+  const auto after = db.latest_version();
+  rmf_traffic::schedule::ItineraryVersion iv = 1;
+
+  WHEN("The itinerary is delayed repeatedly")
+  {
+    for (std::size_t i = 0; i < 1000; ++i)
+      db.delay(p, 1s, iv++);
+
+    // The delays all belong to the same route, so only its newest entry needs
+    // to be in the journal.
+    CHECK(Debug::current_entry_history_count(db) == 1);
+    CHECK(Debug::current_change_journal_size(db) <= 2);
+
+    const auto changes =
+      db.changes(rmf_traffic::schedule::query_all(), after);
+    REQUIRE(changes.size() == 1);
+    CHECK(changes.begin()->delays().size() == 1000);
+  }
+
+  WHEN("The itinerary is set repeatedly")
+  {
+    for (rmf_traffic::RouteId r = 1; r <= 1000; ++r)
+      db.set(p, create_test_input(r, make_trajectory(time)), iv++);
+
+    // Every route that was replaced still has an erasure in the database until
+    // it gets culled, but the journal should not grow any faster than that.
+    const auto histories = Debug::current_entry_history_count(db);
+    CHECK(histories == 1001);
+    CHECK(Debug::current_change_journal_size(db) <= 2*histories);
+
+    const auto changes =
+      db.changes(rmf_traffic::schedule::query_all(), after);
+    REQUIRE(changes.size() == 1);
+    CHECK(changes.begin()->erasures().ids().size() == 1);
+    CHECK(changes.begin()->additions().items().size() == 1);
+
+    db.set(p, create_test_input(1001, make_trajectory(time + 1h)), iv++);
+    db.cull(time + 30min);
+    CHECK(Debug::current_entry_history_count(db) == 1);
+    CHECK(Debug::current_change_journal_size(db) == 1);
+  }
+}
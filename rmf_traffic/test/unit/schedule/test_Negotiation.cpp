@@ -16,11 +16,14 @@
 */
 
 #include <rmf_traffic/schedule/Negotiation.hpp>
+#include <rmf_traffic/schedule/Negotiator.hpp>
 #include <rmf_traffic/schedule/Database.hpp>
 #include <rmf_traffic/geometry/Circle.hpp>
 
 #include <rmf_utils/catch.hpp>
 
+#include <thread>
+
 SCENARIO("Negotiation Unit Tests")
 {
   const auto database = std::make_shared<rmf_traffic::schedule::Database>();
@@ -89,3 +92,83 @@ SCENARIO("Negotiation Unit Tests")
   CHECK(table->defunct());
   CHECK(viewer->defunct());
 }
+
+namespace {
+//==============================================================================
+class FakeNegotiator : public rmf_traffic::schedule::Negotiator
+{
+public:
+
+  FakeNegotiator(std::size_t id)
+  : id(id)
+  {
+    // Do nothing
+  }
+
+  void respond(const TableViewerPtr&, const ResponderPtr& responder) final
+  {
+    responder->forfeit({id});
+  }
+
+  std::size_t id;
+};
+
+//==============================================================================
+class RecordingResponder : public rmf_traffic::schedule::Negotiator::Responder
+{
+public:
+
+  RecordingResponder(std::vector<std::size_t>& record)
+  : record(record)
+  {
+    // Do nothing
+  }
+
+  void submit(std::vector<rmf_traffic::Route>, ApprovalCallback) const final
+  {
+    // Do nothing
+  }
+
+  void reject(const Alternatives&) const final
+  {
+    // Do nothing
+  }
+
+  void forfeit(const std::vector<ParticipantId>& blockers) const final
+  {
+    CHECK(std::this_thread::get_id() == main_thread);
+    record.push_back(blockers.front());
+  }
+
+  std::vector<std::size_t>& record;
+  const std::thread::id main_thread = std::this_thread::get_id();
+};
+} // anonymous namespace
+
+//==============================================================================
+SCENARIO("Responding to tables in parallel")
+{
+  using Negotiator = rmf_traffic::schedule::Negotiator;
+
+  std::vector<FakeNegotiator> negotiators;
+  for (std::size_t i = 0; i < 4; ++i)
+    negotiators.emplace_back(i);
+
+  std::vector<std::size_t> record;
+  std::vector<Negotiator::Request> requests;
+  for (auto& n : negotiators)
+  {
+    requests.push_back(
+      Negotiator::Request{
+        &n,
+        nullptr,
+        std::make_shared<RecordingResponder>(record)
+      });
+  }
+
+  Negotiator::respond_in_parallel(requests, 4);
+
+  // The responses arrive on this thread in the order of the requests
+  const std::vector<std::size_t> expected = {0, 1, 2, 3};
+  CHECK(record == expected);
+}
@@ -532,4 +532,183 @@ SCENARIO("DetectConflict unit tests")
   }
 }
 
+SCENARIO("Analytic circle conflicts match FCL")
+{
+  const double fcl_error_margin = 0.5;
+  const rmf_traffic::Time begin_time = std::chrono::steady_clock::now();
+
+  const auto make_trajectory = [&](
+    const std::vector<std::pair<Eigen::Vector3d, Eigen::Vector3d>>& states)
+    {
+      rmf_traffic::Trajectory trajectory;
+      for (std::size_t i = 0; i < states.size(); ++i)
+      {
+        trajectory.insert(
+          begin_time + std::chrono::seconds(10*i),
+          states[i].first,
+          states[i].second);
+      }
+
+      return trajectory;
+    };
+
+  const auto circle = [](const double r)
+    {
+      return rmf_traffic::geometry::make_final_convex<
+        rmf_traffic::geometry::Circle>(r);
+    };
+
+  GIVEN("Straight motions")
+  {
+    const auto profile = create_test_profile(UnitCircle);
+    const auto t1 = make_trajectory({
+        {{-5.0, 0.0, 0.0}, {0.0, 0.0, 0.0}},
+        {{5.0, 0.0, 0.0}, {0.0, 0.0, 0.0}}
+      });
+
+    WHEN("The paths cross")
+    {
+      const auto t2 = make_trajectory({
+          {{0.0, -5.0, 0.0}, {0.0, 0.0, 0.0}},
+          {{0.0, 5.0, 0.0}, {0.0, 0.0, 0.0}}
+        });
+
+      CHECK(rmf_traffic::DetectConflict::between(profile, t1, profile, t2));
+      CHECK_analytic_matches_fcl(profile, t1, profile, t2, fcl_error_margin);
+    }
+
+    WHEN("The paths are parallel")
+    {
+      const auto t2 = make_trajectory({
+          {{-5.0, 2.5, 0.0}, {0.0, 0.0, 0.0}},
+          {{5.0, 2.5, 0.0}, {0.0, 0.0, 0.0}}
+        });
+
+      CHECK_FALSE(
+        rmf_traffic::DetectConflict::between(profile, t1, profile, t2));
+      CHECK_analytic_matches_fcl(profile, t1, profile, t2, fcl_error_margin);
+    }
+
+    WHEN("The paths cross at different times")
+    {
+      const auto t2 = make_trajectory({
+          {{0.0, -15.0, 0.0}, {0.0, 0.0, 0.0}},
+          {{0.0, -5.0, 0.0}, {0.0, 0.0, 0.0}}
+        });
+
+      CHECK_FALSE(
+        rmf_traffic::DetectConflict::between(profile, t1, profile, t2));
+      CHECK_analytic_matches_fcl(profile, t1, profile, t2, fcl_error_margin);
+    }
+  }
+
+  GIVEN("Curved motions")
+  {
+    const auto profile = create_test_profile(UnitCircle);
+    const auto t1 = make_trajectory({
+        {{-5.0, 0.0, 0.0}, {1.0, 0.0, 0.0}},
+        {{0.0, -5.0, 0.0}, {0.0, -1.0, 0.0}}
+      });
+
+    WHEN("The curves meet")
+    {
+      const auto t2 = make_trajectory({
+          {{-5.0, -5.0, 0.0}, {1.0, 0.0, 0.0}},
+          {{0.0, 0.0, 0.0}, {0.0, 1.0, 0.0}}
+        });
+
+      CHECK(rmf_traffic::DetectConflict::between(profile, t1, profile, t2));
+      CHECK_analytic_matches_fcl(profile, t1, profile, t2, fcl_error_margin);
+    }
+
+    WHEN("The curves stay apart")
+    {
+      const auto t2 = make_trajectory({
+          {{5.0, 0.0, 0.0}, {-1.0, 0.0, 0.0}},
+          {{0.0, 5.0, 0.0}, {0.0, 1.0, 0.0}}
+        });
+
+      CHECK_FALSE(
+        rmf_traffic::DetectConflict::between(profile, t1, profile, t2));
+      CHECK_analytic_matches_fcl(profile, t1, profile, t2, fcl_error_margin);
+    }
+
+    WHEN("A straight motion passes through the curve")
+    {
+      const auto t2 = make_trajectory({
+          {{-5.0, -5.0, 0.0}, {0.0, 0.0, 0.0}},
+          {{0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}}
+        });
+
+      CHECK_analytic_matches_fcl(profile, t1, profile, t2, fcl_error_margin);
+    }
+  }
+
+  GIVEN("Footprints that are smaller than the vicinities")
+  {
+    const rmf_traffic::Profile profile_a{circle(0.5), circle(1.5)};
+    const rmf_traffic::Profile profile_b{circle(0.3), circle(1.0)};
+
+    const auto t1 = make_trajectory({
+        {{-10.0, -5.0, 0.0}, {0.5, 0.0, 0.0}},
+        {{-5.0, -5.0, 0.0}, {0.5, 0.0, 0.0}},
+        {{0.0, 0.0, 0.0}, {0.0, 0.5, 0.0}},
+        {{0.0, 5.0, 0.0}, {0.0, 0.5, 0.0}}
+      });
+
+    WHEN("A straight motion crosses the curved segment")
+    {
+      const auto t2 = make_trajectory({
+          {{-8.0, 0.0, 0.0}, {0.0, 0.0, 0.0}},
+          {{-6.0, 0.0, 0.0}, {0.0, 0.0, 0.0}},
+          {{2.0, -4.0, 0.0}, {0.0, 0.0, 0.0}},
+          {{4.0, -4.0, 0.0}, {0.0, 0.0, 0.0}}
+        });
+
+      CHECK_analytic_matches_fcl(
+        profile_a, t1, profile_b, t2, fcl_error_margin);
+      CHECK_analytic_matches_fcl(
+        profile_b, t2, profile_a, t1, fcl_error_margin);
+    }
+
+    WHEN("A curved motion only enters the larger vicinity")
+    {
+      const auto t2 = make_trajectory({
+          {{-10.0, -7.0, 0.0}, {0.5, 0.0, 0.0}},
+          {{-5.0, -7.0, 0.0}, {0.5, 0.0, 0.0}},
+          {{1.2, -0.8, 0.0}, {0.0, 0.5, 0.0}},
+          {{1.2, 4.2, 0.0}, {0.0, 0.5, 0.0}}
+        });
+
+      CHECK_analytic_matches_fcl(
+        profile_a, t1, profile_b, t2, fcl_error_margin);
+      CHECK_analytic_matches_fcl(
+        profile_b, t2, profile_a, t1, fcl_error_margin);
+    }
+  }
+
+  GIVEN("Vehicles that start close to each other")
+  {
+    const auto profile = create_test_profile(UnitCircle);
+
+    WHEN("They back away from each other and then return")
+    {
+      const auto t1 = make_trajectory({
+          {{0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}},
+          {{-3.0, 0.0, 0.0}, {0.0, 0.0, 0.0}},
+          {{0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}}
+        });
+
+      const auto t2 = make_trajectory({
+          {{1.5, 0.0, 0.0}, {0.0, 0.0, 0.0}},
+          {{4.5, 1.0, 0.0}, {0.0, 0.0, 0.0}},
+          {{1.5, 0.0, 0.0}, {0.0, 0.0, 0.0}}
+        });
+
+      CHECK(rmf_traffic::DetectConflict::between(profile, t1, profile, t2));
+      CHECK_analytic_matches_fcl(profile, t1, profile, t2, fcl_error_margin);
+    }
+  }
+}
+
 // A useful website for playing with 2D cubic splines: https://www.desmos.com/calculator/
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <src/rmf_traffic/MapId.hpp>
+#include <src/rmf_traffic/internal_Route.hpp>
+#include <src/rmf_traffic/agv/internal_Graph.hpp>
+
+#include <rmf_utils/catch.hpp>
+
+#include <thread>
+#include <vector>
+
+using rmf_traffic::MapId;
+
+//==============================================================================
+SCENARIO("Interning map names")
+{
+  const MapId L1 = MapId::intern("test_MapId_L1");
+  const MapId L2 = MapId::intern("test_MapId_L2");
+
+  CHECK(L1 != L2);
+  CHECK(L1 == MapId::intern("test_MapId_L1"));
+  CHECK(L1.name() == "test_MapId_L1");
+  CHECK(L2.name() == "test_MapId_L2");
+
+  REQUIRE(MapId::find("test_MapId_L1").has_value());
+  CHECK(*MapId::find("test_MapId_L1") == L1);
+  CHECK_FALSE(MapId::find("test_MapId_never_interned").has_value());
+
+  CHECK(MapId() == MapId::intern(""));
+  CHECK(MapId().name().empty());
+
+  WHEN("Many threads intern the same names at once")
+  {
+    std::vector<std::vector<MapId>> results(8);
+    std::vector<std::thread> threads;
+    for (auto& result : results)
+    {
+      threads.emplace_back(
+        [&result]()
+        {
+          for (std::size_t i = 0; i < 100; ++i)
+          {
+            result.push_back(
+              MapId::intern("test_MapId_concurrent_" + std::to_string(i)));
+          }
+        });
+    }
+
+    for (auto& thread : threads)
+      thread.join();
+
+    for (const auto& result : results)
+      CHECK(result == results.front());
+  }
+}
+
+//==============================================================================
+SCENARIO("Map IDs stay in sync with map names")
+{
+  WHEN("The map of a route changes")
+  {
+    rmf_traffic::Route route{"test_MapId_A", rmf_traffic::Trajectory()};
+    CHECK(rmf_traffic::RouteData::get(route).map_id
+      == MapId::intern("test_MapId_A"));
+
+    route.map("test_MapId_B");
+    CHECK(rmf_traffic::RouteData::get(route).map_id
+      == MapId::intern("test_MapId_B"));
+
+    const rmf_traffic::Route copy = route;
+    CHECK(rmf_traffic::RouteData::get(copy).map_id
+      == MapId::intern("test_MapId_B"));
+  }
+
+  WHEN("The map of a waypoint changes")
+  {
+    using Waypoint = rmf_traffic::agv::Graph::Waypoint;
+
+    rmf_traffic::agv::Graph graph;
+    auto& wp = graph.add_waypoint("test_MapId_A", {0.0, 0.0});
+    CHECK(Waypoint::Implementation::get(wp).map_id
+      == MapId::intern("test_MapId_A"));
+
+    wp.set_map_name("test_MapId_B");
+    CHECK(Waypoint::Implementation::get(graph.get_waypoint(0)).map_id
+      == MapId::intern("test_MapId_B"));
+  }
+}
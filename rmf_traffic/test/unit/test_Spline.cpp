@@ -66,3 +66,78 @@ SCENARIO("Test spline")
     CHECK(p[1] == Approx(delta_t.count() - 5.0));
   }
 }
+
+SCENARIO("Test first time within a distance")
+{
+  using namespace std::chrono_literals;
+
+  const rmf_traffic::Time begin_time = std::chrono::steady_clock::now();
+
+  // Vehicle `a` crosses the x axis while vehicle `b` curves up along the y axis
+  rmf_traffic::Trajectory trajectory_a;
+  trajectory_a.insert(
+    begin_time,
+    Eigen::Vector3d{-5.0, 0.0, 0.0},
+    Eigen::Vector3d{ 1.0, 0.0, 0.0});
+
+  trajectory_a.insert(
+    begin_time + 10s,
+    Eigen::Vector3d{ 5.0, 0.0, 0.0},
+    Eigen::Vector3d{ 1.0, 0.0, 0.0});
+
+  rmf_traffic::Trajectory trajectory_b;
+  trajectory_b.insert(
+    begin_time,
+    Eigen::Vector3d{ 2.0, -5.0, 0.0},
+    Eigen::Vector3d{ 0.0, 0.5, 0.0});
+
+  trajectory_b.insert(
+    begin_time + 10s,
+    Eigen::Vector3d{ 0.0, 5.0, 0.0},
+    Eigen::Vector3d{-1.0, 1.5, 0.0});
+
+  const rmf_traffic::Spline spline_a(++trajectory_a.begin());
+  const rmf_traffic::Spline spline_b(++trajectory_b.begin());
+  const rmf_traffic::DistanceDifferential differential(spline_a, spline_b);
+
+  // Find the closest approach and the first time within each distance by
+  // densely sampling the splines
+  const auto distance_at = [&](const double s)
+    {
+      const auto time = begin_time + std::chrono::duration_cast<
+        rmf_traffic::Duration>(s * 10s);
+      return (spline_a.compute_position(time)
+        - spline_b.compute_position(time)).block<2, 1>(0, 0).norm();
+    };
+
+  const auto first_sample_within = [&](const double distance)
+    -> rmf_utils::optional<double>
+    {
+      const std::size_t samples = 100000;
+      for (std::size_t i = 0; i <= samples; ++i)
+      {
+        const double s = double(i)/double(samples);
+        if (distance_at(s) <= distance)
+          return s;
+      }
+
+      return rmf_utils::nullopt;
+    };
+
+  for (const double distance : {0.5, 1.0, 2.0, 5.0})
+  {
+    const auto expected = first_sample_within(distance);
+    const auto s = differential.first_time_within(distance);
+    REQUIRE(expected.has_value() == s.has_value());
+    if (s)
+      CHECK(*s == Approx(*expected).margin(1e-4));
+  }
+
+  // The vehicles never get this close
+  CHECK_FALSE(differential.first_time_within(0.01));
+
+  // If the splines start within the distance then the first time is the start
+  const auto s = differential.first_time_within(distance_at(0.0) + 0.1);
+  REQUIRE(s);
+  CHECK(*s == 0.0);
+}
@@ -908,3 +908,110 @@ SCENARIO("Trajectory and base_iterator unit tests")
     }
   }
 }
+
+SCENARIO("Iterator stability tests")
+{
+  using namespace std::chrono_literals;
+  const auto now = std::chrono::steady_clock::now();
+
+  rmf_traffic::Trajectory trajectory;
+  for (int i = 0; i < 5; ++i)
+  {
+    trajectory.insert(
+      now + std::chrono::seconds(10*i),
+      Eigen::Vector3d(i, 0, 0),
+      Eigen::Vector3d::Zero());
+  }
+
+  auto third_it = trajectory.find(now + 20s);
+  REQUIRE(third_it != trajectory.end());
+  rmf_traffic::Trajectory::Waypoint& third = *third_it;
+
+  // Insert before the waypoint so that its index shifts
+  const Eigen::Vector3d zero = Eigen::Vector3d::Zero();
+  trajectory.insert(now - 10s, Eigen::Vector3d(-1, 0, 0), zero);
+  trajectory.insert(now + 5s, Eigen::Vector3d(0.5, 0, 0), zero);
+  CHECK(third.time() == now + 20s);
+  CHECK(third.position().x() == Approx(2.0));
+  CHECK(&(*third_it) == &third);
+  CHECK(&trajectory[4] == &third);
+
+  // Erase waypoints before and after it
+  trajectory.erase(trajectory.begin());
+  trajectory.erase(trajectory.find(now + 40s));
+  CHECK(third_it->time() == now + 20s);
+  CHECK(&trajectory[3] == &third);
+  CHECK(trajectory.size() == 5);
+
+  // Move the waypoint to the front and then to the back
+  third.change_time(now - 5s);
+  CHECK(&trajectory.front() == &third);
+  CHECK(third_it == trajectory.begin());
+  CHECK(rmf_traffic::Trajectory::Debug::check_iterator_time_consistency(
+    trajectory, true));
+
+  third.change_time(now + 1h);
+  CHECK(&trajectory.back() == &third);
+  CHECK(++rmf_traffic::Trajectory::iterator(third_it) == trajectory.end());
+  CHECK(--trajectory.end() == third_it);
+  CHECK_THROWS(third.change_time(now + 5s));
+  CHECK(rmf_traffic::Trajectory::Debug::check_iterator_time_consistency(
+    trajectory, true));
+
+  // Slots that were freed by erasing get reused
+  trajectory.insert(now + 15s, Eigen::Vector3d(1.5, 0, 0), zero);
+  CHECK(trajectory.size() == 6);
+  CHECK(third.time() == now + 1h);
+
+  const rmf_traffic::Trajectory copy = trajectory;
+  REQUIRE(copy.size() == trajectory.size());
+  auto copy_it = copy.begin();
+  for (const auto& wp : trajectory)
+  {
+    CHECK(copy_it->time() == wp.time());
+    CHECK((copy_it->position() - wp.position()).norm() == Approx(0.0));
+    CHECK(&(*copy_it) != &wp);
+    ++copy_it;
+  }
+  CHECK(copy_it == copy.end());
+  CHECK(rmf_traffic::Trajectory::Debug::check_iterator_time_consistency(
+    copy, true));
+}
+
+SCENARIO("Start and finish time pointer stability")
+{
+  using namespace std::chrono_literals;
+  const auto now = std::chrono::steady_clock::now();
+  const Eigen::Vector3d zero = Eigen::Vector3d::Zero();
+
+  rmf_traffic::Trajectory trajectory;
+  trajectory.insert(now, zero, zero);
+  trajectory.insert(now + 10s, zero, zero);
+
+  const rmf_traffic::Time* const start = trajectory.start_time();
+  const rmf_traffic::Time* const finish = trajectory.finish_time();
+  REQUIRE(start);
+  REQUIRE(finish);
+
+  // The pointers refer to the same waypoints while other waypoints are
+  // inserted and erased around them
+  for (int i = 1; i < 100; ++i)
+    trajectory.insert(now + std::chrono::milliseconds(50*i), zero, zero);
+
+  CHECK(*start == now);
+  CHECK(*finish == now + 10s);
+
+  trajectory.erase(++trajectory.begin(), --trajectory.end());
+  REQUIRE(trajectory.size() == 2);
+  CHECK(*start == now);
+  CHECK(*finish == now + 10s);
+
+  // The pointers follow changes to the times of their waypoints
+  trajectory.begin()->adjust_times(5s);
+  CHECK(*start == now + 5s);
+  CHECK(*finish == now + 15s);
+
+  trajectory.back().change_time(now + 20s);
+  CHECK(*finish == now + 20s);
+  CHECK(trajectory.finish_time() == finish);
+}
@@ -138,4 +138,43 @@ inline void CHECK_ConflictList(
   }
 }
 
+//==============================================================================
+/// Check that the analytic circle-vs-circle check finds the same conflicts as
+/// FCL, up to FCL's precision for the time of each conflict.
+inline void CHECK_analytic_matches_fcl(
+  const rmf_traffic::Profile& p1,
+  const rmf_traffic::Trajectory& t1,
+  const rmf_traffic::Profile& p2,
+  const rmf_traffic::Trajectory& t2,
+  const double error_margin)
+{
+  using Implementation = rmf_traffic::DetectConflict::Implementation;
+  const auto interpolate =
+    rmf_traffic::DetectConflict::Interpolate::CubicSpline;
+
+  Implementation::Conflicts analytic_conflicts;
+  const auto analytic = Implementation::between(
+    p1, t1, p2, t2, interpolate, &analytic_conflicts, true);
+
+  Implementation::Conflicts fcl_conflicts;
+  const auto fcl = Implementation::between(
+    p1, t1, p2, t2, interpolate, &fcl_conflicts, false);
+
+  REQUIRE(analytic.has_value() == fcl.has_value());
+  REQUIRE(analytic_conflicts.size() == fcl_conflicts.size());
+  for (std::size_t i = 0; i < analytic_conflicts.size(); ++i)
+  {
+    const auto& a = analytic_conflicts[i];
+    const auto& f = fcl_conflicts[i];
+    CHECK(a.a_it == f.a_it);
+    CHECK(a.b_it == f.b_it);
+
+    const double analytic_time = rmf_traffic::time::to_seconds(
+      a.time - t1.begin()->time());
+    const double fcl_time = rmf_traffic::time::to_seconds(
+      f.time - t1.begin()->time());
+    CHECK(analytic_time == Approx(fcl_time).margin(error_margin));
+  }
+}
+
 #endif // RMF_TRAFFIC__TEST__UNIT__UTILS_TRAJECTORY_HPP
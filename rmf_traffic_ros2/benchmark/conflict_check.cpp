@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "../src/rmf_traffic_ros2/schedule/internal_ConflictCheck.hpp"
+
+#include <rmf_traffic/geometry/Circle.hpp>
+#include <rmf_traffic/schedule/Database.hpp>
+#include <rmf_traffic/schedule/Mirror.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+using namespace std::chrono_literals;
+
+//==============================================================================
+/// Fill a database with participants that drive back and forth across a shared
+/// square area so that many of their routes cross each other.
+std::shared_ptr<rmf_traffic::schedule::Database> make_database(
+  const std::size_t num_participants,
+  const std::size_t routes_per_participant)
+{
+  auto database = std::make_shared<rmf_traffic::schedule::Database>();
+
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(0.5)
+  };
+
+  const double area = 100.0;
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < num_participants; ++i)
+  {
+    const auto registration = database->register_participant(
+      rmf_traffic::schedule::ParticipantDescription{
+        "participant_" + std::to_string(i),
+        "benchmark",
+        rmf_traffic::schedule::ParticipantDescription::Rx::Responsive,
+        profile
+      });
+
+    rmf_traffic::schedule::Writer::Input input;
+    for (std::size_t r = 0; r < routes_per_participant; ++r)
+    {
+      // Spread the participants around a circle and send each one across to
+      // the far side, offset by a different angle for each route.
+      const double angle =
+        2.0*M_PI*static_cast<double>(i + r*7) / num_participants;
+      const Eigen::Vector3d p0{
+        area/2.0*std::cos(angle), area/2.0*std::sin(angle), angle};
+      const Eigen::Vector3d p1{-p0[0], -p0[1], angle};
+
+      const auto t0 = start + std::chrono::minutes(2*r);
+      rmf_traffic::Trajectory trajectory;
+      trajectory.insert(t0, p0, Eigen::Vector3d::Zero());
+      trajectory.insert(t0 + 90s, p1, Eigen::Vector3d::Zero());
+
+      input.push_back(
+        {
+          static_cast<rmf_traffic::RouteId>(r),
+          std::make_shared<rmf_traffic::Route>("L1", std::move(trajectory))
+        });
+    }
+
+    database->set(registration.id(), input, 0);
+  }
+
+  return database;
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+  const std::size_t num_participants =
+    argc > 1 ? std::stoul(argv[1]) : 100;
+  const std::size_t routes_per_participant =
+    argc > 2 ? std::stoul(argv[2]) : 5;
+  const std::size_t max_threads =
+    argc > 3 ? std::stoul(argv[3]) :
+    std::max(1u, std::thread::hardware_concurrency());
+  const std::size_t repetitions = 5;
+
+  const auto database = make_database(num_participants, routes_per_participant);
+  const auto query_all = rmf_traffic::schedule::query_all();
+
+  rmf_traffic::schedule::Mirror mirror;
+  mirror.update(database->changes(query_all, rmf_utils::nullopt));
+
+  // Every route counts as a change, which is the worst case for the checker
+  const auto view_changes = database->query(query_all, 0);
+
+  std::cout << "Participants: " << num_participants
+            << " | Routes per participant: " << routes_per_participant
+            << std::endl;
+
+  std::vector<std::size_t> thread_counts = {1};
+  if (max_threads > 1)
+    thread_counts.push_back(max_threads);
+
+  std::size_t expected_conflicts = 0;
+  for (const std::size_t num_threads : thread_counts)
+  {
+    rmf_traffic_ros2::schedule::ConflictChecker checker(num_threads);
+
+    std::size_t conflicts = 0;
+    const auto begin = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < repetitions; ++i)
+    {
+      conflicts = 0;
+      checker.check(
+        view_changes, mirror,
+        [&](const rmf_traffic_ros2::schedule::ConflictChecker::ConflictSet&)
+        {
+          ++conflicts;
+        });
+    }
+    const auto finish = std::chrono::steady_clock::now();
+
+    const double ms = std::chrono::duration_cast<
+      std::chrono::duration<double, std::milli>>(finish - begin).count()
+      / static_cast<double>(repetitions);
+
+    std::cout << "Threads: " << num_threads << " | Conflicts: " << conflicts
+              << " | Time per check: " << ms << " ms" << std::endl;
+
+    if (num_threads == 1)
+      expected_conflicts = conflicts;
+    else if (conflicts != expected_conflicts)
+    {
+      std::cerr << "Mismatch in the number of conflicts between 1 and "
+                << num_threads << " threads!" << std::endl;
+      return 1;
+    }
+  }
+
+  return 0;
+}
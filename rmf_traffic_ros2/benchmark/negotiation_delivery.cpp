@@ -0,0 +1,265 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic_ros2/Route.hpp>
+#include <rmf_traffic_ros2/schedule/Itinerary.hpp>
+
+#include <rmf_traffic/schedule/ParticipantDescription.hpp>
+
+#include <rmf_traffic_msgs/msg/negotiation_proposal.hpp>
+#include <rmf_traffic_msgs/msg/negotiation_rejection.hpp>
+
+#include <rclcpp/serialization.hpp>
+#include <rclcpp/serialized_message.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std::chrono_literals;
+using ParticipantId = rmf_traffic::schedule::ParticipantId;
+
+//==============================================================================
+/// One message on the negotiation topics, along with what it costs an adapter
+/// to receive it.
+struct Delivery
+{
+  std::vector<ParticipantId> participants;
+  std::size_t bytes;
+  double cpu_ms;
+};
+
+//==============================================================================
+rmf_traffic::Route make_route(
+  std::mt19937& rng,
+  const std::size_t num_waypoints)
+{
+  std::uniform_real_distribution<double> coordinate(-100.0, 100.0);
+  rmf_traffic::Trajectory trajectory;
+  auto t = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < num_waypoints; ++i)
+  {
+    trajectory.insert(
+      t, {coordinate(rng), coordinate(rng), 0.0}, {1.0, 0.0, 0.0});
+    t += 5s;
+  }
+
+  return rmf_traffic::Route("L1", std::move(trajectory));
+}
+
+//==============================================================================
+/// Serialize the message to find out how many bytes go over the network, then
+/// measure what it costs a receiver to deserialize it and convert its
+/// itineraries, which is what Negotiation does with every message it gets.
+template<typename Message, typename Convert>
+Delivery measure(
+  const Message& msg,
+  std::vector<ParticipantId> participants,
+  Convert convert)
+{
+  static const rclcpp::Serialization<Message> serializer;
+  rclcpp::SerializedMessage serialized;
+  serializer.serialize_message(&msg, &serialized);
+
+  const std::size_t repetitions = 10;
+  const auto begin = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < repetitions; ++i)
+  {
+    Message received;
+    serializer.deserialize_message(&serialized, &received);
+    convert(received);
+  }
+  const auto finish = std::chrono::steady_clock::now();
+
+  const double cpu_ms = std::chrono::duration_cast<
+    std::chrono::duration<double, std::milli>>(finish - begin).count()
+    / static_cast<double>(repetitions);
+
+  return Delivery{
+    std::move(participants),
+    serialized.get_rcl_serialized_message().buffer_length,
+    cpu_ms
+  };
+}
+
+//==============================================================================
+/// Produce the traffic of one negotiation: a proposal on every table of the
+/// negotiation tree and one rejection with an alternative.
+void negotiate(
+  std::mt19937& rng,
+  const uint64_t conflict_version,
+  std::vector<ParticipantId> participants,
+  const std::size_t num_waypoints,
+  std::vector<Delivery>& deliveries)
+{
+  std::sort(participants.begin(), participants.end());
+
+  std::vector<std::vector<ParticipantId>> tables;
+  do
+  {
+    for (std::size_t i = 1; i <= participants.size(); ++i)
+    {
+      std::vector<ParticipantId> table(
+        participants.begin(), participants.begin() + i);
+      if (std::find(tables.begin(), tables.end(), table) == tables.end())
+        tables.push_back(std::move(table));
+    }
+  } while (std::next_permutation(participants.begin(), participants.end()));
+
+  for (const auto& table : tables)
+  {
+    rmf_traffic_msgs::msg::NegotiationProposal msg;
+    msg.conflict_version = conflict_version;
+    msg.proposal_version = 1;
+    msg.for_participant = table.back();
+    for (std::size_t i = 0; i < table.size() - 1; ++i)
+    {
+      rmf_traffic_msgs::msg::NegotiationKey key;
+      key.participant = table[i];
+      key.version = 1;
+      msg.to_accommodate.push_back(key);
+    }
+
+    msg.itinerary.push_back(
+      rmf_traffic_ros2::convert(make_route(rng, num_waypoints)));
+
+    deliveries.push_back(
+      measure(msg, participants, [](const auto& received)
+      {
+        return rmf_traffic_ros2::convert(received.itinerary);
+      }));
+  }
+
+  rmf_traffic_msgs::msg::NegotiationRejection msg;
+  msg.conflict_version = conflict_version;
+  for (const auto p : tables.back())
+  {
+    rmf_traffic_msgs::msg::NegotiationKey key;
+    key.participant = p;
+    key.version = 1;
+    msg.table.push_back(key);
+  }
+  msg.rejected_by = participants.front();
+
+  rmf_traffic_msgs::msg::Itinerary alternative;
+  alternative.routes.push_back(
+    rmf_traffic_ros2::convert(make_route(rng, num_waypoints)));
+  msg.alternatives.push_back(std::move(alternative));
+
+  deliveries.push_back(
+    measure(msg, participants, [](const auto& received)
+    {
+      return rmf_traffic_ros2::convert(received.alternatives);
+    }));
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+  const std::size_t num_fleets =
+    argc > 1 ? std::stoul(argv[1]) : 20;
+  const std::size_t robots_per_fleet =
+    argc > 2 ? std::stoul(argv[2]) : 5;
+  const std::size_t num_negotiations =
+    argc > 3 ? std::stoul(argv[3]) : 200;
+  const std::size_t num_waypoints =
+    argc > 4 ? std::stoul(argv[4]) : 30;
+
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<ParticipantId> pick(
+    0, num_fleets*robots_per_fleet - 1);
+  std::bernoulli_distribution three_way(0.2);
+
+  std::vector<Delivery> deliveries;
+  for (std::size_t n = 0; n < num_negotiations; ++n)
+  {
+    const std::size_t size = three_way(rng) ? 3 : 2;
+    std::vector<ParticipantId> participants;
+    while (participants.size() < size)
+    {
+      const auto p = pick(rng);
+      if (std::find(participants.begin(), participants.end(), p)
+        == participants.end())
+        participants.push_back(p);
+    }
+
+    negotiate(rng, n, std::move(participants), num_waypoints, deliveries);
+  }
+
+  // With broadcasting, every adapter receives every message. With scoped
+  // delivery, the schedule node relays a message once to each participant of
+  // its negotiation, so an adapter receives it once for each of its robots
+  // that is participating.
+  std::size_t broadcast_bytes = 0;
+  double broadcast_ms = 0.0;
+  std::vector<std::size_t> scoped_bytes(num_fleets, 0);
+  std::vector<double> scoped_ms(num_fleets, 0.0);
+  for (const auto& d : deliveries)
+  {
+    broadcast_bytes += d.bytes;
+    broadcast_ms += d.cpu_ms;
+
+    for (const auto p : d.participants)
+    {
+      const std::size_t fleet = p / robots_per_fleet;
+      scoped_bytes[fleet] += d.bytes;
+      scoped_ms[fleet] += d.cpu_ms;
+    }
+  }
+
+  std::size_t scoped_bytes_total = 0;
+  double scoped_ms_total = 0.0;
+  for (std::size_t f = 0; f < num_fleets; ++f)
+  {
+    scoped_bytes_total += scoped_bytes[f];
+    scoped_ms_total += scoped_ms[f];
+  }
+
+  const double fleets = static_cast<double>(num_fleets);
+  std::cout << "Fleets: " << num_fleets
+            << " | Robots per fleet: " << robots_per_fleet
+            << " | Negotiations: " << num_negotiations
+            << " | Messages: " << deliveries.size()
+            << " | Waypoints per route: " << num_waypoints
+            << std::endl;
+
+  std::cout << "Broadcast per adapter: "
+            << static_cast<double>(broadcast_bytes)/1024.0 << " KiB, "
+            << broadcast_ms << " ms" << std::endl;
+
+  std::cout << "Scoped per adapter: mean "
+            << static_cast<double>(scoped_bytes_total)/fleets/1024.0
+            << " KiB, " << scoped_ms_total/fleets << " ms | max "
+            << static_cast<double>(
+                 *std::max_element(scoped_bytes.begin(), scoped_bytes.end()))
+               /1024.0
+            << " KiB, "
+            << *std::max_element(scoped_ms.begin(), scoped_ms.end()) << " ms"
+            << std::endl;
+
+  // The schedule node receives each message once, as before, and now also
+  // sends it out once for each participant.
+  std::cout << "Schedule node relay output: "
+            << static_cast<double>(scoped_bytes_total)/1024.0 << " KiB"
+            << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "../src/rmf_traffic_ros2/schedule/internal_WriteAheadLog.hpp"
+
+#include <rmf_traffic_ros2/schedule/Writer.hpp>
+
+#include <rmf_traffic/geometry/Circle.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <string>
+
+using namespace std::chrono_literals;
+using rmf_traffic_ros2::schedule::WriteAheadLog;
+
+//==============================================================================
+void register_participants(
+  rmf_traffic::schedule::Database& database,
+  const std::size_t num_participants)
+{
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(0.5)
+  };
+
+  for (std::size_t i = 0; i < num_participants; ++i)
+  {
+    database.register_participant(
+      rmf_traffic::schedule::ParticipantDescription{
+        "participant_" + std::to_string(i),
+        "benchmark",
+        rmf_traffic::schedule::ParticipantDescription::Rx::Responsive,
+        profile
+      });
+  }
+}
+
+//==============================================================================
+/// Give every participant an itinerary and then a few delays, logging each
+/// change before it is applied, the same way the schedule node does.
+void fill_log(
+  rmf_traffic::schedule::Database& database,
+  WriteAheadLog& log,
+  const std::size_t num_participants,
+  const std::size_t routes_per_participant,
+  const std::size_t delays_per_participant)
+{
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < num_participants; ++i)
+  {
+    rmf_traffic::schedule::Writer::Input input;
+    for (std::size_t r = 0; r < routes_per_participant; ++r)
+    {
+      const double x = static_cast<double>(i);
+      const auto t0 = start + std::chrono::minutes(2*r);
+      rmf_traffic::Trajectory trajectory;
+      trajectory.insert(t0, {x, 0.0, 0.0}, Eigen::Vector3d::Zero());
+      trajectory.insert(t0 + 90s, {x, 50.0, 0.0}, Eigen::Vector3d::Zero());
+
+      input.push_back(
+        {
+          static_cast<rmf_traffic::RouteId>(r),
+          std::make_shared<rmf_traffic::Route>("L1", std::move(trajectory))
+        });
+    }
+
+    WriteAheadLog::ItinerarySet set;
+    set.participant = i;
+    set.itinerary = rmf_traffic_ros2::convert(input);
+    set.itinerary_version = 0;
+    log.write(set);
+    database.set(i, input, 0);
+  }
+
+  for (std::size_t d = 0; d < delays_per_participant; ++d)
+  {
+    for (std::size_t i = 0; i < num_participants; ++i)
+    {
+      WriteAheadLog::ItineraryDelay delay;
+      delay.participant = i;
+      delay.delay = rmf_traffic::Duration(1s).count();
+      delay.itinerary_version = d + 1;
+      log.write(delay);
+      database.delay(i, 1s, d + 1);
+    }
+  }
+
+  log.sync();
+}
+
+//==============================================================================
+double recover(
+  const std::string& directory,
+  const std::size_t num_participants,
+  WriteAheadLog::Recovery& recovery)
+{
+  rmf_traffic::schedule::Database database;
+  register_participants(database, num_participants);
+
+  WriteAheadLog::Options options;
+  options.checkpoint_interval = std::numeric_limits<std::size_t>::max();
+  WriteAheadLog log(directory, options);
+
+  const auto begin = std::chrono::steady_clock::now();
+  recovery = log.recover(database);
+  const auto finish = std::chrono::steady_clock::now();
+
+  return std::chrono::duration_cast<
+    std::chrono::duration<double, std::milli>>(finish - begin).count();
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+  const std::size_t routes_per_participant =
+    argc > 1 ? std::stoul(argv[1]) : 10;
+  const std::size_t delays_per_participant =
+    argc > 2 ? std::stoul(argv[2]) : 5;
+
+  const auto directory =
+    std::filesystem::temp_directory_path() / "benchmark_schedule_recovery";
+
+  std::cout << "Routes per participant: " << routes_per_participant
+            << " | Delays per participant: " << delays_per_participant
+            << std::endl;
+
+  for (const std::size_t num_participants : {100, 1000, 5000})
+  {
+    std::filesystem::remove_all(directory);
+
+    double write_ms = 0.0;
+    {
+      rmf_traffic::schedule::Database database;
+      register_participants(database, num_participants);
+
+      WriteAheadLog::Options options;
+      options.checkpoint_interval = std::numeric_limits<std::size_t>::max();
+      WriteAheadLog log(directory.string(), options);
+      log.recover(database);
+
+      const auto begin = std::chrono::steady_clock::now();
+      fill_log(
+        database, log, num_participants,
+        routes_per_participant, delays_per_participant);
+      const auto finish = std::chrono::steady_clock::now();
+      write_ms = std::chrono::duration_cast<
+        std::chrono::duration<double, std::milli>>(finish - begin).count();
+    }
+
+    // The first recovery replays every change in the log, and then compacts
+    // it into a checkpoint, which the second recovery gets to start from.
+    WriteAheadLog::Recovery from_log;
+    const double log_ms =
+      recover(directory.string(), num_participants, from_log);
+
+    WriteAheadLog::Recovery from_checkpoint;
+    const double checkpoint_ms =
+      recover(directory.string(), num_participants, from_checkpoint);
+
+    std::cout << "Participants: " << num_participants
+              << " | Logging: " << write_ms << " ms"
+              << " | Replay " << from_log.log_records << " log records: "
+              << log_ms << " ms"
+              << " | Replay " << from_checkpoint.checkpoint_records
+              << " checkpoint records: " << checkpoint_ms << " ms"
+              << std::endl;
+  }
+
+  std::filesystem::remove_all(directory);
+  return 0;
+}
@@ -27,6 +27,12 @@ rmf_traffic::Route convert(const rmf_traffic_msgs::msg::Route& from);
 //==============================================================================
 rmf_traffic_msgs::msg::Route convert(const rmf_traffic::Route& from);
 
+//==============================================================================
+/// Convert from a Route instance to a Route message whose trajectory has full
+/// precision, regardless of the default trajectory encoding of this process.
+rmf_traffic_msgs::msg::Route convert_full_precision(
+  const rmf_traffic::Route& from);
+
 //==============================================================================
 std::vector<rmf_traffic::Route> convert(
   const std::vector<rmf_traffic_msgs::msg::Route>& from);
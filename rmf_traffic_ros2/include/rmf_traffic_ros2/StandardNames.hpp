@@ -35,6 +35,7 @@ const std::string RegisterQueryServiceName = Prefix + "register_query";
 const std::string UnregisterQueryServiceName = Prefix + "unregister_query";
 const std::string MirrorUpdateServiceName = Prefix + "mirror_update";
 const std::string MirrorWakeupTopicName = Prefix + "mirror_wakeup";
+const std::string MirrorPatchTopicPrefix = Prefix + "mirror_patch/query_";
 const std::string ScheduleInconsistencyTopicName = Prefix +
   "schedule_inconsistency";
 const std::string NegotiationAckTopicName = Prefix +
@@ -53,6 +54,12 @@ const std::string NegotiationForfeitTopicName = Prefix +
   "negotiation_forfeit";
 const std::string NegotiationConclusionTopicName = Prefix +
   "negotiation_conclusion";
+const std::string NegotiationProposalTopicPrefix = Prefix +
+  "negotiation_proposal/participant_";
+const std::string NegotiationRejectionTopicPrefix = Prefix +
+  "negotiation_rejection/participant_";
+const std::string NegotiationForfeitTopicPrefix = Prefix +
+  "negotiation_forfeit/participant_";
 
 const std::string BlockadeCancelTopicName = Prefix +
   "blockade_cancel";
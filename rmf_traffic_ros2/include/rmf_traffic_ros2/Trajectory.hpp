@@ -22,11 +22,18 @@
 
 #include <rmf_traffic/Trajectory.hpp>
 
+#include <rclcpp/node.hpp>
+
+#include <optional>
+
 namespace rmf_traffic_ros2 {
 
 //==============================================================================
 /// Convert from a Trajectory message to a Trajectory instance.
 ///
+/// Both the full precision and the compact encoding are accepted. A compact
+/// encoding is decoded straight into the Trajectory.
+///
 /// If the Trajectory is malformed, this will throw a std::runtime_error
 /// describing the issue.
 // TODO(MXG): Consider making conversion functions that do not require any
@@ -35,8 +42,97 @@ rmf_traffic::Trajectory convert(const rmf_traffic_msgs::msg::Trajectory& from);
 
 //==============================================================================
 /// Convert from a Trajectory instance to a Trajectory message.
+///
+/// This uses the compact encoding if one was chosen with
+/// set_default_trajectory_encoding() or declare_trajectory_encoding(),
+/// otherwise every waypoint is sent with full precision. This is also what the
+/// converters for routes, itineraries, schedule patches, and negotiation
+/// messages use.
 rmf_traffic_msgs::msg::Trajectory convert(const rmf_traffic::Trajectory& from);
 
+//==============================================================================
+/// Convert from a Trajectory instance to a Trajectory message with every
+/// waypoint at full precision, regardless of the default encoding that was
+/// chosen for this process. Use this when the message must convert back into
+/// exactly the same Trajectory.
+rmf_traffic_msgs::msg::Trajectory convert_full_precision(
+  const rmf_traffic::Trajectory& from);
+
+//==============================================================================
+/// The largest error that the compact Trajectory encoding may introduce into
+/// each kind of value. Values are rounded to steps of twice their tolerance,
+/// so a larger tolerance gives a more compact message.
+struct CompactTrajectoryTolerance
+{
+  /// Tolerance for the time of each waypoint
+  rmf_traffic::Duration time = std::chrono::microseconds(500);
+
+  /// Tolerance for the x and y coordinates of each position, in meters
+  double position = 5e-4;
+
+  /// Tolerance for the yaw of each position, in radians
+  double yaw = 5e-4;
+
+  /// Tolerance for the x and y components of each velocity, in meters per
+  /// second
+  double velocity = 5e-4;
+
+  /// Tolerance for the yaw rate of each velocity, in radians per second
+  double angular_velocity = 5e-4;
+};
+
+//==============================================================================
+/// Convert from a Trajectory instance to a Trajectory message using the
+/// compact encoding, which packs delta-coded, quantized waypoints into a byte
+/// array.
+///
+/// If the trajectory cannot be encoded within the tolerance, e.g. because two
+/// of its waypoints are closer together in time than the time tolerance, then
+/// it will be sent with full precision instead.
+///
+/// \throws std::invalid_argument if any tolerance is not positive.
+rmf_traffic_msgs::msg::Trajectory convert(
+  const rmf_traffic::Trajectory& from,
+  const CompactTrajectoryTolerance& tolerance);
+
+//==============================================================================
+/// Choose whether convert(const rmf_traffic::Trajectory&) should use the
+/// compact encoding for every Trajectory that is sent by this process. Pass in
+/// std::nullopt to go back to full precision, which is the default.
+///
+/// Messages are always decoded according to how they were encoded, so this
+/// only needs to be set by the processes that send trajectories. It is safe to
+/// call this while other threads are converting trajectories.
+///
+/// \throws std::invalid_argument if any tolerance is not positive.
+void set_default_trajectory_encoding(
+  std::optional<CompactTrajectoryTolerance> tolerance);
+
+//==============================================================================
+/// Get the compact encoding tolerance that is currently being used by default,
+/// if any.
+std::optional<CompactTrajectoryTolerance> get_default_trajectory_encoding();
+
+//==============================================================================
+/// Declare the parameters that choose the default trajectory encoding of this
+/// process on a node, and pass their values to
+/// set_default_trajectory_encoding().
+///
+/// The compact encoding is used if the "compact_trajectories" parameter is
+/// true. Its tolerances are then taken from the
+/// "compact_trajectory_time_tolerance_us",
+/// "compact_trajectory_position_tolerance",
+/// "compact_trajectory_yaw_tolerance",
+/// "compact_trajectory_velocity_tolerance", and
+/// "compact_trajectory_angular_velocity_tolerance" parameters, which default
+/// to the values of CompactTrajectoryTolerance.
+///
+/// \throws std::invalid_argument if any tolerance is not positive.
+///
+/// \return the encoding that was chosen.
+std::optional<CompactTrajectoryTolerance> declare_trajectory_encoding(
+  rclcpp::Node& node);
+
 } // namespace rmf_traffic_ros2
 
 #endif // RMF_TRAFFIC_ROS2__TRAJECTORY_HPP
@@ -44,9 +44,15 @@ public:
     /// \brief update_on_wakeup
     ///   Specify if the mirror should perform an update whenever it gets woken
     ///   up by the schedule.
+    ///
+    /// \brief stream_updates
+    ///   Specify if the mirror should apply the patches that the schedule node
+    ///   pushes for its query, instead of asking for a patch each time it gets
+    ///   woken up.
     Options(
       std::mutex* update_mutex = nullptr,
-      bool update_on_wakeup = true);
+      bool update_on_wakeup = true,
+      bool stream_updates = true);
 
     /// Get a reference to the mutex that will be used when performing an
     /// update.
@@ -63,6 +69,21 @@ public:
     /// Toggle the choice to wakeup on an update.
     Options& update_on_wakeup(bool choice);
 
+    /// True if the mirror should be kept up to date by the patches that the
+    /// schedule node publishes for its query. Each patch picks up where the
+    /// previous one left off, so the mirror only needs to make a MirrorUpdate
+    /// request when it first starts up or when it notices that it has missed a
+    /// patch.
+    ///
+    /// When this is false, the mirror will make a MirrorUpdate request each
+    /// time it receives a MirrorWakeup message instead.
+    ///
+    /// This has no effect if update_on_wakeup() is false.
+    bool stream_updates() const;
+
+    /// Toggle the choice to use streamed updates.
+    Options& stream_updates(bool choice);
+
     class Implementation;
   private:
     rmf_utils::impl_ptr<Implementation> _pimpl;
@@ -68,6 +68,37 @@ public:
   /// Get the current timeout duration setting.
   rmf_traffic::Duration timeout_duration() const;
 
+  /// Set the number of threads that can be used to respond to tables. When
+  /// this is more than 1, every table that is waiting for a response from one
+  /// of the registered negotiators gets responded to at the same time. Use 0
+  /// to pick the number of hardware threads.
+  ///
+  /// Negotiators that are used this way must be safe to run at the same time
+  /// as other Negotiator instances. Their responses will still be delivered to
+  /// the negotiation one at a time.
+  ///
+  /// The default is 1, which responds to the tables one at a time.
+  Negotiation& table_threads(std::size_t num_threads);
+
+  /// Get the number of threads that can be used to respond to tables.
+  std::size_t table_threads() const;
+
+  /// Turn scoped delivery on or off. When it is on, proposals, rejections, and
+  /// forfeits will only be received for negotiations that one of the
+  /// registered negotiators is participating in. The schedule node relays
+  /// those messages on a separate topic for each participant, so the messages
+  /// of all other negotiations never reach this node.
+  ///
+  /// While scoped delivery is on, the status update callback and table_view()
+  /// will not have any information about negotiations that none of the
+  /// registered negotiators are participating in.
+  ///
+  /// Scoped delivery is off by default.
+  Negotiation& scoped_delivery(bool on);
+
+  /// Check whether scoped delivery is turned on.
+  bool scoped_delivery() const;
+
   using TableViewPtr = rmf_traffic::schedule::Negotiation::Table::ViewerPtr;
   using StatusUpdateCallback =
     std::function<void (uint64_t conflict_version, TableViewPtr table_view)>;
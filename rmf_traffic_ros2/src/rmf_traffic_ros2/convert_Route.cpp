@@ -35,6 +35,16 @@ rmf_traffic_msgs::msg::Route convert(const rmf_traffic::Route& from)
   return output;
 }
 
+//==============================================================================
+rmf_traffic_msgs::msg::Route convert_full_precision(
+  const rmf_traffic::Route& from)
+{
+  rmf_traffic_msgs::msg::Route output;
+  output.map = from.map();
+  output.trajectory = convert_full_precision(from.trajectory());
+  return output;
+}
+
 //==============================================================================
 std::vector<rmf_traffic::Route> convert(
   const std::vector<rmf_traffic_msgs::msg::Route>& from)
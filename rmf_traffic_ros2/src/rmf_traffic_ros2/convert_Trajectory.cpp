@@ -20,6 +20,13 @@
 
 #include <rmf_traffic/geometry/Circle.hpp>
 
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
 #include <unordered_map>
 #include <vector>
 
@@ -37,9 +44,376 @@ std::array<double, 3> from_eigen(const Eigen::Vector3d& values)
   return {values[0], values[1], values[2]};
 }
 
+namespace {
+//==============================================================================
+// The compact encoding is laid out as:
+//
+//   u8       format version
+//   varint   number of waypoints
+//   varint   time step, in nanoseconds
+//   f64 x4   position, yaw, velocity, and angular velocity steps
+//   zigzag   time of the first waypoint, in nanoseconds
+//
+// followed by each waypoint:
+//
+//   varint   number of time steps since the previous waypoint (not present
+//            for the first waypoint)
+//   zigzag   x, y, yaw of the position, as a change in the number of steps
+//            from the previous waypoint
+//   zigzag   x, y, yaw of the velocity, also as a change in steps
+//
+// Each value is rounded to a whole number of steps. The steps are twice the
+// tolerance, so rounding never moves a value by more than its tolerance.
+// Delta-coding the rounded step counts instead of the raw values keeps those
+// errors from adding up along the trajectory.
+const uint8_t CompactFormatVersion = 1;
+
+// Beyond this many steps, a double can no longer represent every step count
+// exactly.
+const double MaxSteps = 9007199254740992.0; // 2^53
+
+//==============================================================================
+void put_varint(std::vector<uint8_t>& buffer, uint64_t value)
+{
+  while (value >= 0x80)
+  {
+    buffer.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+
+  buffer.push_back(static_cast<uint8_t>(value));
+}
+
+//==============================================================================
+void put_zigzag(std::vector<uint8_t>& buffer, const int64_t value)
+{
+  put_varint(
+    buffer,
+    (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+//==============================================================================
+void put_double(std::vector<uint8_t>& buffer, const double value)
+{
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  for (std::size_t i = 0; i < sizeof(bits); ++i)
+    buffer.push_back(static_cast<uint8_t>(bits >> (8*i)));
+}
+
+//==============================================================================
+class Reader
+{
+public:
+
+  Reader(const std::vector<uint8_t>& buffer)
+  : _data(buffer.data()),
+    _end(buffer.data() + buffer.size())
+  {
+    // Do nothing
+  }
+
+  uint8_t byte()
+  {
+    if (_data == _end)
+      fail("ends too early");
+
+    return *_data++;
+  }
+
+  uint64_t varint()
+  {
+    uint64_t value = 0;
+    for (unsigned int shift = 0; shift < 64; shift += 7)
+    {
+      const uint8_t b = byte();
+      value |= static_cast<uint64_t>(b & 0x7f) << shift;
+      if ((b & 0x80) == 0)
+        return value;
+    }
+
+    fail("has an invalid varint");
+    return 0;
+  }
+
+  int64_t zigzag()
+  {
+    const uint64_t value = varint();
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+  }
+
+  double real()
+  {
+    uint64_t bits = 0;
+    for (std::size_t i = 0; i < sizeof(bits); ++i)
+      bits |= static_cast<uint64_t>(byte()) << (8*i);
+
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  bool done() const
+  {
+    return _data == _end;
+  }
+
+  [[noreturn]] static void fail(const std::string& issue)
+  {
+    throw std::runtime_error(
+            "[rmf_traffic_ros2::convert] The packed Trajectory " + issue);
+  }
+
+private:
+  const uint8_t* _data;
+  const uint8_t* _end;
+};
+
+//==============================================================================
+struct Steps
+{
+  double position;
+  double yaw;
+  double velocity;
+  double angular_velocity;
+
+  std::array<double, 3> for_position() const
+  {
+    return {position, position, yaw};
+  }
+
+  std::array<double, 3> for_velocity() const
+  {
+    return {velocity, velocity, angular_velocity};
+  }
+};
+
+//==============================================================================
+/// Returns false if the sum would overflow.
+bool accumulate(int64_t& total, const int64_t delta)
+{
+  constexpr int64_t max = std::numeric_limits<int64_t>::max();
+  constexpr int64_t min = std::numeric_limits<int64_t>::min();
+  if (delta > 0 ? total > max - delta : total < min - delta)
+    return false;
+
+  total += delta;
+  return true;
+}
+
+//==============================================================================
+bool quantize(const double value, const double step, int64_t& output)
+{
+  const double count = std::round(value / step);
+  if (!std::isfinite(count) || std::abs(count) > MaxSteps)
+    return false;
+
+  output = static_cast<int64_t>(count);
+  return true;
+}
+
+//==============================================================================
+void validate(const CompactTrajectoryTolerance& tolerance)
+{
+  const auto positive = [](const double value)
+    {
+      return std::isfinite(value) && value > 0.0;
+    };
+
+  if (tolerance.time <= rmf_traffic::Duration(0)
+    || !positive(tolerance.position) || !positive(tolerance.yaw)
+    || !positive(tolerance.velocity) || !positive(tolerance.angular_velocity))
+  {
+    throw std::invalid_argument(
+            "[rmf_traffic_ros2::convert] Every CompactTrajectoryTolerance "
+            "value must be positive");
+  }
+}
+
+//==============================================================================
+/// Returns false if the trajectory cannot be packed within the tolerance.
+bool pack(
+  const rmf_traffic::Trajectory& from,
+  const CompactTrajectoryTolerance& tolerance,
+  std::vector<uint8_t>& buffer)
+{
+  const int64_t time_step = 2 * tolerance.time.count();
+  const Steps steps{
+    2.0 * tolerance.position,
+    2.0 * tolerance.yaw,
+    2.0 * tolerance.velocity,
+    2.0 * tolerance.angular_velocity
+  };
+
+  buffer.clear();
+  buffer.reserve(48 + 16*from.size());
+  buffer.push_back(CompactFormatVersion);
+  put_varint(buffer, from.size());
+  put_varint(buffer, static_cast<uint64_t>(time_step));
+  put_double(buffer, steps.position);
+  put_double(buffer, steps.yaw);
+  put_double(buffer, steps.velocity);
+  put_double(buffer, steps.angular_velocity);
+
+  const auto position_steps = steps.for_position();
+  const auto velocity_steps = steps.for_velocity();
+
+  int64_t start_time = 0;
+  int64_t last_time_count = 0;
+  std::array<int64_t, 3> last_position = {0, 0, 0};
+  std::array<int64_t, 3> last_velocity = {0, 0, 0};
+  bool first = true;
+  for (const auto& waypoint : from)
+  {
+    const int64_t time = waypoint.time().time_since_epoch().count();
+    if (first)
+    {
+      start_time = time;
+      put_zigzag(buffer, start_time);
+    }
+    else
+    {
+      // Waypoint times are always increasing, so the offset is positive
+      const int64_t time_count = (time - start_time + time_step/2) / time_step;
+      if (time_count <= last_time_count)
+        return false;
+
+      put_varint(buffer, static_cast<uint64_t>(time_count - last_time_count));
+      last_time_count = time_count;
+    }
+    first = false;
+
+    const Eigen::Vector3d p = waypoint.position();
+    const Eigen::Vector3d v = waypoint.velocity();
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+      int64_t count;
+      if (!quantize(p[i], position_steps[i], count))
+        return false;
+
+      put_zigzag(buffer, count - last_position[i]);
+      last_position[i] = count;
+    }
+
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+      int64_t count;
+      if (!quantize(v[i], velocity_steps[i], count))
+        return false;
+
+      put_zigzag(buffer, count - last_velocity[i]);
+      last_velocity[i] = count;
+    }
+  }
+
+  return true;
+}
+
+//==============================================================================
+rmf_traffic::Trajectory unpack(const std::vector<uint8_t>& buffer)
+{
+  Reader reader(buffer);
+  const uint8_t format = reader.byte();
+  if (format != CompactFormatVersion)
+  {
+    Reader::fail(
+      "has an unsupported format version [" + std::to_string(format) + "]");
+  }
+
+  const uint64_t size = reader.varint();
+  const int64_t time_step = static_cast<int64_t>(reader.varint());
+  if (time_step <= 0)
+  {
+    Reader::fail(
+      "has an invalid time step [" + std::to_string(time_step) + "]");
+  }
+
+  Steps steps;
+  steps.position = reader.real();
+  steps.yaw = reader.real();
+  steps.velocity = reader.real();
+  steps.angular_velocity = reader.real();
+  for (const double step :
+    {steps.position, steps.yaw, steps.velocity, steps.angular_velocity})
+  {
+    if (!std::isfinite(step) || step <= 0.0)
+      Reader::fail("has an invalid step [" + std::to_string(step) + "]");
+  }
+
+  const auto position_steps = steps.for_position();
+  const auto velocity_steps = steps.for_velocity();
+
+  rmf_traffic::Trajectory output;
+  int64_t start_time = 0;
+  int64_t time_count = 0;
+  std::array<int64_t, 3> position = {0, 0, 0};
+  std::array<int64_t, 3> velocity = {0, 0, 0};
+  for (uint64_t w = 0; w < size; ++w)
+  {
+    if (w == 0)
+    {
+      start_time = reader.zigzag();
+    }
+    else
+    {
+      const uint64_t delta = reader.varint();
+      if (delta == 0)
+        Reader::fail("has waypoints that are out of order");
+
+      const auto max_delta = static_cast<uint64_t>(
+        std::numeric_limits<int64_t>::max() - time_count);
+      if (delta > max_delta)
+        Reader::fail("has a waypoint time that overflows");
+
+      time_count += static_cast<int64_t>(delta);
+    }
+
+    Eigen::Vector3d p;
+    Eigen::Vector3d v;
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+      if (!accumulate(position[i], reader.zigzag()))
+        Reader::fail("has a position that overflows");
+
+      p[i] = static_cast<double>(position[i]) * position_steps[i];
+    }
+
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+      if (!accumulate(velocity[i], reader.zigzag()))
+        Reader::fail("has a velocity that overflows");
+
+      v[i] = static_cast<double>(velocity[i]) * velocity_steps[i];
+    }
+
+    int64_t time = start_time;
+    if (time_count > std::numeric_limits<int64_t>::max() / time_step
+      || !accumulate(time, time_count * time_step))
+    {
+      Reader::fail("has a waypoint time that overflows");
+    }
+
+    output.insert(
+      rmf_traffic::Time(rmf_traffic::Duration(time)), p, v);
+  }
+
+  if (!reader.done())
+    Reader::fail("has leftover bytes");
+
+  return output;
+}
+
+//==============================================================================
+std::shared_ptr<const CompactTrajectoryTolerance> default_encoding;
+
+} // anonymous namespace
+
 //==============================================================================
 rmf_traffic::Trajectory convert(const rmf_traffic_msgs::msg::Trajectory& from)
 {
+  if (!from.packed.empty())
+    return unpack(from.packed);
+
   rmf_traffic::Trajectory output;
 
   for (const auto& waypoint : from.waypoints)
@@ -70,11 +444,106 @@ rmf_traffic_msgs::msg::TrajectoryWaypoint convert_waypoint(
 //==============================================================================
 rmf_traffic_msgs::msg::Trajectory convert(const rmf_traffic::Trajectory& from)
 {
+  const auto tolerance = std::atomic_load(&default_encoding);
+  if (tolerance)
+    return convert(from, *tolerance);
+
+  return convert_full_precision(from);
+}
+
+//==============================================================================
+rmf_traffic_msgs::msg::Trajectory convert_full_precision(
+  const rmf_traffic::Trajectory& from)
+{
+  rmf_traffic_msgs::msg::Trajectory output;
+  output.waypoints.reserve(from.size());
+  for (const auto& waypoint : from)
+    output.waypoints.emplace_back(convert_waypoint(waypoint));
+
+  return output;
+}
+
+//==============================================================================
+rmf_traffic_msgs::msg::Trajectory convert(
+  const rmf_traffic::Trajectory& from,
+  const CompactTrajectoryTolerance& tolerance)
+{
+  validate(tolerance);
+
   rmf_traffic_msgs::msg::Trajectory output;
+  if (from.size() > 0 && pack(from, tolerance, output.packed))
+    return output;
+
+  output.packed.clear();
+  output.waypoints.reserve(from.size());
   for (const auto& waypoint : from)
     output.waypoints.emplace_back(convert_waypoint(waypoint));
 
   return output;
 }
 
+//==============================================================================
+void set_default_trajectory_encoding(
+  std::optional<CompactTrajectoryTolerance> tolerance)
+{
+  std::shared_ptr<const CompactTrajectoryTolerance> encoding;
+  if (tolerance)
+  {
+    validate(*tolerance);
+    encoding = std::make_shared<CompactTrajectoryTolerance>(*tolerance);
+  }
+
+  std::atomic_store(&default_encoding, std::move(encoding));
+}
+
+//==============================================================================
+std::optional<CompactTrajectoryTolerance> get_default_trajectory_encoding()
+{
+  const auto encoding = std::atomic_load(&default_encoding);
+  if (!encoding)
+    return std::nullopt;
+
+  return *encoding;
+}
+
+//==============================================================================
+std::optional<CompactTrajectoryTolerance> declare_trajectory_encoding(
+  rclcpp::Node& node)
+{
+  if (!node.declare_parameter<bool>("compact_trajectories", false))
+  {
+    set_default_trajectory_encoding(std::nullopt);
+    return std::nullopt;
+  }
+
+  CompactTrajectoryTolerance tolerance;
+  const auto time_us =
+    std::chrono::duration_cast<std::chrono::microseconds>(tolerance.time);
+  tolerance.time = std::chrono::microseconds(
+    node.declare_parameter<int64_t>(
+      "compact_trajectory_time_tolerance_us", time_us.count()));
+  tolerance.position = node.declare_parameter<double>(
+    "compact_trajectory_position_tolerance", tolerance.position);
+  tolerance.yaw = node.declare_parameter<double>(
+    "compact_trajectory_yaw_tolerance", tolerance.yaw);
+  tolerance.velocity = node.declare_parameter<double>(
+    "compact_trajectory_velocity_tolerance", tolerance.velocity);
+  tolerance.angular_velocity = node.declare_parameter<double>(
+    "compact_trajectory_angular_velocity_tolerance",
+    tolerance.angular_velocity);
+
+  set_default_trajectory_encoding(tolerance);
+
+  RCLCPP_INFO(
+    node.get_logger(),
+    "Sending trajectories with the compact encoding. Tolerances: time "
+    + std::to_string(tolerance.time.count()) + "ns, position "
+    + std::to_string(tolerance.position) + "m, yaw "
+    + std::to_string(tolerance.yaw) + "rad, velocity "
+    + std::to_string(tolerance.velocity) + "m/s, angular velocity "
+    + std::to_string(tolerance.angular_velocity) + "rad/s");
+
+  return tolerance;
+}
+
 } // namespace rmf_traffic_ros2
@@ -0,0 +1,305 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "internal_ConflictCheck.hpp"
+
+#include <rmf_traffic/DetectConflict.hpp>
+#include <rmf_traffic/schedule/Query.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <limits>
+#include <list>
+#include <set>
+
+namespace rmf_traffic_ros2 {
+namespace schedule {
+
+namespace {
+//==============================================================================
+/// A conservative bound on where a route might be occupied by its participant.
+/// Two routes can only have a conflict if their bounds overlap.
+struct BroadPhaseBound
+{
+  Eigen::Vector2d min;
+  Eigen::Vector2d max;
+};
+
+//==============================================================================
+BroadPhaseBound get_broad_phase_bound(
+  const rmf_traffic::Profile& profile,
+  const rmf_traffic::Trajectory& trajectory)
+{
+  BroadPhaseBound bound{
+    Eigen::Vector2d::Constant(std::numeric_limits<double>::infinity()),
+    Eigen::Vector2d::Constant(-std::numeric_limits<double>::infinity())
+  };
+
+  const auto include = [&bound](const Eigen::Vector3d& p)
+    {
+      bound.min = bound.min.cwiseMin(p.block<2, 1>(0, 0));
+      bound.max = bound.max.cwiseMax(p.block<2, 1>(0, 0));
+    };
+
+  // Each segment of the trajectory is a cubic Hermite spline, and the curve of
+  // a cubic spline is always contained by the convex hull of its Bezier
+  // control points, so the bounding box of the control points is a bounding
+  // box for the whole segment.
+  auto it = trajectory.begin();
+  include(it->position());
+  for (auto prev = it++; it != trajectory.end(); prev = it++)
+  {
+    const double dt = rmf_traffic::time::to_seconds(it->time() - prev->time());
+    include(prev->position() + prev->velocity()*dt/3.0);
+    include(it->position() - it->velocity()*dt/3.0);
+    include(it->position());
+  }
+
+  double radius = profile.footprint()->get_characteristic_length();
+  if (const auto& vicinity = profile.vicinity())
+    radius = std::max(radius, vicinity->get_characteristic_length());
+
+  bound.min -= Eigen::Vector2d::Constant(radius);
+  bound.max += Eigen::Vector2d::Constant(radius);
+  return bound;
+}
+
+//==============================================================================
+bool overlap(const BroadPhaseBound& a, const BroadPhaseBound& b)
+{
+  for (int i = 0; i < 2; ++i)
+  {
+    if (a.max[i] < b.min[i] || b.max[i] < a.min[i])
+      return false;
+  }
+
+  return true;
+}
+
+//==============================================================================
+/// A pair of routes that survived the broad phase
+struct Candidate
+{
+  const rmf_traffic::Profile* profile_a;
+  const rmf_traffic::Trajectory* trajectory_a;
+  const rmf_traffic::Profile* profile_b;
+  const rmf_traffic::Trajectory* trajectory_b;
+  std::pair<ConflictChecker::ParticipantId, ConflictChecker::ParticipantId>
+  participants;
+};
+
+// The number of candidates that a thread will claim at a time during the
+// narrow phase. This keeps the threads from fighting over the shared counter.
+const std::size_t CandidateChunkSize = 8;
+
+} // anonymous namespace
+
+//==============================================================================
+ConflictChecker::ConflictChecker(std::size_t num_threads)
+{
+  if (num_threads == 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+  // The thread that calls check() also does its share of the work, so we only
+  // need to create num_threads - 1 workers.
+  for (std::size_t i = 1; i < num_threads; ++i)
+    _workers.emplace_back([this]() { this->_work(); });
+}
+
+//==============================================================================
+std::size_t ConflictChecker::num_threads() const
+{
+  return _workers.size() + 1;
+}
+
+//==============================================================================
+void ConflictChecker::check(
+  const rmf_traffic::schedule::Viewer::View& view_changes,
+  const rmf_traffic::schedule::Viewer& viewer,
+  const Report& report)
+{
+  // We keep the views of the candidates alive until the narrow phase is
+  // finished, because the candidates refer to the data inside of them.
+  std::list<rmf_traffic::schedule::Viewer::View> candidate_views;
+  std::vector<Candidate> candidates;
+
+  for (const auto& vc : view_changes)
+  {
+    const auto& trajectory = vc.route.trajectory();
+    const auto* start_time = trajectory.start_time();
+    const auto* finish_time = trajectory.finish_time();
+    if (!start_time || !finish_time)
+      continue;
+
+    const auto& profile = vc.description.profile();
+    const auto vc_bound = get_broad_phase_bound(profile, trajectory);
+
+    // The mirror's timeline narrows this down to the routes on the same map
+    // whose time ranges overlap with the changed route.
+    candidate_views.emplace_back(
+      viewer.query(
+        rmf_traffic::schedule::make_query(
+          {vc.route.map()}, start_time, finish_time)));
+
+    for (const auto& candidate : candidate_views.back())
+    {
+      if (candidate.participant == vc.participant)
+      {
+        // There's no need to check a participant against itself
+        continue;
+      }
+
+      const auto& candidate_profile = candidate.description.profile();
+      const auto& candidate_trajectory = candidate.route.trajectory();
+      const auto candidate_bound =
+        get_broad_phase_bound(candidate_profile, candidate_trajectory);
+
+      if (!overlap(vc_bound, candidate_bound))
+        continue;
+
+      candidates.push_back(
+        Candidate{
+          &profile,
+          &trajectory,
+          &candidate_profile,
+          &candidate_trajectory,
+          std::minmax(candidate.participant, vc.participant)
+        });
+    }
+  }
+
+  // Run the narrow phase for every candidate, sharing the candidates between
+  // the threads of the pool.
+  std::vector<char> in_conflict(candidates.size(), false);
+  std::atomic_size_t next_candidate(0);
+  std::mutex error_mutex;
+  std::exception_ptr error;
+
+  const auto narrow_phase = [&]()
+    {
+      while (true)
+      {
+        const std::size_t begin = next_candidate.fetch_add(CandidateChunkSize);
+        if (begin >= candidates.size())
+          return;
+
+        const std::size_t end =
+          std::min(begin + CandidateChunkSize, candidates.size());
+
+        for (std::size_t i = begin; i < end; ++i)
+        {
+          const Candidate& c = candidates[i];
+          try
+          {
+            in_conflict[i] = rmf_traffic::DetectConflict::between(
+              *c.profile_a, *c.trajectory_a,
+              *c.profile_b, *c.trajectory_b).has_value();
+          }
+          catch (...)
+          {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error)
+              error = std::current_exception();
+          }
+        }
+      }
+    };
+
+  if (candidates.size() > CandidateChunkSize && !_workers.empty())
+    _run(narrow_phase);
+  else
+    narrow_phase();
+
+  if (error)
+    std::rethrow_exception(error);
+
+  // Merge the results in the order that the candidates were found, so that
+  // the reports do not depend on how the work was divided between threads.
+  std::set<std::pair<ParticipantId, ParticipantId>> reported;
+  for (std::size_t i = 0; i < candidates.size(); ++i)
+  {
+    if (!in_conflict[i])
+      continue;
+
+    const auto& participants = candidates[i].participants;
+    if (!reported.insert(participants).second)
+      continue;
+
+    report({participants.first, participants.second});
+  }
+}
+
+//==============================================================================
+ConflictChecker::~ConflictChecker()
+{
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _quit = true;
+  }
+  _job_cv.notify_all();
+
+  for (auto& worker : _workers)
+  {
+    if (worker.joinable())
+      worker.join();
+  }
+}
+
+//==============================================================================
+void ConflictChecker::_run(const std::function<void()>& job)
+{
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _job = job;
+    ++_job_count;
+    _busy_workers = _workers.size();
+  }
+  _job_cv.notify_all();
+
+  job();
+
+  std::unique_lock<std::mutex> lock(_mutex);
+  _done_cv.wait(lock, [&]() { return _busy_workers == 0; });
+  _job = nullptr;
+}
+
+//==============================================================================
+void ConflictChecker::_work()
+{
+  std::size_t last_job = 0;
+  std::unique_lock<std::mutex> lock(_mutex);
+  while (true)
+  {
+    _job_cv.wait(lock, [&]() { return _quit || _job_count != last_job; });
+    if (_quit)
+      return;
+
+    last_job = _job_count;
+    const auto job = _job;
+
+    lock.unlock();
+    job();
+    lock.lock();
+
+    if (--_busy_workers == 0)
+      _done_cv.notify_all();
+  }
+}
+
+} // namespace schedule
+} // namespace rmf_traffic_ros2
@@ -15,11 +15,14 @@
  *
 */
 
+#include "internal_MirrorPatchSync.hpp"
+
 #include <rmf_traffic_ros2/StandardNames.hpp>
 #include <rmf_traffic_ros2/schedule/MirrorManager.hpp>
 #include <rmf_traffic_ros2/schedule/Patch.hpp>
 #include <rmf_traffic_ros2/schedule/Query.hpp>
 
+#include <rmf_traffic_msgs/msg/mirror_patch.hpp>
 #include <rmf_traffic_msgs/msg/mirror_wakeup.hpp>
 
 #include <rmf_traffic_msgs/srv/mirror_update.hpp>
@@ -41,6 +44,9 @@ using UnregisterQueryClient = rclcpp::Client<UnregisterQuery>::SharedPtr;
 using MirrorWakeup = rmf_traffic_msgs::msg::MirrorWakeup;
 using MirrorWakeupSub = rclcpp::Subscription<MirrorWakeup>::SharedPtr;
 
+using MirrorPatch = rmf_traffic_msgs::msg::MirrorPatch;
+using MirrorPatchSub = rclcpp::Subscription<MirrorPatch>::SharedPtr;
+
 //==============================================================================
 class MirrorManager::Implementation
 {
@@ -51,15 +57,16 @@ public:
   MirrorUpdateClient mirror_update_client;
   UnregisterQueryClient unregister_query_client;
   MirrorWakeupSub mirror_wakeup_sub;
+  MirrorPatchSub mirror_patch_sub;
 
   MirrorUpdate::Request::SharedPtr request_msg;
+  MirrorUpdateFuture request_future;
 
   std::shared_ptr<rmf_traffic::schedule::Mirror> mirror;
 
-  bool initial_request = true;
-  bool waiting_for_reply = false;
-
-  rmf_traffic::schedule::Version next_minimum_version = 0;
+  // Keeps the streamed patches lined up with the mirror, and decides when a
+  // MirrorUpdate request is needed to catch up.
+  MirrorPatchSync patch_sync;
 
   Implementation(
     rclcpp::Node& _node,
@@ -72,16 +79,58 @@ public:
     mirror_update_client(std::move(_mirror_update_client)),
     unregister_query_client(std::move(_unregister_query_client)),
     request_msg(std::make_shared<MirrorUpdate::Request>()),
-    mirror(std::make_shared<rmf_traffic::schedule::Mirror>())
-  {
-    mirror_wakeup_sub = node.create_subscription<MirrorWakeup>(
-      MirrorWakeupTopicName, rclcpp::SystemDefaultsQoS(),
-      [&](const MirrorWakeup::SharedPtr msg)
+    mirror(std::make_shared<rmf_traffic::schedule::Mirror>()),
+    patch_sync(
+      [this]() { return mirror->latest_version(); },
+      [this](uint64_t minimum_version, bool initial_request)
       {
-        trigger_wakeup(msg->latest_version);
-      });
-
+        send_request(minimum_version, initial_request);
+      },
+      [this](uint64_t previous, uint64_t received)
+      {
+        RCLCPP_DEBUG(
+          node.get_logger(),
+          "Mirror [" + std::to_string(request_msg->query_id)
+          + "] received patch sequence [" + std::to_string(received)
+          + "] after [" + std::to_string(previous) + "]");
+      })
+  {
     request_msg->query_id = _query_id;
+    configure_subscriptions();
+  }
+
+  /// Only subscribe to the topic that the current options will make use of,
+  /// so that streaming mirrors are not also sent a wakeup for every change.
+  void configure_subscriptions()
+  {
+    if (options.stream_updates())
+    {
+      mirror_wakeup_sub.reset();
+      if (!mirror_patch_sub)
+      {
+        mirror_patch_sub = node.create_subscription<MirrorPatch>(
+          MirrorPatchTopicPrefix + std::to_string(request_msg->query_id),
+          rclcpp::SystemDefaultsQoS(),
+          [&](const MirrorPatch::SharedPtr msg)
+          {
+            receive_patch(msg);
+          });
+      }
+    }
+    else
+    {
+      mirror_patch_sub.reset();
+      patch_sync.reset_stream();
+      if (!mirror_wakeup_sub)
+      {
+        mirror_wakeup_sub = node.create_subscription<MirrorWakeup>(
+          MirrorWakeupTopicName, rclcpp::SystemDefaultsQoS(),
+          [&](const MirrorWakeup::SharedPtr msg)
+          {
+            trigger_wakeup(msg->latest_version);
+          });
+      }
+    }
   }
 
   void trigger_wakeup(uint64_t minimum_version)
@@ -90,29 +139,73 @@ public:
       update(minimum_version);
   }
 
+  void receive_patch(const MirrorPatch::SharedPtr& msg)
+  {
+    if (!options.update_on_wakeup())
+      return;
+
+    patch_sync.receive(
+      MirrorPatchSync::Patch{
+        msg->sequence,
+        msg->base_version,
+        msg->patch.latest_version,
+        [this, msg]() { apply_patch(*msg); }
+      });
+  }
+
+  void apply_patch(const MirrorPatch& msg)
+  {
+    try
+    {
+      apply(convert(msg.patch));
+    }
+    catch (const std::exception& e)
+    {
+      RCLCPP_ERROR(
+        node.get_logger(),
+        "[rmf_traffic_ros2::MirrorManager] Failed to deserialize "
+        "MirrorPatch message: " + std::string(e.what()));
+    }
+  }
+
+  void apply(const rmf_traffic::schedule::Patch& patch)
+  {
+    std::mutex* update_mutex = options.update_mutex();
+    if (update_mutex)
+    {
+      std::lock_guard<std::mutex> lock(*update_mutex);
+      mirror->update(patch);
+    }
+    else
+    {
+      mirror->update(patch);
+    }
+  }
+
   void update(
     uint64_t minimum_version,
     const rmf_traffic::Duration wait = rmf_traffic::Duration(0))
   {
-    if (waiting_for_reply)
-    {
-      next_minimum_version = minimum_version;
+    if (!patch_sync.request(minimum_version))
       return;
-    }
 
-    waiting_for_reply = true;
+    if (wait > rmf_traffic::Duration(0))
+      request_future.wait_for(wait);
+  }
+
+  void send_request(uint64_t minimum_version, bool initial_request)
+  {
     // TODO(MXG): What if the latest version has wrapped around the integer
     // overflow, but this is a fresh mirror starting up? We should have a ROS2
     // service to ask the schedule database what its oldest version is, and
     // initialize this value to that. Or maybe the mirror wakeup can publish
     // both its oldest and latest version.
-    // This is also relevant to the next_minimum_version value.
+    // This is also relevant to the next minimum version of the patch_sync.
     request_msg->latest_mirror_version = mirror->latest_version();
     request_msg->minimum_patch_version = minimum_version;
     request_msg->initial_request = initial_request;
-    initial_request = false;
 
-    const auto future = mirror_update_client->async_send_request(
+    request_future = mirror_update_client->async_send_request(
       request_msg,
       [&](const MirrorUpdateFuture response_future)
       {
@@ -129,20 +222,8 @@ public:
             + std::to_string(response->patch.latest_version)
             + "]: " + std::to_string(patch.size()) + " changes");
 
-          std::mutex* update_mutex = options.update_mutex();
-          if (update_mutex)
-          {
-            std::lock_guard<std::mutex> lock(*update_mutex);
-            mirror->update(patch);
-          }
-          else
-          {
-            mirror->update(patch);
-          }
-
-          waiting_for_reply = false;
-          if (patch.latest_version() < next_minimum_version)
-            update(next_minimum_version);
+          apply(patch);
+          patch_sync.reply_applied(patch.latest_version());
         }
         catch (const std::exception& e)
         {
@@ -150,11 +231,12 @@ public:
             node.get_logger(),
             "[rmf_traffic_ros2::MirrorManager] Failed to deserialize Patch "
             "message: " + std::string(e.what()));
+
+          // Let the next streamed patch trigger another attempt instead of
+          // holding onto patches that can no longer be lined up.
+          patch_sync.reply_failed();
         }
       });
-
-    if (wait > rmf_traffic::Duration(0))
-      future.wait_for(wait);
   }
 
   ~Implementation()
@@ -185,16 +267,20 @@ public:
 
   bool update_on_wakeup;
 
+  bool stream_updates;
+
 };
 
 //==============================================================================
 MirrorManager::Options::Options(
   std::mutex* update_mutex,
-  bool update_on_wakeup)
+  bool update_on_wakeup,
+  bool stream_updates)
 : _pimpl(rmf_utils::make_impl<Implementation>(
       Implementation{
         update_mutex,
-        update_on_wakeup
+        update_on_wakeup,
+        stream_updates
       }))
 {
   // Do nothing
@@ -226,6 +312,19 @@ auto MirrorManager::Options::update_on_wakeup(bool choice) -> Options&
   return *this;
 }
 
+//==============================================================================
+bool MirrorManager::Options::stream_updates() const
+{
+  return _pimpl->stream_updates;
+}
+
+//==============================================================================
+auto MirrorManager::Options::stream_updates(bool choice) -> Options&
+{
+  _pimpl->stream_updates = choice;
+  return *this;
+}
+
 //==============================================================================
 const rmf_traffic::schedule::Viewer& MirrorManager::viewer() const
 {
@@ -255,6 +354,7 @@ auto MirrorManager::get_options() const -> const Options&
 MirrorManager& MirrorManager::set_options(Options options)
 {
   _pimpl->options = std::move(options);
+  _pimpl->configure_subscriptions();
   return *this;
 }
 
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "internal_MirrorPatchSync.hpp"
+
+#include <rmf_utils/Modular.hpp>
+
+namespace rmf_traffic_ros2 {
+namespace schedule {
+
+//==============================================================================
+MirrorPatchSync::MirrorPatchSync(
+  MirrorVersion mirror_version,
+  SendRequest send_request,
+  SequenceGap sequence_gap)
+: _mirror_version(std::move(mirror_version)),
+  _send_request(std::move(send_request)),
+  _sequence_gap(std::move(sequence_gap))
+{
+  // Do nothing
+}
+
+//==============================================================================
+void MirrorPatchSync::receive(Patch patch)
+{
+  if (_waiting_for_reply)
+  {
+    _held.push_back(std::move(patch));
+    return;
+  }
+
+  _process(patch);
+}
+
+//==============================================================================
+bool MirrorPatchSync::request(const Version minimum_version)
+{
+  if (_waiting_for_reply)
+  {
+    _next_minimum_version = minimum_version;
+    return false;
+  }
+
+  _waiting_for_reply = true;
+  const bool initial_request = _initial_request;
+  _initial_request = false;
+  _send_request(minimum_version, initial_request);
+  return true;
+}
+
+//==============================================================================
+void MirrorPatchSync::reply_applied(const Version reply_version)
+{
+  _waiting_for_reply = false;
+  if (reply_version < _next_minimum_version)
+  {
+    request(_next_minimum_version);
+    return;
+  }
+
+  auto held = std::move(_held);
+  _held.clear();
+  for (auto& patch : held)
+  {
+    // Processing a patch might send another request, in which case the rest
+    // need to wait for that one to be answered.
+    if (_waiting_for_reply)
+      _held.push_back(std::move(patch));
+    else
+      _process(patch);
+  }
+}
+
+//==============================================================================
+void MirrorPatchSync::reply_failed()
+{
+  _waiting_for_reply = false;
+  _held.clear();
+}
+
+//==============================================================================
+void MirrorPatchSync::reset_stream()
+{
+  _held.clear();
+  _last_sequence = rmf_utils::nullopt;
+}
+
+//==============================================================================
+bool MirrorPatchSync::waiting_for_reply() const
+{
+  return _waiting_for_reply;
+}
+
+//==============================================================================
+std::size_t MirrorPatchSync::held_patches() const
+{
+  return _held.size();
+}
+
+//==============================================================================
+void MirrorPatchSync::_process(const Patch& patch)
+{
+  if (_last_sequence && patch.sequence != *_last_sequence + 1 && _sequence_gap)
+    _sequence_gap(*_last_sequence, patch.sequence);
+
+  _last_sequence = patch.sequence;
+
+  const auto current_version = _mirror_version();
+  if (!_initial_request)
+  {
+    if (patch.base_version == current_version)
+    {
+      patch.apply();
+      return;
+    }
+
+    // We already caught up past this patch while resyncing
+    if (rmf_utils::modular(patch.latest_version)
+      .less_than_or_equal(current_version))
+      return;
+  }
+
+  // Either this mirror has never been synced or at least one patch was missed,
+  // so we need to ask the schedule node to catch us up.
+  request(patch.latest_version);
+}
+
+} // namespace schedule
+} // namespace rmf_traffic_ros2
@@ -34,6 +34,8 @@
 
 #include <rclcpp/logging.hpp>
 
+#include <algorithm>
+
 namespace rmf_traffic_ros2 {
 namespace schedule {
 
@@ -56,6 +58,13 @@ std::string ptr_to_string(T* ptr)
   return str.str();
 }
 
+//==============================================================================
+rclcpp::QoS negotiation_qos()
+{
+  // TODO(MXG): Make the QoS configurable
+  return rclcpp::ServicesQoS().reliable().keep_last(1000);
+}
+
 //==============================================================================
 class Negotiation::Implementation
 {
@@ -214,6 +223,10 @@ public:
   std::shared_ptr<Worker> worker;
   rmf_traffic::Duration timeout = std::chrono::seconds(15);
 
+  // The number of threads that sibling tables can be responded to with. When
+  // this is 1, the tables are responded to one at a time.
+  std::size_t table_threads = 1;
+
   using Repeat = rmf_traffic_msgs::msg::NegotiationRepeat;
   using RepeatSub = rclcpp::Subscription<Repeat>;
   using RepeatPub = rclcpp::Publisher<Repeat>;
@@ -261,6 +274,23 @@ public:
   using WeakNegotiationMapPtr = std::weak_ptr<NegotiatorMap>;
   NegotiationMapPtr negotiators;
 
+  // When scoped delivery is on, proposals, rejections, and forfeits are only
+  // received on the topics that the schedule node relays to each of our
+  // negotiators, instead of on the topics that every fleet adapter shares.
+  bool scoped = false;
+  struct ScopedSubscriptions
+  {
+    ProposalSub::SharedPtr proposal;
+    RejectionSub::SharedPtr rejection;
+    ForfeitSub::SharedPtr forfeit;
+  };
+
+  using ScopedSubscriptionMap =
+    std::unordered_map<ParticipantId, ScopedSubscriptions>;
+  using ScopedSubscriptionMapPtr = std::shared_ptr<ScopedSubscriptionMap>;
+  using WeakScopedSubscriptionMapPtr = std::weak_ptr<ScopedSubscriptionMap>;
+  ScopedSubscriptionMapPtr scoped_subscriptions;
+
   using Version = rmf_traffic::schedule::Version;
   using Negotiation = rmf_traffic::schedule::Negotiation;
   struct Entry
@@ -274,6 +304,17 @@ public:
   // The negotiations that this Negotiation class is involved in
   NegotiationMap negotiations;
 
+  // The schedule node may relay messages for a negotiation before we have
+  // received the notice for it, e.g. when catching up a participant that was
+  // added to a negotiation which was already underway. Those messages are
+  // held here until the notice arrives.
+  struct EarlyMessages
+  {
+    std::chrono::steady_clock::time_point since;
+    std::vector<std::function<void()>> handlers;
+  };
+  std::unordered_map<Version, EarlyMessages> early_messages;
+
   using TablePtr = rmf_traffic::schedule::Negotiation::TablePtr;
   using ItineraryVersion = rmf_traffic::schedule::ItineraryVersion;
   using UpdateVersion = rmf_utils::optional<ItineraryVersion>;
@@ -307,10 +348,10 @@ public:
   : node(node_),
     viewer(std::move(viewer_)),
     worker(std::move(worker_)),
-    negotiators(std::make_shared<NegotiatorMap>())
+    negotiators(std::make_shared<NegotiatorMap>()),
+    scoped_subscriptions(std::make_shared<ScopedSubscriptionMap>())
   {
-    // TODO(MXG): Make the QoS configurable
-    const auto qos = rclcpp::ServicesQoS().reliable().keep_last(1000);
+    const auto qos = negotiation_qos();
 
     repeat_sub = node.create_subscription<Repeat>(
       NegotiationRepeatTopicName, qos,
@@ -335,6 +376,32 @@ public:
     refusal_pub = node.create_publisher<Refusal>(
       NegotiationRefusalTopicName, qos);
 
+    proposal_pub = node.create_publisher<Proposal>(
+      NegotiationProposalTopicName, qos);
+
+    rejection_pub = node.create_publisher<Rejection>(
+      NegotiationRejectionTopicName, qos);
+
+    forfeit_pub = node.create_publisher<Forfeit>(
+      NegotiationForfeitTopicName, qos);
+
+    conclusion_sub = node.create_subscription<Conclusion>(
+      NegotiationConclusionTopicName, qos,
+      [&](const Conclusion::UniquePtr msg)
+      {
+        this->receive_conclusion(*msg);
+      });
+
+    ack_pub = node.create_publisher<Ack>(
+      NegotiationAckTopicName, qos);
+
+    subscribe_to_all_negotiations();
+  }
+
+  void subscribe_to_all_negotiations()
+  {
+    const auto qos = negotiation_qos();
+
     proposal_sub = node.create_subscription<Proposal>(
       NegotiationProposalTopicName, qos,
       [&](const Proposal::UniquePtr msg)
@@ -342,9 +409,6 @@ public:
         this->receive_proposal(*msg);
       });
 
-    proposal_pub = node.create_publisher<Proposal>(
-      NegotiationProposalTopicName, qos);
-
     rejection_sub = node.create_subscription<Rejection>(
       NegotiationRejectionTopicName, qos,
       [&](const Rejection::UniquePtr msg)
@@ -352,28 +416,100 @@ public:
         this->receive_rejection(*msg);
       });
 
-    rejection_pub = node.create_publisher<Rejection>(
-      NegotiationRejectionTopicName, qos);
-
     forfeit_sub = node.create_subscription<Forfeit>(
       NegotiationForfeitTopicName, qos,
       [&](const Forfeit::UniquePtr msg)
       {
         this->receive_forfeit(*msg);
       });
+  }
 
-    forfeit_pub = node.create_publisher<Forfeit>(
-      NegotiationForfeitTopicName, qos);
+  void subscribe_to_participant(const ParticipantId participant)
+  {
+    const auto qos = negotiation_qos();
+    const auto suffix = std::to_string(participant);
 
-    conclusion_sub = node.create_subscription<Conclusion>(
-      NegotiationConclusionTopicName, qos,
-      [&](const Conclusion::UniquePtr msg)
+    ScopedSubscriptions subscriptions;
+    subscriptions.proposal = node.create_subscription<Proposal>(
+      NegotiationProposalTopicPrefix + suffix, qos,
+      [&](const Proposal::UniquePtr msg)
       {
-        this->receive_conclusion(*msg);
+        this->receive_proposal(*msg);
       });
 
-    ack_pub = node.create_publisher<Ack>(
-      NegotiationAckTopicName, qos);
+    subscriptions.rejection = node.create_subscription<Rejection>(
+      NegotiationRejectionTopicPrefix + suffix, qos,
+      [&](const Rejection::UniquePtr msg)
+      {
+        this->receive_rejection(*msg);
+      });
+
+    subscriptions.forfeit = node.create_subscription<Forfeit>(
+      NegotiationForfeitTopicPrefix + suffix, qos,
+      [&](const Forfeit::UniquePtr msg)
+      {
+        this->receive_forfeit(*msg);
+      });
+
+    (*scoped_subscriptions)[participant] = std::move(subscriptions);
+  }
+
+  void set_scoped_delivery(const bool on)
+  {
+    if (on == scoped)
+      return;
+
+    scoped = on;
+    if (scoped)
+    {
+      proposal_sub.reset();
+      rejection_sub.reset();
+      forfeit_sub.reset();
+
+      for (const auto& n : *negotiators)
+        subscribe_to_participant(n.first);
+    }
+    else
+    {
+      scoped_subscriptions->clear();
+      subscribe_to_all_negotiations();
+    }
+  }
+
+  void hold_early_message(
+    const Version conflict_version,
+    std::function<void()> handler)
+  {
+    const auto now = std::chrono::steady_clock::now();
+
+    // If a notice has not arrived for this long, then the messages most likely
+    // belong to a negotiation that has already concluded.
+    for (auto it = early_messages.begin(); it != early_messages.end(); )
+    {
+      if (it->first != conflict_version && timeout < now - it->second.since)
+        it = early_messages.erase(it);
+      else
+        ++it;
+    }
+
+    auto& early = early_messages[conflict_version];
+    if (early.handlers.empty())
+      early.since = now;
+
+    early.handlers.emplace_back(std::move(handler));
+  }
+
+  void release_early_messages(const Version conflict_version)
+  {
+    const auto it = early_messages.find(conflict_version);
+    if (it == early_messages.end())
+      return;
+
+    const auto handlers = std::move(it->second.handlers);
+    early_messages.erase(it);
+
+    for (const auto& handler : handlers)
+      handler();
   }
 
   void receive_repeat_request(const Repeat& msg)
@@ -422,6 +558,9 @@ public:
       std::vector<TablePtr> queue,
       Version conflict_version)
   {
+    if (table_threads != 1)
+      return respond_to_queue_in_parallel(std::move(queue), conflict_version);
+
     while (!queue.empty())
     {
       const auto top = queue.back();
@@ -463,6 +602,75 @@ public:
     }
   }
 
+  /// Respond to every table in the queue at once, then move on to whichever
+  /// tables those responses have opened up. Sibling tables always belong to
+  /// different participants, so their negotiators can plan at the same time.
+  void respond_to_queue_in_parallel(
+      std::vector<TablePtr> queue,
+      Version conflict_version)
+  {
+    using Request = rmf_traffic::schedule::Negotiator::Request;
+
+    while (!queue.empty())
+    {
+      std::vector<TablePtr> batch;
+      std::vector<Request> requests;
+      for (const auto& table : queue)
+      {
+        if (table->defunct())
+          continue;
+
+        if (std::find(batch.begin(), batch.end(), table) != batch.end())
+          continue;
+
+        if (table->submission())
+        {
+          batch.push_back(table);
+          continue;
+        }
+
+        const auto n_it = negotiators->find(table->participant());
+        if (n_it == negotiators->end())
+          continue;
+
+        // TODO(MXG): Make this limit configurable
+        if (table->version() > 3)
+        {
+          // Give up on this table at this point to avoid an infinite loop
+          table->forfeit(table->version());
+          publish_forfeit(conflict_version, *table);
+          continue;
+        }
+
+        batch.push_back(table);
+        requests.push_back(
+          Request{
+            n_it->second.get(),
+            table->viewer(),
+            Responder::make(this, conflict_version, table)
+          });
+      }
+
+      rmf_traffic::schedule::Negotiator::respond_in_parallel(
+        requests, table_threads);
+
+      queue.clear();
+      for (const auto& table : batch)
+      {
+        if (table->submission())
+        {
+          for (const auto& c : table->children())
+            queue.push_back(c);
+        }
+        else if (const auto& parent = table->parent())
+        {
+          if (parent->rejected())
+            queue.push_back(parent);
+        }
+      }
+    }
+  }
+
   void receive_notice(const Notice& msg)
   {
     bool relevant = false;
@@ -475,6 +683,12 @@ public:
       }
     }
 
+    if (!relevant && scoped)
+    {
+      // We will never receive the proposals for this negotiation, so there is
+      // no point in keeping track of it.
+      return;
+    }
 
     auto new_negotiation = Negotiation::make(
           viewer->snapshot(), msg.participants);
@@ -496,6 +710,8 @@ public:
       const auto n_it = negotiations.find(msg.conflict_version);
       if (n_it != negotiations.end())
         negotiations.erase(n_it);
+
+      early_messages.erase(msg.conflict_version);
       return;
     }
 
@@ -533,6 +749,7 @@ public:
       queue.push_back(negotiation.table(p, {}));
 
     respond_to_queue(queue, msg.conflict_version);
+    release_early_messages(msg.conflict_version);
   }
 
   void receive_proposal(const Proposal& msg)
@@ -540,7 +757,13 @@ public:
     const auto negotiate_it = negotiations.find(msg.conflict_version);
     if (negotiate_it == negotiations.end())
     {
-      // This negotiation has probably been completed already
+      if (scoped)
+      {
+        hold_early_message(
+          msg.conflict_version, [this, msg]() { receive_proposal(msg); });
+      }
+
+      // Otherwise this negotiation has probably been completed already
       return;
     }
 
@@ -604,9 +827,16 @@ public:
     const auto negotiate_it = negotiations.find(msg.conflict_version);
     if (negotiate_it == negotiations.end())
     {
-      // We don't need to worry about caching an unknown rejection, because it
-      // is impossible for a proposal that was produced by this negotiation
-      // instance to be rejected without us being aware of that proposal.
+      if (scoped)
+      {
+        hold_early_message(
+          msg.conflict_version, [this, msg]() { receive_rejection(msg); });
+      }
+
+      // Otherwise we don't need to worry about caching an unknown rejection,
+      // because it is impossible for a proposal that was produced by this
+      // negotiation instance to be rejected without us being aware of that
+      // proposal.
       return;
     }
 
@@ -661,9 +891,16 @@ public:
     const auto negotiate_it = negotiations.find(msg.conflict_version);
     if (negotiate_it == negotiations.end())
     {
-      // We don't need to worry about caching an unknown rejection, because it
-      // is impossible for a proposal that was produced by this negotiation
-      // instance to be rejected without us being aware of that proposal.
+      if (scoped)
+      {
+        hold_early_message(
+          msg.conflict_version, [this, msg]() { receive_forfeit(msg); });
+      }
+
+      // Otherwise we don't need to worry about caching an unknown forfeit,
+      // because it is impossible for a proposal that was produced by this
+      // negotiation instance to be forfeited without us being aware of that
+      // proposal.
       return;
     }
 
@@ -680,6 +917,11 @@ public:
       return;
     }
 
+    // With scoped delivery, the same forfeit is relayed once for each of our
+    // negotiators that is in the negotiation.
+    if (table->forfeited())
+      return;
+
     table->forfeit(msg.table.back().version);
 
     if (status_callback)
@@ -749,6 +991,8 @@ public:
 
   void receive_conclusion(const Conclusion& msg)
   {
+    early_messages.erase(msg.conflict_version);
+
     const auto negotiate_it = negotiations.find(msg.conflict_version);
     if (negotiate_it == negotiations.end())
     {
@@ -956,20 +1200,26 @@ public:
   {
     Handle(
       const ParticipantId for_participant_,
-      NegotiationMapPtr map)
+      NegotiationMapPtr map,
+      ScopedSubscriptionMapPtr subscriptions)
     : for_participant(for_participant_),
-      weak_map(map)
+      weak_map(map),
+      weak_subscriptions(subscriptions)
     {
       // Do nothing
     }
 
     ParticipantId for_participant;
     WeakNegotiationMapPtr weak_map;
+    WeakScopedSubscriptionMapPtr weak_subscriptions;
 
     ~Handle()
     {
       if (const auto map = weak_map.lock())
         map->erase(for_participant);
+
+      if (const auto subscriptions = weak_subscriptions.lock())
+        subscriptions->erase(for_participant);
     }
   };
 
@@ -990,7 +1240,11 @@ public:
       // *INDENT-ON*
     }
 
-    return std::make_shared<Handle>(for_participant, negotiators);
+    if (scoped)
+      subscribe_to_participant(for_participant);
+
+    return std::make_shared<Handle>(
+      for_participant, negotiators, scoped_subscriptions);
   }
 
   void set_retained_history_count(uint count)
@@ -1080,6 +1334,32 @@ rmf_traffic::Duration Negotiation::timeout_duration() const
   return _pimpl->timeout;
 }
 
+//==============================================================================
+Negotiation& Negotiation::table_threads(const std::size_t num_threads)
+{
+  _pimpl->table_threads = num_threads;
+  return *this;
+}
+
+//==============================================================================
+std::size_t Negotiation::table_threads() const
+{
+  return _pimpl->table_threads;
+}
+
+//==============================================================================
+Negotiation& Negotiation::scoped_delivery(const bool on)
+{
+  _pimpl->set_scoped_delivery(on);
+  return *this;
+}
+
+//==============================================================================
+bool Negotiation::scoped_delivery() const
+{
+  return _pimpl->scoped;
+}
+
 //==============================================================================
 Negotiation::TableViewPtr Negotiation::table_view(
     uint64_t conflict_version,
@@ -25,6 +25,8 @@
 #include <rmf_traffic_msgs/msg/negotiation_forfeit.hpp>
 #include <rmf_traffic_msgs/msg/negotiation_key.hpp>
 
+#include <rclcpp/qos.hpp>
+
 #include <list>
 
 namespace rmf_traffic_ros2 {
@@ -43,6 +45,10 @@ using ParticipantId = rmf_traffic::schedule::ParticipantId;
 using NegotiatorPtr = std::unique_ptr<rmf_traffic::schedule::Negotiator>;
 using NegotiatorMap = std::unordered_map<ParticipantId, NegotiatorPtr>;
 
+//==============================================================================
+/// The QoS of the topics that negotiation messages are sent over
+rclcpp::QoS negotiation_qos();
+
 //==============================================================================
 // TODO(MXG): Refactor this class into something more broadly usable.
 struct NegotiationRoom
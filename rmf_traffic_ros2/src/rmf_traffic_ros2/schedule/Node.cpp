@@ -16,6 +16,7 @@
 */
 
 #include "internal_Node.hpp"
+#include "internal_ConflictCheck.hpp"
 
 #include <cstring>
 
@@ -30,56 +31,16 @@
 #include <rmf_traffic_ros2/schedule/ParticipantDescription.hpp>
 #include <rmf_traffic_ros2/schedule/Inconsistencies.hpp>
 
-#include <rmf_traffic/DetectConflict.hpp>
 #include <rmf_traffic/schedule/Mirror.hpp>
 
 #include <rmf_utils/optional.hpp>
 
+#include <algorithm>
 #include <unordered_map>
 
 namespace rmf_traffic_ros2 {
 namespace schedule {
 
-//==============================================================================
-std::vector<ScheduleNode::ConflictSet> get_conflicts(
-  const rmf_traffic::schedule::Viewer::View& view_changes,
-  const rmf_traffic::schedule::ItineraryViewer& viewer)
-{
-  std::vector<ScheduleNode::ConflictSet> conflicts;
-  const auto& participants = viewer.participant_ids();
-  for (const auto participant : participants)
-  {
-    const auto itinerary = *viewer.get_itinerary(participant);
-    const auto& description = *viewer.get_participant(participant);
-    for (auto vc = view_changes.begin(); vc != view_changes.end(); ++vc)
-    {
-      if (vc->participant == participant)
-      {
-        // There's no need to check a participant against itself
-        continue;
-      }
-
-      for (const auto& route : itinerary)
-      {
-        assert(route);
-        if (route->map() != vc->route.map())
-          continue;
-
-        if (rmf_traffic::DetectConflict::between(
-            vc->description.profile(),
-            vc->route.trajectory(),
-            description.profile(),
-            route->trajectory()))
-        {
-          conflicts.push_back({participant, vc->participant});
-        }
-      }
-    }
-  }
-
-  return conflicts;
-}
-
 //==============================================================================
 ScheduleNode::ScheduleNode(const rclcpp::NodeOptions& options)
 : Node("rmf_traffic_schedule_node", options),
@@ -115,6 +76,72 @@ ScheduleNode::ScheduleNode(const rclcpp::NodeOptions& options)
     throw e;
   }
 
+  // The itineraries are only persisted if a directory is given for their log.
+  declare_parameter<std::string>("write_ahead_log", "");
+  std::string write_ahead_log_directory;
+  get_parameter_or<std::string>(
+    "write_ahead_log",
+    write_ahead_log_directory,
+    "");
+
+  if (!write_ahead_log_directory.empty())
+  {
+    WriteAheadLog::Options wal_options;
+    declare_parameter<int>(
+      "write_ahead_log_sync_period_ms",
+      static_cast<int>(wal_options.sync_period.count()));
+    declare_parameter<int>(
+      "write_ahead_log_checkpoint_interval",
+      static_cast<int>(wal_options.checkpoint_interval));
+
+    int sync_period_ms = static_cast<int>(wal_options.sync_period.count());
+    get_parameter_or<int>(
+      "write_ahead_log_sync_period_ms",
+      sync_period_ms,
+      sync_period_ms);
+    wal_options.sync_period = std::chrono::milliseconds(
+      std::max(1, sync_period_ms));
+
+    int checkpoint_interval = static_cast<int>(wal_options.checkpoint_interval);
+    get_parameter_or<int>(
+      "write_ahead_log_checkpoint_interval",
+      checkpoint_interval,
+      checkpoint_interval);
+    wal_options.checkpoint_interval =
+      static_cast<std::size_t>(std::max(1, checkpoint_interval));
+
+    try
+    {
+      write_ahead_log = std::make_unique<WriteAheadLog>(
+        write_ahead_log_directory, wal_options);
+
+      const auto recovery = write_ahead_log->recover(*database);
+      const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        recovery.replay_time).count();
+
+      RCLCPP_INFO(
+        get_logger(),
+        "Recovered schedule from [" + write_ahead_log_directory + "] in "
+        + std::to_string(ms) + "ms: "
+        + std::to_string(recovery.checkpoint_records)
+        + " itineraries from the checkpoint and "
+        + std::to_string(recovery.log_records) + " logged changes ("
+        + std::to_string(recovery.rejected_records) + " rejected)"
+        + (recovery.truncated_tail ? ". A damaged tail was cut off." : "")
+        + (recovery.discarded_invalid ?
+        ". The previous log had been invalidated, so it was discarded." : ""));
+    }
+    catch (const std::exception& e)
+    {
+      RCLCPP_FATAL(
+        get_logger(),
+        "Failed to recover the schedule from [%s]: %s",
+        write_ahead_log_directory.c_str(),
+        e.what());
+      throw;
+    }
+  }
+
   // TODO(MXG): As soon as possible, all of these services should be made
   // multi-threaded so they can be parallel processed.
   register_query_service =
@@ -254,11 +281,34 @@ ScheduleNode::ScheduleNode(const rclcpp::NodeOptions& options)
   conflict_conclusion_pub = create_publisher<ConflictConclusion>(
     rmf_traffic_ros2::NegotiationConclusionTopicName, negotiation_qos);
 
+  // The participants that were restored from the registry will not register
+  // with this node again, so their relays need to be created now.
+  for (const auto participant : database->participant_ids())
+    relay_for(participant);
+
+  // Choose how the trajectories of the patches that get sent to the mirrors are
+  // encoded. The write-ahead log always keeps full precision.
+  rmf_traffic_ros2::declare_trajectory_encoding(*this);
+
+  // The number of threads that check for conflicts between routes. A value of
+  // 0 will use all the hardware threads that are available.
+  declare_parameter<int>("conflict_check_threads", 1);
+  int conflict_check_threads = 1;
+  get_parameter_or<int>(
+    "conflict_check_threads",
+    conflict_check_threads,
+    1);
+  conflict_check_threads = std::max(0, conflict_check_threads);
+  RCLCPP_INFO(get_logger(),
+    "Using %d thread(s) for conflict checking",
+    conflict_check_threads);
+
   conflict_check_quit = false;
   conflict_check_thread = std::thread(
-    [&]()
+    [&, conflict_check_threads]()
     {
       rmf_traffic::schedule::Mirror mirror;
+      ConflictChecker conflict_checker(conflict_check_threads);
       const auto query_all = rmf_traffic::schedule::query_all();
       Version last_checked_version = 0;
 
@@ -300,19 +350,28 @@ ScheduleNode::ScheduleNode(const rclcpp::NodeOptions& options)
           }
         }
 
-        const auto conflicts = get_conflicts(view_changes, mirror);
         std::unordered_map<Version, const Negotiation*> new_negotiations;
-        for (const auto& conflict : conflicts)
-        {
-          std::unique_lock<std::mutex> lock(active_conflicts_mutex);
-          const auto new_negotiation = active_conflicts.insert(conflict);
-
-          if (new_negotiation)
-            new_negotiations[new_negotiation->first] = new_negotiation->second;
-        }
+        conflict_checker.check(
+          view_changes, mirror,
+          [&](const ConflictSet& conflict)
+          {
+            std::unique_lock<std::mutex> lock(active_conflicts_mutex);
+            const auto new_negotiation = active_conflicts.insert(conflict);
+
+            if (new_negotiation)
+            {
+              new_negotiations[new_negotiation->first] =
+                new_negotiation->second;
+            }
+          });
 
+        std::unique_lock<std::mutex> lock(active_conflicts_mutex);
         for (const auto& n : new_negotiations)
         {
+          // The negotiation might have concluded since it was inserted
+          if (!active_conflicts.negotiation(n.first))
+            continue;
+
           ConflictNotice msg;
           msg.conflict_version = n.first;
 
@@ -321,6 +380,7 @@ ScheduleNode::ScheduleNode(const rclcpp::NodeOptions& options)
             participants.begin(), participants.end());
 
           conflict_notice_pub->publish(msg);
+          open_relay(n.first, *n.second);
         }
       }
     });
@@ -362,6 +422,14 @@ void ScheduleNode::register_query(
   registered_queries.insert(
     std::make_pair(query_id, rmf_traffic_ros2::convert(request->query)));
 
+  // Mirrors get their initial state from a MirrorUpdate request, so the stream
+  // only needs to carry the changes that come after this point.
+  auto& stream = mirror_streams[query_id];
+  stream.publisher = create_publisher<MirrorPatch>(
+    rmf_traffic_ros2::MirrorPatchTopicPrefix + std::to_string(query_id),
+    rclcpp::SystemDefaultsQoS());
+  stream.last_version = database->latest_version();
+
   response->query_id = query_id;
   RCLCPP_INFO(
     get_logger(),
@@ -388,6 +456,7 @@ void ScheduleNode::unregister_query(
   }
 
   registered_queries.erase(it);
+  mirror_streams.erase(request->query_id);
   response->confirmation = true;
 
   RCLCPP_INFO(
@@ -419,6 +488,13 @@ void ScheduleNode::register_participant(
         .last_route_id(registration.last_route_id())
         .error("");
 
+    {
+      // Create the relay ahead of time so its topics are discovered before the
+      // participant ends up in a negotiation.
+      std::lock_guard<std::mutex> lock2(active_conflicts_mutex);
+      relay_for(response->participant_id);
+    }
+
     RCLCPP_INFO(
       get_logger(),
       "Registered participant [" + std::to_string(response->participant_id)
@@ -464,9 +540,23 @@ void ScheduleNode::unregister_participant(
     const std::string owner = p->owner();
     
     auto version = database->itinerary_version(request->participant_id);
+    if (write_ahead_log)
+    {
+      ItineraryClear clear;
+      clear.participant = request->participant_id;
+      clear.itinerary_version = version;
+      log_change(clear);
+    }
+
     database->erase(request->participant_id, version);
+    checkpoint_if_due();
     response->confirmation = true;
 
+    {
+      std::lock_guard<std::mutex> lock2(active_conflicts_mutex);
+      negotiation_relays.erase(request->participant_id);
+    }
+
     RCLCPP_INFO(
       get_logger(),
       "Unregistered participant [" + std::to_string(request->participant_id)
@@ -513,11 +603,15 @@ void ScheduleNode::itinerary_set(const ItinerarySet& set)
 {
   std::unique_lock<std::mutex> lock(database_mutex);
   assert(!set.itinerary.empty());
+  log_change(set);
+
   database->set(
     set.participant,
     rmf_traffic_ros2::convert(set.itinerary),
     set.itinerary_version);
 
+  checkpoint_if_due();
+
   publish_inconsistencies(set.participant);
 
   std::lock_guard<std::mutex> lock2(active_conflicts_mutex);
@@ -529,11 +623,15 @@ void ScheduleNode::itinerary_set(const ItinerarySet& set)
 void ScheduleNode::itinerary_extend(const ItineraryExtend& extend)
 {
   std::unique_lock<std::mutex> lock(database_mutex);
+  log_change(extend);
+
   database->extend(
     extend.participant,
     rmf_traffic_ros2::convert(extend.routes),
     extend.itinerary_version);
 
+  checkpoint_if_due();
+
   publish_inconsistencies(extend.participant);
 
   std::lock_guard<std::mutex> lock2(active_conflicts_mutex);
@@ -546,11 +644,15 @@ void ScheduleNode::itinerary_extend(const ItineraryExtend& extend)
 void ScheduleNode::itinerary_delay(const ItineraryDelay& delay)
 {
   std::unique_lock<std::mutex> lock(database_mutex);
+  log_change(delay);
+
   database->delay(
     delay.participant,
     rmf_traffic::Duration(delay.delay),
     delay.itinerary_version);
 
+  checkpoint_if_due();
+
   publish_inconsistencies(delay.participant);
 
   std::lock_guard<std::mutex> lock2(active_conflicts_mutex);
@@ -563,12 +665,16 @@ void ScheduleNode::itinerary_delay(const ItineraryDelay& delay)
 void ScheduleNode::itinerary_erase(const ItineraryErase& erase)
 {
   std::unique_lock<std::mutex> lock(database_mutex);
+  log_change(erase);
+
   database->erase(
     erase.participant,
     std::vector<rmf_traffic::RouteId>(
       erase.routes.begin(), erase.routes.end()),
     erase.itinerary_version);
 
+  checkpoint_if_due();
+
   publish_inconsistencies(erase.participant);
 
   std::lock_guard<std::mutex> lock2(active_conflicts_mutex);
@@ -581,8 +687,12 @@ void ScheduleNode::itinerary_erase(const ItineraryErase& erase)
 void ScheduleNode::itinerary_clear(const ItineraryClear& clear)
 {
   std::unique_lock<std::mutex> lock(database_mutex);
+  log_change(clear);
+
   database->erase(clear.participant, clear.itinerary_version);
 
+  checkpoint_if_due();
+
   publish_inconsistencies(clear.participant);
 
   std::lock_guard<std::mutex> lock2(active_conflicts_mutex);
@@ -606,6 +716,72 @@ void ScheduleNode::publish_inconsistencies(
   inconsistency_pub->publish(rmf_traffic_ros2::convert(*it));
 }
 
+//==============================================================================
+template<typename Change>
+void ScheduleNode::log_change(const Change& change)
+{
+  if (!write_ahead_log)
+    return;
+
+  try
+  {
+    write_ahead_log->write(change);
+  }
+  catch (const std::exception& e)
+  {
+    // Once a change is missing from the log, replaying it would give the wrong
+    // schedule, so we stop logging instead of leaving a gap. The schedule keeps
+    // being served, but it will not be recovered after a restart. The files
+    // that were already written get invalidated so that a restart does not
+    // recover the stale schedule that they describe.
+    RCLCPP_ERROR(
+      get_logger(),
+      std::string("Failed to write to the schedule write-ahead log, so the ")
+      + "schedule will no longer be persisted: " + e.what());
+
+    try
+    {
+      write_ahead_log->invalidate(e.what());
+    }
+    catch (const std::exception& invalidate_error)
+    {
+      RCLCPP_ERROR(
+        get_logger(),
+        std::string("Failed to invalidate the schedule write-ahead log. Its ")
+        + "directory must be cleared before the schedule node restarts, or "
+        + "a stale schedule will be recovered: " + invalidate_error.what());
+    }
+
+    write_ahead_log.reset();
+  }
+}
+
+//==============================================================================
+void ScheduleNode::checkpoint_if_due()
+{
+  if (!write_ahead_log || !write_ahead_log->checkpoint_due())
+    return;
+
+  // Only the itineraries are captured here while the database is locked. The
+  // log serializes the checkpoint and flushes it to disk on its own thread.
+  // If that fails, the log keeps growing until a checkpoint succeeds, so
+  // nothing is lost.
+  const auto logger = get_logger();
+  const auto on_failure = [logger](const std::string& error)
+    {
+      RCLCPP_ERROR(logger, "Failed to write a schedule checkpoint: " + error);
+    };
+
+  try
+  {
+    write_ahead_log->checkpoint_in_background(*database, on_failure);
+  }
+  catch (const std::exception& e)
+  {
+    on_failure(e.what());
+  }
+}
+
 //==============================================================================
 void ScheduleNode::wakeup_mirrors()
 {
@@ -613,9 +789,42 @@ void ScheduleNode::wakeup_mirrors()
   msg.latest_version = database->latest_version();
   mirror_wakeup_publisher->publish(msg);
 
+  publish_mirror_patches();
+
   conflict_check_cv.notify_all();
 }
 
+//==============================================================================
+void ScheduleNode::publish_mirror_patches()
+{
+  const auto latest_version = database->latest_version();
+  for (auto& [query_id, stream] : mirror_streams)
+  {
+    if (stream.last_version == latest_version)
+      continue;
+
+    // If nothing is listening to this stream, we let the changes pile up. The
+    // next patch that gets published will pick up from the last one that was
+    // published, so any mirror that subscribes later can still line up with it
+    // after its initial MirrorUpdate.
+    if (stream.publisher->get_subscription_count() == 0)
+      continue;
+
+    const auto query_it = registered_queries.find(query_id);
+    assert(query_it != registered_queries.end());
+
+    MirrorPatch msg;
+    msg.query_id = query_id;
+    msg.sequence = ++stream.sequence;
+    msg.base_version = stream.last_version;
+    msg.patch = rmf_traffic_ros2::convert(
+      database->changes(query_it->second, stream.last_version));
+
+    stream.last_version = msg.patch.latest_version;
+    stream.publisher->publish(msg);
+  }
+}
+
 //==============================================================================
 void print_conclusion(
   const std::unordered_map<
@@ -678,6 +887,73 @@ void ScheduleNode::receive_conclusion_ack(const ConflictAck& msg)
 //  print_conclusion(active_conflicts._waiting);
 }
 
+//==============================================================================
+auto ScheduleNode::relay_for(const ParticipantId participant)
+-> const NegotiationRelay&
+{
+  const auto insertion =
+    negotiation_relays.insert({participant, NegotiationRelay()});
+
+  auto& relay = insertion.first->second;
+  if (insertion.second)
+  {
+    // This matches the QoS that the Negotiation class subscribes with
+    const auto qos = negotiation_qos();
+    const auto suffix = std::to_string(participant);
+
+    relay.proposal_pub = create_publisher<ConflictProposal>(
+      rmf_traffic_ros2::NegotiationProposalTopicPrefix + suffix, qos);
+
+    relay.rejection_pub = create_publisher<ConflictRejection>(
+      rmf_traffic_ros2::NegotiationRejectionTopicPrefix + suffix, qos);
+
+    relay.forfeit_pub = create_publisher<ConflictForfeit>(
+      rmf_traffic_ros2::NegotiationForfeitTopicPrefix + suffix, qos);
+  }
+
+  return relay;
+}
+
+//==============================================================================
+void ScheduleNode::open_relay(
+  const Version conflict_version,
+  const rmf_traffic::schedule::Negotiation& negotiation)
+{
+  auto& history = relay_histories[conflict_version];
+  for (const auto p : negotiation.participants())
+  {
+    if (!history.recipients.insert(p).second)
+      continue;
+
+    // This participant was added to a negotiation that was already underway,
+    // so it needs to hear everything that was said before it arrived.
+    const auto& relay = relay_for(p);
+    for (const auto& publish : history.log)
+      publish(relay);
+  }
+}
+
+//==============================================================================
+void ScheduleNode::relay(
+  const Version conflict_version,
+  std::function<void(const NegotiationRelay&)> publish)
+{
+  const auto it = relay_histories.find(conflict_version);
+  if (it == relay_histories.end())
+    return;
+
+  for (const auto p : it->second.recipients)
+    publish(relay_for(p));
+
+  it->second.log.emplace_back(std::move(publish));
+}
+
+//==============================================================================
+void ScheduleNode::close_relay(const Version conflict_version)
+{
+  relay_histories.erase(conflict_version);
+}
+
 //==============================================================================
 void ScheduleNode::receive_refusal(const ConflictRefusal& msg)
 {
@@ -693,6 +969,7 @@ void ScheduleNode::receive_refusal(const ConflictRefusal& msg)
   RCLCPP_INFO(get_logger(), output);
 
   active_conflicts.refuse(msg.conflict_version);
+  close_relay(msg.conflict_version);
 
   ConflictConclusion conclusion;
   conclusion.conflict_version = msg.conflict_version;
@@ -710,6 +987,11 @@ void ScheduleNode::receive_proposal(const ConflictProposal& msg)
   if (!negotiation_room)
     return;
 
+  relay(msg.conflict_version, [msg](const NegotiationRelay& r)
+    {
+      r.proposal_pub->publish(msg);
+    });
+
   auto& negotiation = negotiation_room->negotiation;
 
   const auto search = negotiation.find(
@@ -750,6 +1032,7 @@ void ScheduleNode::receive_proposal(const ConflictProposal& msg)
     assert(choose);
 
     active_conflicts.conclude(msg.conflict_version);
+    close_relay(msg.conflict_version);
 
     ConflictConclusion conclusion;
     conclusion.conflict_version = msg.conflict_version;
@@ -774,6 +1057,7 @@ void ScheduleNode::receive_proposal(const ConflictProposal& msg)
     RCLCPP_INFO(get_logger(), output);
 
     active_conflicts.conclude(msg.conflict_version);
+    close_relay(msg.conflict_version);
 
     // This implies a complete failure
     ConflictConclusion conclusion;
@@ -794,6 +1078,11 @@ void ScheduleNode::receive_rejection(const ConflictRejection& msg)
   if (!negotiation_room)
     return;
 
+  relay(msg.conflict_version, [msg](const NegotiationRelay& r)
+    {
+      r.rejection_pub->publish(msg);
+    });
+
   auto& negotiation = negotiation_room->negotiation;
 
   const auto search = negotiation.find(rmf_traffic_ros2::convert(msg.table));
@@ -837,6 +1126,11 @@ void ScheduleNode::receive_forfeit(const ConflictForfeit& msg)
   if (!negotiation_room)
     return;
 
+  relay(msg.conflict_version, [msg](const NegotiationRelay& r)
+    {
+      r.forfeit_pub->publish(msg);
+    });
+
   auto& negotiation = negotiation_room->negotiation;
 
   const auto search = negotiation.find(rmf_traffic_ros2::convert(msg.table));
@@ -872,6 +1166,7 @@ void ScheduleNode::receive_forfeit(const ConflictForfeit& msg)
     RCLCPP_INFO(get_logger(), output);
 
     active_conflicts.conclude(msg.conflict_version);
+    close_relay(msg.conflict_version);
 
     ConflictConclusion conclusion;
     conclusion.conflict_version = msg.conflict_version;
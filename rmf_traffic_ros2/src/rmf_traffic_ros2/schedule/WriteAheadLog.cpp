@@ -0,0 +1,1000 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "internal_WriteAheadLog.hpp"
+
+#include <rmf_traffic_ros2/Route.hpp>
+#include <rmf_traffic_ros2/schedule/Writer.hpp>
+
+#include <rmf_traffic/schedule/Query.hpp>
+
+#include <rclcpp/serialization.hpp>
+#include <rclcpp/serialized_message.hpp>
+
+#include <rmf_utils/Modular.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace rmf_traffic_ros2 {
+namespace schedule {
+
+namespace {
+
+// Both kinds of file start with one of these, followed by a format version and
+// the generation number of the file.
+const std::array<char, 8> LogMagic = {'R', 'M', 'F', 'S', 'W', 'A', 'L', 0};
+const std::array<char, 8> CheckpointMagic =
+{'R', 'M', 'F', 'S', 'C', 'K', 'P', 0};
+const uint32_t FormatVersion = 1;
+const std::size_t HeaderSize = 8 + sizeof(uint32_t) + sizeof(uint64_t);
+
+// Each record is framed by the size of its payload, a CRC-32 of everything
+// after the CRC, the type of record, and the participant and itinerary version
+// that it applies to. Everything is stored in host byte order.
+const std::size_t CrcOffset = sizeof(uint32_t);
+const std::size_t TypeOffset = CrcOffset + sizeof(uint32_t);
+const std::size_t ParticipantOffset = TypeOffset + sizeof(uint8_t);
+const std::size_t VersionOffset = ParticipantOffset + sizeof(uint64_t);
+const std::size_t FrameSize = VersionOffset + sizeof(uint64_t);
+
+const std::string CheckpointName = "checkpoint";
+const std::string LogPrefix = "log.";
+const std::string InvalidName = "invalid";
+
+using RecordType = WriteAheadLog::RecordType;
+using ParticipantId = rmf_traffic::schedule::ParticipantId;
+using ItineraryVersion = rmf_traffic::schedule::ItineraryVersion;
+
+//==============================================================================
+struct Record
+{
+  RecordType type;
+  ParticipantId participant;
+  ItineraryVersion version;
+  const uint8_t* frame;
+  std::size_t frame_size;
+  const uint8_t* payload;
+  std::size_t payload_size;
+};
+
+//==============================================================================
+uint32_t crc32(const uint8_t* data, const std::size_t size, uint32_t crc = 0)
+{
+  static const std::array<uint32_t, 256> table = []()
+    {
+      std::array<uint32_t, 256> output;
+      for (uint32_t i = 0; i < 256; ++i)
+      {
+        uint32_t c = i;
+        for (std::size_t k = 0; k < 8; ++k)
+          c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+
+        output[i] = c;
+      }
+
+      return output;
+    }();
+
+  crc = ~crc;
+  for (std::size_t i = 0; i < size; ++i)
+    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+
+  return ~crc;
+}
+
+//==============================================================================
+template<typename T>
+void put(std::vector<uint8_t>& buffer, const T& value)
+{
+  const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+  buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+//==============================================================================
+template<typename T>
+T get(const uint8_t* data)
+{
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+//==============================================================================
+std::vector<uint8_t> make_header(
+  const std::array<char, 8>& magic,
+  const uint64_t generation)
+{
+  std::vector<uint8_t> header(magic.begin(), magic.end());
+  put(header, FormatVersion);
+  put(header, generation);
+  return header;
+}
+
+//==============================================================================
+std::vector<uint8_t> make_frame(
+  const RecordType type,
+  const ParticipantId participant,
+  const ItineraryVersion version,
+  const std::vector<uint8_t>& payload)
+{
+  std::vector<uint8_t> frame;
+  frame.reserve(FrameSize + payload.size());
+  put(frame, static_cast<uint32_t>(payload.size()));
+  put(frame, uint32_t(0));
+  put(frame, static_cast<uint8_t>(type));
+  put(frame, static_cast<uint64_t>(participant));
+  put(frame, static_cast<uint64_t>(version));
+  frame.insert(frame.end(), payload.begin(), payload.end());
+
+  const uint32_t crc =
+    crc32(frame.data() + TypeOffset, frame.size() - TypeOffset);
+  std::memcpy(frame.data() + CrcOffset, &crc, sizeof(crc));
+  return frame;
+}
+
+//==============================================================================
+template<typename Message>
+std::vector<uint8_t> serialize(const Message& msg)
+{
+  static const rclcpp::Serialization<Message> serializer;
+  rclcpp::SerializedMessage serialized;
+  serializer.serialize_message(&msg, &serialized);
+
+  const auto& raw = serialized.get_rcl_serialized_message();
+  return std::vector<uint8_t>(raw.buffer, raw.buffer + raw.buffer_length);
+}
+
+//==============================================================================
+template<typename Message>
+Message deserialize(const uint8_t* data, const std::size_t size)
+{
+  static const rclcpp::Serialization<Message> serializer;
+  rclcpp::SerializedMessage serialized(size);
+  auto& raw = serialized.get_rcl_serialized_message();
+  std::memcpy(raw.buffer, data, size);
+  raw.buffer_length = size;
+
+  Message msg;
+  serializer.deserialize_message(&serialized, &msg);
+  return msg;
+}
+
+//==============================================================================
+void apply(
+  rmf_traffic::schedule::Database& database,
+  const Record& record)
+{
+  const uint8_t* data = record.payload;
+  const std::size_t size = record.payload_size;
+  switch (record.type)
+  {
+    case RecordType::Set:
+    {
+      const auto set = deserialize<WriteAheadLog::ItinerarySet>(data, size);
+      database.set(
+        set.participant,
+        rmf_traffic_ros2::convert(set.itinerary),
+        set.itinerary_version);
+      return;
+    }
+    case RecordType::Extend:
+    {
+      const auto extend =
+        deserialize<WriteAheadLog::ItineraryExtend>(data, size);
+      database.extend(
+        extend.participant,
+        rmf_traffic_ros2::convert(extend.routes),
+        extend.itinerary_version);
+      return;
+    }
+    case RecordType::Delay:
+    {
+      const auto delay = deserialize<WriteAheadLog::ItineraryDelay>(data, size);
+      database.delay(
+        delay.participant,
+        rmf_traffic::Duration(delay.delay),
+        delay.itinerary_version);
+      return;
+    }
+    case RecordType::Erase:
+    {
+      const auto erase = deserialize<WriteAheadLog::ItineraryErase>(data, size);
+      database.erase(
+        erase.participant,
+        std::vector<rmf_traffic::RouteId>(
+          erase.routes.begin(), erase.routes.end()),
+        erase.itinerary_version);
+      return;
+    }
+    case RecordType::Clear:
+    {
+      const auto clear = deserialize<WriteAheadLog::ItineraryClear>(data, size);
+      database.erase(clear.participant, clear.itinerary_version);
+      return;
+    }
+  }
+
+  throw std::runtime_error(
+          "[WriteAheadLog] Unrecognized record type ["
+          + std::to_string(static_cast<int>(record.type)) + "]");
+}
+
+//==============================================================================
+std::vector<uint8_t> read_file(const std::filesystem::path& path)
+{
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+  {
+    throw std::runtime_error(
+            "[WriteAheadLog] Unable to open [" + path.string() + "]");
+  }
+
+  return std::vector<uint8_t>(
+    std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+//==============================================================================
+/// Check the header of a file and get its generation number. Returns false if
+/// the file is too short or does not have the expected header.
+bool read_header(
+  const std::vector<uint8_t>& data,
+  const std::array<char, 8>& magic,
+  uint64_t& generation)
+{
+  if (data.size() < HeaderSize)
+    return false;
+
+  if (!std::equal(magic.begin(), magic.end(), data.begin()))
+    return false;
+
+  if (get<uint32_t>(data.data() + 8) != FormatVersion)
+    return false;
+
+  generation = get<uint64_t>(data.data() + 8 + sizeof(uint32_t));
+  return true;
+}
+
+//==============================================================================
+/// Visit each intact record in data, starting after the header. Returns the
+/// offset just past the last intact record.
+template<typename Visitor>
+std::size_t for_each_record(const std::vector<uint8_t>& data, Visitor visit)
+{
+  std::size_t offset = HeaderSize;
+  while (offset + FrameSize <= data.size())
+  {
+    const uint8_t* frame = data.data() + offset;
+    const std::size_t size = get<uint32_t>(frame);
+    if (data.size() - offset - FrameSize < size)
+      break;
+
+    const auto crc = get<uint32_t>(frame + CrcOffset);
+    if (crc32(frame + TypeOffset, FrameSize - TypeOffset + size) != crc)
+      break;
+
+    visit(
+      Record{
+        static_cast<RecordType>(frame[TypeOffset]),
+        get<uint64_t>(frame + ParticipantOffset),
+        get<uint64_t>(frame + VersionOffset),
+        frame,
+        FrameSize + size,
+        frame + FrameSize,
+        size
+      });
+
+    offset += FrameSize + size;
+  }
+
+  return offset;
+}
+
+//==============================================================================
+void write_all(const int fd, const uint8_t* data, std::size_t size)
+{
+  while (size > 0)
+  {
+    const auto written = ::write(fd, data, size);
+    if (written < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      throw std::runtime_error(
+              std::string("[WriteAheadLog] Failed to write: ")
+              + std::strerror(errno));
+    }
+
+    data += written;
+    size -= static_cast<std::size_t>(written);
+  }
+}
+
+//==============================================================================
+int open_file(const std::filesystem::path& path, const int flags)
+{
+  const int fd = ::open(path.c_str(), flags, 0644);
+  if (fd < 0)
+  {
+    throw std::runtime_error(
+            "[WriteAheadLog] Unable to open [" + path.string() + "]: "
+            + std::strerror(errno));
+  }
+
+  return fd;
+}
+
+//==============================================================================
+void sync_directory(const std::string& directory)
+{
+  const int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd < 0)
+    return;
+
+  ::fsync(fd);
+  ::close(fd);
+}
+
+//==============================================================================
+/// Get the generation numbers of the log files in the directory, in ascending
+/// order.
+std::map<uint64_t, std::filesystem::path> find_logs(
+  const std::string& directory)
+{
+  std::map<uint64_t, std::filesystem::path> logs;
+  for (const auto& entry : std::filesystem::directory_iterator(directory))
+  {
+    const std::string name = entry.path().filename().string();
+    if (name.rfind(LogPrefix, 0) != 0)
+      continue;
+
+    const std::string number = name.substr(LogPrefix.size());
+    if (number.empty()
+      || !std::all_of(number.begin(), number.end(), ::isdigit))
+      continue;
+
+    logs[std::stoull(number)] = entry.path();
+  }
+
+  return logs;
+}
+
+//==============================================================================
+/// Visit each intact record of the current checkpoint and the logs that follow
+/// it, in the order that they were written, stopping before the log of the
+/// given generation. Nothing is modified, even if some of the files are
+/// damaged.
+template<typename Visitor>
+void for_each_history_record(
+  const std::string& directory,
+  const uint64_t before,
+  Visitor visit)
+{
+  const auto checkpoint_path =
+    std::filesystem::path(directory) / CheckpointName;
+  uint64_t generation = 0;
+  if (std::filesystem::exists(checkpoint_path))
+  {
+    const auto data = read_file(checkpoint_path);
+    if (read_header(data, CheckpointMagic, generation))
+      for_each_record(data, visit);
+  }
+
+  for (const auto& [log_generation, path] : find_logs(directory))
+  {
+    if (log_generation < generation)
+      continue;
+
+    if (before <= log_generation)
+      return;
+
+    const auto data = read_file(path);
+    uint64_t header_generation = 0;
+    if (!read_header(data, LogMagic, header_generation))
+      return;
+
+    if (for_each_record(data, visit) != data.size())
+      return;
+  }
+}
+
+//==============================================================================
+/// Remove the checkpoint and every log in the directory.
+void remove_history(const std::string& directory)
+{
+  const auto path = std::filesystem::path(directory);
+  std::filesystem::remove(path / CheckpointName);
+  std::filesystem::remove(path / (CheckpointName + ".tmp"));
+  for (const auto& [generation, log] : find_logs(directory))
+  {
+    (void)(generation);
+    std::filesystem::remove(log);
+  }
+}
+
+} // anonymous namespace
+
+//==============================================================================
+WriteAheadLog::WriteAheadLog(std::string directory, Options options)
+: _directory(std::move(directory)),
+  _options(options)
+{
+  std::filesystem::create_directories(_directory);
+  _sync_thread = std::thread([this]() { _sync_loop(); });
+}
+
+//==============================================================================
+WriteAheadLog::WriteAheadLog(std::string directory)
+: WriteAheadLog(std::move(directory), Options())
+{
+  // Do nothing
+}
+
+//==============================================================================
+auto WriteAheadLog::recover(Database& database) -> Recovery
+{
+  Recovery recovery;
+  const auto start = std::chrono::steady_clock::now();
+
+  // The marker is only removed after everything that it refers to, so a crash
+  // in the middle of this still leaves the remaining files refused.
+  const auto invalid_path = std::filesystem::path(_directory) / InvalidName;
+  if (std::filesystem::exists(invalid_path))
+  {
+    remove_history(_directory);
+    sync_directory(_directory);
+    std::filesystem::remove(invalid_path);
+    recovery.discarded_invalid = true;
+  }
+
+  const auto checkpoint_path =
+    std::filesystem::path(_directory) / CheckpointName;
+
+  uint64_t generation = 0;
+  if (std::filesystem::exists(checkpoint_path))
+  {
+    // Checkpoints are only ever put in place by an atomic rename after they
+    // have been flushed, so any damage here is not the result of a crash.
+    const auto data = read_file(checkpoint_path);
+    if (!read_header(data, CheckpointMagic, generation))
+    {
+      throw std::runtime_error(
+              "[WriteAheadLog] The checkpoint ["
+              + checkpoint_path.string() + "] has an invalid header");
+    }
+
+    const std::size_t end = for_each_record(
+      data,
+      [&](const Record& record)
+      {
+        apply(database, record);
+        ++recovery.checkpoint_records;
+      });
+
+    if (end != data.size())
+    {
+      throw std::runtime_error(
+              "[WriteAheadLog] The checkpoint ["
+              + checkpoint_path.string() + "] is damaged");
+    }
+  }
+
+  uint64_t latest_generation = generation;
+  bool damaged = false;
+  for (const auto& [log_generation, path] : find_logs(_directory))
+  {
+    latest_generation = std::max(latest_generation, log_generation);
+
+    // Logs from before the checkpoint are already covered by it
+    if (log_generation < generation)
+      continue;
+
+    // Once one log has a damaged tail, nothing after it can be trusted.
+    if (damaged)
+    {
+      std::filesystem::remove(path);
+      continue;
+    }
+
+    const auto data = read_file(path);
+    uint64_t header_generation = 0;
+    if (!read_header(data, LogMagic, header_generation)
+      || header_generation != log_generation)
+    {
+      // The log was created but its header never made it to disk.
+      damaged = true;
+      recovery.truncated_tail = true;
+      std::filesystem::remove(path);
+      continue;
+    }
+
+    const std::size_t end = for_each_record(
+      data,
+      [&](const Record& record)
+      {
+        ++recovery.log_records;
+        try
+        {
+          apply(database, record);
+        }
+        catch (const std::exception&)
+        {
+          // The Database validates each change before making any modification,
+          // so a rejected change leaves it untouched, just like the first
+          // time that this change was received.
+          ++recovery.rejected_records;
+        }
+      });
+
+    if (end != data.size())
+    {
+      damaged = true;
+      recovery.truncated_tail = true;
+      std::filesystem::resize_file(path, end);
+    }
+  }
+
+  recovery.replay_time = std::chrono::steady_clock::now() - start;
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _generation = latest_generation;
+  }
+
+  // Compact everything that was just replayed so that the next recovery does
+  // not have to replay it again.
+  checkpoint(database);
+  return recovery;
+}
+
+//==============================================================================
+void WriteAheadLog::write(const ItinerarySet& set)
+{
+  _append(
+    RecordType::Set, set.participant, set.itinerary_version,
+    serialize(set));
+}
+
+//==============================================================================
+void WriteAheadLog::write(const ItineraryExtend& extend)
+{
+  _append(
+    RecordType::Extend, extend.participant, extend.itinerary_version,
+    serialize(extend));
+}
+
+//==============================================================================
+void WriteAheadLog::write(const ItineraryDelay& delay)
+{
+  _append(
+    RecordType::Delay, delay.participant, delay.itinerary_version,
+    serialize(delay));
+}
+
+//==============================================================================
+void WriteAheadLog::write(const ItineraryErase& erase)
+{
+  _append(
+    RecordType::Erase, erase.participant, erase.itinerary_version,
+    serialize(erase));
+}
+
+//==============================================================================
+void WriteAheadLog::write(const ItineraryClear& clear)
+{
+  _append(
+    RecordType::Clear, clear.participant, clear.itinerary_version,
+    serialize(clear));
+}
+
+//==============================================================================
+bool WriteAheadLog::checkpoint_due() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return !_checkpoint_in_progress
+    && _records_since_checkpoint >= _options.checkpoint_interval;
+}
+
+//==============================================================================
+void WriteAheadLog::checkpoint(const Database& database)
+{
+  auto pending = _prepare_checkpoint(database);
+  try
+  {
+    _write_checkpoint(std::move(pending));
+  }
+  catch (...)
+  {
+    _finish_checkpoint();
+    throw;
+  }
+
+  _finish_checkpoint();
+}
+
+//==============================================================================
+void WriteAheadLog::checkpoint_in_background(
+  const Database& database,
+  std::function<void(const std::string& error)> on_failure)
+{
+  auto pending = _prepare_checkpoint(database);
+  pending.on_failure = std::move(on_failure);
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _pending_checkpoint = std::move(pending);
+  }
+  _sync_cv.notify_all();
+}
+
+//==============================================================================
+void WriteAheadLog::sync()
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (_fd < 0)
+    return;
+
+  ::fdatasync(_fd);
+  _unsynced = 0;
+}
+
+//==============================================================================
+void WriteAheadLog::invalidate(const std::string& reason)
+{
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_fd >= 0)
+    {
+      ::close(_fd);
+      _fd = -1;
+    }
+    _unsynced = 0;
+  }
+
+  const auto invalid_path = std::filesystem::path(_directory) / InvalidName;
+  const int fd =
+    open_file(invalid_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC);
+  try
+  {
+    write_all(
+      fd, reinterpret_cast<const uint8_t*>(reason.data()), reason.size());
+  }
+  catch (...)
+  {
+    ::close(fd);
+    throw;
+  }
+  ::fsync(fd);
+  ::close(fd);
+  sync_directory(_directory);
+
+  // The marker already refuses these files, so there is no need to fail if
+  // they cannot be removed. A checkpoint that is still being written in the
+  // background may also put a new file in place after this, but the marker
+  // refuses that too.
+  std::error_code ec;
+  const auto directory = std::filesystem::path(_directory);
+  std::filesystem::remove(directory / CheckpointName, ec);
+  for (const auto& entry : std::filesystem::directory_iterator(directory, ec))
+  {
+    if (entry.path().filename().string().rfind(LogPrefix, 0) == 0)
+      std::filesystem::remove(entry.path(), ec);
+  }
+}
+
+//==============================================================================
+WriteAheadLog::~WriteAheadLog()
+{
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _quit = true;
+  }
+  _sync_cv.notify_all();
+
+  if (_sync_thread.joinable())
+    _sync_thread.join();
+
+  if (_fd >= 0)
+  {
+    ::fdatasync(_fd);
+    ::close(_fd);
+  }
+}
+
+//==============================================================================
+auto WriteAheadLog::_prepare_checkpoint(const Database& database)
+-> PendingCheckpoint
+{
+  // The version of each participant's itinerary that has actually been
+  // applied. Changes that arrived out of order are held by the Database until
+  // the changes before them arrive, and those are not part of the itinerary.
+  // Like the Database, the version before 0 is used to mean that nothing has
+  // been applied yet.
+  std::unordered_map<ParticipantId, ItineraryVersion> applied;
+  std::unordered_set<ParticipantId> waiting;
+  for (const auto participant : database.participant_ids())
+  {
+    auto& version = applied[participant];
+    version = database.itinerary_version(participant);
+
+    const auto inconsistency = database.inconsistencies().find(participant);
+    if (inconsistency != database.inconsistencies().end()
+      && inconsistency->ranges.size() > 0)
+    {
+      version = inconsistency->ranges.begin()->lower - 1;
+      waiting.insert(participant);
+    }
+  }
+
+  std::unique_lock<std::mutex> lock(_mutex);
+  _checkpoint_cv.wait(lock, [&]() { return !_checkpoint_in_progress; });
+  _checkpoint_in_progress = true;
+  const uint64_t generation = _generation + 1;
+  lock.unlock();
+
+  // Changes that are written after this point will not be in the checkpoint,
+  // so they need to go into the log that follows it.
+  const auto log_path = std::filesystem::path(_directory)
+    / (LogPrefix + std::to_string(generation));
+  int log_fd = -1;
+  try
+  {
+    log_fd = open_file(
+      log_path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC);
+    const auto log_header = make_header(LogMagic, generation);
+    write_all(log_fd, log_header.data(), log_header.size());
+  }
+  catch (...)
+  {
+    if (log_fd >= 0)
+      ::close(log_fd);
+
+    _finish_checkpoint();
+    throw;
+  }
+
+  PendingCheckpoint checkpoint{
+    generation,
+    database.query(rmf_traffic::schedule::query_all()),
+    std::move(applied),
+    std::move(waiting),
+    -1,
+    nullptr
+  };
+
+  lock.lock();
+  checkpoint.previous_fd = _fd;
+  _fd = log_fd;
+  _generation = generation;
+  _unsynced = 0;
+  _records_since_checkpoint = 0;
+
+  return checkpoint;
+}
+
+//==============================================================================
+void WriteAheadLog::_write_checkpoint(PendingCheckpoint checkpoint)
+{
+  // The records of the previous log must stay on disk until the checkpoint
+  // that covers them is in place.
+  if (checkpoint.previous_fd >= 0)
+  {
+    ::fdatasync(checkpoint.previous_fd);
+    ::close(checkpoint.previous_fd);
+  }
+
+  const uint64_t generation = checkpoint.generation;
+  std::vector<uint8_t> data = make_header(CheckpointMagic, generation);
+
+  std::map<rmf_traffic::schedule::ParticipantId, ItinerarySet> itineraries;
+  for (const auto& element : checkpoint.routes)
+  {
+    rmf_traffic_msgs::msg::ScheduleWriterItem item;
+    item.id = element.route_id;
+    // The checkpoint must restore the routes exactly, even if this process
+    // sends its trajectories with the compact encoding.
+    item.route = rmf_traffic_ros2::convert_full_precision(element.route);
+    itineraries[element.participant].itinerary.push_back(std::move(item));
+  }
+
+  // The held changes cannot be read back out of the Database, so copy their
+  // records out of the history that this checkpoint will replace.
+  const ItineraryVersion nothing_applied =
+    std::numeric_limits<ItineraryVersion>::max();
+  std::unordered_map<ParticipantId, std::vector<uint8_t>> waiting;
+  for (const auto participant : checkpoint.waiting)
+    waiting[participant];
+
+  if (!waiting.empty())
+  {
+    for_each_history_record(
+      _directory, generation,
+      [&](const Record& record)
+      {
+        const auto it = waiting.find(record.participant);
+        if (it == waiting.end())
+          return;
+
+        const auto version = checkpoint.applied.at(record.participant);
+        if (version != nothing_applied
+          && !rmf_utils::modular(version).less_than(record.version))
+          return;
+
+        it->second.insert(
+          it->second.end(), record.frame, record.frame + record.frame_size);
+      });
+  }
+
+  for (const auto& [participant, version] : checkpoint.applied)
+  {
+    if (version != nothing_applied)
+    {
+      auto& set = itineraries[participant];
+      set.participant = participant;
+      set.itinerary_version = version;
+
+      const auto frame = make_frame(
+        RecordType::Set, participant, version, serialize(set));
+      data.insert(data.end(), frame.begin(), frame.end());
+    }
+
+    const auto w_it = waiting.find(participant);
+    if (w_it != waiting.end())
+      data.insert(data.end(), w_it->second.begin(), w_it->second.end());
+  }
+
+  const auto directory = std::filesystem::path(_directory);
+  const auto temp_path = directory / (CheckpointName + ".tmp");
+  const int checkpoint_fd =
+    open_file(temp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC);
+  try
+  {
+    write_all(checkpoint_fd, data.data(), data.size());
+  }
+  catch (...)
+  {
+    ::close(checkpoint_fd);
+    throw;
+  }
+  ::fsync(checkpoint_fd);
+  ::close(checkpoint_fd);
+
+  // The log that follows this checkpoint must be on disk before the checkpoint
+  // is put in place. Otherwise a failure in between would leave new changes
+  // going into a log that the checkpoint claims to cover.
+  const auto log_path = directory / (LogPrefix + std::to_string(generation));
+  const int log_fd = open_file(log_path, O_RDONLY | O_CLOEXEC);
+  ::fsync(log_fd);
+  ::close(log_fd);
+
+  std::filesystem::rename(temp_path, directory / CheckpointName);
+  sync_directory(_directory);
+
+  for (const auto& [log_generation, path] : find_logs(_directory))
+  {
+    if (log_generation < generation)
+      std::filesystem::remove(path);
+  }
+}
+
+//==============================================================================
+void WriteAheadLog::_finish_checkpoint()
+{
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _checkpoint_in_progress = false;
+  }
+  _checkpoint_cv.notify_all();
+}
+
+//==============================================================================
+void WriteAheadLog::_append(
+  const RecordType type,
+  const ParticipantId participant,
+  const ItineraryVersion version,
+  const std::vector<uint8_t>& payload)
+{
+  const auto frame = make_frame(type, participant, version, payload);
+
+  std::unique_lock<std::mutex> lock(_mutex);
+  if (_fd < 0)
+  {
+    throw std::runtime_error(
+            "[WriteAheadLog] recover() must be called before writing");
+  }
+
+  write_all(_fd, frame.data(), frame.size());
+  ++_records_since_checkpoint;
+  if (++_unsynced >= _options.sync_batch_size)
+  {
+    lock.unlock();
+    _sync_cv.notify_all();
+  }
+}
+
+//==============================================================================
+void WriteAheadLog::_sync_loop()
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+  while (true)
+  {
+    _sync_cv.wait_for(
+      lock, _options.sync_period,
+      [&]()
+      {
+        return _quit || _pending_checkpoint.has_value()
+        || _unsynced >= _options.sync_batch_size;
+      });
+
+    // A checkpoint that has been started is always finished, even when we are
+    // quitting, because the log has already been restarted for it.
+    if (_pending_checkpoint)
+    {
+      PendingCheckpoint checkpoint = std::move(*_pending_checkpoint);
+      _pending_checkpoint.reset();
+      lock.unlock();
+
+      const auto on_failure = checkpoint.on_failure;
+      try
+      {
+        _write_checkpoint(std::move(checkpoint));
+      }
+      catch (const std::exception& e)
+      {
+        if (on_failure)
+          on_failure(e.what());
+      }
+
+      _finish_checkpoint();
+      lock.lock();
+    }
+
+    if (_quit)
+      break;
+
+    if (_fd < 0 || _unsynced == 0)
+      continue;
+
+    // Flush a duplicate of the descriptor so that writers are not blocked
+    // while the disk catches up, even if a checkpoint swaps out the log.
+    const int fd = ::dup(_fd);
+    _unsynced = 0;
+    if (fd < 0)
+      continue;
+
+    lock.unlock();
+    ::fdatasync(fd);
+    ::close(fd);
+    lock.lock();
+  }
+}
+
+} // namespace schedule
+} // namespace rmf_traffic_ros2
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC_ROS2__SCHEDULE__INTERNAL_CONFLICTCHECK_HPP
+#define SRC__RMF_TRAFFIC_ROS2__SCHEDULE__INTERNAL_CONFLICTCHECK_HPP
+
+#include <rmf_traffic/schedule/Viewer.hpp>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace rmf_traffic_ros2 {
+namespace schedule {
+
+//==============================================================================
+/// Finds the conflicts between the routes that have changed in the schedule
+/// and the rest of the routes in the schedule.
+///
+/// The candidate pairs of routes are first filtered by a broad phase that
+/// rejects any pairs whose time ranges or spatial bounds do not overlap. The
+/// narrow phase (DetectConflict::between) of the surviving pairs is shared
+/// across a pool of worker threads.
+class ConflictChecker
+{
+public:
+
+  using ParticipantId = rmf_traffic::schedule::ParticipantId;
+  using ConflictSet = std::unordered_set<ParticipantId>;
+  using Report = std::function<void(const ConflictSet&)>;
+
+  /// Constructor
+  ///
+  /// \param[in] num_threads
+  ///   The number of threads that will perform the narrow phase. The thread
+  ///   that calls check() is counted as one of these threads. If this is 0,
+  ///   then the number of hardware threads will be used.
+  ConflictChecker(std::size_t num_threads = 1);
+
+  /// Get the number of threads that perform the narrow phase.
+  std::size_t num_threads() const;
+
+  /// Check the changed routes in view_changes against all the routes in the
+  /// viewer. Each pair of conflicting participants will be passed to report
+  /// once. The reports are always given in the same order, regardless of how
+  /// many threads are being used.
+  void check(
+    const rmf_traffic::schedule::Viewer::View& view_changes,
+    const rmf_traffic::schedule::Viewer& viewer,
+    const Report& report);
+
+  ~ConflictChecker();
+
+private:
+
+  /// Run the job on each worker thread and on the calling thread, and then
+  /// wait until every thread has finished it.
+  void _run(const std::function<void()>& job);
+
+  void _work();
+
+  std::vector<std::thread> _workers;
+  std::mutex _mutex;
+  std::condition_variable _job_cv;
+  std::condition_variable _done_cv;
+  std::function<void()> _job;
+  std::size_t _job_count = 0;
+  std::size_t _busy_workers = 0;
+  bool _quit = false;
+};
+
+} // namespace schedule
+} // namespace rmf_traffic_ros2
+
+#endif // SRC__RMF_TRAFFIC_ROS2__SCHEDULE__INTERNAL_CONFLICTCHECK_HPP
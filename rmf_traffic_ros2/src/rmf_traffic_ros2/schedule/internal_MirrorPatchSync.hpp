@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC_ROS2__SCHEDULE__INTERNAL_MIRRORPATCHSYNC_HPP
+#define SRC__RMF_TRAFFIC_ROS2__SCHEDULE__INTERNAL_MIRRORPATCHSYNC_HPP
+
+#include <rmf_traffic/schedule/Version.hpp>
+
+#include <rmf_utils/optional.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace rmf_traffic_ros2 {
+namespace schedule {
+
+//==============================================================================
+/// Decides what a mirror should do with each patch that gets streamed to it:
+/// apply it, skip it, hold it while a MirrorUpdate request is being answered,
+/// or ask the schedule node for a MirrorUpdate so that it can catch up.
+///
+/// This does not know anything about ROS. The MirrorManager provides the
+/// callbacks that read the mirror and send the requests, and it reports back
+/// when each reply has been handled.
+class MirrorPatchSync
+{
+public:
+
+  using Version = rmf_traffic::schedule::Version;
+
+  /// A patch that was streamed to the mirror
+  struct Patch
+  {
+    /// The position of this patch in the stream
+    uint64_t sequence;
+
+    /// The version of the mirror that this patch needs to be applied to
+    Version base_version;
+
+    /// The version that the mirror will have once this patch is applied
+    Version latest_version;
+
+    /// Apply the changes of this patch to the mirror
+    std::function<void()> apply;
+  };
+
+  /// Get the latest version of the mirror
+  using MirrorVersion = std::function<Version()>;
+
+  /// Send a MirrorUpdate request to the schedule node
+  using SendRequest =
+    std::function<void(Version minimum_version, bool initial_request)>;
+
+  /// Notified when a patch arrives out of sequence
+  using SequenceGap = std::function<void(uint64_t previous, uint64_t received)>;
+
+  /// Constructor
+  ///
+  /// \param[in] mirror_version
+  ///   Get the latest version of the mirror
+  ///
+  /// \param[in] send_request
+  ///   Send a MirrorUpdate request. Once the reply has been handled, either
+  ///   reply_applied() or reply_failed() must be called.
+  ///
+  /// \param[in] sequence_gap
+  ///   Optional callback for when a patch arrives out of sequence
+  MirrorPatchSync(
+    MirrorVersion mirror_version,
+    SendRequest send_request,
+    SequenceGap sequence_gap = nullptr);
+
+  /// Handle a patch that was streamed to the mirror. If a request is waiting
+  /// for its reply, the patch is held until the reply has been handled.
+  void receive(Patch patch);
+
+  /// Ask for a MirrorUpdate that brings the mirror up to at least
+  /// minimum_version. If a request is already waiting for its reply, another
+  /// request will be sent for minimum_version after that reply is applied,
+  /// unless the reply already reaches it.
+  ///
+  /// \return true if a request was sent, or false if one was already waiting
+  /// for its reply.
+  bool request(Version minimum_version);
+
+  /// The reply to the last request has been applied to the mirror, which is
+  /// now at reply_version. Any patches that were held will be sorted out now.
+  void reply_applied(Version reply_version);
+
+  /// The reply to the last request could not be applied. The patches that
+  /// were held are dropped, because they can no longer be lined up with the
+  /// mirror. The next patch to arrive will trigger another request.
+  void reply_failed();
+
+  /// Forget about the stream, e.g. because the mirror stopped subscribing to
+  /// it.
+  void reset_stream();
+
+  /// True if a request is waiting for its reply
+  bool waiting_for_reply() const;
+
+  /// The number of patches that are being held until a reply is handled
+  std::size_t held_patches() const;
+
+private:
+
+  void _process(const Patch& patch);
+
+  MirrorVersion _mirror_version;
+  SendRequest _send_request;
+  SequenceGap _sequence_gap;
+
+  std::vector<Patch> _held;
+  rmf_utils::optional<uint64_t> _last_sequence;
+  bool _initial_request = true;
+  bool _waiting_for_reply = false;
+  Version _next_minimum_version = 0;
+};
+
+} // namespace schedule
+} // namespace rmf_traffic_ros2
+
+#endif // SRC__RMF_TRAFFIC_ROS2__SCHEDULE__INTERNAL_MIRRORPATCHSYNC_HPP
@@ -19,12 +19,14 @@
 #define SRC__RMF_TRAFFIC_SCHEDULE__SCHEDULENODE_HPP
 
 #include "NegotiationRoom.hpp"
+#include "internal_WriteAheadLog.hpp"
 
 #include <rmf_traffic/schedule/Database.hpp>
 #include <rmf_traffic/schedule/Negotiation.hpp>
 
 #include <rclcpp/node.hpp>
 
+#include <rmf_traffic_msgs/msg/mirror_patch.hpp>
 #include <rmf_traffic_msgs/msg/mirror_wakeup.hpp>
 
 #include <rmf_traffic_msgs/msg/itinerary_clear.hpp>
@@ -57,6 +59,7 @@
 
 #include <rmf_utils/Modular.hpp>
 
+#include <functional>
 #include <set>
 #include <unordered_map>
 
@@ -133,6 +136,25 @@ public:
   using MirrorWakeupPublisher = rclcpp::Publisher<MirrorWakeup>;
   MirrorWakeupPublisher::SharedPtr mirror_wakeup_publisher;
 
+  using MirrorPatch = rmf_traffic_msgs::msg::MirrorPatch;
+  using MirrorPatchPublisher = rclcpp::Publisher<MirrorPatch>;
+
+  // Each registered query gets its own topic where the schedule node pushes a
+  // patch whenever the schedule changes. The patch is computed once per
+  // version and shared by every mirror that uses the query, so the mirrors do
+  // not need to ask for it with a MirrorUpdate request.
+  struct MirrorStream
+  {
+    MirrorPatchPublisher::SharedPtr publisher;
+    uint64_t sequence = 0;
+    rmf_traffic::schedule::Version last_version = 0;
+  };
+
+  using MirrorStreamMap = std::unordered_map<uint64_t, MirrorStream>;
+  MirrorStreamMap mirror_streams;
+
+  void publish_mirror_patches();
+
   using ItinerarySet = rmf_traffic_msgs::msg::ItinerarySet;
   void itinerary_set(const ItinerarySet& set);
   rclcpp::Subscription<ItinerarySet>::SharedPtr itinerary_set_sub;
@@ -159,6 +181,16 @@ public:
 
   void wakeup_mirrors();
 
+  // Append a change to the write-ahead log, if there is one. If the log cannot
+  // be written, it is dropped and the node carries on without it. The
+  // database_mutex must be locked when calling this.
+  template<typename Change>
+  void log_change(const Change& change);
+
+  // Start a checkpoint of the schedule if enough changes have been logged since
+  // the last one. The database_mutex must be locked when calling this.
+  void checkpoint_if_due();
+
   // TODO(MXG): Consider using libguarded instead of a database_mutex
   std::mutex database_mutex;
   std::shared_ptr<rmf_traffic::schedule::Database> database;
@@ -213,6 +245,40 @@ public:
   using ParticipantId = rmf_traffic::schedule::ParticipantId;
   using ConflictSet = std::unordered_set<ParticipantId>;
 
+  // Proposals, rejections, and forfeits are relayed to each participant of a
+  // negotiation on a topic of its own, so fleet adapters that have opted into
+  // scoped delivery never receive traffic for negotiations they are not in.
+  struct NegotiationRelay
+  {
+    rclcpp::Publisher<ConflictProposal>::SharedPtr proposal_pub;
+    rclcpp::Publisher<ConflictRejection>::SharedPtr rejection_pub;
+    rclcpp::Publisher<ConflictForfeit>::SharedPtr forfeit_pub;
+  };
+
+  using NegotiationRelayMap =
+    std::unordered_map<ParticipantId, NegotiationRelay>;
+  NegotiationRelayMap negotiation_relays;
+
+  // Everything that has been relayed for an open negotiation, in order, so that
+  // participants who get added to the negotiation later can be caught up.
+  struct RelayHistory
+  {
+    ConflictSet recipients;
+    std::vector<std::function<void(const NegotiationRelay&)>> log;
+  };
+
+  std::unordered_map<Version, RelayHistory> relay_histories;
+
+  // The active_conflicts_mutex must be locked when calling these functions.
+  const NegotiationRelay& relay_for(ParticipantId participant);
+  void open_relay(
+    Version conflict_version,
+    const rmf_traffic::schedule::Negotiation& negotiation);
+  void relay(
+    Version conflict_version,
+    std::function<void(const NegotiationRelay&)> publish);
+  void close_relay(Version conflict_version);
+
   using Negotiation = rmf_traffic::schedule::Negotiation;
 
   class ConflictRecord
@@ -409,6 +475,10 @@ public:
   ConflictRecord active_conflicts;
   std::mutex active_conflicts_mutex;
   std::shared_ptr<ParticipantRegistry> participant_registry;
+
+  // This is only used if a directory was given for the write_ahead_log
+  // parameter.
+  std::unique_ptr<WriteAheadLog> write_ahead_log;
 };
 
 } // namespace schedule
@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC_ROS2__SCHEDULE__INTERNAL_WRITEAHEADLOG_HPP
+#define SRC__RMF_TRAFFIC_ROS2__SCHEDULE__INTERNAL_WRITEAHEADLOG_HPP
+
+#include <rmf_traffic/schedule/Database.hpp>
+
+#include <rmf_traffic_msgs/msg/itinerary_clear.hpp>
+#include <rmf_traffic_msgs/msg/itinerary_delay.hpp>
+#include <rmf_traffic_msgs/msg/itinerary_erase.hpp>
+#include <rmf_traffic_msgs/msg/itinerary_extend.hpp>
+#include <rmf_traffic_msgs/msg/itinerary_set.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace rmf_traffic_ros2 {
+namespace schedule {
+
+//==============================================================================
+/// A binary write-ahead log of the itinerary changes that the schedule node
+/// applies to its Database. Each change is appended to the log before it is
+/// applied, using the same message types that the node receives, so that a
+/// restarted schedule node can rebuild its Database without every fleet
+/// needing to resend its itineraries.
+///
+/// Appends are written to the log file right away but flushed to disk in
+/// batches by a background thread, so a crash can lose at most the last
+/// Options::sync_period worth of changes. Participants will fill in anything
+/// that was lost through the usual inconsistency reports.
+///
+/// Every Options::checkpoint_interval records, the caller should write a
+/// checkpoint, which is a compacted copy of the current itineraries. The log
+/// is then restarted, so recovery only needs to replay the checkpoint and the
+/// tail of changes that came after it. With checkpoint_in_background(), the
+/// caller only has to hold the Database still while the itineraries are
+/// captured. The background thread serializes them and flushes them to disk.
+///
+/// Participant registrations are not part of this log. They are kept by the
+/// ParticipantRegistry, which must be restored before recover() is called so
+/// that the participant IDs line up.
+///
+/// This class does not lock the Database. The caller must make sure that
+/// nothing else modifies the Database while write() + the change itself,
+/// checkpoint(), or recover() are running.
+class WriteAheadLog
+{
+public:
+
+  using Database = rmf_traffic::schedule::Database;
+  using ItinerarySet = rmf_traffic_msgs::msg::ItinerarySet;
+  using ItineraryExtend = rmf_traffic_msgs::msg::ItineraryExtend;
+  using ItineraryDelay = rmf_traffic_msgs::msg::ItineraryDelay;
+  using ItineraryErase = rmf_traffic_msgs::msg::ItineraryErase;
+  using ItineraryClear = rmf_traffic_msgs::msg::ItineraryClear;
+
+  struct Options
+  {
+    /// The longest that an appended record will wait before it is flushed to
+    /// disk.
+    std::chrono::milliseconds sync_period = std::chrono::milliseconds(20);
+
+    /// Flush early once this many records are waiting to be flushed.
+    std::size_t sync_batch_size = 256;
+
+    /// checkpoint_due() becomes true once this many records have been written
+    /// since the last checkpoint.
+    std::size_t checkpoint_interval = 10000;
+  };
+
+  struct Recovery
+  {
+    /// Number of itineraries that were restored from the checkpoint
+    std::size_t checkpoint_records = 0;
+
+    /// Number of changes that were replayed from the log after the checkpoint
+    std::size_t log_records = 0;
+
+    /// Number of logged changes that the Database rejected when they were
+    /// replayed. The Database would have rejected them the first time too.
+    std::size_t rejected_records = 0;
+
+    /// True if the end of the log was damaged, most likely by a crash in the
+    /// middle of an append, and had to be cut off.
+    bool truncated_tail = false;
+
+    /// True if the log had been invalidated (see invalidate()). Its files were
+    /// discarded instead of being replayed, so nothing was recovered.
+    bool discarded_invalid = false;
+
+    /// Time spent reading and replaying the checkpoint and the log
+    std::chrono::steady_clock::duration replay_time =
+      std::chrono::steady_clock::duration(0);
+  };
+
+  /// Constructor
+  ///
+  /// \param[in] directory
+  ///   The directory to keep the checkpoint and log files in. It will be
+  ///   created if it does not exist.
+  ///
+  /// \param[in] options
+  ///   Tuning for flushing and checkpoints
+  ///
+  /// \throws std::filesystem::filesystem_error if the directory cannot be
+  /// created.
+  WriteAheadLog(std::string directory, Options options);
+
+  /// Constructor with default Options
+  WriteAheadLog(std::string directory);
+
+  /// Replay the latest checkpoint and the log that follows it into database,
+  /// then write a fresh checkpoint and start a new log. This must be called
+  /// once, before anything is written.
+  ///
+  /// If the log was invalidated, its files are discarded and database is left
+  /// untouched.
+  ///
+  /// \throws std::runtime_error if the checkpoint is damaged or the files
+  /// cannot be opened.
+  Recovery recover(Database& database);
+
+  /// Append a change to the log. Call this before applying the change to the
+  /// Database.
+  void write(const ItinerarySet& set);
+  void write(const ItineraryExtend& extend);
+  void write(const ItineraryDelay& delay);
+  void write(const ItineraryErase& erase);
+  void write(const ItineraryClear& clear);
+
+  /// True when enough records have been written since the last checkpoint that
+  /// a new one should be made.
+  bool checkpoint_due() const;
+
+  /// Write a checkpoint of the itineraries in database and restart the log.
+  /// The database must have every change that has been written to this log
+  /// applied to it.
+  void checkpoint(const Database& database);
+
+  /// Capture the itineraries in database and restart the log right away, like
+  /// checkpoint(), but leave serializing the checkpoint and flushing it to
+  /// disk to the background thread. checkpoint_due() stays false until that
+  /// is finished.
+  ///
+  /// If the background thread fails to write the checkpoint, on_failure is
+  /// called from that thread with a description of the problem. Nothing is
+  /// lost when that happens, because the logs that the checkpoint would have
+  /// replaced are only removed once it is in place.
+  void checkpoint_in_background(
+    const Database& database,
+    std::function<void(const std::string& error)> on_failure);
+
+  /// Flush every record that has been written so far to disk, without waiting
+  /// for the background thread.
+  void sync();
+
+  /// Mark the files of this log as invalid, e.g. because a change could not be
+  /// written to it. The checkpoint and logs no longer match the schedule, so
+  /// the next recover() will discard them instead of restoring a stale
+  /// schedule. Nothing can be written to this log afterwards.
+  ///
+  /// A marker is put in the directory before anything gets removed, so the
+  /// files are refused even if removing them fails.
+  ///
+  /// \param[in] reason
+  ///   A description of why the log is invalid, which is kept in the marker.
+  ///
+  /// 	hrows std::runtime_error if the marker cannot be written.
+  void invalidate(const std::string& reason);
+
+  ~WriteAheadLog();
+
+  enum class RecordType : uint8_t
+  {
+    Set = 1,
+    Extend = 2,
+    Delay = 3,
+    Erase = 4,
+    Clear = 5
+  };
+
+private:
+
+  using ParticipantId = rmf_traffic::schedule::ParticipantId;
+  using ItineraryVersion = rmf_traffic::schedule::ItineraryVersion;
+
+  void _append(
+    RecordType type,
+    ParticipantId participant,
+    ItineraryVersion version,
+    const std::vector<uint8_t>& payload);
+
+  /// Everything that a checkpoint needs from the Database
+  struct PendingCheckpoint
+  {
+    uint64_t generation;
+    rmf_traffic::schedule::Viewer::View routes;
+
+    // The itinerary version that has been applied for each participant
+    std::unordered_map<ParticipantId, ItineraryVersion> applied;
+
+    // Participants that have changes being held back by the Database
+    std::unordered_set<ParticipantId> waiting;
+
+    // The log that this checkpoint replaces. It still needs to be flushed.
+    int previous_fd;
+
+    std::function<void(const std::string&)> on_failure;
+  };
+
+  /// Capture what a checkpoint needs from the Database and start the log that
+  /// will follow it. The Database must not change while this is running.
+  PendingCheckpoint _prepare_checkpoint(const Database& database);
+
+  /// Serialize a checkpoint, flush it to disk, and put it in place of the
+  /// previous one.
+  void _write_checkpoint(PendingCheckpoint checkpoint);
+
+  void _finish_checkpoint();
+
+  void _sync_loop();
+
+  std::string _directory;
+  Options _options;
+
+  mutable std::mutex _mutex;
+  std::condition_variable _sync_cv;
+  std::condition_variable _checkpoint_cv;
+  int _fd = -1;
+  uint64_t _generation = 0;
+  std::size_t _unsynced = 0;
+  std::size_t _records_since_checkpoint = 0;
+  bool _checkpoint_in_progress = false;
+  std::optional<PendingCheckpoint> _pending_checkpoint;
+  bool _quit = false;
+  std::thread _sync_thread;
+};
+
+} // namespace schedule
+} // namespace rmf_traffic_ros2
+
+#endif // SRC__RMF_TRAFFIC_ROS2__SCHEDULE__INTERNAL_WRITEAHEADLOG_HPP
@@ -0,0 +1,290 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic_ros2/Trajectory.hpp>
+
+#include <rmf_utils/catch.hpp>
+
+#include <cstring>
+#include <limits>
+#include <random>
+
+using namespace std::chrono_literals;
+
+namespace {
+//==============================================================================
+rmf_traffic::Trajectory make_random_trajectory(
+  std::mt19937& rng,
+  const std::size_t size)
+{
+  std::uniform_real_distribution<double> coordinate(-500.0, 500.0);
+  std::uniform_real_distribution<double> yaw(-M_PI, M_PI);
+  std::uniform_real_distribution<double> speed(-2.0, 2.0);
+  std::uniform_int_distribution<int64_t> gap(1'000'000, 10'000'000'000);
+
+  rmf_traffic::Trajectory trajectory;
+  auto time = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    time += rmf_traffic::Duration(gap(rng));
+    trajectory.insert(
+      time,
+      {coordinate(rng), coordinate(rng), yaw(rng)},
+      {speed(rng), speed(rng), speed(rng)});
+  }
+
+  return trajectory;
+}
+
+//==============================================================================
+void check_within(
+  const rmf_traffic::Trajectory& original,
+  const rmf_traffic::Trajectory& decoded,
+  const rmf_traffic_ros2::CompactTrajectoryTolerance& tolerance)
+{
+  REQUIRE(decoded.size() == original.size());
+
+  // Leave room for the rounding error of the floating point math itself
+  const double eps = 1e-9;
+  auto it = decoded.begin();
+  for (const auto& wp : original)
+  {
+    const auto time_error = wp.time() - it->time();
+    CHECK(std::abs(time_error.count()) <= tolerance.time.count());
+
+    const Eigen::Vector3d dp = wp.position() - it->position();
+    CHECK(std::abs(dp[0]) <= tolerance.position + eps);
+    CHECK(std::abs(dp[1]) <= tolerance.position + eps);
+    CHECK(std::abs(dp[2]) <= tolerance.yaw + eps);
+
+    const Eigen::Vector3d dv = wp.velocity() - it->velocity();
+    CHECK(std::abs(dv[0]) <= tolerance.velocity + eps);
+    CHECK(std::abs(dv[1]) <= tolerance.velocity + eps);
+    CHECK(std::abs(dv[2]) <= tolerance.angular_velocity + eps);
+
+    ++it;
+  }
+}
+
+//==============================================================================
+void check_exact(
+  const rmf_traffic::Trajectory& original,
+  const rmf_traffic::Trajectory& decoded)
+{
+  rmf_traffic_ros2::CompactTrajectoryTolerance exact;
+  exact.time = rmf_traffic::Duration(0);
+  exact.position = 0.0;
+  exact.yaw = 0.0;
+  exact.velocity = 0.0;
+  exact.angular_velocity = 0.0;
+  check_within(original, decoded, exact);
+}
+
+//==============================================================================
+void put_varint(std::vector<uint8_t>& buffer, uint64_t value)
+{
+  while (value >= 0x80)
+  {
+    buffer.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+
+  buffer.push_back(static_cast<uint8_t>(value));
+}
+
+//==============================================================================
+void put_double(std::vector<uint8_t>& buffer, const double value)
+{
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  for (std::size_t i = 0; i < sizeof(bits); ++i)
+    buffer.push_back(static_cast<uint8_t>(bits >> (8*i)));
+}
+
+//==============================================================================
+/// Hand-craft a packed trajectory whose waypoints all sit at the origin
+rmf_traffic_msgs::msg::Trajectory make_packed(
+  const uint64_t time_step,
+  const std::array<double, 4>& steps,
+  const std::vector<uint64_t>& time_deltas)
+{
+  rmf_traffic_msgs::msg::Trajectory msg;
+  auto& buffer = msg.packed;
+  buffer.push_back(1);
+  put_varint(buffer, time_deltas.size() + 1);
+  put_varint(buffer, time_step);
+  for (const double step : steps)
+    put_double(buffer, step);
+
+  // The first waypoint has a start time instead of a time delta
+  put_varint(buffer, 0);
+  for (std::size_t i = 0; i < 6; ++i)
+    put_varint(buffer, 0);
+
+  for (const uint64_t delta : time_deltas)
+  {
+    put_varint(buffer, delta);
+    for (std::size_t i = 0; i < 6; ++i)
+      put_varint(buffer, 0);
+  }
+
+  return msg;
+}
+} // anonymous namespace
+
+//==============================================================================
+SCENARIO("Compact trajectory encoding")
+{
+  std::mt19937 rng(42);
+  rmf_traffic_ros2::CompactTrajectoryTolerance tolerance;
+
+  WHEN("Trajectories are encoded with the default tolerance")
+  {
+    for (const std::size_t size : {1, 2, 10, 200})
+    {
+      const auto original = make_random_trajectory(rng, size);
+      const auto msg = rmf_traffic_ros2::convert(original, tolerance);
+      CHECK(msg.waypoints.empty());
+      REQUIRE_FALSE(msg.packed.empty());
+
+      check_within(original, rmf_traffic_ros2::convert(msg), tolerance);
+
+      // Each full precision waypoint needs 7 numbers of 8 bytes each
+      if (size >= 10)
+        CHECK(msg.packed.size() < size * 7 * 8 / 2);
+    }
+  }
+
+  WHEN("Trajectories are encoded with a coarse tolerance")
+  {
+    tolerance.time = 50ms;
+    tolerance.position = 0.05;
+    tolerance.yaw = 0.01;
+    tolerance.velocity = 0.1;
+    tolerance.angular_velocity = 0.1;
+
+    for (std::size_t i = 0; i < 20; ++i)
+    {
+      const auto original = make_random_trajectory(rng, 50);
+      const auto msg = rmf_traffic_ros2::convert(original, tolerance);
+      if (msg.packed.empty())
+      {
+        // The random gaps between waypoints can be shorter than the time
+        // tolerance, in which case the trajectory must be sent exactly.
+        check_exact(original, rmf_traffic_ros2::convert(msg));
+        continue;
+      }
+
+      check_within(original, rmf_traffic_ros2::convert(msg), tolerance);
+    }
+  }
+
+  WHEN("Waypoints are too close together for the time tolerance")
+  {
+    rmf_traffic::Trajectory original;
+    const auto start = std::chrono::steady_clock::now();
+    original.insert(start, {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0});
+    original.insert(start + 100us, {0.1, 0.0, 0.0}, {0.0, 0.0, 0.0});
+    original.insert(start + 10s, {5.0, 0.0, 0.0}, {0.0, 0.0, 0.0});
+
+    const auto msg = rmf_traffic_ros2::convert(original, tolerance);
+    CHECK(msg.packed.empty());
+    CHECK(msg.waypoints.size() == 3);
+    check_exact(original, rmf_traffic_ros2::convert(msg));
+  }
+
+  WHEN("The packed buffer is damaged")
+  {
+    const auto original = make_random_trajectory(rng, 10);
+    auto msg = rmf_traffic_ros2::convert(original, tolerance);
+
+    auto truncated = msg;
+    truncated.packed.pop_back();
+    CHECK_THROWS_AS(rmf_traffic_ros2::convert(truncated), std::runtime_error);
+
+    auto padded = msg;
+    padded.packed.push_back(0);
+    CHECK_THROWS_AS(rmf_traffic_ros2::convert(padded), std::runtime_error);
+
+    auto future_format = msg;
+    future_format.packed.front() = 200;
+    CHECK_THROWS_AS(
+      rmf_traffic_ros2::convert(future_format), std::runtime_error);
+  }
+
+  WHEN("The packed header is invalid")
+  {
+    const std::array<double, 4> steps = {1e-3, 1e-3, 1e-3, 1e-3};
+    CHECK(rmf_traffic_ros2::convert(make_packed(1000, steps, {1})).size() == 2);
+
+    CHECK_THROWS_AS(
+      rmf_traffic_ros2::convert(make_packed(0, steps, {1})),
+      std::runtime_error);
+
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    for (const double bad : {0.0, -1e-3, nan})
+    {
+      for (std::size_t i = 0; i < steps.size(); ++i)
+      {
+        auto bad_steps = steps;
+        bad_steps[i] = bad;
+        CHECK_THROWS_AS(
+          rmf_traffic_ros2::convert(make_packed(1000, bad_steps, {1})),
+          std::runtime_error);
+      }
+    }
+
+    // The time count itself overflows
+    const uint64_t half = uint64_t(1) << 62;
+    CHECK_THROWS_AS(
+      rmf_traffic_ros2::convert(make_packed(1, steps, {half, half})),
+      std::runtime_error);
+
+    // The time count fits, but not once it is multiplied by the time step
+    CHECK_THROWS_AS(
+      rmf_traffic_ros2::convert(make_packed(1000, steps, {half})),
+      std::runtime_error);
+  }
+
+  WHEN("The tolerance is not positive")
+  {
+    const auto original = make_random_trajectory(rng, 3);
+    tolerance.position = 0.0;
+    CHECK_THROWS_AS(
+      rmf_traffic_ros2::convert(original, tolerance), std::invalid_argument);
+    CHECK_THROWS_AS(
+      rmf_traffic_ros2::set_default_trajectory_encoding(tolerance),
+      std::invalid_argument);
+  }
+
+  WHEN("A default encoding is chosen")
+  {
+    const auto original = make_random_trajectory(rng, 10);
+    CHECK_FALSE(rmf_traffic_ros2::get_default_trajectory_encoding());
+    CHECK(rmf_traffic_ros2::convert(original).packed.empty());
+
+    rmf_traffic_ros2::set_default_trajectory_encoding(tolerance);
+    REQUIRE(rmf_traffic_ros2::get_default_trajectory_encoding());
+    const auto msg = rmf_traffic_ros2::convert(original);
+    CHECK_FALSE(msg.packed.empty());
+    check_within(original, rmf_traffic_ros2::convert(msg), tolerance);
+
+    rmf_traffic_ros2::set_default_trajectory_encoding(std::nullopt);
+    CHECK_FALSE(rmf_traffic_ros2::get_default_trajectory_encoding());
+    CHECK(rmf_traffic_ros2::convert(original).packed.empty());
+  }
+}
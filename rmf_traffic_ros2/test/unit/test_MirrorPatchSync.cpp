@@ -0,0 +1,251 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "../../src/rmf_traffic_ros2/schedule/internal_MirrorPatchSync.hpp"
+
+#include <rmf_utils/catch.hpp>
+
+#include <utility>
+#include <vector>
+
+using rmf_traffic_ros2::schedule::MirrorPatchSync;
+using Version = MirrorPatchSync::Version;
+
+namespace {
+//==============================================================================
+/// A stand-in for a mirror and the schedule node that it requests updates from
+struct FakeMirror
+{
+  struct Request
+  {
+    Version minimum_version;
+    bool initial_request;
+
+    bool operator==(const Request& other) const
+    {
+      return minimum_version == other.minimum_version
+        && initial_request == other.initial_request;
+    }
+  };
+
+  Version version = 0;
+  std::vector<uint64_t> applied;
+  std::vector<Request> requests;
+  std::vector<std::pair<uint64_t, uint64_t>> gaps;
+
+  MirrorPatchSync sync{
+    [this]() { return version; },
+    [this](Version minimum_version, bool initial_request)
+    {
+      requests.push_back({minimum_version, initial_request});
+    },
+    [this](uint64_t previous, uint64_t received)
+    {
+      gaps.push_back({previous, received});
+    }
+  };
+
+  /// Stream the patch with the given sequence number. Patch n takes the
+  /// mirror from version 10 + n - 1 to version 10 + n.
+  void stream(const uint64_t sequence)
+  {
+    const Version latest = 10 + sequence;
+    sync.receive(
+      MirrorPatchSync::Patch{
+        sequence,
+        latest - 1,
+        latest,
+        [this, sequence, latest]()
+        {
+          applied.push_back(sequence);
+          version = latest;
+        }
+      });
+  }
+
+  /// Answer the last request with the given version of the schedule
+  void reply(const Version reply_version)
+  {
+    REQUIRE(sync.waiting_for_reply());
+    version = reply_version;
+    sync.reply_applied(reply_version);
+  }
+};
+
+using Requests = std::vector<FakeMirror::Request>;
+using Sequences = std::vector<uint64_t>;
+} // anonymous namespace
+
+//==============================================================================
+SCENARIO("Lining up streamed patches with a mirror")
+{
+  FakeMirror mirror;
+
+  GIVEN("A mirror that has not been synced yet")
+  {
+    // Even a patch that lines up with the mirror cannot be trusted until the
+    // initial request has been answered.
+    mirror.version = 10;
+    mirror.stream(1);
+    CHECK(mirror.applied.empty());
+    CHECK(mirror.requests == Requests{{11, true}});
+    CHECK(mirror.sync.waiting_for_reply());
+
+    WHEN("More patches arrive before the reply")
+    {
+      mirror.stream(2);
+      mirror.stream(3);
+      CHECK(mirror.sync.held_patches() == 2);
+      CHECK(mirror.requests.size() == 1);
+
+      THEN("The patches that the reply covers are skipped")
+      {
+        mirror.reply(12);
+        CHECK(mirror.applied == Sequences{3});
+        CHECK(mirror.version == 13);
+        CHECK(mirror.sync.held_patches() == 0);
+        CHECK_FALSE(mirror.sync.waiting_for_reply());
+        CHECK(mirror.requests.size() == 1);
+      }
+    }
+  }
+
+  GIVEN("A mirror that has been synced")
+  {
+    mirror.stream(1);
+    mirror.reply(11);
+    mirror.requests.clear();
+    REQUIRE(mirror.applied.empty());
+
+    WHEN("Patches arrive in order")
+    {
+      mirror.stream(2);
+      mirror.stream(3);
+      mirror.stream(4);
+      CHECK(mirror.applied == Sequences{2, 3, 4});
+      CHECK(mirror.version == 14);
+      CHECK(mirror.requests.empty());
+      CHECK(mirror.gaps.empty());
+    }
+
+    WHEN("A patch is missed")
+    {
+      mirror.stream(3);
+      CHECK(mirror.applied.empty());
+      CHECK(mirror.requests == Requests{{13, false}});
+      CHECK(mirror.gaps == std::vector<std::pair<uint64_t, uint64_t>>{{1, 3}});
+
+      mirror.stream(4);
+      mirror.stream(5);
+      CHECK(mirror.sync.held_patches() == 2);
+
+      THEN("The held patches are applied after the reply")
+      {
+        mirror.reply(13);
+        CHECK(mirror.applied == Sequences{4, 5});
+        CHECK(mirror.version == 15);
+      }
+    }
+
+    WHEN("A patch is received twice")
+    {
+      mirror.stream(2);
+      mirror.stream(2);
+      CHECK(mirror.applied == Sequences{2});
+      CHECK(mirror.version == 12);
+      CHECK(mirror.requests.empty());
+    }
+
+    WHEN("Patches arrive out of order")
+    {
+      mirror.stream(3);
+      CHECK(mirror.requests == Requests{{13, false}});
+
+      // The patch that was skipped over arrives while the mirror is waiting
+      // for its reply
+      mirror.stream(2);
+      mirror.stream(4);
+      CHECK(mirror.sync.held_patches() == 2);
+
+      mirror.reply(13);
+      CHECK(mirror.applied == Sequences{4});
+      CHECK(mirror.version == 14);
+      CHECK(mirror.requests.size() == 1);
+    }
+
+    WHEN("An update is requested while a reply is pending")
+    {
+      mirror.stream(3);
+      CHECK_FALSE(mirror.sync.request(20));
+      mirror.stream(4);
+
+      THEN("Another request is sent if the reply falls short")
+      {
+        mirror.reply(13);
+        CHECK(mirror.requests == Requests{{13, false}, {20, false}});
+        CHECK(mirror.sync.waiting_for_reply());
+        CHECK(mirror.sync.held_patches() == 1);
+        CHECK(mirror.applied.empty());
+
+        mirror.reply(20);
+        CHECK(mirror.applied.empty());
+        CHECK(mirror.sync.held_patches() == 0);
+      }
+
+      THEN("No other request is sent if the reply reaches far enough")
+      {
+        mirror.reply(20);
+        CHECK(mirror.requests.size() == 1);
+        CHECK(mirror.applied.empty());
+        CHECK(mirror.sync.held_patches() == 0);
+      }
+    }
+
+    WHEN("A reply cannot be applied")
+    {
+      mirror.stream(3);
+      mirror.stream(4);
+      REQUIRE(mirror.sync.held_patches() == 1);
+
+      mirror.sync.reply_failed();
+      CHECK_FALSE(mirror.sync.waiting_for_reply());
+      CHECK(mirror.sync.held_patches() == 0);
+      CHECK(mirror.applied.empty());
+
+      THEN("The next patch that does not line up triggers another request")
+      {
+        mirror.stream(5);
+        CHECK(mirror.requests == Requests{{13, false}, {15, false}});
+      }
+    }
+
+    WHEN("The stream is reset")
+    {
+      mirror.stream(3);
+      mirror.stream(4);
+      mirror.sync.reset_stream();
+      CHECK(mirror.sync.held_patches() == 0);
+
+      // The sequence starts over without being reported as a gap
+      mirror.gaps.clear();
+      mirror.reply(13);
+      mirror.stream(4);
+      CHECK(mirror.gaps.empty());
+      CHECK(mirror.applied == Sequences{4});
+    }
+  }
+}
@@ -0,0 +1,623 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "../../src/rmf_traffic_ros2/schedule/internal_WriteAheadLog.hpp"
+
+#include <rmf_traffic_ros2/Trajectory.hpp>
+#include <rmf_traffic_ros2/schedule/Writer.hpp>
+
+#include <rmf_traffic/geometry/Circle.hpp>
+#include <rmf_traffic/schedule/Query.hpp>
+
+#include <rmf_utils/catch.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+using rmf_traffic_ros2::schedule::WriteAheadLog;
+using Database = rmf_traffic::schedule::Database;
+using namespace std::chrono_literals;
+
+namespace {
+//==============================================================================
+void register_participants(Database& database, const std::size_t count)
+{
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(0.5)
+  };
+
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    database.register_participant(
+      rmf_traffic::schedule::ParticipantDescription{
+        "participant " + std::to_string(i),
+        "test_WriteAheadLog",
+        rmf_traffic::schedule::ParticipantDescription::Rx::Responsive,
+        profile
+      });
+  }
+}
+
+//==============================================================================
+std::vector<rmf_traffic_msgs::msg::ScheduleWriterItem> make_routes(
+  const rmf_traffic::RouteId first_id,
+  const std::size_t count,
+  const double offset)
+{
+  const auto start = rmf_traffic::Time(10min);
+  rmf_traffic::schedule::Writer::Input input;
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    const double x = offset + static_cast<double>(i);
+    rmf_traffic::Trajectory trajectory;
+    trajectory.insert(start, {x, 0.0, 0.0}, {0.0, 0.0, 0.0});
+    trajectory.insert(start + 30s, {x, 10.0, 0.0}, {0.0, 0.0, 0.0});
+    input.push_back(
+      {
+        first_id + i,
+        std::make_shared<rmf_traffic::Route>("L1", std::move(trajectory))
+      });
+  }
+
+  return rmf_traffic_ros2::convert(input);
+}
+
+//==============================================================================
+/// Log each change before applying it, the same way the schedule node does.
+class LoggedDatabase
+{
+public:
+
+  LoggedDatabase(Database& database, WriteAheadLog& log)
+  : _database(database),
+    _log(log)
+  {
+    // Do nothing
+  }
+
+  void set(
+    const uint64_t participant,
+    const uint64_t version,
+    std::vector<rmf_traffic_msgs::msg::ScheduleWriterItem> itinerary)
+  {
+    WriteAheadLog::ItinerarySet msg;
+    msg.participant = participant;
+    msg.itinerary = std::move(itinerary);
+    msg.itinerary_version = version;
+    _log.write(msg);
+    _database.set(
+      participant, rmf_traffic_ros2::convert(msg.itinerary), version);
+  }
+
+  void extend(
+    const uint64_t participant,
+    const uint64_t version,
+    std::vector<rmf_traffic_msgs::msg::ScheduleWriterItem> routes)
+  {
+    WriteAheadLog::ItineraryExtend msg;
+    msg.participant = participant;
+    msg.routes = std::move(routes);
+    msg.itinerary_version = version;
+    _log.write(msg);
+    _database.extend(
+      participant, rmf_traffic_ros2::convert(msg.routes), version);
+  }
+
+  void delay(
+    const uint64_t participant,
+    const uint64_t version,
+    const rmf_traffic::Duration delay)
+  {
+    WriteAheadLog::ItineraryDelay msg;
+    msg.participant = participant;
+    msg.delay = delay.count();
+    msg.itinerary_version = version;
+    _log.write(msg);
+    _database.delay(participant, delay, version);
+  }
+
+  void erase(
+    const uint64_t participant,
+    const uint64_t version,
+    const std::vector<rmf_traffic::RouteId>& routes)
+  {
+    WriteAheadLog::ItineraryErase msg;
+    msg.participant = participant;
+    msg.routes.assign(routes.begin(), routes.end());
+    msg.itinerary_version = version;
+    _log.write(msg);
+    _database.erase(participant, routes, version);
+  }
+
+  void clear(const uint64_t participant, const uint64_t version)
+  {
+    WriteAheadLog::ItineraryClear msg;
+    msg.participant = participant;
+    msg.itinerary_version = version;
+    _log.write(msg);
+    _database.erase(participant, version);
+  }
+
+private:
+  Database& _database;
+  WriteAheadLog& _log;
+};
+
+//==============================================================================
+using RouteKey = std::pair<uint64_t, rmf_traffic::RouteId>;
+using RouteSummary =
+  std::tuple<std::string, rmf_traffic::Time, rmf_traffic::Time, std::size_t>;
+
+std::map<RouteKey, RouteSummary> summarize(const Database& database)
+{
+  std::map<RouteKey, RouteSummary> summary;
+  for (const auto& element : database.query(rmf_traffic::schedule::query_all()))
+  {
+    const auto& trajectory = element.route.trajectory();
+    summary[{element.participant, element.route_id}] = RouteSummary{
+      element.route.map(),
+      *trajectory.start_time(),
+      *trajectory.finish_time(),
+      trajectory.size()
+    };
+  }
+
+  return summary;
+}
+
+//==============================================================================
+void check_same_schedule(const Database& original, const Database& recovered)
+{
+  CHECK(summarize(original) == summarize(recovered));
+
+  for (const auto participant : original.participant_ids())
+  {
+    CHECK(original.itinerary_version(participant)
+      == recovered.itinerary_version(participant));
+  }
+}
+
+//==============================================================================
+std::filesystem::path make_directory(const std::string& name)
+{
+  const auto directory = std::filesystem::temp_directory_path() / name;
+  std::filesystem::remove_all(directory);
+  return directory;
+}
+
+//==============================================================================
+std::filesystem::path latest_log(const std::filesystem::path& directory)
+{
+  std::filesystem::path latest;
+  for (const auto& entry : std::filesystem::directory_iterator(directory))
+  {
+    const auto name = entry.path().filename().string();
+    if (name.rfind("log.", 0) == 0 && (latest.empty() || latest < entry.path()))
+      latest = entry.path();
+  }
+
+  return latest;
+}
+} // anonymous namespace
+
+//==============================================================================
+SCENARIO("Recover a schedule from its write-ahead log")
+{
+  const auto directory = make_directory("test_WriteAheadLog");
+  WriteAheadLog::Options options;
+  options.checkpoint_interval = 1000;
+
+  Database original;
+  register_participants(original, 3);
+
+  {
+    WriteAheadLog log(directory.string(), options);
+    const auto recovery = log.recover(original);
+    CHECK(recovery.checkpoint_records == 0);
+    CHECK(recovery.log_records == 0);
+
+    LoggedDatabase logged(original, log);
+    logged.set(0, 0, make_routes(0, 3, 0.0));
+    logged.set(1, 0, make_routes(0, 2, 10.0));
+    logged.delay(0, 1, 5s);
+    logged.extend(1, 1, make_routes(2, 2, 20.0));
+    logged.erase(0, 2, {1});
+    logged.set(2, 0, make_routes(0, 1, 30.0));
+    logged.clear(2, 1);
+
+    // Version 4 arrives before version 3, so it should be held back by the
+    // database, and the recovered database should do the same.
+    logged.delay(1, 3, 10s);
+  }
+
+  WHEN("The log is replayed")
+  {
+    Database recovered;
+    register_participants(recovered, 3);
+
+    WriteAheadLog log(directory.string(), options);
+    const auto recovery = log.recover(recovered);
+    CHECK(recovery.checkpoint_records == 0);
+    CHECK(recovery.log_records == 8);
+    CHECK(recovery.rejected_records == 0);
+    CHECK_FALSE(recovery.truncated_tail);
+
+    check_same_schedule(original, recovered);
+    CHECK(recovered.get_itinerary(0)->size() == 2);
+    CHECK(recovered.get_itinerary(2)->empty());
+
+    const auto inconsistency = recovered.inconsistencies().find(1);
+    REQUIRE(inconsistency != recovered.inconsistencies().end());
+    CHECK(inconsistency->ranges.size() == 1);
+
+    THEN("The recovery was compacted into a checkpoint")
+    {
+      LoggedDatabase logged(recovered, log);
+      logged.delay(1, 2, 1s);
+      logged.set(0, 3, make_routes(5, 1, 40.0));
+      original.delay(1, 1s, 2);
+      original.set(0, rmf_traffic_ros2::convert(make_routes(5, 1, 40.0)), 3);
+
+      Database again;
+      register_participants(again, 3);
+      WriteAheadLog log_again(directory.string(), options);
+      const auto recovery_again = log_again.recover(again);
+
+      // Participant 1 still had a change waiting on an inconsistency at the
+      // time of the checkpoint, so that change was carried into the
+      // checkpoint. Participant 2 has an empty itinerary but its version still
+      // needs to be kept.
+      CHECK(recovery_again.checkpoint_records == 4);
+      CHECK(recovery_again.log_records == 2);
+      check_same_schedule(original, again);
+    }
+  }
+
+  WHEN("The end of the log is damaged")
+  {
+    {
+      std::ofstream file(latest_log(directory), std::ios::binary |
+        std::ios::app);
+      const char garbage[] = {5, 0, 0, 0, 1, 2, 3, 4, 1, 'x'};
+      file.write(garbage, sizeof(garbage));
+    }
+
+    Database recovered;
+    register_participants(recovered, 3);
+
+    WriteAheadLog log(directory.string(), options);
+    const auto recovery = log.recover(recovered);
+    CHECK(recovery.log_records == 8);
+    CHECK(recovery.truncated_tail);
+    check_same_schedule(original, recovered);
+  }
+
+  WHEN("A change is rejected by the database")
+  {
+    Database live;
+    register_participants(live, 3);
+    {
+      WriteAheadLog log(directory.string(), options);
+      log.recover(live);
+
+      // Route 0 of participant 0 is already in its itinerary
+      LoggedDatabase logged(live, log);
+      CHECK_THROWS(logged.extend(0, 3, make_routes(0, 1, 50.0)));
+    }
+
+    Database recovered;
+    register_participants(recovered, 3);
+
+    WriteAheadLog log(directory.string(), options);
+    const auto recovery = log.recover(recovered);
+    CHECK(recovery.log_records == 1);
+    CHECK(recovery.rejected_records == 1);
+
+    // The rejection should play out the same way that it did originally
+    check_same_schedule(live, recovered);
+    CHECK(summarize(original) == summarize(recovered));
+  }
+
+  std::filesystem::remove_all(directory);
+}
+
+//==============================================================================
+SCENARIO("Periodic checkpoints of the write-ahead log")
+{
+  const auto directory = make_directory("test_WriteAheadLog_checkpoints");
+  WriteAheadLog::Options options;
+  options.checkpoint_interval = 4;
+
+  Database original;
+  register_participants(original, 2);
+
+  {
+    WriteAheadLog log(directory.string(), options);
+    log.recover(original);
+
+    LoggedDatabase logged(original, log);
+    uint64_t version = 0;
+    for (std::size_t i = 0; i < 10; ++i)
+    {
+      logged.set(i % 2, version, make_routes(10*i, 2, static_cast<double>(i)));
+      if (i % 2 == 1)
+        ++version;
+
+      if (log.checkpoint_due())
+        log.checkpoint(original);
+    }
+
+    log.sync();
+  }
+
+  // Only the checkpoint and the log that follows it should be left over
+  std::size_t files = 0;
+  for (const auto& entry : std::filesystem::directory_iterator(directory))
+  {
+    (void)(entry);
+    ++files;
+  }
+  CHECK(files == 2);
+
+  Database recovered;
+  register_participants(recovered, 2);
+  WriteAheadLog log(directory.string(), options);
+  const auto recovery = log.recover(recovered);
+  CHECK(recovery.checkpoint_records == 2);
+  CHECK(recovery.log_records == 2);
+  check_same_schedule(original, recovered);
+
+  std::filesystem::remove_all(directory);
+}
+
+//==============================================================================
+SCENARIO("Background checkpoints of the write-ahead log")
+{
+  const auto directory =
+    make_directory("test_WriteAheadLog_background_checkpoints");
+  WriteAheadLog::Options options;
+  options.checkpoint_interval = 4;
+
+  Database original;
+  register_participants(original, 2);
+
+  std::vector<std::string> failures;
+  std::mutex failures_mutex;
+  const auto on_failure = [&](const std::string& error)
+    {
+      std::lock_guard<std::mutex> lock(failures_mutex);
+      failures.push_back(error);
+    };
+
+  std::size_t checkpoints = 0;
+  {
+    WriteAheadLog log(directory.string(), options);
+    log.recover(original);
+
+    LoggedDatabase logged(original, log);
+    uint64_t version = 0;
+    for (std::size_t i = 0; i < 10; ++i)
+    {
+      logged.set(i % 2, version, make_routes(10*i, 2, static_cast<double>(i)));
+      if (i % 2 == 1)
+        ++version;
+
+      if (log.checkpoint_due())
+      {
+        log.checkpoint_in_background(original, on_failure);
+        ++checkpoints;
+      }
+    }
+
+    // Destroying the log finishes any checkpoint that is still in progress
+  }
+
+  CHECK(checkpoints > 0);
+  CHECK(failures.empty());
+
+  // Only the checkpoint and the log that follows it should be left over
+  std::size_t files = 0;
+  for (const auto& entry : std::filesystem::directory_iterator(directory))
+  {
+    (void)(entry);
+    ++files;
+  }
+  CHECK(files == 2);
+
+  Database recovered;
+  register_participants(recovered, 2);
+  WriteAheadLog log(directory.string(), options);
+  const auto recovery = log.recover(recovered);
+  CHECK(recovery.checkpoint_records == 2);
+  check_same_schedule(original, recovered);
+
+  std::filesystem::remove_all(directory);
+}
+
+//==============================================================================
+SCENARIO("Checkpoints keep full precision with a compact trajectory encoding")
+{
+  const auto directory = make_directory("test_WriteAheadLog_full_precision");
+  WriteAheadLog::Options options;
+  options.checkpoint_interval = 1000;
+
+  Database original;
+  register_participants(original, 1);
+
+  // None of these values lie on the steps of the compact encoding
+  const auto start = rmf_traffic::Time(10min + 123457ns);
+  rmf_traffic::Trajectory trajectory;
+  trajectory.insert(
+    start, {0.123456789, -1.987654321, 0.314159}, {0.1234567, 0.0, 0.0});
+  trajectory.insert(
+    start + 12345678901ns, {5.000000123, 3.3333333, -1.2345678},
+    {0.0, -0.7654321, 0.0101010});
+
+  rmf_traffic::schedule::Writer::Input input;
+  input.push_back(
+    {0, std::make_shared<rmf_traffic::Route>("L1", trajectory)});
+  auto routes = rmf_traffic_ros2::convert(input);
+
+  // Make sure the compact encoding is switched off again even if a check fails
+  struct CompactEncoding
+  {
+    CompactEncoding()
+    {
+      rmf_traffic_ros2::set_default_trajectory_encoding(
+        rmf_traffic_ros2::CompactTrajectoryTolerance());
+    }
+
+    ~CompactEncoding()
+    {
+      rmf_traffic_ros2::set_default_trajectory_encoding(std::nullopt);
+    }
+  };
+
+  {
+    WriteAheadLog log(directory.string(), options);
+    log.recover(original);
+
+    LoggedDatabase logged(original, log);
+    logged.set(0, 0, std::move(routes));
+
+    const CompactEncoding compact;
+    REQUIRE(rmf_traffic_ros2::get_default_trajectory_encoding());
+
+    // The compact encoding would not convert this trajectory back exactly
+    const auto compact_msg = rmf_traffic_ros2::convert(trajectory);
+    CHECK_FALSE(compact_msg.packed.empty());
+
+    log.checkpoint(original);
+    log.sync();
+  }
+
+  Database recovered;
+  register_participants(recovered, 1);
+  WriteAheadLog log(directory.string(), options);
+  const auto recovery = log.recover(recovered);
+  CHECK(recovery.checkpoint_records == 1);
+  CHECK(recovery.log_records == 0);
+  check_same_schedule(original, recovered);
+
+  const auto itinerary = recovered.get_itinerary(0);
+  REQUIRE(itinerary);
+  REQUIRE(itinerary->size() == 1);
+  const auto& recovered_trajectory = itinerary->front()->trajectory();
+  REQUIRE(recovered_trajectory.size() == trajectory.size());
+  for (std::size_t i = 0; i < trajectory.size(); ++i)
+  {
+    const auto& expected = trajectory[i];
+    const auto& actual = recovered_trajectory[i];
+    CHECK(actual.time() == expected.time());
+    CHECK(actual.position() == expected.position());
+    CHECK(actual.velocity() == expected.velocity());
+  }
+
+  std::filesystem::remove_all(directory);
+}
+
+//==============================================================================
+SCENARIO("An invalidated write-ahead log is not recovered")
+{
+  const auto directory = make_directory("test_WriteAheadLog_invalidated");
+  WriteAheadLog::Options options;
+  options.checkpoint_interval = 1000;
+
+  Database original;
+  register_participants(original, 2);
+
+  const auto checkpoint_path = directory / "checkpoint";
+  const auto stale_path = directory.parent_path()
+    / "test_WriteAheadLog_invalidated_stale_checkpoint";
+  std::filesystem::remove(stale_path);
+
+  {
+    WriteAheadLog log(directory.string(), options);
+    log.recover(original);
+
+    LoggedDatabase logged(original, log);
+    logged.set(0, 0, make_routes(0, 2, 0.0));
+    log.checkpoint(original);
+    logged.set(1, 0, make_routes(0, 1, 10.0));
+    log.sync();
+
+    // Keep a copy of the checkpoint to put back in place after it has been
+    // removed, as if removing it had failed.
+    std::filesystem::copy_file(checkpoint_path, stale_path);
+
+    // This is what the schedule node does when a change cannot be written
+    log.invalidate("a change could not be written");
+    CHECK(std::filesystem::exists(directory / "invalid"));
+    CHECK_FALSE(std::filesystem::exists(checkpoint_path));
+    CHECK(latest_log(directory).empty());
+
+    WriteAheadLog::ItineraryClear clear;
+    clear.participant = 0;
+    clear.itinerary_version = 1;
+    CHECK_THROWS(log.write(clear));
+  }
+
+  WHEN("The log is recovered")
+  {
+    Database recovered;
+    register_participants(recovered, 2);
+
+    WriteAheadLog log(directory.string(), options);
+    const auto recovery = log.recover(recovered);
+    CHECK(recovery.discarded_invalid);
+    CHECK(recovery.checkpoint_records == 0);
+    CHECK(recovery.log_records == 0);
+    CHECK(summarize(recovered).empty());
+    CHECK_FALSE(std::filesystem::exists(directory / "invalid"));
+
+    THEN("The fresh log can be used and recovered normally")
+    {
+      LoggedDatabase logged(recovered, log);
+      logged.set(1, 0, make_routes(0, 3, 20.0));
+      log.sync();
+
+      Database again;
+      register_participants(again, 2);
+      WriteAheadLog log_again(directory.string(), options);
+      const auto recovery_again = log_again.recover(again);
+      CHECK_FALSE(recovery_again.discarded_invalid);
+      CHECK(recovery_again.log_records == 1);
+      check_same_schedule(recovered, again);
+    }
+  }
+
+  WHEN("The stale files could not be removed")
+  {
+    std::filesystem::copy_file(stale_path, checkpoint_path);
+
+    Database recovered;
+    register_participants(recovered, 2);
+
+    WriteAheadLog log(directory.string(), options);
+    const auto recovery = log.recover(recovered);
+    CHECK(recovery.discarded_invalid);
+    CHECK(recovery.checkpoint_records == 0);
+    CHECK(summarize(recovered).empty());
+  }
+
+  std::filesystem::remove(stale_path);
+  std::filesystem::remove_all(directory);
+}